@@ -0,0 +1,57 @@
+#ifndef ASTAR_H
+#define ASTAR_H
+
+#include <cmath>
+
+#include "RoadGraph.h"
+#include "ArcWeights.h"
+#include "SearchSpace.h"
+
+namespace astar {
+
+/* Point to point search guided by straight line estimate. Profile is a
+policy type from routing_profile namespace, its estimate is inlined into
+the loop. Returns false if target is unreachable. Path is left in search_space */
+template <typename Profile>
+bool Search(const RoadGraph& road_graph, const ArcWeights& arc_weights,
+            const uint32_t source, const uint32_t target, SearchSpace& search_space)
+{
+    const auto target_point = road_graph.VertexPoint(target);
+    const auto estimate = [&road_graph, &target_point](const uint32_t vertex) {
+        const auto& point = road_graph.VertexPoint(vertex);
+        return routing_profile::EstimateCost<Profile>(std::hypot(point.x - target_point.x, point.y - target_point.y));
+    };
+
+    search_space.Clear();
+    search_space.Relax(source, 0, estimate(source), SearchSpace::kNoVertex, SearchSpace::kNoVertex);
+
+    uint32_t vertex, head;
+    float weight;
+    double cost, head_cost;
+    for (; search_space.PopMin(vertex);)
+    {
+        if (vertex == target)
+            return true;
+
+        cost = search_space.Cost(vertex);
+        for (auto arc = road_graph.FirstArc(vertex); arc < road_graph.FirstArc(vertex + 1); arc++)
+        {
+            weight = arc_weights.Weight(arc);
+            if (!ArcWeights::IsAccessible(weight))
+                continue;
+
+            head = road_graph.ArcHead(arc);
+            if (search_space.IsSettled(head))
+                continue;
+
+            head_cost = cost + weight;
+            search_space.Relax(head, head_cost, head_cost + estimate(head), vertex, arc);
+        }
+    }
+
+    return false;
+}
+
+} // namespace astar
+
+#endif // ASTAR_H
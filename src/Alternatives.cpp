@@ -0,0 +1,211 @@
+#include "Alternatives.h"
+
+#include <algorithm>
+
+#include "Bidirectional.h"
+#include "Dijkstra.h"
+
+//! Relative tolerance of float arc weights summed in different order
+constexpr double kAlternativeCostTolerance { 1e-6 };
+//! Edge belongs to one of the chosen routes
+constexpr char kChosenEdgeMark { 1 };
+//! Edge is used by candidate under evaluation, second use means the path is not simple
+constexpr char kCandidateEdgeMark { 2 };
+
+struct Candidate
+{
+    double cost;
+    //! Cost of plateau around via vertex
+    double plateau_cost;
+    uint32_t via_vertex;
+};
+
+/* T-test: takes vertices u before and w after via vertex, each about half of
+test length away along the path, and checks that path between them is
+shortest. Proves that detour around via vertex is not an artificial one */
+bool IsLocallyOptimal(const RoadGraph& road_graph, const ArcWeights& arc_weights, const std::vector<uint32_t>& path_arcs,
+                      const size_t via_arc_index, const double test_cost, SearchSpace& local_search_space)
+{
+    // via_arc_index is number of arcs before via vertex
+    auto first_arc = via_arc_index;
+    auto cost_before = 0.0;
+    for (; first_arc > 0 && cost_before < test_cost / 2;)
+        cost_before += arc_weights.Weight(path_arcs[--first_arc]);
+
+    auto end_arc = via_arc_index;
+    auto cost_after = 0.0;
+    for (; end_arc < path_arcs.size() && cost_after < test_cost / 2;)
+        cost_after += arc_weights.Weight(path_arcs[end_arc++]);
+
+    if (first_arc == end_arc)
+        return true;
+
+    const auto start_vertex = road_graph.ArcHead(road_graph.ReverseArc(path_arcs[first_arc]));
+    const auto end_vertex = road_graph.ArcHead(path_arcs[end_arc - 1]);
+
+    dijkstra::StartSearch(start_vertex, local_search_space);
+    if (!dijkstra::SearchUntilSettled(road_graph, arc_weights, end_vertex, false, local_search_space))
+        return false;
+
+    const auto subpath_cost = cost_before + cost_after;
+    return local_search_space.Cost(end_vertex) >= subpath_cost - kAlternativeCostTolerance * subpath_cost;
+}
+
+namespace alternatives {
+
+Marks::Marks(const size_t vertex_count, const size_t edge_count)
+    : edge_stamps_(edge_count, 0), edge_marks_(edge_count, 0), vertex_stamps_(vertex_count, 0)
+{
+
+}
+
+void Marks::Clear()
+{
+    stamp_++;
+
+    // On overflow old stamps could be mistaken for current ones
+    if (stamp_ == 0)
+    {
+        std::fill(edge_stamps_.begin(), edge_stamps_.end(), 0);
+        std::fill(vertex_stamps_.begin(), vertex_stamps_.end(), 0);
+        stamp_ = 1;
+    }
+}
+
+void Find(const RoadGraph& road_graph, const ArcWeights& arc_weights, const uint32_t source, const uint32_t target,
+          const size_t max_route_count, const Limits& limits, const double cost_per_distance,
+          SearchSpace& forward_search_space, SearchSpace& backward_search_space, SearchSpace& local_search_space,
+          Marks& marks, std::vector<Route>& routes)
+{
+    routes.clear();
+    if (max_route_count == 0 || source == target)
+        return;
+
+    uint32_t meeting_vertex;
+    const auto shortest_cost = bidirectional::Search(road_graph, arc_weights, source, target, limits.max_stretch,
+                                                     forward_search_space, backward_search_space, meeting_vertex, cost_per_distance);
+    if (meeting_vertex == SearchSpace::kNoVertex)
+        return;
+
+    auto shortest_route = Route { shortest_cost, {} };
+    bidirectional::BuildArcPath(road_graph, forward_search_space, backward_search_space, meeting_vertex, shortest_route.arcs);
+    routes.push_back(std::move(shortest_route));
+
+    // Sharing is measured per edge, so direction in which road is used does not matter
+    marks.Clear();
+    const auto choose = [&](const std::vector<uint32_t>& path_arcs) {
+        for (const auto arc : path_arcs)
+        {
+            marks.SetEdgeMark(road_graph.ArcEdge(arc), kChosenEdgeMark);
+            marks.CoverVertex(road_graph.ArcHead(arc));
+        }
+    };
+
+    marks.CoverVertex(source);
+    choose(routes.front().arcs);
+
+    const auto is_in_both_trees = [&](const uint32_t vertex) {
+        return forward_search_space.IsSettled(vertex) && backward_search_space.IsSettled(vertex);
+    };
+    // Both trees use the same arc from vertex to next_vertex
+    const auto is_plateau_arc = [&](const uint32_t vertex, const uint32_t next_vertex) {
+        return vertex != SearchSpace::kNoVertex && next_vertex != SearchSpace::kNoVertex && is_in_both_trees(next_vertex)
+            && forward_search_space.ParentVertex(next_vertex) == vertex && backward_search_space.ParentVertex(vertex) == next_vertex;
+    };
+
+    /* Plateaus within stretch are found from their first vertices, cost is the
+    same along each of them. Vertex in both trees is settled by forward one */
+    const auto max_cost = limits.max_stretch * shortest_cost;
+    const auto min_plateau_cost = limits.min_plateau * shortest_cost;
+    auto candidates = std::vector<Candidate>();
+    for (const auto vertex : forward_search_space.SettledVertices())
+    {
+        if (!is_in_both_trees(vertex) || is_plateau_arc(forward_search_space.ParentVertex(vertex), vertex))
+            continue;
+
+        const auto cost = forward_search_space.Cost(vertex) + backward_search_space.Cost(vertex);
+        if (cost > max_cost)
+            continue;
+
+        auto last_vertex = vertex;
+        for (; is_plateau_arc(last_vertex, backward_search_space.ParentVertex(last_vertex));)
+            last_vertex = backward_search_space.ParentVertex(last_vertex);
+
+        const auto start_cost = forward_search_space.Cost(vertex);
+        const auto plateau_cost = forward_search_space.Cost(last_vertex) - start_cost;
+        if (plateau_cost < min_plateau_cost)
+            continue;
+
+        auto via_vertex = vertex;
+        for (; forward_search_space.Cost(via_vertex) < start_cost + plateau_cost / 2;)
+            via_vertex = backward_search_space.ParentVertex(via_vertex);
+
+        candidates.push_back(Candidate { cost, plateau_cost, via_vertex });
+    }
+
+    // Of equally long candidates the one with longer plateau is more likely to be admissible
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& candidate, const Candidate& other) {
+        return candidate.cost < other.cost || (candidate.cost == other.cost && candidate.plateau_cost > other.plateau_cost);
+    });
+
+    const auto test_cost = limits.local_optimality * shortest_cost;
+    auto path_arcs = std::vector<uint32_t>();
+    for (const auto& candidate : candidates)
+    {
+        if (routes.size() >= max_route_count)
+            break;
+
+        const auto via_vertex = candidate.via_vertex;
+        if (marks.IsVertexCovered(via_vertex))
+            continue;
+
+        bidirectional::BuildArcPath(road_graph, forward_search_space, backward_search_space, via_vertex, path_arcs);
+
+        // Concatenation of two trees may run along the same road back and forth
+        auto is_simple = true;
+        auto shared_cost = 0.0;
+        for (const auto arc : path_arcs)
+        {
+            const auto edge_mark = marks.EdgeMark(road_graph.ArcEdge(arc));
+            if (edge_mark == kCandidateEdgeMark)
+            {
+                is_simple = false;
+                break;
+            }
+
+            if (edge_mark == kChosenEdgeMark)
+                shared_cost += arc_weights.Weight(arc);
+            else
+                marks.SetEdgeMark(road_graph.ArcEdge(arc), kCandidateEdgeMark);
+        }
+
+        // Marks of the candidate are released, chosen edges keep theirs
+        for (const auto arc : path_arcs)
+        {
+            if (marks.EdgeMark(road_graph.ArcEdge(arc)) == kCandidateEdgeMark)
+                marks.SetEdgeMark(road_graph.ArcEdge(arc), 0);
+        }
+
+        if (!is_simple || shared_cost > limits.max_sharing * candidate.cost)
+            continue;
+
+        // Subpath crossing via vertex and not longer than plateau starts or ends on it, so it is shortest
+        if (candidate.plateau_cost < test_cost)
+        {
+            // Forward part of the path ends at via vertex
+            auto via_arc_index = size_t(0);
+            for (auto vertex = via_vertex; forward_search_space.ParentVertex(vertex) != SearchSpace::kNoVertex; vertex = forward_search_space.ParentVertex(vertex))
+                via_arc_index++;
+
+            if (!IsLocallyOptimal(road_graph, arc_weights, path_arcs, via_arc_index, test_cost, local_search_space))
+                continue;
+        }
+
+        // Only accepted paths cover their vertices, rejected ones must not hide via vertices that could pass
+        choose(path_arcs);
+
+        routes.push_back(Route { candidate.cost, path_arcs });
+    }
+}
+
+} // namespace alternatives
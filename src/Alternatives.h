@@ -0,0 +1,75 @@
+#ifndef ALTERNATIVES_H
+#define ALTERNATIVES_H
+
+#include "RoadGraph.h"
+#include "ArcWeights.h"
+#include "SearchSpace.h"
+
+namespace alternatives {
+
+//! Limits of admissible alternative, costs are relative to shortest path cost
+struct Limits
+{
+    //! Alternative may be at most this much longer than shortest path
+    double max_stretch = 1.25;
+    //! Part of alternative cost that may be shared with shortest or another chosen route
+    double max_sharing = 0.6;
+    //! Every subpath of alternative up to this cost must be shortest itself
+    double local_optimality = 0.25;
+    //! Candidates with shorter plateau are dropped before their paths are built
+    double min_plateau = 0.05;
+};
+
+struct Route
+{
+    double cost;
+    std::vector<uint32_t> arcs;
+};
+
+/* Edge marks and covered vertices of one query. Sized once for the graph and
+reused between queries, entries are validated by stamp as in SearchSpace, so
+a query touches only edges and vertices of paths it builds */
+class Marks
+{
+public:
+    Marks(const size_t vertex_count, const size_t edge_count);
+
+    void Clear();
+
+    char EdgeMark(const uint32_t edge) const { return edge_stamps_[edge] == stamp_ ? edge_marks_[edge] : 0; }
+    void SetEdgeMark(const uint32_t edge, const char mark)
+    {
+        edge_stamps_[edge] = stamp_;
+        edge_marks_[edge] = mark;
+    }
+
+    bool IsVertexCovered(const uint32_t vertex) const { return vertex_stamps_[vertex] == stamp_; }
+    void CoverVertex(const uint32_t vertex) { vertex_stamps_[vertex] = stamp_; }
+
+private:
+    uint32_t stamp_ = 1;
+    std::vector<uint32_t> edge_stamps_;
+    std::vector<char> edge_marks_;
+    std::vector<uint32_t> vertex_stamps_;
+};
+
+/* Via-vertex alternatives. One bidirectional search grows both trees up to
+max_stretch, any vertex reached by both gives candidate path source -> via ->
+target. Neighbouring vertices where both trees follow the same road form a
+plateau and give the same path, so each plateau is one candidate with via
+vertex in its middle. Candidates are tried in order of cost, skipping vertices
+that lie on already tried paths, and kept if they share little with chosen
+routes and pass local optimality test around via vertex. Plateau at least as
+long as the test proves local optimality without searching. First route is
+the shortest one. cost_per_distance is passed to bidirectional::Search,
+local_search_space holds searches of the local optimality test. Candidates
+are collected from vertices settled by the forward search only, so apart
+from the searches a query costs nothing per vertex of the graph */
+void Find(const RoadGraph& road_graph, const ArcWeights& arc_weights, const uint32_t source, const uint32_t target,
+          const size_t max_route_count, const Limits& limits, const double cost_per_distance,
+          SearchSpace& forward_search_space, SearchSpace& backward_search_space, SearchSpace& local_search_space,
+          Marks& marks, std::vector<Route>& routes);
+
+} // namespace alternatives
+
+#endif // ALTERNATIVES_H
@@ -0,0 +1,96 @@
+#ifndef ARCWEIGHTS_H
+#define ARCWEIGHTS_H
+
+#include <memory>
+
+#include "RoadGraph.h"
+#include "RoutingProfile.h"
+#include "RoadOverrides.h"
+
+/* Costs of every arc of RoadGraph for one routing profile, precomputed
+once so search loops only read a compact float array. Copies share the
+array, a copy may carry road overrides applied on lookup */
+class ArcWeights
+{
+public:
+    template <typename Profile>
+    static ArcWeights Build(const RoadGraph& road_graph);
+
+    //! Same weights with overrides applied, nothing is copied. Empty or null overrides are dropped
+    ArcWeights WithOverrides(RoadOverridesSPtr road_overrides_s_ptr) const;
+
+    float Weight(const uint32_t arc) const
+    {
+        return road_overrides_ ? road_overrides_->Apply(arc, weights_[arc]) : weights_[arc];
+    }
+    static bool IsAccessible(const float weight) { return weight != routing_profile::kInaccessible; }
+
+    //! Whether vertex has at least one arc in any direction usable by profile
+    bool IsVertexAccessible(const uint32_t vertex) const
+    {
+        return data_s_ptr_->accessible_vertices[vertex] && !(road_overrides_ && road_overrides_->IsVertexClosed(vertex));
+    }
+
+    //! Maximal speed of profile in meters per second, bounds distance covered for given cost
+    double MaxSpeed() const { return max_speed_; }
+
+private:
+    struct Data
+    {
+        std::vector<float> weights;
+        std::vector<char> accessible_vertices;
+    };
+
+    double max_speed_ = 0;
+    std::shared_ptr<const Data> data_s_ptr_;
+    //! Array of data_s_ptr_, kept at hand for search loops
+    const float* weights_ = nullptr;
+
+    RoadOverridesSPtr road_overrides_s_ptr_;
+    const RoadOverrides* road_overrides_ = nullptr;
+};
+
+template <typename Profile>
+ArcWeights ArcWeights::Build(const RoadGraph& road_graph)
+{
+    auto data = std::make_shared<Data>();
+    data->weights.resize(road_graph.ArcCount());
+    data->accessible_vertices.assign(road_graph.VertexCount(), 0);
+
+    uint32_t edge;
+    for (uint32_t vertex = 0; vertex < road_graph.VertexCount(); vertex++)
+    {
+        for (auto arc = road_graph.FirstArc(vertex); arc < road_graph.FirstArc(vertex + 1); arc++)
+        {
+            edge = road_graph.ArcEdge(arc);
+
+            data->weights[arc] = routing_profile::ArcCost<Profile>(
+                road_graph.EdgeRoadClass(edge), road_graph.EdgeOneway(edge),
+                road_graph.EdgeLength(edge), road_graph.IsArcForward(arc));
+
+            if (IsAccessible(data->weights[arc]))
+            {
+                data->accessible_vertices[vertex] = 1;
+                data->accessible_vertices[road_graph.ArcHead(arc)] = 1;
+            }
+        }
+    }
+
+    auto arc_weights = ArcWeights();
+    arc_weights.max_speed_ = Profile::kMaxSpeed;
+    arc_weights.weights_ = data->weights.data();
+    arc_weights.data_s_ptr_ = std::move(data);
+
+    return arc_weights;
+}
+
+inline ArcWeights ArcWeights::WithOverrides(RoadOverridesSPtr road_overrides_s_ptr) const
+{
+    auto arc_weights = *this;
+    arc_weights.road_overrides_s_ptr_ = road_overrides_s_ptr && !road_overrides_s_ptr->IsEmpty() ? std::move(road_overrides_s_ptr) : nullptr;
+    arc_weights.road_overrides_ = arc_weights.road_overrides_s_ptr_.get();
+
+    return arc_weights;
+}
+
+#endif // ARCWEIGHTS_H
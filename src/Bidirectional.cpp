@@ -0,0 +1,108 @@
+#include "Bidirectional.h"
+
+#include <cmath>
+#include <algorithm>
+
+#include "Dijkstra.h"
+
+namespace bidirectional {
+
+double Search(const RoadGraph& road_graph, const ArcWeights& arc_weights, const uint32_t source, const uint32_t target,
+              const double stretch, SearchSpace& forward_search_space, SearchSpace& backward_search_space, uint32_t& meeting_vertex,
+              const double cost_per_distance)
+{
+    const auto source_point = road_graph.VertexPoint(source);
+    const auto target_point = road_graph.VertexPoint(target);
+
+    dijkstra::StartSearch(source, forward_search_space);
+    dijkstra::StartSearch(target, backward_search_space);
+
+    auto best_cost = SearchSpace::kInfinity;
+    meeting_vertex = SearchSpace::kNoVertex;
+
+    const auto update_best_cost = [&](const uint32_t vertex) {
+        const auto cost = forward_search_space.Cost(vertex) + backward_search_space.Cost(vertex);
+        if (cost < best_cost)
+        {
+            best_cost = cost;
+            meeting_vertex = vertex;
+        }
+    };
+
+    uint32_t vertex, head;
+    float weight;
+    double cost, head_cost;
+    for (;;)
+    {
+        const auto forward_min = forward_search_space.MinPriority();
+        const auto backward_min = backward_search_space.MinPriority();
+
+        if (stretch <= 1)
+        {
+            if (forward_min + backward_min >= best_cost)
+                break;
+        }
+        else if (std::min(forward_min, backward_min) > stretch * best_cost)
+        {
+            break;
+        }
+
+        // Both queues empty gives infinite minimums, which stops search above only if path was found
+        if (forward_min == SearchSpace::kInfinity && backward_min == SearchSpace::kInfinity)
+            break;
+
+        const auto is_backward = backward_min < forward_min && (stretch <= 1 || backward_min <= stretch * best_cost);
+        auto& search_space = is_backward ? backward_search_space : forward_search_space;
+        const auto& opposite_search_space = is_backward ? forward_search_space : backward_search_space;
+
+        search_space.PopMin(vertex);
+        if (opposite_search_space.IsReached(vertex))
+            update_best_cost(vertex);
+
+        cost = search_space.Cost(vertex);
+        if (stretch > 1 && best_cost != SearchSpace::kInfinity)
+        {
+            /* Rest of the path to the other root costs exactly as much as opposite tree
+            says once it settled the vertex, otherwise at least its queue minimum and
+            straight line estimate. Vertex stays settled, only paths through it that
+            are too long are cut off */
+            auto remaining_cost = opposite_search_space.Cost(vertex);
+            if (!opposite_search_space.IsSettled(vertex))
+            {
+                const auto& point = road_graph.VertexPoint(vertex);
+                const auto& root_point = is_backward ? source_point : target_point;
+                remaining_cost = std::max(is_backward ? forward_min : backward_min,
+                                          cost_per_distance * std::hypot(point.x - root_point.x, point.y - root_point.y));
+            }
+
+            if (cost + remaining_cost > stretch * best_cost)
+                continue;
+        }
+
+        for (auto arc = road_graph.FirstArc(vertex); arc < road_graph.FirstArc(vertex + 1); arc++)
+        {
+            weight = arc_weights.Weight(is_backward ? road_graph.ReverseArc(arc) : arc);
+            if (!ArcWeights::IsAccessible(weight))
+                continue;
+
+            head = road_graph.ArcHead(arc);
+            head_cost = cost + weight;
+            if (search_space.Relax(head, head_cost, head_cost, vertex, arc) && opposite_search_space.IsReached(head))
+                update_best_cost(head);
+        }
+    }
+
+    return best_cost;
+}
+
+void BuildArcPath(const RoadGraph& road_graph, const SearchSpace& forward_search_space, const SearchSpace& backward_search_space,
+                  const uint32_t via_vertex, std::vector<uint32_t>& path_arcs)
+{
+    forward_search_space.BuildArcPath(via_vertex, path_arcs);
+
+    // Backward parents lead to target, their arcs point against travel direction
+    for (auto vertex = via_vertex; backward_search_space.ParentVertex(vertex) != SearchSpace::kNoVertex; vertex = backward_search_space.ParentVertex(vertex))
+        path_arcs.push_back(road_graph.ReverseArc(backward_search_space.ParentArc(vertex)));
+}
+
+} // namespace bidirectional
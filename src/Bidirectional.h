@@ -0,0 +1,30 @@
+#ifndef BIDIRECTIONAL_H
+#define BIDIRECTIONAL_H
+
+#include "RoadGraph.h"
+#include "ArcWeights.h"
+#include "SearchSpace.h"
+
+namespace bidirectional {
+
+/* Grows forward search from source and backward one from target, always
+advancing the side with smaller queue minimum. With stretch 1 search stops
+as soon as shortest path is proven. With larger stretch each side goes on
+until its minimum exceeds stretch * shortest cost, so both trees cover every
+vertex lying on a path at most that long, as alternative routes need. Then
+vertices whose cost plus a lower bound of the rest exceeds that are not
+expanded, bound is cost in or queue minimum of the opposite tree and straight
+line distance to its root times cost_per_distance, the lower bound of cost per
+unit of distance (0 if unknown). So trees cover an ellipse, not two discs.
+Returns shortest cost (infinity if unreachable) and vertex where trees meet */
+double Search(const RoadGraph& road_graph, const ArcWeights& arc_weights, const uint32_t source, const uint32_t target,
+              const double stretch, SearchSpace& forward_search_space, SearchSpace& backward_search_space, uint32_t& meeting_vertex,
+              const double cost_per_distance = 0);
+
+//! Writes arcs of path from source to target passing via vertex reached by both trees
+void BuildArcPath(const RoadGraph& road_graph, const SearchSpace& forward_search_space, const SearchSpace& backward_search_space,
+                  const uint32_t via_vertex, std::vector<uint32_t>& path_arcs);
+
+} // namespace bidirectional
+
+#endif // BIDIRECTIONAL_H
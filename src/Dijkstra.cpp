@@ -0,0 +1,91 @@
+#include "Dijkstra.h"
+
+namespace dijkstra {
+
+void SearchOneToMany(const RoadGraph& road_graph, const ArcWeights& arc_weights, const uint32_t source,
+                     const std::vector<char>& is_target, const size_t target_count,
+                     SearchSpace& search_space)
+{
+    search_space.Clear();
+    search_space.Relax(source, 0, 0, SearchSpace::kNoVertex, SearchSpace::kNoVertex);
+
+    auto settled_target_count = size_t(0);
+    uint32_t vertex;
+    float weight;
+    double cost, head_cost;
+    for (; settled_target_count < target_count && search_space.PopMin(vertex);)
+    {
+        if (is_target[vertex])
+            settled_target_count++;
+
+        cost = search_space.Cost(vertex);
+        for (auto arc = road_graph.FirstArc(vertex); arc < road_graph.FirstArc(vertex + 1); arc++)
+        {
+            weight = arc_weights.Weight(arc);
+            if (!ArcWeights::IsAccessible(weight))
+                continue;
+
+            head_cost = cost + weight;
+            search_space.Relax(road_graph.ArcHead(arc), head_cost, head_cost, vertex, arc);
+        }
+    }
+}
+
+void SearchBounded(const RoadGraph& road_graph, const ArcWeights& arc_weights, const uint32_t source, const double max_cost,
+                   SearchSpace& search_space, std::vector<uint32_t>& settled_vertices)
+{
+    search_space.Clear();
+    search_space.Relax(source, 0, 0, SearchSpace::kNoVertex, SearchSpace::kNoVertex);
+
+    uint32_t vertex;
+    float weight;
+    double cost, head_cost;
+    for (; search_space.MinPriority() <= max_cost && search_space.PopMin(vertex);)
+    {
+        settled_vertices.push_back(vertex);
+
+        cost = search_space.Cost(vertex);
+        for (auto arc = road_graph.FirstArc(vertex); arc < road_graph.FirstArc(vertex + 1); arc++)
+        {
+            weight = arc_weights.Weight(arc);
+            if (!ArcWeights::IsAccessible(weight))
+                continue;
+
+            head_cost = cost + weight;
+            if (head_cost <= max_cost)
+                search_space.Relax(road_graph.ArcHead(arc), head_cost, head_cost, vertex, arc);
+        }
+    }
+}
+
+void StartSearch(const uint32_t root, SearchSpace& search_space)
+{
+    search_space.Clear();
+    search_space.Relax(root, 0, 0, SearchSpace::kNoVertex, SearchSpace::kNoVertex);
+}
+
+bool SearchUntilSettled(const RoadGraph& road_graph, const ArcWeights& arc_weights, const uint32_t vertex,
+                        const bool is_backward, SearchSpace& search_space)
+{
+    uint32_t settled_vertex;
+    float weight;
+    double cost, head_cost;
+    for (; !search_space.IsSettled(vertex) && search_space.PopMin(settled_vertex);)
+    {
+        // Arcs of settled vertex are relaxed before returning, otherwise resumed search would miss them
+        cost = search_space.Cost(settled_vertex);
+        for (auto arc = road_graph.FirstArc(settled_vertex); arc < road_graph.FirstArc(settled_vertex + 1); arc++)
+        {
+            weight = arc_weights.Weight(is_backward ? road_graph.ReverseArc(arc) : arc);
+            if (!ArcWeights::IsAccessible(weight))
+                continue;
+
+            head_cost = cost + weight;
+            search_space.Relax(road_graph.ArcHead(arc), head_cost, head_cost, settled_vertex, arc);
+        }
+    }
+
+    return search_space.IsSettled(vertex);
+}
+
+} // namespace dijkstra
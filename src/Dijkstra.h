@@ -0,0 +1,34 @@
+#ifndef DIJKSTRA_H
+#define DIJKSTRA_H
+
+#include "RoadGraph.h"
+#include "ArcWeights.h"
+#include "SearchSpace.h"
+
+namespace dijkstra {
+
+/* Runs search from source until every vertex marked in is_target is settled
+or graph is exhausted. target_count is number of marked vertices. Results
+are left in search_space */
+void SearchOneToMany(const RoadGraph& road_graph, const ArcWeights& arc_weights, const uint32_t source,
+                     const std::vector<char>& is_target, const size_t target_count,
+                     SearchSpace& search_space);
+
+/* Settles every vertex reachable from source within max_cost. Settled vertices
+are appended to settled_vertices in order of non-decreasing cost */
+void SearchBounded(const RoadGraph& road_graph, const ArcWeights& arc_weights, const uint32_t source, const double max_cost,
+                   SearchSpace& search_space, std::vector<uint32_t>& settled_vertices);
+
+//! Clears search_space and puts root into queue, search is advanced by SearchUntilSettled
+void StartSearch(const uint32_t root, SearchSpace& search_space);
+
+/* Advances search started by StartSearch until vertex is settled or graph is
+exhausted. Tree stays valid, so later calls for other vertices continue from
+where this one stopped. Backward search follows arcs against their direction,
+costs are then costs to root. Returns false if vertex is unreachable */
+bool SearchUntilSettled(const RoadGraph& road_graph, const ArcWeights& arc_weights, const uint32_t vertex,
+                        const bool is_backward, SearchSpace& search_space);
+
+} // namespace dijkstra
+
+#endif // DIJKSTRA_H
@@ -0,0 +1,59 @@
+#include "DistanceMatrix.h"
+
+#include <atomic>
+#include <thread>
+#include <algorithm>
+
+#include "SearchSpace.h"
+#include "Dijkstra.h"
+
+namespace distance_matrix {
+
+void Compute(const RoadGraph& road_graph, const ArcWeights& arc_weights,
+             const std::vector<uint32_t>& source_vertices, const std::vector<uint32_t>& target_vertices,
+             const unsigned int thread_count, std::vector<double>& costs)
+{
+    const auto target_count = target_vertices.size();
+    costs.assign(source_vertices.size() * target_count, SearchSpace::kInfinity);
+
+    if (source_vertices.empty() || target_vertices.empty())
+        return;
+
+    // Several targets may snap to the same vertex, search stops when all distinct ones are settled
+    auto is_target = std::vector<char>(road_graph.VertexCount(), 0);
+    auto distinct_target_count = size_t(0);
+    for (const auto target : target_vertices)
+    {
+        if (!is_target[target])
+            distinct_target_count++;
+
+        is_target[target] = 1;
+    }
+
+    auto next_source = std::atomic<size_t>(0);
+
+    const auto compute_rows = [&]() {
+        auto search_space = SearchSpace(road_graph.VertexCount());
+
+        for (auto source = next_source.fetch_add(1); source < source_vertices.size(); source = next_source.fetch_add(1))
+        {
+            dijkstra::SearchOneToMany(road_graph, arc_weights, source_vertices[source], is_target, distinct_target_count, search_space);
+
+            for (size_t target = 0; target < target_count; target++)
+                costs[source * target_count + target] = search_space.Cost(target_vertices[target]);
+        }
+    };
+
+    const auto worker_count = std::max(1u, std::min<unsigned int>(thread_count, source_vertices.size()));
+
+    auto workers = std::vector<std::thread>();
+    for (unsigned int i = 1; i < worker_count; i++)
+        workers.emplace_back(compute_rows);
+
+    compute_rows();
+
+    for (auto& worker : workers)
+        worker.join();
+}
+
+} // namespace distance_matrix
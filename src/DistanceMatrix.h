@@ -0,0 +1,19 @@
+#ifndef DISTANCEMATRIX_H
+#define DISTANCEMATRIX_H
+
+#include "RoadGraph.h"
+#include "ArcWeights.h"
+
+namespace distance_matrix {
+
+/* Computes shortest path costs from every source vertex to every target vertex.
+One-to-many searches are distributed over thread_count threads. Result is
+stored row-major: costs[i * targets.size() + j] is cost from sources[i] to
+targets[j], infinity if target is unreachable */
+void Compute(const RoadGraph& road_graph, const ArcWeights& arc_weights,
+             const std::vector<uint32_t>& source_vertices, const std::vector<uint32_t>& target_vertices,
+             const unsigned int thread_count, std::vector<double>& costs);
+
+} // namespace distance_matrix
+
+#endif // DISTANCEMATRIX_H
@@ -0,0 +1,348 @@
+#include "Geocoder.h"
+
+#include <iostream>
+#include <algorithm>
+#include <unordered_set>
+#include <queue>
+#include <cmath>
+#include <cstdlib>
+#include <cctype>
+#include <limits>
+
+#include <QtSql/QSqlQuery>
+#include <QtSql/QSqlError>
+#include <QVariant>
+
+//! Matching places looked at before ranking, they come in kind and name order
+constexpr size_t kMaxGeocoderCandidateCount { 4096 };
+//! Named objects of the same kind and name closer than this are one place, like segments of a street
+constexpr double kPlaceMergeDistance { 1000 };
+//! Words shorter than this must match exactly, from the second length on two typos are allowed
+constexpr size_t kMinOneTypoWordLength { 4 };
+constexpr size_t kMinTwoTypoWordLength { 8 };
+
+NameIndex::PlaceKind ParsePlaceKind(const std::string& place, const std::string& boundary, const bool is_line)
+{
+    using PlaceKind = NameIndex::PlaceKind;
+
+    if (is_line)
+        return PlaceKind::Street;
+
+    if (place == "country" || place == "state" || place == "region" || place == "province" || place == "county" ||
+        place == "district" || place == "municipality")
+        return PlaceKind::Region;
+    if (place == "city")
+        return PlaceKind::City;
+    if (place == "town")
+        return PlaceKind::Town;
+    if (place == "village")
+        return PlaceKind::Village;
+    if (place == "suburb" || place == "quarter" || place == "neighbourhood" || place == "borough")
+        return PlaceKind::Suburb;
+    if (!place.empty())
+        return PlaceKind::Locality;
+
+    if (boundary == "administrative")
+        return PlaceKind::Region;
+
+    return PlaceKind::PointOfInterest;
+}
+
+size_t CodePointCount(const std::string& text)
+{
+    return static_cast<size_t>(std::count_if(text.begin(), text.end(), [](const char byte) { return (byte & 0xc0) != 0x80; }));
+}
+
+Geocoder::Geocoder()
+{
+
+}
+
+GeocoderUPtr Geocoder::Create(const QSqlDatabase& database)
+{
+    auto places = std::vector<NameIndex::Place>();
+    if (!LoadPlaces(database, places))
+        return nullptr;
+
+    return Create(NameIndex::Create(places));
+}
+
+GeocoderUPtr Geocoder::Create(NameIndexUPtr name_index_u_ptr)
+{
+    if (!name_index_u_ptr)
+    {
+        std::cerr << "Geocoder::Create Failed to create name index" << std::endl;
+        return nullptr;
+    }
+
+    std::unique_ptr<Geocoder> instance(new Geocoder());
+    instance->name_index_u_ptr_ = std::move(name_index_u_ptr);
+
+    return instance;
+}
+
+/* Database connection has unique name and is removed after loading, like the
+one used for routing data */
+GeocoderUPtr Geocoder::CreateFromEnvironment()
+{
+    const auto index_path = std::getenv("OPENROUTE_GEOCODER_INDEX");
+    const auto has_index_path = index_path && *index_path;
+    if (has_index_path)
+    {
+        auto name_index_u_ptr = NameIndex::Create(std::string(index_path));
+        if (name_index_u_ptr)
+            return Create(std::move(name_index_u_ptr));
+    }
+
+    auto geocoder_u_ptr = GeocoderUPtr();
+    {
+        auto database = QSqlDatabase::addDatabase("QPSQL", "Geocoder");
+        database.setHostName("localhost");
+        database.setDatabaseName("gis");
+        database.setUserName("mapper");
+        database.setPassword("");
+
+        if (database.open())
+        {
+            geocoder_u_ptr = Create(database);
+            database.close();
+        }
+        else
+        {
+            std::cerr << "Geocoder::CreateFromEnvironment Database connection error: " << database.lastError().text().toStdString() << std::endl;
+        }
+    }
+
+    QSqlDatabase::removeDatabase("Geocoder");
+
+    // Index which failed to save is still usable until exit
+    if (geocoder_u_ptr && has_index_path)
+        geocoder_u_ptr->name_index_u_ptr_->Write(index_path);
+
+    return geocoder_u_ptr;
+}
+
+bool Geocoder::LoadPlaces(const QSqlDatabase& database, std::vector<NameIndex::Place>& places)
+{
+    auto query = QSqlQuery(database);
+    query.setForwardOnly(true);
+
+    // Roads are split into many lines, each one is represented by its middle point
+    if (!query.exec(R"(
+        SELECT
+            name,
+            place,
+            NULL,
+            false,
+            ST_X(way),
+            ST_Y(way)
+        FROM
+            planet_osm_point
+        WHERE
+            name IS NOT NULL
+        UNION ALL
+        SELECT
+            name,
+            place,
+            boundary,
+            false,
+            ST_X(ST_PointOnSurface(way)),
+            ST_Y(ST_PointOnSurface(way))
+        FROM
+            planet_osm_polygon
+        WHERE
+            name IS NOT NULL
+        UNION ALL
+        SELECT
+            name,
+            NULL,
+            NULL,
+            true,
+            ST_X(ST_LineInterpolatePoint(way, 0.5)),
+            ST_Y(ST_LineInterpolatePoint(way, 0.5))
+        FROM
+            planet_osm_line
+        WHERE
+            name IS NOT NULL AND highway IS NOT NULL AND ST_GeometryType(way) = 'ST_LineString';
+    )"))
+    {
+        std::cerr << "Geocoder::LoadPlaces SQL query execution error: " << query.lastError().text().toStdString() << std::endl;
+        return false;
+    }
+
+    auto place_keys_u_set = std::unordered_set<std::string>();
+    for (; query.next();)
+    {
+        auto place = NameIndex::Place();
+        place.name = query.value(0).toString().toStdString();
+        place.kind = ParsePlaceKind(query.value(1).toString().toStdString(), query.value(2).toString().toStdString(), query.value(3).toBool());
+        place.point = projection::Epsg3857Point(query.value(4).toDouble(), query.value(5).toDouble());
+
+        auto place_key = place.name;
+        place_key.push_back('\0');
+        place_key.append(std::to_string(static_cast<int>(place.kind)));
+        place_key.push_back(':');
+        place_key.append(std::to_string(static_cast<int64_t>(std::floor(place.point.x / kPlaceMergeDistance))));
+        place_key.push_back(':');
+        place_key.append(std::to_string(static_cast<int64_t>(std::floor(place.point.y / kPlaceMergeDistance))));
+
+        if (place_keys_u_set.insert(std::move(place_key)).second)
+            places.push_back(std::move(place));
+    }
+
+    return true;
+}
+
+void Geocoder::MatchWord(const std::string& word, const bool is_prefix, WordMatch& word_match) const
+{
+    const auto& name_index = *name_index_u_ptr_;
+
+    word_match.token_ranges.clear();
+    word_match.posting_count = 0;
+
+    uint32_t first_token, last_token;
+    if (is_prefix)
+    {
+        name_index.FindPrefix(word, first_token, last_token);
+        if (first_token < last_token)
+            word_match.token_ranges.emplace_back(first_token, last_token);
+    }
+    else if (name_index.FindToken(word, first_token))
+    {
+        word_match.token_ranges.emplace_back(first_token, first_token + 1);
+    }
+
+    const auto word_length = CodePointCount(word);
+    if (word_match.token_ranges.empty() && word_length >= kMinOneTypoWordLength)
+    {
+        auto token_ids = std::vector<uint32_t>();
+        name_index.FindSimilarTokens(word, is_prefix, word_length >= kMinTwoTypoWordLength ? 2 : 1, token_ids);
+
+        for (const auto token_id : token_ids)
+            word_match.token_ranges.emplace_back(token_id, token_id + 1);
+    }
+
+    for (const auto& token_range : word_match.token_ranges)
+        word_match.posting_count += name_index.PostingCount(token_range.first, token_range.second);
+}
+
+bool Geocoder::IsPlaceMatching(const uint32_t place, const WordMatch& word_match) const
+{
+    const auto& name_index = *name_index_u_ptr_;
+
+    for (auto token = name_index.PlaceTokensBegin(place); token != name_index.PlaceTokensEnd(place); token++)
+    {
+        // Last range starting at or before the token is the only one which can hold it
+        const auto token_range = std::upper_bound(word_match.token_ranges.begin(), word_match.token_ranges.end(), *token,
+            [](const uint32_t token_id, const std::pair<uint32_t, uint32_t>& range) { return token_id < range.first; });
+
+        if (token_range != word_match.token_ranges.begin() && *token < std::prev(token_range)->second)
+            return true;
+    }
+
+    return false;
+}
+
+void Geocoder::Search(const std::string& query, const projection::Epsg3857Point& focus_point, const size_t max_count,
+                      std::vector<Result>& results) const
+{
+    results.clear();
+
+    auto words = std::vector<std::string>();
+    NameIndex::Tokenize(query, words);
+    if (words.empty() || max_count == 0)
+        return;
+
+    // Non ASCII bytes belong to letters, separators among them are rare in queries
+    const auto last_byte = static_cast<unsigned char>(query.back());
+    const auto is_last_word_prefix = last_byte >= 0x80 || std::isalnum(last_byte);
+
+    auto word_matches = std::vector<WordMatch>(words.size());
+    for (size_t word = 0; word < words.size(); word++)
+    {
+        MatchWord(words[word], word + 1 == words.size() && is_last_word_prefix, word_matches[word]);
+        if (word_matches[word].token_ranges.empty())
+            return;
+    }
+
+    // Candidates come from the most selective word, merged over its tokens in place order
+    const auto seed_word = static_cast<size_t>(std::min_element(word_matches.begin(), word_matches.end(),
+        [](const WordMatch& lhs, const WordMatch& rhs) { return lhs.posting_count < rhs.posting_count; }) - word_matches.begin());
+
+    const auto& name_index = *name_index_u_ptr_;
+
+    using PostingCursor = std::pair<const uint32_t*, const uint32_t*>;
+    const auto is_after = [](const PostingCursor& lhs, const PostingCursor& rhs) { return *lhs.first > *rhs.first; };
+    auto cursor_queue = std::priority_queue<PostingCursor, std::vector<PostingCursor>, decltype(is_after)>(is_after);
+    for (const auto& token_range : word_matches[seed_word].token_ranges)
+    {
+        for (auto token_id = token_range.first; token_id < token_range.second; token_id++)
+        {
+            if (name_index.PostingCount(token_id, token_id + 1) > 0)
+                cursor_queue.emplace(name_index.PostingsBegin(token_id), name_index.PostingsEnd(token_id + 1));
+        }
+    }
+
+    auto candidates = std::vector<uint32_t>();
+    auto previous_place = std::numeric_limits<uint32_t>::max();
+    for (; !cursor_queue.empty() && candidates.size() < kMaxGeocoderCandidateCount;)
+    {
+        auto cursor = cursor_queue.top();
+        cursor_queue.pop();
+
+        const auto place = *cursor.first;
+        if (++cursor.first != cursor.second)
+            cursor_queue.push(cursor);
+
+        if (place == previous_place)
+            continue;
+
+        previous_place = place;
+
+        auto is_matching = true;
+        for (size_t word = 0; word < word_matches.size() && is_matching; word++)
+        {
+            if (word != seed_word)
+                is_matching = IsPlaceMatching(place, word_matches[word]);
+        }
+
+        if (is_matching)
+            candidates.push_back(place);
+    }
+
+    const auto squared_distance = [&](const uint32_t place) {
+        const auto point = name_index.PlacePoint(place);
+        return (point.x - focus_point.x) * (point.x - focus_point.x) + (point.y - focus_point.y) * (point.y - focus_point.y);
+    };
+
+    const auto result_count = std::min(max_count, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + result_count, candidates.end(), [&](const uint32_t lhs, const uint32_t rhs) {
+        if (name_index.Kind(lhs) != name_index.Kind(rhs))
+            return name_index.Kind(lhs) < name_index.Kind(rhs);
+
+        return squared_distance(lhs) < squared_distance(rhs);
+    });
+
+    for (size_t candidate = 0; candidate < result_count; candidate++)
+    {
+        const auto place = candidates[candidate];
+        results.push_back(Result { std::string(name_index.PlaceName(place)), name_index.Kind(place), name_index.PlacePoint(place) });
+    }
+}
+
+const char* Geocoder::KindName(const NameIndex::PlaceKind kind)
+{
+    switch (kind)
+    {
+    case NameIndex::PlaceKind::Region: return "region";
+    case NameIndex::PlaceKind::City: return "city";
+    case NameIndex::PlaceKind::Town: return "town";
+    case NameIndex::PlaceKind::Village: return "village";
+    case NameIndex::PlaceKind::Suburb: return "suburb";
+    case NameIndex::PlaceKind::Locality: return "locality";
+    case NameIndex::PlaceKind::Street: return "street";
+    case NameIndex::PlaceKind::PointOfInterest: return "place";
+    }
+
+    return "";
+}
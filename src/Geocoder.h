@@ -0,0 +1,59 @@
+#ifndef GEOCODER_H
+#define GEOCODER_H
+
+#include <QSqlDatabase>
+
+#include "NameIndex.h"
+
+class Geocoder;
+using GeocoderUPtr = std::unique_ptr<Geocoder>;
+
+/* Offline search of places, streets and points of interest by name, backed
+by NameIndex built from name tags of osm2pgsql tables */
+class Geocoder
+{
+public:
+    struct Result
+    {
+        std::string name;
+        NameIndex::PlaceKind kind;
+        projection::Epsg3857Point point;
+    };
+
+    //! Builds index from planet_osm_point, planet_osm_polygon and named roads of planet_osm_line
+    static GeocoderUPtr Create(const QSqlDatabase& database);
+    static GeocoderUPtr Create(NameIndexUPtr name_index_u_ptr);
+    /* Maps index file from OPENROUTE_GEOCODER_INDEX if it exists. Otherwise
+    builds index from database and, when the variable is set, saves it there */
+    static GeocoderUPtr CreateFromEnvironment();
+
+    /* Finds places having all words of query, the last one may be incomplete
+    unless query ends with a separator. Words without exact match are matched
+    with up to one typo (two for long words). Results are ordered by place kind,
+    then by distance to focus_point */
+    void Search(const std::string& query, const projection::Epsg3857Point& focus_point, const size_t max_count,
+                std::vector<Result>& results) const;
+
+    static const char* KindName(const NameIndex::PlaceKind kind);
+
+    const NameIndex& Index() const { return *name_index_u_ptr_; }
+
+private:
+    //! Token ids one word of query accepts, as sorted disjoint ranges
+    struct WordMatch
+    {
+        std::vector<std::pair<uint32_t, uint32_t>> token_ranges;
+        size_t posting_count = 0;
+    };
+
+    NameIndexUPtr name_index_u_ptr_;
+
+    Geocoder();
+
+    static bool LoadPlaces(const QSqlDatabase& database, std::vector<NameIndex::Place>& places);
+
+    void MatchWord(const std::string& word, const bool is_prefix, WordMatch& word_match) const;
+    bool IsPlaceMatching(const uint32_t place, const WordMatch& word_match) const;
+};
+
+#endif // GEOCODER_H
@@ -0,0 +1,141 @@
+#include "GraphFile.h"
+
+#include <iostream>
+#include <fstream>
+#include <cstring>
+
+constexpr char kGraphFileMagic[] = "ORGR";
+constexpr uint32_t kGraphFileVersion { 1 };
+
+template <typename T>
+void WriteArray(std::ostream& stream, const std::vector<T>& values)
+{
+    const auto count = static_cast<uint64_t>(values.size());
+    stream.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    stream.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+}
+
+//! Bytes left from the current position, 0 if stream cannot tell
+uint64_t RemainingByteCount(std::istream& stream)
+{
+    const auto position = stream.tellg();
+    stream.seekg(0, std::ios::end);
+    const auto end = stream.tellg();
+    stream.seekg(position);
+
+    return position < 0 || end < position ? 0 : static_cast<uint64_t>(end - position);
+}
+
+template <typename T>
+bool ReadArray(std::istream& stream, const uint64_t expected_count, std::vector<T>& values)
+{
+    // Count from a corrupted header must not allocate more than the file can hold
+    uint64_t count;
+    if (!stream.read(reinterpret_cast<char*>(&count), sizeof(count)) || count != expected_count
+        || count > RemainingByteCount(stream) / sizeof(T))
+        return false;
+
+    values.resize(count);
+    return static_cast<bool>(stream.read(reinterpret_cast<char*>(values.data()), count * sizeof(T)));
+}
+
+namespace graph_file {
+
+bool Write(const std::string& path, const GraphData& graph_data)
+{
+    auto file = std::ofstream(path, std::ios::binary);
+    if (!file)
+    {
+        std::cerr << "GraphFile::Write Failed to open " << path << std::endl;
+        return false;
+    }
+
+    const auto vertex_count = static_cast<uint64_t>(graph_data.vertex_ids.size());
+    const auto edge_count = static_cast<uint64_t>(graph_data.edge_ids.size());
+
+    file.write(kGraphFileMagic, 4);
+    file.write(reinterpret_cast<const char*>(&kGraphFileVersion), sizeof(kGraphFileVersion));
+    file.write(reinterpret_cast<const char*>(&vertex_count), sizeof(vertex_count));
+    file.write(reinterpret_cast<const char*>(&edge_count), sizeof(edge_count));
+
+    WriteArray(file, graph_data.vertex_ids);
+    WriteArray(file, graph_data.vertex_points);
+
+    WriteArray(file, graph_data.edge_ids);
+    WriteArray(file, graph_data.edge_sources);
+    WriteArray(file, graph_data.edge_targets);
+    WriteArray(file, graph_data.edge_lengths);
+    WriteArray(file, graph_data.edge_road_classes);
+    WriteArray(file, graph_data.edge_oneways);
+    graph_data.edge_shapes.Save(file);
+
+    if (!file)
+    {
+        std::cerr << "GraphFile::Write Failed to write " << path << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool Read(const std::string& path, GraphData& graph_data)
+{
+    auto file = std::ifstream(path, std::ios::binary);
+    if (!file)
+    {
+        std::cerr << "GraphFile::Read Failed to open " << path << std::endl;
+        return false;
+    }
+
+    char magic[4];
+    uint32_t version;
+    uint64_t vertex_count, edge_count;
+    file.read(magic, 4);
+    file.read(reinterpret_cast<char*>(&version), sizeof(version));
+    file.read(reinterpret_cast<char*>(&vertex_count), sizeof(vertex_count));
+    file.read(reinterpret_cast<char*>(&edge_count), sizeof(edge_count));
+
+    if (!file || std::memcmp(magic, kGraphFileMagic, 4) != 0 || version != kGraphFileVersion)
+    {
+        std::cerr << "GraphFile::Read " << path << " is not a graph file of version " << kGraphFileVersion << std::endl;
+        return false;
+    }
+
+    const auto is_read = ReadArray(file, vertex_count, graph_data.vertex_ids)
+        && ReadArray(file, vertex_count, graph_data.vertex_points)
+        && ReadArray(file, edge_count, graph_data.edge_ids)
+        && ReadArray(file, edge_count, graph_data.edge_sources)
+        && ReadArray(file, edge_count, graph_data.edge_targets)
+        && ReadArray(file, edge_count, graph_data.edge_lengths)
+        && ReadArray(file, edge_count, graph_data.edge_road_classes)
+        && ReadArray(file, edge_count, graph_data.edge_oneways)
+        && graph_data.edge_shapes.Load(file)
+        && graph_data.edge_shapes.Count() == edge_count;
+
+    if (!is_read)
+    {
+        std::cerr << "GraphFile::Read " << path << " is truncated or corrupted" << std::endl;
+        return false;
+    }
+
+    for (uint64_t edge = 0; edge < edge_count; edge++)
+    {
+        if (graph_data.edge_sources[edge] >= vertex_count || graph_data.edge_targets[edge] >= vertex_count)
+        {
+            std::cerr << "GraphFile::Read Edge " << graph_data.edge_ids[edge] << " references unknown vertex" << std::endl;
+            return false;
+        }
+
+        // Enums are read as raw bytes, unknown values would silently get default speed or be taken as two way
+        if (graph_data.edge_road_classes[edge] > routing_profile::RoadClass::Other
+            || graph_data.edge_oneways[edge] > routing_profile::Oneway::Backward)
+        {
+            std::cerr << "GraphFile::Read Edge " << graph_data.edge_ids[edge] << " has unknown road class or oneway value" << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+} // namespace graph_file
@@ -0,0 +1,37 @@
+#ifndef GRAPHFILE_H
+#define GRAPHFILE_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "Projection.h"
+#include "RoutingProfile.h"
+#include "PolylineStore.h"
+
+namespace graph_file {
+
+/* Road graph as stored in graph file. Vertices are referenced by position in
+vertex arrays, ids keep source identifiers (OSM node ids for imported graphs).
+Shape of edge i is polyline i and goes from its source to its target */
+struct GraphData
+{
+    std::vector<int64_t> vertex_ids;
+    std::vector<projection::Epsg3857Point> vertex_points;
+
+    std::vector<int64_t> edge_ids;
+    std::vector<uint32_t> edge_sources;
+    std::vector<uint32_t> edge_targets;
+    std::vector<double> edge_lengths;
+    std::vector<routing_profile::RoadClass> edge_road_classes;
+    std::vector<routing_profile::Oneway> edge_oneways;
+    PolylineStore edge_shapes;
+};
+
+bool Write(const std::string& path, const GraphData& graph_data);
+//! Reads and validates graph file, in case of error returns false
+bool Read(const std::string& path, GraphData& graph_data);
+
+} // namespace graph_file
+
+#endif // GRAPHFILE_H
@@ -0,0 +1,56 @@
+#ifndef HILBERT_H
+#define HILBERT_H
+
+#include <cstdint>
+
+namespace hilbert {
+
+constexpr uint32_t kAxisMax { 0xFFFF };
+
+//! Returns position of (x, y) on Hilbert curve filling 2^16 x 2^16 grid, x and y must be in [0, kAxisMax]
+inline uint32_t XYToIndex(uint32_t x, uint32_t y)
+{
+    uint32_t index = 0;
+
+    for (uint32_t side = 1u << 15; side > 0; side >>= 1)
+    {
+        const uint32_t rx = (x & side) > 0;
+        const uint32_t ry = (y & side) > 0;
+        index += side * side * ((3 * rx) ^ ry);
+
+        // Rotate quadrant so that curve stays continuous
+        if (ry == 0)
+        {
+            if (rx == 1)
+            {
+                x = kAxisMax - x;
+                y = kAxisMax - y;
+            }
+
+            const auto tmp = x;
+            x = y;
+            y = tmp;
+        }
+    }
+
+    return index;
+}
+
+//! Maps value from [min, max] range into Hilbert grid axis coordinate
+inline uint32_t ToAxis(const double value, const double min, const double max)
+{
+    if (max <= min)
+        return 0;
+
+    const auto scaled = (value - min) / (max - min) * kAxisMax;
+    if (scaled <= 0)
+        return 0;
+    if (scaled >= kAxisMax)
+        return kAxisMax;
+
+    return static_cast<uint32_t>(scaled);
+}
+
+} // namespace hilbert
+
+#endif // HILBERT_H
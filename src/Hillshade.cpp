@@ -0,0 +1,313 @@
+#include "Hillshade.h"
+
+#include <iostream>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <QDir>
+#include <QString>
+
+#include "Projection.h"
+
+//! Height of SRTM voids, such samples are treated as missing
+constexpr int kDemVoidHeight { -32768 };
+
+//! Light from the north west 45 degrees above horizon, unit vector of east, north and up components
+constexpr float kLightEast { -0.5f };
+constexpr float kLightNorth { 0.5f };
+constexpr float kLightUp { 0.70710678f };
+
+//! Heights are exaggerated so that relief stays visible on large pixels of low zooms
+constexpr float kVerticalExaggeration { 2 };
+
+//! Opacity of the darkest shadow and of the brightest lit slope
+constexpr float kMaxShadowAlpha { 150 };
+constexpr float kMaxHighlightAlpha { 90 };
+
+//! Sample of SRTM file is big endian signed 16 bit number
+int DemHeight(const uint8_t* sample)
+{
+    return static_cast<int16_t>((sample[0] << 8) | sample[1]);
+}
+
+//! Premultiplied pixel of one shade, black below flat ground brightness and white above it
+uint32_t ShadePixel(const float gradient_east, const float gradient_south)
+{
+    const auto shade = (kLightUp - gradient_east * kLightEast + gradient_south * kLightNorth)
+        / std::sqrt(1 + gradient_east * gradient_east + gradient_south * gradient_south);
+
+    const auto shadow = std::clamp((kLightUp - shade) * (kMaxShadowAlpha / kLightUp), 0.0f, kMaxShadowAlpha);
+    const auto highlight = std::clamp((shade - kLightUp) * (kMaxHighlightAlpha / (1 - kLightUp)), 0.0f, kMaxHighlightAlpha);
+
+    const auto shadow_alpha = static_cast<uint32_t>(std::lrint(shadow));
+    const auto highlight_alpha = static_cast<uint32_t>(std::lrint(highlight));
+
+    // At most one of them is not zero
+    return (shadow_alpha << 24) | (highlight_alpha * 0x01010101u);
+}
+
+/* Horn's 3x3 gradient of one row of pixels. Rows above, at and below hold
+size + 2 elevations, scale turns sums of eight weighted differences into slope */
+uint32_t ShadeRow(const float* above, const float* middle, const float* below, const int size, const float scale, uint32_t* pixels)
+{
+    auto covered_pixels = uint32_t(0);
+
+    auto pixel = 0;
+#if defined(__SSE2__)
+    // Four pixels per step, neighbours are unaligned loads shifted by one column
+    const auto scale_4 = _mm_set1_ps(scale);
+    const auto one = _mm_set1_ps(1);
+    const auto zero = _mm_setzero_ps();
+    const auto light_east = _mm_set1_ps(kLightEast);
+    const auto light_north = _mm_set1_ps(kLightNorth);
+    const auto light_up = _mm_set1_ps(kLightUp);
+    const auto shadow_scale = _mm_set1_ps(kMaxShadowAlpha / kLightUp);
+    const auto highlight_scale = _mm_set1_ps(kMaxHighlightAlpha / (1 - kLightUp));
+    const auto max_shadow = _mm_set1_ps(kMaxShadowAlpha);
+    const auto max_highlight = _mm_set1_ps(kMaxHighlightAlpha);
+
+    auto covered = _mm_setzero_si128();
+    for (; pixel + 4 <= size; pixel += 4)
+    {
+        const auto a = _mm_loadu_ps(above + pixel);
+        const auto b = _mm_loadu_ps(above + pixel + 1);
+        const auto c = _mm_loadu_ps(above + pixel + 2);
+        const auto d = _mm_loadu_ps(middle + pixel);
+        const auto f = _mm_loadu_ps(middle + pixel + 2);
+        const auto g = _mm_loadu_ps(below + pixel);
+        const auto h = _mm_loadu_ps(below + pixel + 1);
+        const auto i = _mm_loadu_ps(below + pixel + 2);
+
+        const auto gradient_east = _mm_mul_ps(_mm_sub_ps(_mm_add_ps(_mm_add_ps(c, i), _mm_add_ps(f, f)),
+                                                         _mm_add_ps(_mm_add_ps(a, g), _mm_add_ps(d, d))), scale_4);
+        const auto gradient_south = _mm_mul_ps(_mm_sub_ps(_mm_add_ps(_mm_add_ps(g, i), _mm_add_ps(h, h)),
+                                                          _mm_add_ps(_mm_add_ps(a, c), _mm_add_ps(b, b))), scale_4);
+
+        const auto length = _mm_sqrt_ps(_mm_add_ps(one, _mm_add_ps(_mm_mul_ps(gradient_east, gradient_east),
+                                                                   _mm_mul_ps(gradient_south, gradient_south))));
+        const auto shade = _mm_div_ps(_mm_add_ps(_mm_sub_ps(light_up, _mm_mul_ps(gradient_east, light_east)),
+                                                 _mm_mul_ps(gradient_south, light_north)), length);
+
+        const auto shadow = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(light_up, shade), shadow_scale), zero), max_shadow);
+        const auto highlight = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(shade, light_up), highlight_scale), zero), max_highlight);
+
+        const auto shadow_alpha = _mm_cvtps_epi32(shadow);
+        const auto highlight_alpha = _mm_cvtps_epi32(highlight);
+        const auto highlight_pixel = _mm_or_si128(_mm_or_si128(highlight_alpha, _mm_slli_epi32(highlight_alpha, 8)),
+                                                  _mm_or_si128(_mm_slli_epi32(highlight_alpha, 16), _mm_slli_epi32(highlight_alpha, 24)));
+        const auto shade_pixel = _mm_or_si128(_mm_slli_epi32(shadow_alpha, 24), highlight_pixel);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + pixel), shade_pixel);
+        covered = _mm_or_si128(covered, shade_pixel);
+    }
+
+    covered = _mm_or_si128(covered, _mm_shuffle_epi32(covered, _MM_SHUFFLE(1, 0, 3, 2)));
+    covered = _mm_or_si128(covered, _mm_shuffle_epi32(covered, _MM_SHUFFLE(2, 3, 0, 1)));
+    covered_pixels = static_cast<uint32_t>(_mm_cvtsi128_si32(covered));
+#endif
+
+    for (; pixel < size; pixel++)
+    {
+        const auto gradient_east = ((above[pixel + 2] + 2 * middle[pixel + 2] + below[pixel + 2]) - (above[pixel] + 2 * middle[pixel] + below[pixel])) * scale;
+        const auto gradient_south = ((below[pixel] + 2 * below[pixel + 1] + below[pixel + 2]) - (above[pixel] + 2 * above[pixel + 1] + above[pixel + 2])) * scale;
+
+        pixels[pixel] = ShadePixel(gradient_east, gradient_south);
+        covered_pixels |= pixels[pixel];
+    }
+
+    return covered_pixels;
+}
+
+Hillshade::Hillshade()
+{
+
+}
+
+HillshadeUPtr Hillshade::Create(const std::string& directory)
+{
+    std::unique_ptr<Hillshade> instance(new Hillshade());
+
+    if (directory.empty())
+        return instance;
+
+    const auto dem_directory = QDir(QString::fromStdString(directory));
+    if (!dem_directory.exists())
+    {
+        std::cerr << "Hillshade::Create Directory " << directory << " does not exist" << std::endl;
+        return nullptr;
+    }
+
+    // Name is the south west corner of the square: N52E013.hgt
+    for (const auto& file_name : dem_directory.entryList({ "*.hgt", "*.HGT" }, QDir::Files))
+    {
+        const auto name = file_name.toUpper();
+        if (name.size() != 11 || (name[0] != 'N' && name[0] != 'S') || (name[3] != 'E' && name[3] != 'W'))
+            continue;
+
+        auto is_latitude = false;
+        auto is_longitude = false;
+        const auto latitude = name.mid(1, 2).toInt(&is_latitude) * (name[0] == 'S' ? -1 : 1);
+        const auto longitude = name.mid(4, 3).toInt(&is_longitude) * (name[3] == 'W' ? -1 : 1);
+        if (!is_latitude || !is_longitude || latitude < -90 || latitude >= 90 || longitude < -180 || longitude >= 180)
+            continue;
+
+        instance->dem_paths_u_map_.emplace(DemKey(latitude, longitude), dem_directory.filePath(file_name).toStdString());
+    }
+
+    return instance;
+}
+
+HillshadeUPtr Hillshade::CreateFromEnvironment()
+{
+    const auto dem_directory = std::getenv("OPENROUTE_DEM");
+    if (!dem_directory || !*dem_directory)
+        return Create({});
+
+    return Create(dem_directory);
+}
+
+int Hillshade::DemKey(const int latitude, const int longitude)
+{
+    return (latitude + 90) * 360 + (longitude + 180);
+}
+
+const Hillshade::DemFile* Hillshade::FindDemFile(const int latitude, const int longitude)
+{
+    const auto dem_key = DemKey(latitude, longitude);
+
+    // Neighbouring pixels nearly always fall into the same square
+    if (dem_key == last_dem_key_)
+        return last_dem_file_;
+
+    last_dem_key_ = dem_key;
+    last_dem_file_ = nullptr;
+
+    const auto dem_file = dem_files_u_map_.find(dem_key);
+    if (dem_file != dem_files_u_map_.end())
+    {
+        last_dem_file_ = dem_file->second.heights ? &dem_file->second : nullptr;
+        return last_dem_file_;
+    }
+
+    // Squares without file are remembered too, so they are looked up once
+    auto& new_dem_file = dem_files_u_map_[dem_key];
+
+    const auto dem_path = dem_paths_u_map_.find(dem_key);
+    if (dem_path == dem_paths_u_map_.end())
+        return nullptr;
+
+    new_dem_file.file = std::make_unique<QFile>(QString::fromStdString(dem_path->second));
+    if (!new_dem_file.file->open(QIODevice::ReadOnly))
+    {
+        std::cerr << "Hillshade::FindDemFile Failed to open " << dem_path->second << std::endl;
+        return nullptr;
+    }
+
+    // Square grid of two byte samples
+    const auto file_size = new_dem_file.file->size();
+    const auto size = static_cast<int>(std::lround(std::sqrt(file_size / 2.0)));
+    if (size < 2 || static_cast<qint64>(size) * size * 2 != file_size)
+    {
+        std::cerr << "Hillshade::FindDemFile Unexpected size of " << dem_path->second << std::endl;
+        return nullptr;
+    }
+
+    new_dem_file.heights = new_dem_file.file->map(0, file_size);
+    if (!new_dem_file.heights)
+    {
+        std::cerr << "Hillshade::FindDemFile Failed to map " << dem_path->second << std::endl;
+        return nullptr;
+    }
+
+    new_dem_file.size = size;
+    last_dem_file_ = &new_dem_file;
+
+    return last_dem_file_;
+}
+
+bool Hillshade::Elevation(const double latitude, const double longitude, float& elevation)
+{
+    const auto south = static_cast<int>(std::floor(latitude));
+    const auto west = static_cast<int>(std::floor(longitude));
+
+    const auto dem_file = FindDemFile(south, west);
+    if (!dem_file)
+        return false;
+
+    // Edges of neighbouring squares repeat the same samples, so four samples never cross a file
+    const auto last_sample = dem_file->size - 1;
+    const auto row = (south + 1 - latitude) * last_sample;
+    const auto column = (longitude - west) * last_sample;
+    const auto top_row = std::min(static_cast<int>(row), last_sample - 1);
+    const auto left_column = std::min(static_cast<int>(column), last_sample - 1);
+    const auto row_fraction = static_cast<float>(row - top_row);
+    const auto column_fraction = static_cast<float>(column - left_column);
+
+    const auto top_samples = dem_file->heights + 2 * (static_cast<size_t>(top_row) * dem_file->size + left_column);
+    const auto bottom_samples = top_samples + 2 * static_cast<size_t>(dem_file->size);
+    const int heights[4] = { DemHeight(top_samples), DemHeight(top_samples + 2), DemHeight(bottom_samples), DemHeight(bottom_samples + 2) };
+    if (heights[0] == kDemVoidHeight || heights[1] == kDemVoidHeight || heights[2] == kDemVoidHeight || heights[3] == kDemVoidHeight)
+        return false;
+
+    const auto top = heights[0] + (heights[1] - heights[0]) * column_fraction;
+    const auto bottom = heights[2] + (heights[3] - heights[2]) * column_fraction;
+    elevation = top + (bottom - top) * row_fraction;
+
+    return true;
+}
+
+bool Hillshade::RenderTile(const map::Tile& tile, const unsigned int zoom, const int size, std::vector<uint32_t>& pixels)
+{
+    if (IsEmpty() || size <= 0)
+        return false;
+
+    const auto tile_bounds = projection::TileBounds(tile, zoom);
+    const auto pixel_length = (tile_bounds.top_right_point.x - tile_bounds.bottom_left_point.x) / size;
+    const auto grid_size = size + 2;
+
+    // EPSG:3857 axes are independent, longitude depends on column and latitude on row only
+    auto grid_longitudes = std::vector<double>(grid_size);
+    auto grid_latitudes = std::vector<double>(grid_size);
+    for (auto i = 0; i < grid_size; i++)
+    {
+        auto epsg_4326_point = projection::Epsg4326Point();
+        projection::ToEpsg4326(projection::Epsg3857Point(tile_bounds.bottom_left_point.x + (i - 0.5) * pixel_length,
+                                                         tile_bounds.top_right_point.y - (i - 0.5) * pixel_length), epsg_4326_point);
+
+        // Border of the leftmost and rightmost tiles wraps around antimeridian
+        grid_longitudes[i] = epsg_4326_point.longitude < -180 ? epsg_4326_point.longitude + 360
+                             : epsg_4326_point.longitude >= 180 ? epsg_4326_point.longitude - 360 : epsg_4326_point.longitude;
+        grid_latitudes[i] = std::clamp(epsg_4326_point.latitude, -89.999999, 89.999999);
+    }
+
+    // Missing samples are sea level, SRTM has no files for open sea
+    elevations_.assign(static_cast<size_t>(grid_size) * grid_size, 0);
+    auto has_data = false;
+    for (auto row = 0; row < grid_size; row++)
+    {
+        for (auto column = 0; column < grid_size; column++)
+            has_data |= Elevation(grid_latitudes[row], grid_longitudes[column], elevations_[static_cast<size_t>(row) * grid_size + column]);
+    }
+
+    if (!has_data)
+        return false;
+
+    pixels.resize(static_cast<size_t>(size) * size);
+    auto covered_pixels = uint32_t(0);
+    for (auto row = 0; row < size; row++)
+    {
+        // Pixel of EPSG:3857 is shorter on the ground by cosine of latitude
+        const auto ground_pixel_length = pixel_length * std::cos(grid_latitudes[row + 1] * M_PI / 180);
+        const auto scale = static_cast<float>(kVerticalExaggeration / (8 * ground_pixel_length));
+
+        const auto above = elevations_.data() + static_cast<size_t>(row) * grid_size;
+        covered_pixels |= ShadeRow(above, above + grid_size, above + 2 * grid_size, size, scale, pixels.data() + static_cast<size_t>(row) * size);
+    }
+
+    return covered_pixels != 0;
+}
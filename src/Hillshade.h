@@ -0,0 +1,69 @@
+#ifndef HILLSHADE_H
+#define HILLSHADE_H
+
+#include <string>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+#include <QFile>
+
+#include "Map.h"
+
+class Hillshade;
+using HillshadeUPtr = std::unique_ptr<Hillshade>;
+
+/* Relief shading of map tiles computed from local elevation data. DEM is a
+directory of SRTM tiles (N52E013.hgt etc.), one degree squares of big endian
+16 bit heights, mapped into memory on first use. Elevation is sampled at pixel
+centres of EPSG:3857 tile with one pixel border, and Horn's method gives slope
+and aspect of every pixel, shading for light from the north west. Pixels are
+translucent black on slopes facing away from light and translucent white on
+slopes facing it, flat ground stays clear, so tile is drawn over rendered map.
+Not thread safe, files are mapped by the thread rendering tiles */
+class Hillshade
+{
+public:
+    //! Fails if directory can not be read, no .hgt files in it gives empty hillshade
+    static HillshadeUPtr Create(const std::string& directory);
+    //! Directory from OPENROUTE_DEM, empty hillshade if it is not set
+    static HillshadeUPtr CreateFromEnvironment();
+
+    bool IsEmpty() const { return dem_paths_u_map_.empty(); }
+
+    /* Fills size x size premultiplied ARGB pixels (QImage::Format_ARGB32_Premultiplied)
+    of tile. Returns false if tile has no elevation data or no visible relief */
+    bool RenderTile(const map::Tile& tile, const unsigned int zoom, const int size, std::vector<uint32_t>& pixels);
+
+private:
+    struct DemFile
+    {
+        std::unique_ptr<QFile> file;
+        //! Rows from north to south, nullptr if file could not be mapped
+        const uint8_t* heights = nullptr;
+        //! Samples per side, 1201 for 3 arc seconds and 3601 for 1 arc second
+        int size = 0;
+    };
+
+    //! Paths of existing files by DemKey of their south west corner
+    std::unordered_map<int, std::string> dem_paths_u_map_;
+    std::unordered_map<int, DemFile> dem_files_u_map_;
+    //! Square of the previous lookup, -1 before the first one
+    int last_dem_key_ = -1;
+    const DemFile* last_dem_file_ = nullptr;
+
+    //! Elevations of tile with border, (size + 2) x (size + 2) from north to south
+    std::vector<float> elevations_;
+
+    Hillshade();
+
+    static int DemKey(const int latitude, const int longitude);
+
+    //! Maps file on first use, nullptr if there is no data for the square
+    const DemFile* FindDemFile(const int latitude, const int longitude);
+    //! Bilinear elevation in meters, returns false outside of available data
+    bool Elevation(const double latitude, const double longitude, float& elevation);
+};
+
+#endif // HILLSHADE_H
@@ -0,0 +1,173 @@
+#include "HillshadeService.h"
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+
+#include <QDir>
+#include <QFile>
+#include <QString>
+#include <QByteArray>
+
+#include "Trace.h"
+
+//! Path of tile in cache directory, zoom/x/y
+QString CachedTilePath(const std::string& cache_directory, const map::Tile& tile, const unsigned int zoom)
+{
+    return QString("%1/%2/%3/%4").arg(QString::fromStdString(cache_directory)).arg(zoom).arg(tile.x_index).arg(tile.y_index);
+}
+
+HillshadeService::HillshadeService(HillshadeUPtr hillshade_u_ptr, const int tile_size, const std::string& cache_directory)
+    : hillshade_u_ptr_(std::move(hillshade_u_ptr)), is_empty_(hillshade_u_ptr_->IsEmpty()), tile_size_(tile_size), cache_directory_(cache_directory)
+{
+
+}
+
+HillshadeServiceUPtr HillshadeService::Create(HillshadeUPtr hillshade_u_ptr, const int tile_size, const std::string& cache_directory)
+{
+    if (!hillshade_u_ptr)
+    {
+        std::cerr << "HillshadeService::Create Hillshade is not created" << std::endl;
+        return nullptr;
+    }
+
+    if (!cache_directory.empty() && !QDir().mkpath(QString::fromStdString(cache_directory)))
+    {
+        std::cerr << "HillshadeService::Create Failed to create cache directory " << cache_directory << std::endl;
+        return nullptr;
+    }
+
+    std::unique_ptr<HillshadeService> instance(new HillshadeService(std::move(hillshade_u_ptr), tile_size, cache_directory));
+
+    // Nothing is ever shaded without elevation data
+    if (!instance->is_empty_)
+        instance->worker_thread_ = std::thread([instance = instance.get()]() { instance->RunWorker(); });
+
+    return instance;
+}
+
+HillshadeServiceUPtr HillshadeService::CreateFromEnvironment(const int tile_size)
+{
+    const auto cache_directory = std::getenv("OPENROUTE_HILLSHADE_CACHE");
+
+    return Create(Hillshade::CreateFromEnvironment(), tile_size, cache_directory ? cache_directory : std::string());
+}
+
+HillshadeService::~HillshadeService()
+{
+    {
+        std::lock_guard tile_task_queue_lock(tile_task_queue_mutex_);
+        is_stopped_.store(true);
+    }
+
+    tile_task_added_or_stop_cv_.notify_all();
+
+    if (worker_thread_.joinable())
+        worker_thread_.join();
+}
+
+void HillshadeService::Submit(const map::Tile& tile, const unsigned int zoom, TileCallback on_shaded)
+{
+    if (is_empty_)
+        return;
+
+    {
+        std::lock_guard tile_task_queue_lock(tile_task_queue_mutex_);
+        tile_task_queue_.push_back(TileTask { tile, zoom, std::move(on_shaded) });
+    }
+
+    tile_task_added_or_stop_cv_.notify_one();
+}
+
+void HillshadeService::Clear()
+{
+    std::lock_guard tile_task_queue_lock(tile_task_queue_mutex_);
+    tile_task_queue_.clear();
+}
+
+void HillshadeService::RunWorker()
+{
+    for (;;)
+    {
+        std::unique_lock tile_task_queue_lock(tile_task_queue_mutex_);
+        tile_task_added_or_stop_cv_.wait(tile_task_queue_lock, [this]() {
+            return !tile_task_queue_.empty() || is_stopped_.load();
+        });
+
+        if (is_stopped_.load())
+            break;
+
+        auto tile_task = std::move(tile_task_queue_.front());
+        tile_task_queue_.pop_front();
+
+        tile_task_queue_lock.unlock();
+
+        auto pixels = std::vector<uint32_t>();
+        if (cache_directory_.empty() || !ReadCachedTile(tile_task.tile, tile_task.zoom, pixels))
+        {
+            const auto hillshade_span = trace::Span("Hillshade tile");
+
+            if (!hillshade_u_ptr_->RenderTile(tile_task.tile, tile_task.zoom, tile_size_, pixels))
+                pixels.clear();
+
+            if (!cache_directory_.empty())
+                WriteCachedTile(tile_task.tile, tile_task.zoom, pixels);
+        }
+
+        tile_task.on_shaded(tile_task.tile, tile_task.zoom, std::move(pixels));
+    }
+}
+
+bool HillshadeService::ReadCachedTile(const map::Tile& tile, const unsigned int zoom, std::vector<uint32_t>& pixels) const
+{
+    auto file = QFile(CachedTilePath(cache_directory_, tile, zoom));
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    const auto compressed_pixels = file.readAll();
+    if (compressed_pixels.isEmpty())
+        return true;
+
+    // Tile of other size or damaged file is shaded again and overwritten
+    const auto pixel_bytes = qUncompress(compressed_pixels);
+    if (static_cast<size_t>(pixel_bytes.size()) != static_cast<size_t>(tile_size_) * tile_size_ * sizeof(uint32_t))
+        return false;
+
+    pixels.resize(static_cast<size_t>(tile_size_) * tile_size_);
+    std::memcpy(pixels.data(), pixel_bytes.constData(), pixel_bytes.size());
+
+    return true;
+}
+
+void HillshadeService::WriteCachedTile(const map::Tile& tile, const unsigned int zoom, const std::vector<uint32_t>& pixels) const
+{
+    const auto path = CachedTilePath(cache_directory_, tile, zoom);
+    if (!QDir().mkpath(QString("%1/%2/%3").arg(QString::fromStdString(cache_directory_)).arg(zoom).arg(tile.x_index)))
+    {
+        std::cerr << "HillshadeService::WriteCachedTile Failed to create directory for " << path.toStdString() << std::endl;
+        return;
+    }
+
+    // Written aside and renamed, so a crash never leaves a truncated tile under its name
+    const auto temporary_path = path + ".tmp";
+    auto file = QFile(temporary_path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        std::cerr << "HillshadeService::WriteCachedTile Failed to open " << temporary_path.toStdString() << std::endl;
+        return;
+    }
+
+    if (!pixels.empty() && file.write(qCompress(reinterpret_cast<const uchar*>(pixels.data()), static_cast<int>(pixels.size() * sizeof(uint32_t)))) < 0)
+    {
+        std::cerr << "HillshadeService::WriteCachedTile Failed to write " << temporary_path.toStdString() << std::endl;
+        file.close();
+        QFile::remove(temporary_path);
+        return;
+    }
+
+    file.close();
+
+    QFile::remove(path);
+    if (!QFile::rename(temporary_path, path))
+        std::cerr << "HillshadeService::WriteCachedTile Failed to write " << path.toStdString() << std::endl;
+}
@@ -0,0 +1,71 @@
+#ifndef HILLSHADESERVICE_H
+#define HILLSHADESERVICE_H
+
+#include <thread>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <functional>
+#include <condition_variable>
+
+#include "Hillshade.h"
+
+class HillshadeService;
+using HillshadeServiceUPtr = std::unique_ptr<HillshadeService>;
+
+/* Shades tiles on a worker thread owning Hillshade, which is not thread safe
+and takes tens of milliseconds per tile, too long for the UI thread. With a
+cache directory shaded tiles are also kept on disk as zoom/x/y files (y
+counted from the south as in map::Tile), so relief is computed once per tile
+across sessions. A file holds compressed pixels, empty file marks a tile
+without relief. Cache is not invalidated, it is removed when DEM changes */
+class HillshadeService
+{
+public:
+    //! Pixels are empty if tile has no relief
+    using TileCallback = std::function<void(const map::Tile& tile, const unsigned int zoom, std::vector<uint32_t>&& pixels)>;
+
+    //! Empty cache directory keeps tiles in memory of the caller only
+    static HillshadeServiceUPtr Create(HillshadeUPtr hillshade_u_ptr, const int tile_size, const std::string& cache_directory);
+    //! Hillshade from OPENROUTE_DEM, disk cache from OPENROUTE_HILLSHADE_CACHE if it is set
+    static HillshadeServiceUPtr CreateFromEnvironment(const int tile_size);
+    ~HillshadeService();
+
+    bool IsEmpty() const { return is_empty_; }
+
+    /* Queues tile, on_shaded is called in the worker thread. It is not called
+    for tasks dropped by Clear or still queued when service is destroyed */
+    void Submit(const map::Tile& tile, const unsigned int zoom, TileCallback on_shaded);
+    //! Drops queued tasks, e.g. of the previous zoom, the running one still completes
+    void Clear();
+
+private:
+    struct TileTask
+    {
+        map::Tile tile;
+        unsigned int zoom;
+        TileCallback on_shaded;
+    };
+
+    HillshadeUPtr hillshade_u_ptr_;
+    bool is_empty_;
+    int tile_size_;
+    std::string cache_directory_;
+
+    std::mutex tile_task_queue_mutex_;
+    std::deque<TileTask> tile_task_queue_;
+    std::condition_variable tile_task_added_or_stop_cv_;
+
+    std::atomic<bool> is_stopped_ = false;
+    std::thread worker_thread_;
+
+    HillshadeService(HillshadeUPtr hillshade_u_ptr, const int tile_size, const std::string& cache_directory);
+
+    void RunWorker();
+    //! Reads tile from disk cache, returns false if it is not there
+    bool ReadCachedTile(const map::Tile& tile, const unsigned int zoom, std::vector<uint32_t>& pixels) const;
+    void WriteCachedTile(const map::Tile& tile, const unsigned int zoom, const std::vector<uint32_t>& pixels) const;
+};
+
+#endif // HILLSHADESERVICE_H
@@ -0,0 +1,299 @@
+#include "Isochrone.h"
+
+#include <array>
+#include <cmath>
+#include <algorithm>
+
+#include "SearchSpace.h"
+#include "Dijkstra.h"
+#include "LineSimplification.h"
+
+//! Number of grid cells along each axis, defines polygon resolution
+constexpr int kIsochroneGridSize { 256 };
+//! Gaps between reachable roads narrower than this (in cells) are closed
+constexpr int kIsochroneClosingRadius { 2 };
+//! Holes smaller than this (in cells) are dropped
+constexpr double kIsochroneMinHoleCellArea { 48 };
+
+/* Raster of reachable area used to trace polygon boundary. Cell (x, y)
+covers [min_x + x * cell_size, min_x + (x + 1) * cell_size) and the same along y */
+struct IsochroneGrid
+{
+    double min_x;
+    double min_y;
+    double cell_size;
+    std::vector<char> cells;
+
+    bool IsFilled(const int x, const int y) const
+    {
+        if (x < 0 || y < 0 || x >= kIsochroneGridSize || y >= kIsochroneGridSize)
+            return false;
+
+        return cells[y * kIsochroneGridSize + x];
+    }
+
+    void Mark(const double point_x, const double point_y)
+    {
+        const auto x = static_cast<int>(std::floor((point_x - min_x) / cell_size));
+        const auto y = static_cast<int>(std::floor((point_y - min_y) / cell_size));
+
+        if (x < 0 || y < 0 || x >= kIsochroneGridSize || y >= kIsochroneGridSize)
+            return;
+
+        cells[y * kIsochroneGridSize + x] = 1;
+    }
+
+    void MarkSegment(const projection::Epsg3857Point& start, const projection::Epsg3857Point& end)
+    {
+        const auto length = std::hypot(end.x - start.x, end.y - start.y);
+        const auto step_count = static_cast<int>(std::ceil(2 * length / cell_size)) + 1;
+
+        for (auto step = 0; step <= step_count; step++)
+        {
+            const auto t = static_cast<double>(step) / step_count;
+            Mark(start.x + (end.x - start.x) * t, start.y + (end.y - start.y) * t);
+        }
+    }
+
+    //! Morphological dilation (is_dilation) or erosion with square of given radius, separable
+    void Morph(const int radius, const bool is_dilation)
+    {
+        auto buffer = std::vector<char>(cells.size());
+
+        const auto pass = [&](const std::vector<char>& input, std::vector<char>& output, const bool is_horizontal) {
+            for (auto y = 0; y < kIsochroneGridSize; y++)
+            {
+                for (auto x = 0; x < kIsochroneGridSize; x++)
+                {
+                    auto value = static_cast<char>(!is_dilation);
+                    for (auto offset = -radius; offset <= radius; offset++)
+                    {
+                        const auto nx = is_horizontal ? x + offset : x;
+                        const auto ny = is_horizontal ? y : y + offset;
+                        const auto inside = nx >= 0 && ny >= 0 && nx < kIsochroneGridSize && ny < kIsochroneGridSize;
+                        const auto neighbour = inside ? input[ny * kIsochroneGridSize + nx] : 0;
+
+                        if (is_dilation && neighbour)
+                        {
+                            value = 1;
+                            break;
+                        }
+                        if (!is_dilation && !neighbour)
+                        {
+                            value = 0;
+                            break;
+                        }
+                    }
+                    output[y * kIsochroneGridSize + x] = value;
+                }
+            }
+        };
+
+        pass(cells, buffer, true);
+        pass(buffer, cells, false);
+    }
+};
+
+double SignedRingArea(const Epsg3857Ring& ring)
+{
+    auto area = 0.0;
+    for (size_t i = 1; i < ring.size(); i++)
+        area += ring[i - 1].x * ring[i].y - ring[i].x * ring[i - 1].y;
+
+    return area / 2;
+}
+
+/* Chains cell sides that separate filled and empty cells into closed rings.
+Sides are directed so that filled cells stay on the left, which makes outer
+rings counter-clockwise and holes clockwise */
+void TraceIsochroneRings(const IsochroneGrid& grid, std::vector<Epsg3857Ring>& rings)
+{
+    struct BoundaryEdge
+    {
+        int32_t start_corner;
+        int32_t end_corner;
+        int direction; // 0 is +x, 1 is +y, 2 is -x, 3 is -y
+    };
+
+    constexpr auto kCornerRowSize = kIsochroneGridSize + 1;
+    const auto corner = [](const int x, const int y) { return y * kCornerRowSize + x; };
+
+    auto edges = std::vector<BoundaryEdge>();
+    auto corner_edges = std::vector<std::array<int32_t, 2>>(kCornerRowSize * kCornerRowSize, { -1, -1 });
+
+    const auto add_edge = [&](const int32_t start_corner, const int32_t end_corner, const int direction) {
+        auto& outgoing = corner_edges[start_corner];
+        outgoing[outgoing[0] < 0 ? 0 : 1] = static_cast<int32_t>(edges.size());
+        edges.push_back(BoundaryEdge { start_corner, end_corner, direction });
+    };
+
+    for (auto y = 0; y < kIsochroneGridSize; y++)
+    {
+        for (auto x = 0; x < kIsochroneGridSize; x++)
+        {
+            if (!grid.IsFilled(x, y))
+                continue;
+
+            if (!grid.IsFilled(x, y - 1))
+                add_edge(corner(x, y), corner(x + 1, y), 0);
+            if (!grid.IsFilled(x + 1, y))
+                add_edge(corner(x + 1, y), corner(x + 1, y + 1), 1);
+            if (!grid.IsFilled(x, y + 1))
+                add_edge(corner(x + 1, y + 1), corner(x, y + 1), 2);
+            if (!grid.IsFilled(x - 1, y))
+                add_edge(corner(x, y + 1), corner(x, y), 3);
+        }
+    }
+
+    const auto corner_point = [&grid](const int32_t corner_index) {
+        return projection::Epsg3857Point(grid.min_x + (corner_index % kCornerRowSize) * grid.cell_size,
+                                         grid.min_y + (corner_index / kCornerRowSize) * grid.cell_size);
+    };
+
+    auto is_used = std::vector<char>(edges.size(), 0);
+    auto ring = Epsg3857Ring();
+    for (size_t first_edge = 0; first_edge < edges.size(); first_edge++)
+    {
+        if (is_used[first_edge])
+            continue;
+
+        ring.clear();
+        auto current_edge = static_cast<int32_t>(first_edge);
+        for (;;)
+        {
+            is_used[current_edge] = 1;
+            ring.push_back(corner_point(edges[current_edge].start_corner));
+
+            // On saddle corners prefer left turn, so diagonal cells become separate rings
+            const auto& outgoing = corner_edges[edges[current_edge].end_corner];
+            const auto direction = edges[current_edge].direction;
+            auto next_edge = -1;
+            for (const auto turn : { 1, 0, 3 })
+            {
+                for (const auto candidate : outgoing)
+                {
+                    if (candidate >= 0 && edges[candidate].direction == (direction + turn) % 4)
+                    {
+                        next_edge = candidate;
+                        break;
+                    }
+                }
+                if (next_edge >= 0)
+                    break;
+            }
+
+            if (next_edge < 0 || is_used[next_edge])
+                break;
+
+            current_edge = next_edge;
+        }
+
+        ring.push_back(ring.front());
+        rings.push_back(ring);
+    }
+}
+
+Isochrone::Isochrone(const RoadGraph& road_graph, const ArcWeights& arc_weights, const uint32_t origin_vertex, const double max_cost)
+    : road_graph_(road_graph), arc_weights_(arc_weights), origin_vertex_(origin_vertex), max_cost_(max_cost)
+{
+
+}
+
+IsochroneUPtr Isochrone::Create(const RoadGraph& road_graph, const ArcWeights& arc_weights, const uint32_t origin_vertex, const double max_cost)
+{
+    std::unique_ptr<Isochrone> instance(new Isochrone(road_graph, arc_weights, origin_vertex, max_cost));
+
+    auto search_space = SearchSpace(road_graph.VertexCount());
+    dijkstra::SearchBounded(road_graph, arc_weights, origin_vertex, max_cost, search_space, instance->settled_vertices_);
+
+    instance->settled_costs_.reserve(instance->settled_vertices_.size());
+    for (const auto vertex : instance->settled_vertices_)
+        instance->settled_costs_.push_back(search_space.Cost(vertex));
+
+    return instance;
+}
+
+void Isochrone::BuildRings(const double cost, std::vector<Epsg3857Ring>& rings) const
+{
+    const auto budget = std::min(cost, max_cost_);
+    if (budget <= 0)
+        return;
+
+    /* Nothing moves faster than profile maximal speed, so everything reachable
+    lies within budget * speed from origin. Margin keeps dilated cells inside the grid */
+    const auto reach = budget * arc_weights_.MaxSpeed();
+    const auto half_extent = reach + 2.0 * reach * (kIsochroneClosingRadius + 2) / kIsochroneGridSize;
+
+    auto grid = IsochroneGrid();
+    grid.min_x = Origin().x - half_extent;
+    grid.min_y = Origin().y - half_extent;
+    grid.cell_size = 2 * half_extent / kIsochroneGridSize;
+    grid.cells.assign(kIsochroneGridSize * kIsochroneGridSize, 0);
+
+    const auto settled_end = std::upper_bound(settled_costs_.begin(), settled_costs_.end(), budget) - settled_costs_.begin();
+
+    auto shape = std::vector<projection::Epsg3857Point>();
+    double remaining_cost, remaining_length, segment_length;
+    for (auto i = 0; i < settled_end; i++)
+    {
+        const auto vertex = settled_vertices_[i];
+        const auto& point = road_graph_.VertexPoint(vertex);
+        grid.Mark(point.x, point.y);
+
+        remaining_cost = budget - settled_costs_[i];
+        for (auto arc = road_graph_.FirstArc(vertex); arc < road_graph_.FirstArc(vertex + 1); arc++)
+        {
+            const auto weight = arc_weights_.Weight(arc);
+            if (!ArcWeights::IsAccessible(weight))
+                continue;
+
+            shape.clear();
+            road_graph_.ArcShape(arc, shape);
+
+            // Edge may be reachable only partially, walk along its shape until budget is spent
+            const auto fraction = weight > 0 ? std::min(1.0, remaining_cost / weight) : 1.0;
+
+            auto shape_length = 0.0;
+            for (size_t j = 1; j < shape.size(); j++)
+                shape_length += std::hypot(shape[j].x - shape[j - 1].x, shape[j].y - shape[j - 1].y);
+
+            remaining_length = fraction * shape_length;
+            for (size_t j = 1; j < shape.size() && remaining_length > 0; j++)
+            {
+                segment_length = std::hypot(shape[j].x - shape[j - 1].x, shape[j].y - shape[j - 1].y);
+                if (segment_length <= remaining_length)
+                {
+                    grid.MarkSegment(shape[j - 1], shape[j]);
+                }
+                else
+                {
+                    const auto t = remaining_length / segment_length;
+                    grid.MarkSegment(shape[j - 1], projection::Epsg3857Point(
+                        shape[j - 1].x + (shape[j].x - shape[j - 1].x) * t,
+                        shape[j - 1].y + (shape[j].y - shape[j - 1].y) * t));
+                }
+
+                remaining_length -= segment_length;
+            }
+        }
+    }
+
+    // Closing fills gaps between neighbouring roads, extra dilation leaves margin around roads
+    grid.Morph(kIsochroneClosingRadius + 1, true);
+    grid.Morph(kIsochroneClosingRadius, false);
+
+    auto traced_rings = std::vector<Epsg3857Ring>();
+    TraceIsochroneRings(grid, traced_rings);
+
+    const auto min_hole_area = kIsochroneMinHoleCellArea * grid.cell_size * grid.cell_size;
+    for (const auto& traced_ring : traced_rings)
+    {
+        if (SignedRingArea(traced_ring) < 0 && -SignedRingArea(traced_ring) < min_hole_area)
+            continue;
+
+        auto ring = Epsg3857Ring();
+        line_simplification::Simplify(traced_ring, grid.cell_size * 0.75, ring);
+        if (ring.size() >= 4)
+            rings.push_back(std::move(ring));
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef ISOCHRONE_H
+#define ISOCHRONE_H
+
+#include "RoadGraph.h"
+#include "ArcWeights.h"
+
+class Isochrone;
+using IsochroneUPtr = std::unique_ptr<Isochrone>;
+
+using Epsg3857Ring = std::vector<projection::Epsg3857Point>;
+
+/* Area reachable from origin vertex. Search runs once up to max_cost and
+keeps settled vertices ordered by cost, so polygon for any smaller cost is
+built from a prefix of them without searching again */
+class Isochrone
+{
+public:
+    static IsochroneUPtr Create(const RoadGraph& road_graph, const ArcWeights& arc_weights, const uint32_t origin_vertex, const double max_cost);
+
+    double MaxCost() const { return max_cost_; }
+    const projection::Epsg3857Point& Origin() const { return road_graph_.VertexPoint(origin_vertex_); }
+
+    /* Builds simplified boundary of area reachable within cost. Outer rings are
+    counter-clockwise, holes are clockwise, each ring repeats its first point */
+    void BuildRings(const double cost, std::vector<Epsg3857Ring>& rings) const;
+
+private:
+    const RoadGraph& road_graph_;
+    //! Copy shares weights array and keeps road overrides alive
+    ArcWeights arc_weights_;
+    uint32_t origin_vertex_;
+    double max_cost_;
+
+    std::vector<uint32_t> settled_vertices_;
+    std::vector<double> settled_costs_;
+
+    Isochrone(const RoadGraph& road_graph, const ArcWeights& arc_weights, const uint32_t origin_vertex, const double max_cost);
+};
+
+#endif // ISOCHRONE_H
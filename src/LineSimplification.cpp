@@ -0,0 +1,89 @@
+#include "LineSimplification.h"
+
+#include <utility>
+
+double SquaredDistanceToSegment(const projection::Epsg3857Point& point,
+                                const projection::Epsg3857Point& start, const projection::Epsg3857Point& end)
+{
+    auto x = start.x;
+    auto y = start.y;
+    auto dx = end.x - x;
+    auto dy = end.y - y;
+
+    if (dx != 0 || dy != 0)
+    {
+        const auto t = ((point.x - x) * dx + (point.y - y) * dy) / (dx * dx + dy * dy);
+        if (t > 1)
+        {
+            x = end.x;
+            y = end.y;
+        }
+        else if (t > 0)
+        {
+            x += dx * t;
+            y += dy * t;
+        }
+    }
+
+    dx = point.x - x;
+    dy = point.y - y;
+    return dx * dx + dy * dy;
+}
+
+namespace line_simplification {
+
+void Simplify(const std::vector<projection::Epsg3857Point>& points, const double tolerance,
+              std::vector<projection::Epsg3857Point>& simplified_points)
+{
+    if (points.size() < 3)
+    {
+        simplified_points.insert(simplified_points.end(), points.begin(), points.end());
+        return;
+    }
+
+    const auto squared_tolerance = tolerance * tolerance;
+
+    auto is_kept = std::vector<char>(points.size(), 0);
+    is_kept.front() = 1;
+    is_kept.back() = 1;
+
+    // Iterative version to avoid deep recursion on long tracks
+    auto range_stack = std::vector<std::pair<size_t, size_t>>();
+    range_stack.emplace_back(0, points.size() - 1);
+
+    size_t first, last, farthest;
+    double max_squared_distance, squared_distance;
+    for (; !range_stack.empty();)
+    {
+        first = range_stack.back().first;
+        last = range_stack.back().second;
+        range_stack.pop_back();
+
+        max_squared_distance = 0;
+        farthest = first;
+        for (auto i = first + 1; i < last; i++)
+        {
+            squared_distance = SquaredDistanceToSegment(points[i], points[first], points[last]);
+            if (squared_distance > max_squared_distance)
+            {
+                max_squared_distance = squared_distance;
+                farthest = i;
+            }
+        }
+
+        if (max_squared_distance <= squared_tolerance)
+            continue;
+
+        is_kept[farthest] = 1;
+        range_stack.emplace_back(first, farthest);
+        range_stack.emplace_back(farthest, last);
+    }
+
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        if (is_kept[i])
+            simplified_points.push_back(points[i]);
+    }
+}
+
+} // namespace line_simplification
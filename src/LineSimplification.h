@@ -0,0 +1,18 @@
+#ifndef LINESIMPLIFICATION_H
+#define LINESIMPLIFICATION_H
+
+#include <vector>
+
+#include "Projection.h"
+
+namespace line_simplification {
+
+/* Douglas-Peucker simplification. Keeps end points and every point that
+deviates from simplified line more than tolerance. Closed rings must
+repeat the first point at the end */
+void Simplify(const std::vector<projection::Epsg3857Point>& points, const double tolerance,
+              std::vector<projection::Epsg3857Point>& simplified_points);
+
+} // namespace line_simplification
+
+#endif // LINESIMPLIFICATION_H
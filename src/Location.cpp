@@ -2,89 +2,447 @@
 
 #include <sstream>
 #include <iostream>
+#include <algorithm>
+#include <vector>
+#include <cmath>
+#include <cerrno>
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
 #include <curl/curl.h>
 
 #include "rapidjson/document.h"
 
+constexpr char kGpsdScheme[] = "gpsd://";
+constexpr char kGpsdDefaultPort[] = "2947";
+//! Asks gpsd to stream raw NMEA sentences
+constexpr char kGpsdWatchCommand[] = "?WATCH={\"enable\":true,\"nmea\":true}\n";
+
+//! Stream is polled in slices so that stop request is noticed quickly
+constexpr std::chrono::milliseconds kNmeaPollSlice { 100 };
+//! Incomplete line longer than this is garbage, NMEA sentence is at most 82 characters
+constexpr size_t kNmeaMaxLineBufferSize { 64 * 1024 };
+
 size_t WriteCallback(void *contents, size_t size, size_t nmemb, std::string *buffer)
 {
     buffer->append((char *)contents, size * nmemb);
     return size * nmemb;
 }
 
-bool RequestToIpInfo(std::string& read_buffer)
+//! Nonzero return aborts transfer
+int AbortTransferOnStop(void* is_stopped, curl_off_t, curl_off_t, curl_off_t, curl_off_t)
+{
+    return static_cast<const std::atomic<bool>*>(is_stopped)->load() ? 1 : 0;
+}
+
+bool RequestToLocationEndpoint(const std::string& url, const std::chrono::milliseconds timeout, const std::atomic<bool>& is_stopped,
+                               std::string& read_buffer)
 {
     const auto curl = curl_easy_init();
     if (!curl) {
-        std::cerr << "RequestToIpInfo - failed to init curl" << std::endl;
+        std::cerr << "RequestToLocationEndpoint - failed to init curl" << std::endl;
         return false;
     }
 
-    curl_easy_setopt(curl, CURLOPT_URL, "https://ipinfo.io/json");
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, &read_buffer);
+    curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+
+    // Signals can not be used for timeouts outside of main thread
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, static_cast<long>(timeout.count()));
+    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+    curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, AbortTransferOnStop);
+    curl_easy_setopt(curl, CURLOPT_XFERINFODATA, const_cast<std::atomic<bool>*>(&is_stopped));
 
     const auto res = curl_easy_perform(curl);
     curl_easy_cleanup(curl);
 
     if (res != CURLE_OK) {
-        std::cerr << "RequestToIpInfo - error while using curl: " << curl_easy_strerror(res) << std::endl;
+        std::cerr << "RequestToLocationEndpoint - error while requesting " << url << ": " << curl_easy_strerror(res) << std::endl;
         return false;
     }
 
     return true;
 }
 
-bool ParseJsonForLocationField(const std::string& read_buffer, std::string& location)
+bool ParseLocationString(const std::string& location_string, projection::Epsg4326Point& epsg_4326_point)
+{
+    auto stream = std::istringstream(location_string);
+
+    /* In other locales separator symbol ',' may be treated as a part
+    of a number resulting in inability to read correctly */
+    stream.imbue(std::locale::classic());
+
+    char separator;
+    return static_cast<bool>(stream >> epsg_4326_point.latitude >> separator >> epsg_4326_point.longitude) && separator == ',';
+}
+
+bool ParseJsonForLocation(const std::string& read_buffer, projection::Epsg4326Point& epsg_4326_point)
 {
     rapidjson::Document json_response;
     json_response.Parse(read_buffer.c_str());
 
-    if (json_response.HasParseError() || !json_response.HasMember("loc")) {
-        std::cerr << "ParseJsonForLocationField - failed to parse response from ipinfo" << std::endl;
+    if (json_response.HasParseError() || !json_response.IsObject()) {
+        std::cerr << "ParseJsonForLocation - failed to parse response" << std::endl;
         return false;
     }
 
-    const rapidjson::Value& loc = json_response["loc"];
-    if (!loc.IsString()){
-        std::cerr << "ParseJsonForLocationField - loc field is not a string";
-        return false;
+    if (json_response.HasMember("loc") && json_response["loc"].IsString())
+        return ParseLocationString(json_response["loc"].GetString(), epsg_4326_point);
+
+    if (json_response.HasMember("lat") && json_response["lat"].IsNumber()
+        && json_response.HasMember("lon") && json_response["lon"].IsNumber())
+    {
+        epsg_4326_point.latitude = json_response["lat"].GetDouble();
+        epsg_4326_point.longitude = json_response["lon"].GetDouble();
+        return true;
     }
 
-    location = loc.GetString();
+    std::cerr << "ParseJsonForLocation - response has neither loc nor lat and lon fields" << std::endl;
+    return false;
+}
+
+//! Degrees from NMEA "ddmm.mmmm" (latitude) or "dddmm.mmmm" (longitude) field and hemisphere letter, degrees are kept on failure
+bool ParseNmeaCoordinate(const std::string& value, const std::string& hemisphere, const size_t degree_digit_count, double& degrees)
+{
+    if (value.size() <= degree_digit_count || hemisphere.size() != 1)
+        return false;
+
+    auto stream = std::istringstream(value);
+    stream.imbue(std::locale::classic());
+
+    double raw_value;
+    if (!(stream >> raw_value))
+        return false;
+
+    if (hemisphere != "N" && hemisphere != "S" && hemisphere != "E" && hemisphere != "W")
+        return false;
+
+    const auto whole_degrees = std::floor(raw_value / 100);
+    const auto absolute_degrees = whole_degrees + (raw_value - whole_degrees * 100) / 60;
+    degrees = hemisphere == "S" || hemisphere == "W" ? -absolute_degrees : absolute_degrees;
 
     return true;
 }
 
-void ParseLocationString(const std::string& location_string, projection::Epsg4326Point& epsg_4326_point)
+/* Parses "$xxRMC" with active status or "$xxGGA" with nonzero fix quality,
+any talker. Sentence without valid checksum is rejected. Point is written
+only when both coordinates are valid, so a previous fix is never half replaced */
+bool ParseNmeaSentence(const std::string& line, projection::Epsg4326Point& epsg_4326_point)
 {
-    auto stream = std::istringstream(location_string);
+    const auto start = line.find('$');
+    const auto checksum_start = line.find('*', start);
+    if (start == std::string::npos || checksum_start == std::string::npos || checksum_start + 3 > line.size())
+        return false;
 
-    /* In other locales separator symbol ',' may be treated as a part
-    of a number resulting in inability to read correctly */
-    stream.imbue(std::locale("en_US.utf8"));
+    auto checksum = 0;
+    for (auto i = start + 1; i < checksum_start; i++)
+        checksum ^= static_cast<unsigned char>(line[i]);
+
+    if (std::strtol(line.substr(checksum_start + 1, 2).c_str(), nullptr, 16) != checksum)
+        return false;
 
-    stream >> epsg_4326_point.latitude;
-    stream.ignore(); // Skip separator ','
-    stream >> epsg_4326_point.longitude;
+    auto fields = std::vector<std::string>();
+    auto stream = std::istringstream(line.substr(start + 1, checksum_start - start - 1));
+    for (auto field = std::string(); std::getline(stream, field, ',');)
+        fields.push_back(field);
+
+    if (fields.empty() || fields[0].size() != 5)
+        return false;
+
+    const auto sentence_type = fields[0].substr(2);
+    size_t latitude_field;
+    if (sentence_type == "RMC" && fields.size() > 6 && fields[2] == "A")
+        latitude_field = 3;
+    else if (sentence_type == "GGA" && fields.size() > 6 && !fields[6].empty() && fields[6] != "0")
+        latitude_field = 2;
+    else
+        return false;
+
+    double latitude, longitude;
+    if (!ParseNmeaCoordinate(fields[latitude_field], fields[latitude_field + 1], 2, latitude)
+        || !ParseNmeaCoordinate(fields[latitude_field + 2], fields[latitude_field + 3], 3, longitude))
+        return false;
+
+    epsg_4326_point.latitude = latitude;
+    epsg_4326_point.longitude = longitude;
+
+    return true;
 }
 
-namespace location {
+/* Connects to gpsd "host:port" within timeout and subscribes to NMEA, descriptor
+is nonblocking. Connection is awaited in slices, stop request abandons it */
+bool ConnectToGpsd(const std::string& address, const std::chrono::milliseconds timeout, const std::atomic<bool>& is_stopped, int& descriptor)
+{
+    const auto port_separator = address.rfind(':');
+    const auto host = address.substr(0, port_separator);
+    const auto port = port_separator == std::string::npos ? std::string(kGpsdDefaultPort) : address.substr(port_separator + 1);
+
+    auto hints = addrinfo();
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    addrinfo* addresses;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses) != 0)
+    {
+        std::cerr << "ConnectToGpsd - failed to resolve " << address << std::endl;
+        return false;
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+    descriptor = -1;
+    for (auto current = addresses; current && descriptor < 0 && !is_stopped.load(); current = current->ai_next)
+    {
+        descriptor = socket(current->ai_family, current->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, current->ai_protocol);
+        if (descriptor < 0)
+            continue;
+
+        if (connect(descriptor, current->ai_addr, current->ai_addrlen) == 0)
+            break;
+
+        auto ready_count = errno == EINPROGRESS ? 0 : -1;
+        for (; ready_count == 0 && !is_stopped.load();)
+        {
+            const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            if (remaining.count() <= 0)
+                break;
+
+            auto poll_descriptor = pollfd { descriptor, POLLOUT, 0 };
+            ready_count = poll(&poll_descriptor, 1, static_cast<int>(std::min(remaining, kNmeaPollSlice).count()));
+            if (ready_count < 0 && errno == EINTR)
+                ready_count = 0;
+        }
+
+        auto error = 0;
+        auto error_size = socklen_t(sizeof(error));
+        if (ready_count == 1 && getsockopt(descriptor, SOL_SOCKET, SO_ERROR, &error, &error_size) == 0 && error == 0)
+            break;
+
+        close(descriptor);
+        descriptor = -1;
+    }
+
+    freeaddrinfo(addresses);
+
+    if (descriptor < 0 && is_stopped.load())
+        return false;
+
+    if (descriptor < 0)
+    {
+        std::cerr << "ConnectToGpsd - failed to connect to " << address << std::endl;
+        return false;
+    }
+
+    const auto command_size = sizeof(kGpsdWatchCommand) - 1;
+    if (write(descriptor, kGpsdWatchCommand, command_size) != static_cast<ssize_t>(command_size))
+    {
+        std::cerr << "ConnectToGpsd - failed to send watch command to " << address << std::endl;
+        close(descriptor);
+        descriptor = -1;
+        return false;
+    }
+
+    return true;
+}
 
-bool RequestDeviceLocation(projection::Epsg4326Point& epsg_4326_point)
+HttpLocationProvider::HttpLocationProvider(const std::string& url)
+    : url_(url)
+{
+
+}
+
+LocationProviderUPtr HttpLocationProvider::Create(const std::string& url)
+{
+    if (url.empty())
+    {
+        std::cerr << "HttpLocationProvider::Create Url is empty" << std::endl;
+        return nullptr;
+    }
+
+    return LocationProviderUPtr(new HttpLocationProvider(url));
+}
+
+bool HttpLocationProvider::RequestLocation(const std::chrono::milliseconds timeout, const std::atomic<bool>& is_stopped,
+                                           projection::Epsg4326Point& epsg_4326_point)
 {
     auto read_buffer = std::string();
 
-    if(!RequestToIpInfo(read_buffer))
+    if (!RequestToLocationEndpoint(url_, timeout, is_stopped, read_buffer))
         return false;
 
-    auto location_string = std::string();
-    if(!ParseJsonForLocationField(read_buffer, location_string))
+    return ParseJsonForLocation(read_buffer, epsg_4326_point);
+}
+
+NmeaLocationProvider::NmeaLocationProvider(const std::string& source)
+    : source_(source)
+{
+
+}
+
+NmeaLocationProvider::~NmeaLocationProvider()
+{
+    Close();
+}
+
+LocationProviderUPtr NmeaLocationProvider::Create(const std::string& source)
+{
+    if (source.empty())
+    {
+        std::cerr << "NmeaLocationProvider::Create Source is empty" << std::endl;
+        return nullptr;
+    }
+
+    // Source is opened on first request, device may be plugged in later
+    return LocationProviderUPtr(new NmeaLocationProvider(source));
+}
+
+bool NmeaLocationProvider::Open(const std::chrono::milliseconds timeout, const std::atomic<bool>& is_stopped)
+{
+    line_buffer_.clear();
+
+    if (source_.rfind(kGpsdScheme, 0) == 0)
+    {
+        is_regular_file_ = false;
+        return ConnectToGpsd(source_.substr(sizeof(kGpsdScheme) - 1), timeout, is_stopped, descriptor_);
+    }
+
+    descriptor_ = open(source_.c_str(), O_RDONLY | O_NONBLOCK | O_NOCTTY | O_CLOEXEC);
+    if (descriptor_ < 0)
+    {
+        std::cerr << "NmeaLocationProvider::Open Failed to open " << source_ << std::endl;
         return false;
+    }
 
-    ParseLocationString(location_string, epsg_4326_point);
+    struct stat file_status;
+    is_regular_file_ = fstat(descriptor_, &file_status) == 0 && S_ISREG(file_status.st_mode);
 
     return true;
 }
 
-} // namespace location
+void NmeaLocationProvider::Close()
+{
+    if (descriptor_ >= 0)
+        close(descriptor_);
+
+    descriptor_ = -1;
+}
+
+bool NmeaLocationProvider::Read(const std::chrono::milliseconds timeout, size_t& byte_count)
+{
+    byte_count = 0;
+
+    auto poll_descriptor = pollfd { descriptor_, POLLIN, 0 };
+    const auto ready_count = poll(&poll_descriptor, 1, static_cast<int>(timeout.count()));
+    if (ready_count < 0)
+        return errno == EINTR;
+
+    if (ready_count == 0)
+        return true;
+
+    char buffer[4096];
+    const auto read_count = read(descriptor_, buffer, sizeof(buffer));
+    if (read_count < 0)
+        return errno == EAGAIN || errno == EINTR;
+
+    // End of file, or writer of stream is gone
+    if (read_count == 0)
+        return false;
+
+    line_buffer_.append(buffer, read_count);
+    byte_count = read_count;
+
+    return true;
+}
+
+bool NmeaLocationProvider::TakeFix(const bool is_first_only, projection::Epsg4326Point& epsg_4326_point)
+{
+    auto is_found = false;
+    auto line_start = size_t(0);
+    for (auto line_end = line_buffer_.find('\n'); line_end != std::string::npos; line_end = line_buffer_.find('\n', line_start))
+    {
+        const auto line = line_buffer_.substr(line_start, line_end - line_start);
+        line_start = line_end + 1;
+
+        if (ParseNmeaSentence(line, epsg_4326_point))
+        {
+            is_found = true;
+            if (is_first_only)
+                break;
+        }
+    }
+
+    line_buffer_.erase(0, line_start);
+    if (line_buffer_.size() > kNmeaMaxLineBufferSize)
+        line_buffer_.clear();
+
+    return is_found;
+}
+
+bool NmeaLocationProvider::RequestLocation(const std::chrono::milliseconds timeout, const std::atomic<bool>& is_stopped,
+                                           projection::Epsg4326Point& epsg_4326_point)
+{
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+    if (descriptor_ < 0 && !Open(timeout, is_stopped))
+        return false;
+
+    size_t byte_count;
+    if (is_regular_file_)
+    {
+        auto is_rewound = false;
+        for (; !is_stopped.load() && std::chrono::steady_clock::now() < deadline;)
+        {
+            if (TakeFix(true, epsg_4326_point))
+                return true;
+
+            if (Read(std::chrono::milliseconds(0), byte_count))
+                continue;
+
+            // Second end of file within one request means there are no fixes at all
+            if (is_rewound)
+            {
+                std::cerr << "NmeaLocationProvider::RequestLocation There are no fixes in " << source_ << std::endl;
+                return false;
+            }
+
+            // Last line may have no line break
+            line_buffer_.push_back('\n');
+            lseek(descriptor_, 0, SEEK_SET);
+            is_rewound = true;
+        }
+
+        return false;
+    }
+
+    // Once a fix is found only data already waiting is read, so the newest fix wins
+    auto is_found = false;
+    for (; !is_stopped.load();)
+    {
+        const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        const auto wait = is_found ? std::chrono::milliseconds(0) : std::clamp(remaining, std::chrono::milliseconds(0), kNmeaPollSlice);
+
+        if (!Read(wait, byte_count))
+        {
+            std::cerr << "NmeaLocationProvider::RequestLocation Stream " << source_ << " is closed" << std::endl;
+            Close();
+            break;
+        }
+
+        if (TakeFix(false, epsg_4326_point))
+            is_found = true;
+
+        if (byte_count == 0 && (is_found || remaining.count() <= 0))
+            break;
+    }
+
+    return is_found;
+}
@@ -1,13 +1,77 @@
 #ifndef LOCATION_H
 #define LOCATION_H
 
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <memory>
+
 #include "Projection.h"
 
-namespace location {
+class LocationProvider;
+using LocationProviderUPtr = std::unique_ptr<LocationProvider>;
+
+//! Source of device position, used by one thread at a time
+class LocationProvider
+{
+public:
+    virtual ~LocationProvider() = default;
+
+    virtual std::string Name() const = 0;
+    /* Writes current position, returns false if source gives no fix within timeout.
+    Waiting ends early once is_stopped is set */
+    virtual bool RequestLocation(const std::chrono::milliseconds timeout, const std::atomic<bool>& is_stopped,
+                                 projection::Epsg4326Point& epsg_4326_point) = 0;
+};
+
+/* Asks HTTP endpoint for position. Response is JSON with "loc" field holding
+"latitude,longitude" as ipinfo.io returns it, or with numeric "lat" and "lon" */
+class HttpLocationProvider : public LocationProvider
+{
+public:
+    static LocationProviderUPtr Create(const std::string& url);
+
+    std::string Name() const override { return url_; }
+    bool RequestLocation(const std::chrono::milliseconds timeout, const std::atomic<bool>& is_stopped,
+                         projection::Epsg4326Point& epsg_4326_point) override;
+
+private:
+    std::string url_;
+
+    HttpLocationProvider(const std::string& url);
+};
+
+/* Reads RMC and GGA sentences of NMEA 0183 from file, FIFO, serial device or
+gpsd at "gpsd://host:port". Regular file is replayed, every request takes the
+next fix and reading starts over at the end. Streams give the latest fix */
+class NmeaLocationProvider : public LocationProvider
+{
+public:
+    static LocationProviderUPtr Create(const std::string& source);
+    ~NmeaLocationProvider();
+
+    std::string Name() const override { return source_; }
+    bool RequestLocation(const std::chrono::milliseconds timeout, const std::atomic<bool>& is_stopped,
+                         projection::Epsg4326Point& epsg_4326_point) override;
+
+private:
+    std::string source_;
+
+    int descriptor_ = -1;
+    bool is_regular_file_ = false;
+    //! Received bytes after the last complete line
+    std::string line_buffer_;
+
+    NmeaLocationProvider(const std::string& source);
 
-//! Writing location of device into epsg_4326_point, in case of error returns false
-bool RequestDeviceLocation(projection::Epsg4326Point& epsg_4326_point);
+    bool Open(const std::chrono::milliseconds timeout, const std::atomic<bool>& is_stopped);
+    void Close();
 
-} // namespace location
+    /* Waits up to timeout for data and appends it to line_buffer_, byte_count is 0
+    if nothing came. Returns false at the end of file or when stream is closed */
+    bool Read(const std::chrono::milliseconds timeout, size_t& byte_count);
+    //! Takes fixes from complete lines of line_buffer_, is_first_only stops at the first one
+    bool TakeFix(const bool is_first_only, projection::Epsg4326Point& epsg_4326_point);
+};
 
 #endif // LOCATION_H
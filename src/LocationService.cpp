@@ -0,0 +1,143 @@
+#include "LocationService.h"
+
+#include <iostream>
+#include <cstdlib>
+
+constexpr char kDefaultLocationUrl[] = "https://ipinfo.io/json";
+constexpr std::chrono::milliseconds kDefaultLocationTimeout { 3000 };
+
+LocationService::LocationService(std::vector<LocationProviderUPtr> providers, const std::chrono::milliseconds timeout, QObject* parent)
+    : QObject(parent), providers_(std::move(providers)), timeout_(timeout)
+{
+
+}
+
+LocationServiceUPtr LocationService::Create(std::vector<LocationProviderUPtr> providers, const std::chrono::milliseconds timeout,
+                                            QObject* parent)
+{
+    if (providers.empty())
+    {
+        std::cerr << "LocationService::Create There are no location providers" << std::endl;
+        return nullptr;
+    }
+
+    std::unique_ptr<LocationService> instance(new LocationService(std::move(providers), timeout, parent));
+
+    instance->worker_thread_ = std::thread([instance = instance.get()]() { instance->Work(); });
+
+    return instance;
+}
+
+LocationServiceUPtr LocationService::CreateFromEnvironment(QObject* parent)
+{
+    auto providers = std::vector<LocationProviderUPtr>();
+
+    const auto nmea_source = std::getenv("OPENROUTE_NMEA_SOURCE");
+    if (nmea_source && *nmea_source)
+    {
+        auto provider = NmeaLocationProvider::Create(nmea_source);
+        if (provider)
+            providers.push_back(std::move(provider));
+    }
+
+    const auto location_url = std::getenv("OPENROUTE_LOCATION_URL");
+    auto provider = HttpLocationProvider::Create(location_url ? location_url : kDefaultLocationUrl);
+    if (provider)
+        providers.push_back(std::move(provider));
+
+    auto timeout = kDefaultLocationTimeout;
+    const auto timeout_value = std::getenv("OPENROUTE_LOCATION_TIMEOUT");
+    if (timeout_value && std::atoi(timeout_value) > 0)
+        timeout = std::chrono::milliseconds(std::atoi(timeout_value));
+
+    return Create(std::move(providers), timeout, parent);
+}
+
+LocationService::~LocationService()
+{
+    {
+        auto lock = std::lock_guard<std::mutex>(mutex_);
+        is_stopped_.store(true);
+    }
+    request_or_stop_cv_.notify_one();
+
+    if (worker_thread_.joinable())
+        worker_thread_.join();
+}
+
+void LocationService::RequestLocation()
+{
+    {
+        auto lock = std::lock_guard<std::mutex>(mutex_);
+        if (is_running_)
+            return;
+
+        is_requested_ = true;
+    }
+    request_or_stop_cv_.notify_one();
+}
+
+bool LocationService::LastLocation(projection::Epsg4326Point& epsg_4326_point, std::chrono::steady_clock::duration& age) const
+{
+    auto lock = std::lock_guard<std::mutex>(mutex_);
+    if (!has_last_location_)
+        return false;
+
+    epsg_4326_point = last_location_;
+    age = std::chrono::steady_clock::now() - last_location_time_;
+
+    return true;
+}
+
+void LocationService::Work()
+{
+    for (;;)
+    {
+        {
+            auto lock = std::unique_lock<std::mutex>(mutex_);
+            request_or_stop_cv_.wait(lock, [this]() { return is_requested_ || is_stopped_.load(); });
+
+            if (is_stopped_.load())
+                return;
+
+            is_requested_ = false;
+            is_running_ = true;
+        }
+
+        auto epsg_4326_point = projection::Epsg4326Point();
+        auto is_found = false;
+        for (const auto& provider : providers_)
+        {
+            if (is_stopped_.load())
+                return;
+
+            if (provider->RequestLocation(timeout_, is_stopped_, epsg_4326_point))
+            {
+                is_found = true;
+                break;
+            }
+
+            std::cerr << "LocationService::Work No location from " << provider->Name() << std::endl;
+        }
+
+        {
+            auto lock = std::lock_guard<std::mutex>(mutex_);
+            is_running_ = false;
+
+            if (is_found)
+            {
+                has_last_location_ = true;
+                last_location_ = epsg_4326_point;
+                last_location_time_ = std::chrono::steady_clock::now();
+            }
+        }
+
+        // Signals are emitted in the thread of this object, receivers do not need to be thread safe
+        QMetaObject::invokeMethod(this, [this, is_found, epsg_4326_point]() {
+            if (is_found)
+                emit LocationFound(epsg_4326_point);
+            else
+                emit LocationNotFound();
+        }, Qt::QueuedConnection);
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef LOCATIONSERVICE_H
+#define LOCATIONSERVICE_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+
+#include <QObject>
+
+#include "Location.h"
+
+class LocationService;
+using LocationServiceUPtr = std::unique_ptr<LocationService>;
+
+/* Looks up device location on a worker thread, so UI never waits for network
+or GPS. Providers are asked in order until one gives a fix within timeout,
+the latest fix is cached */
+class LocationService : public QObject
+{
+    Q_OBJECT
+
+public:
+    static LocationServiceUPtr Create(std::vector<LocationProviderUPtr> providers, const std::chrono::milliseconds timeout,
+                                      QObject* parent = nullptr);
+    /* Providers from environment: NMEA source from OPENROUTE_NMEA_SOURCE goes first,
+    then HTTP endpoint from OPENROUTE_LOCATION_URL (ipinfo.io if not set).
+    Timeout in milliseconds is read from OPENROUTE_LOCATION_TIMEOUT */
+    static LocationServiceUPtr CreateFromEnvironment(QObject* parent = nullptr);
+    ~LocationService();
+
+    //! Starts lookup unless one is running, result comes with LocationFound or LocationNotFound
+    void RequestLocation();
+    //! Latest fix and its age, false if there was none yet
+    bool LastLocation(projection::Epsg4326Point& epsg_4326_point, std::chrono::steady_clock::duration& age) const;
+
+signals:
+    void LocationFound(const projection::Epsg4326Point& epsg_4326_point);
+    void LocationNotFound();
+
+private:
+    std::vector<LocationProviderUPtr> providers_;
+    std::chrono::milliseconds timeout_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable request_or_stop_cv_;
+    bool is_requested_ = false;
+    bool is_running_ = false;
+
+    bool has_last_location_ = false;
+    projection::Epsg4326Point last_location_;
+    std::chrono::steady_clock::time_point last_location_time_;
+
+    std::atomic<bool> is_stopped_ = false;
+    std::thread worker_thread_;
+
+    LocationService(std::vector<LocationProviderUPtr> providers, const std::chrono::milliseconds timeout, QObject* parent);
+
+    void Work();
+};
+
+#endif // LOCATIONSERVICE_H
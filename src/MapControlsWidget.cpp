@@ -29,6 +29,76 @@ MapControlsWidget::MapControlsWidget(QWidget *parent)
     location_button_->setFixedSize(30, 30);
     location_button_->setIcon(location_icon);
 
+    isochrone_button_ = new QPushButton("Iso", this);
+    isochrone_button_->setToolTip("Show reachable area on click");
+    isochrone_button_->setCheckable(true);
+    isochrone_button_->setFixedSize(30, 30);
+
+    isochrone_budget_slider_ = new QSlider(Qt::Vertical, this);
+    isochrone_budget_slider_->setToolTip("Reachable time, minutes");
+    isochrone_budget_slider_->setVisible(false);
+    connect(isochrone_budget_slider_, &QSlider::valueChanged, this, [this](const int value) { emit IsochroneBudgetChanged(value); });
+
+    connect(isochrone_button_, &QPushButton::toggled, this, [this](const bool is_checked) {
+        isochrone_budget_slider_->setVisible(is_checked);
+        emit IsochroneModeToggled(is_checked);
+    });
+
+    routing_profile_button_ = new QPushButton(routing_profile::TypeName(routing_profile_type_), this);
+    routing_profile_button_->setToolTip("Routing profile");
+    routing_profile_button_->setFixedSize(30, 30);
+    connect(routing_profile_button_, &QPushButton::clicked, this, [this]() {
+        switch (routing_profile_type_)
+        {
+        case routing_profile::Type::Car: routing_profile_type_ = routing_profile::Type::Bike; break;
+        case routing_profile::Type::Bike: routing_profile_type_ = routing_profile::Type::Foot; break;
+        default: routing_profile_type_ = routing_profile::Type::Car; break;
+        }
+
+        routing_profile_button_->setText(routing_profile::TypeName(routing_profile_type_));
+        emit RoutingProfileChanged(routing_profile_type_);
+    });
+
+    stop_order_button_ = new QPushButton("Opt", this);
+    stop_order_button_->setToolTip("Reorder stops for shortest route, first stop stays first");
+    stop_order_button_->setFixedSize(30, 30);
+    connect(stop_order_button_, &QPushButton::clicked, this, [this]() { emit StopOrderOptimizationRequested(); });
+
+    alternatives_button_ = new QPushButton("Alt", this);
+    alternatives_button_->setToolTip("Show alternative routes between two points");
+    alternatives_button_->setCheckable(true);
+    alternatives_button_->setFixedSize(30, 30);
+    connect(alternatives_button_, &QPushButton::toggled, this, [this](const bool is_checked) { emit AlternativesToggled(is_checked); });
+
+    road_override_button_ = new QPushButton("Blk", this);
+    road_override_button_->setToolTip("Click closes or reopens road, shift click adds or removes penalty");
+    road_override_button_->setCheckable(true);
+    road_override_button_->setFixedSize(30, 30);
+    connect(road_override_button_, &QPushButton::toggled, this, [this](const bool is_checked) { emit RoadOverrideModeToggled(is_checked); });
+
+    hillshade_button_ = new QPushButton("Hil", this);
+    hillshade_button_->setToolTip("Shade relief from elevation data");
+    hillshade_button_->setCheckable(true);
+    hillshade_button_->setFixedSize(30, 30);
+    hillshade_button_->setVisible(false);
+    connect(hillshade_button_, &QPushButton::toggled, this, [this](const bool is_checked) { emit HillshadeToggled(is_checked); });
+
+    theme_button_ = new QPushButton(palette::ThemeName(theme_), this);
+    theme_button_->setToolTip("Map colors: day, night, high contrast or grey");
+    theme_button_->setFixedSize(30, 30);
+    connect(theme_button_, &QPushButton::clicked, this, [this]() {
+        switch (theme_)
+        {
+        case palette::Theme::Day: theme_ = palette::Theme::Night; break;
+        case palette::Theme::Night: theme_ = palette::Theme::HighContrast; break;
+        case palette::Theme::HighContrast: theme_ = palette::Theme::Greyscale; break;
+        default: theme_ = palette::Theme::Day; break;
+        }
+
+        theme_button_->setText(palette::ThemeName(theme_));
+        emit ThemeChanged(theme_);
+    });
+
     const auto layout = new QVBoxLayout(this);
     layout->setContentsMargins(0, 0, 0, 0);
     layout->setAlignment(Qt::AlignCenter);
@@ -36,6 +106,14 @@ MapControlsWidget::MapControlsWidget(QWidget *parent)
     layout->addWidget(zoom_in_button_);
     layout->addWidget(zoom_out_button_);
     layout->addWidget(location_button_);
+    layout->addWidget(routing_profile_button_);
+    layout->addWidget(stop_order_button_);
+    layout->addWidget(alternatives_button_);
+    layout->addWidget(road_override_button_);
+    layout->addWidget(hillshade_button_);
+    layout->addWidget(theme_button_);
+    layout->addWidget(isochrone_button_);
+    layout->addWidget(isochrone_budget_slider_, 0, Qt::AlignHCenter);
 
     setLayout(layout);
 }
@@ -55,6 +133,23 @@ void MapControlsWidget::SetCurrentZoom(const unsigned int zoom)
     CheckZoom();
 }
 
+void MapControlsWidget::SetIsochroneBudgetRange(const int min_budget, const int max_budget, const int step)
+{
+    isochrone_budget_slider_->setRange(min_budget, max_budget);
+    isochrone_budget_slider_->setSingleStep(step);
+    isochrone_budget_slider_->setPageStep(step);
+}
+
+int MapControlsWidget::IsochroneBudget() const
+{
+    return isochrone_budget_slider_->value();
+}
+
+void MapControlsWidget::SetHillshadeAvailable(const bool is_available)
+{
+    hillshade_button_->setVisible(is_available);
+}
+
 void MapControlsWidget::OnZoomInButtonPress()
 {
     current_zoom_++;
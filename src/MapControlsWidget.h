@@ -3,6 +3,10 @@
 
 #include <QWidget>
 #include <QPushButton>
+#include <QSlider>
+
+#include "RoutingProfile.h"
+#include "Palette.h"
 
 class MapControlsWidget : public QWidget
 {
@@ -14,10 +18,25 @@ public:
     void SetZoomRange(const unsigned int min_zoom, const unsigned int max_zoom);
     void SetCurrentZoom(const unsigned int zoom);
 
+    //! Budget of isochrone in minutes
+    void SetIsochroneBudgetRange(const int min_budget, const int max_budget, const int step);
+    int IsochroneBudget() const;
+
+    //! Hillshade button is shown only when elevation data is available
+    void SetHillshadeAvailable(const bool is_available);
+
 signals:
     void ZoomIn();
     void ZoomOut();
     void LocationButtonPressed();
+    void IsochroneModeToggled(const bool is_enabled);
+    void IsochroneBudgetChanged(const int budget);
+    void RoutingProfileChanged(const routing_profile::Type routing_profile_type);
+    void StopOrderOptimizationRequested();
+    void AlternativesToggled(const bool is_enabled);
+    void RoadOverrideModeToggled(const bool is_enabled);
+    void HillshadeToggled(const bool is_enabled);
+    void ThemeChanged(const palette::Theme theme);
 
 private slots:
     void OnZoomInButtonPress();
@@ -32,6 +51,17 @@ private:
     QPushButton* zoom_in_button_;
     QPushButton* zoom_out_button_;
     QPushButton* location_button_;
+    QPushButton* isochrone_button_;
+    QSlider* isochrone_budget_slider_;
+    QPushButton* routing_profile_button_;
+    QPushButton* stop_order_button_;
+    QPushButton* alternatives_button_;
+    QPushButton* road_override_button_;
+    QPushButton* hillshade_button_;
+    QPushButton* theme_button_;
+
+    routing_profile::Type routing_profile_type_ = routing_profile::Type::Car;
+    palette::Theme theme_ = palette::Theme::Day;
 
     void CheckZoom();
 };
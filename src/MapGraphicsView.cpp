@@ -2,6 +2,7 @@
 
 #include <QWheelEvent>
 #include <QScrollBar>
+#include <QGraphicsItem>
 
 MapGraphicsView::MapGraphicsView(QWidget *parent)
     : QGraphicsView(parent)
@@ -18,6 +19,15 @@ MapGraphicsView::MapGraphicsView(QGraphicsScene *scene, QWidget *parent)
 void MapGraphicsView::mousePressEvent(QMouseEvent* event)
 {
     if (event->button() == Qt::LeftButton) {
+        const auto item = itemAt(event->pos());
+        if (item && item->data(kDraggableDataKey).toBool()) {
+            is_item_dragging_ = true;
+            setCursor(Qt::ClosedHandCursor);
+
+            emit ItemDragStarted(item, mapToScene(event->pos()));
+            return;
+        }
+
         is_dragging_ = true;
         last_mouse_pos_ = event->pos();
         setCursor(Qt::ClosedHandCursor);
@@ -30,6 +40,11 @@ void MapGraphicsView::mousePressEvent(QMouseEvent* event)
 
 void MapGraphicsView::mouseMoveEvent(QMouseEvent* event)
 {
+    if (is_item_dragging_) {
+        emit ItemDragged(mapToScene(event->pos()));
+        return;
+    }
+
     if (is_dragging_) {
         const auto delta = event->pos() - last_mouse_pos_;
         last_mouse_pos_ = event->pos();
@@ -44,6 +59,14 @@ void MapGraphicsView::mouseMoveEvent(QMouseEvent* event)
 
 void MapGraphicsView::mouseReleaseEvent(QMouseEvent* event)
 {
+    if (event->button() == Qt::LeftButton && is_item_dragging_) {
+        is_item_dragging_ = false;
+        setCursor(Qt::ArrowCursor);
+
+        emit ItemDragFinished(mapToScene(event->pos()));
+        return;
+    }
+
     if (event->button() == Qt::LeftButton) {
         is_dragging_ = false;
         setCursor(Qt::ArrowCursor);
@@ -9,6 +9,9 @@ class MapGraphicsView : public QGraphicsView
     Q_OBJECT
 
 public:
+    //! Items with true value under this data key are dragged instead of the map
+    static constexpr int kDraggableDataKey = 0;
+
     MapGraphicsView(QWidget* parent = nullptr);
     MapGraphicsView(QGraphicsScene* scene, QWidget* parent = nullptr);
 
@@ -20,6 +23,7 @@ protected:
 
 private:
     bool is_dragging_;
+    bool is_item_dragging_ = false;
     QPoint last_mouse_pos_;
     QTimer click_timer_;
 
@@ -27,6 +31,9 @@ signals:
     void ZoomIn(const QPointF& zoom_position);
     void ZoomOut(const QPointF& zoom_position);
     void MapClicked(const QPointF& position);
+    void ItemDragStarted(QGraphicsItem* item, const QPointF& position);
+    void ItemDragged(const QPointF& position);
+    void ItemDragFinished(const QPointF& position);
 };
 
 #endif // MAPGRAPHICSVIEW_H
@@ -1,30 +1,81 @@
 #include "MapWidget.h"
 
 #include <iostream>
+#include <algorithm>
 
 #include <QThread>
 #include <QScrollBar>
 #include <QHBoxLayout>
 #include <QGraphicsScene>
 #include <QGraphicsPixmapItem>
+#include <QImage>
+#include <QPainterPath>
+#include <QGuiApplication>
+#include <QToolTip>
+#include <QPointer>
 
 #include "MapControlsWidget.h"
-#include "Location.h"
+#include "Trace.h"
 
 constexpr int kZoomLowerBound { 0 };
 constexpr int kZoomUpperBound { 22 };
 
 constexpr int kTilePixelSize { 256 };
 
-constexpr double kMapBoundEpsg3857 { 20037508 };
+//! Shaded tiles kept in memory, about four screens of them
+constexpr size_t kHillshadeCacheCapacity { 256 };
+
+constexpr double kMapBoundEpsg3857 { projection::kEpsg3857Bound };
 
 constexpr int kPenWidth { 5 };
 
+//! Isochrone slider range in minutes, search always runs up to the upper bound
+constexpr int kIsochroneMinBudget { 1 };
+constexpr int kIsochroneMaxBudget { 30 };
+constexpr int kIsochroneBudgetStep { 1 };
+
+constexpr double kSecondsInMinute { 60 };
+
+//! Time in milliseconds given to stop reordering heuristic
+constexpr double kStopOrderTimeBudget { 200 };
+
+//! Routes shown in alternatives mode including the main one
+constexpr size_t kAlternativeRouteCount { 3 };
+
+//! Cost multiplier of road penalized with shift click
+constexpr float kRoadPenaltyFactor { 3 };
+//! Distance in pixels within which a click picks a road to override
+constexpr double kRoadOverrideClickDistance { 12 };
+
+constexpr size_t kSearchResultCount { 8 };
+//! Distance of search box from the top left corner of the map in pixels
+constexpr int kSearchWidgetMargin { 10 };
+
+//! Zoom at which found place is shown, larger places need less detail
+unsigned int SearchResultZoom(const NameIndex::PlaceKind kind)
+{
+    switch (kind)
+    {
+    case NameIndex::PlaceKind::Region: return 8;
+    case NameIndex::PlaceKind::City: return 11;
+    case NameIndex::PlaceKind::Town: return 12;
+    case NameIndex::PlaceKind::Village: return 14;
+    case NameIndex::PlaceKind::Suburb: return 14;
+    case NameIndex::PlaceKind::Locality: return 15;
+    case NameIndex::PlaceKind::Street: return 16;
+    case NameIndex::PlaceKind::PointOfInterest: return 17;
+    }
+
+    return kZoomUpperBound;
+}
+
 MapWidget::MapWidget(QWidget* parent)
     : QWidget(parent),
     scene_(this),
     graphics_view_(&scene_, this),
-    map_controls_widget_(this)
+    map_controls_widget_(this),
+    search_widget_(&graphics_view_),
+    hillshade_tile_cache_(kTilePixelSize, kHillshadeCacheCapacity)
 {
     renderer_processes_manager_u_ptr_ = RendererProcessesManager::Create(QThread::idealThreadCount(), this);
     if (!renderer_processes_manager_u_ptr_)
@@ -34,10 +85,62 @@ MapWidget::MapWidget(QWidget* parent)
     if (!navigation_manager_u_ptr_)
         throw std::runtime_error("Failed to create NavigationManager");
 
+    location_service_u_ptr_ = LocationService::CreateFromEnvironment();
+    if (!location_service_u_ptr_)
+        throw std::runtime_error("Failed to create LocationService");
+
+    geocoder_u_ptr_ = Geocoder::CreateFromEnvironment();
+    if (!geocoder_u_ptr_)
+        throw std::runtime_error("Failed to create Geocoder");
+
+    overlay_data_u_ptr_ = OverlayData::CreateFromEnvironment();
+    if (!overlay_data_u_ptr_)
+        throw std::runtime_error("Failed to create OverlayData");
+
+    hillshade_service_u_ptr_ = HillshadeService::CreateFromEnvironment(kTilePixelSize);
+    if (!hillshade_service_u_ptr_)
+        throw std::runtime_error("Failed to create HillshadeService");
+
     InitConnections();
     InitLayout();
     InitMapControls();
     InitializeMapProperties();
+
+    // Started last, nothing throws after it so destructor always joins the thread
+    LoadReverseGeocoder();
+}
+
+MapWidget::~MapWidget()
+{
+    // Loader gives up at the next query or row, so the wait is short
+    is_reverse_geocoder_load_cancelled_.store(true);
+    if (reverse_geocoder_loader_thread_.joinable())
+        reverse_geocoder_loader_thread_.join();
+}
+
+void MapWidget::LoadReverseGeocoder()
+{
+    /* Address tables take seconds to load, map is usable meanwhile. Address lookup
+    is optional, if tables fail to load clicks just show no address. Guard of the
+    widget is made here in the UI thread, the loader only copies it */
+    const auto widget = QPointer<MapWidget>(this);
+    reverse_geocoder_loader_thread_ = std::thread([this, widget]() {
+        auto reverse_geocoder_u_ptr = ReverseGeocoder::CreateFromEnvironment(is_reverse_geocoder_load_cancelled_);
+        if (!reverse_geocoder_u_ptr)
+        {
+            if (!is_reverse_geocoder_load_cancelled_.load())
+                std::cerr << "MapWidget::LoadReverseGeocoder Failed to create ReverseGeocoder, address lookup is disabled" << std::endl;
+
+            return;
+        }
+
+        // Shared holder frees geocoder if the call is never delivered
+        const auto holder_s_ptr = std::make_shared<ReverseGeocoderUPtr>(std::move(reverse_geocoder_u_ptr));
+        QMetaObject::invokeMethod(this, [widget, holder_s_ptr]() {
+            if (widget)
+                widget->reverse_geocoder_u_ptr_ = std::move(*holder_s_ptr);
+        }, Qt::QueuedConnection);
+    });
 }
 
 void MapWidget::InitConnections() const
@@ -47,6 +150,11 @@ void MapWidget::InitConnections() const
     connect(&graphics_view_, &MapGraphicsView::ZoomIn, this, &MapWidget::OnZoomInWheel);
     connect(&graphics_view_, &MapGraphicsView::ZoomOut, this, &MapWidget::OnZoomOutWheel);
     connect(&graphics_view_, &MapGraphicsView::MapClicked, this, &MapWidget::OnMapClicked);
+    connect(&graphics_view_, &MapGraphicsView::ItemDragStarted, this, &MapWidget::OnItemDragStarted);
+    connect(&graphics_view_, &MapGraphicsView::ItemDragged, this, &MapWidget::OnItemDragged);
+    connect(&graphics_view_, &MapGraphicsView::ItemDragFinished, this, &MapWidget::OnItemDragFinished);
+
+    connect(navigation_manager_u_ptr_.get(), &NavigationManager::PathFound, this, &MapWidget::OnPathFound);
 
     connect(graphics_view_.horizontalScrollBar(), &QScrollBar::valueChanged, this, &MapWidget::UpdateMap);
     connect(graphics_view_.verticalScrollBar(), &QScrollBar::valueChanged, this, &MapWidget::UpdateMap);
@@ -54,6 +162,18 @@ void MapWidget::InitConnections() const
     connect(&map_controls_widget_, &MapControlsWidget::ZoomIn, this, &MapWidget::OnZoomInButtton);
     connect(&map_controls_widget_, &MapControlsWidget::ZoomOut, this, &MapWidget::OnZoomOutButtton);
     connect(&map_controls_widget_, &MapControlsWidget::LocationButtonPressed, this, &MapWidget::OnLocationButtonPressed);
+    connect(location_service_u_ptr_.get(), &LocationService::LocationFound, this, &MapWidget::OnLocationFound);
+    connect(&map_controls_widget_, &MapControlsWidget::IsochroneModeToggled, this, &MapWidget::OnIsochroneModeToggled);
+    connect(&map_controls_widget_, &MapControlsWidget::IsochroneBudgetChanged, this, &MapWidget::OnIsochroneBudgetChanged);
+    connect(&map_controls_widget_, &MapControlsWidget::RoutingProfileChanged, this, &MapWidget::OnRoutingProfileChanged);
+    connect(&map_controls_widget_, &MapControlsWidget::StopOrderOptimizationRequested, this, &MapWidget::OnStopOrderOptimizationRequested);
+    connect(&map_controls_widget_, &MapControlsWidget::AlternativesToggled, this, &MapWidget::OnAlternativesToggled);
+    connect(&map_controls_widget_, &MapControlsWidget::RoadOverrideModeToggled, this, &MapWidget::OnRoadOverrideModeToggled);
+    connect(&map_controls_widget_, &MapControlsWidget::HillshadeToggled, this, &MapWidget::OnHillshadeToggled);
+    connect(&map_controls_widget_, &MapControlsWidget::ThemeChanged, this, &MapWidget::OnThemeChanged);
+
+    connect(&search_widget_, &SearchWidget::QueryChanged, this, &MapWidget::OnSearchQueryChanged);
+    connect(&search_widget_, &SearchWidget::ResultChosen, this, &MapWidget::OnSearchResultChosen);
 }
 
 void MapWidget::InitLayout()
@@ -64,12 +184,18 @@ void MapWidget::InitLayout()
     auto layout = new QHBoxLayout(this);
     layout->addWidget(&graphics_view_);
     setLayout(layout);
+
+    // Search box floats over the map instead of taking space from it
+    search_widget_.move(kSearchWidgetMargin, kSearchWidgetMargin);
+    search_widget_.raise();
 }
 
 void MapWidget::InitMapControls()
 {
     map_controls_widget_.SetZoomRange(kZoomLowerBound, kZoomUpperBound);
     map_controls_widget_.SetCurrentZoom(zoom_);
+    map_controls_widget_.SetIsochroneBudgetRange(kIsochroneMinBudget, kIsochroneMaxBudget, kIsochroneBudgetStep);
+    map_controls_widget_.SetHillshadeAvailable(!hillshade_service_u_ptr_->IsEmpty());
 
     layout()->addWidget(&map_controls_widget_);
 }
@@ -80,13 +206,14 @@ void MapWidget::InitializeMapProperties()
     renderer_processes_manager_u_ptr_->AddRenderingTask(epsg_3857_rect, map::Tile(0, 0), zoom_);
 
     UpdateMapProperties();
+    DrawOverlay();
 }
 
 void MapWidget::UpdateMapProperties()
 {
     axis_tile_count_ = std::pow(2, zoom_);
     max_axis_index_ = axis_tile_count_ - 1;
-    tile_epsg_3857_length_ = 2 * kMapBoundEpsg3857 / axis_tile_count_;
+    tile_epsg_3857_length_ = projection::TileLength(zoom_);
     pixel_epsg_3857_length_ = tile_epsg_3857_length_ / kTilePixelSize;
     scene_upper_bound_pixel_ = axis_tile_count_ * kTilePixelSize;
 }
@@ -96,10 +223,24 @@ void MapWidget::UpdateMapWithNewZoom(const RelativeScenePoint&& relative_zoom_po
     renderer_processes_manager_u_ptr_->ClearRenderingTasks();
     scene_.clear();
     visible_tiles_u_set_.clear();
-    route_ = Route();
+    route_.marker_items.clear();
+    route_.path_item = nullptr;
+    route_.alternatives_item = nullptr;
+    isochrone_item_ = nullptr;
+    closed_roads_item_ = nullptr;
+    penalized_roads_item_ = nullptr;
+    shown_tiles_.clear();
+    hillshade_items_.clear();
+    ClearHillshadeTasks();
 
     UpdateMapProperties();
 
+    // Route and isochrone are kept in EPSG:3857, so they are only redrawn for new scale
+    DrawRoute();
+    DrawIsochrone();
+    DrawRoadOverrides();
+    DrawOverlay();
+
     scene_.setSceneRect(QRectF(kSceneLowerBoundPixel, kSceneLowerBoundPixel, scene_upper_bound_pixel_, scene_upper_bound_pixel_));
     UpdateMapCenter(relative_zoom_position);
 
@@ -131,6 +272,8 @@ void MapWidget::UpdateMapCenter(const RelativeScenePoint& relative_scene_point)
 
 void MapWidget::UpdateMap()
 {
+    const auto update_span = trace::Span("Update map");
+
     auto tile_rect = map::TileRect();
 
     // Converting graphics_view rect into scene coordinates to be able to compute which tiles are visible now
@@ -183,15 +326,9 @@ void MapWidget::RenderTile(const unsigned int x_index, const unsigned int y_inde
 
     visible_tiles_u_set_.insert(tile_key);
 
-    const auto x_min = -kMapBoundEpsg3857 + x_index * tile_epsg_3857_length_;
-    const auto y_min = -kMapBoundEpsg3857 + y_index * tile_epsg_3857_length_;
-    const auto x_max = x_min + tile_epsg_3857_length_;
-    const auto y_max = y_min + tile_epsg_3857_length_;
-
-    const auto epsg_3857_rect = projection::Epsg3857Rect(x_min, y_min, x_max, y_max);
     const auto tile = map::Tile(x_index, y_index);
 
-    renderer_processes_manager_u_ptr_->AddRenderingTask(epsg_3857_rect, tile, zoom_);
+    renderer_processes_manager_u_ptr_->AddRenderingTask(projection::TileBounds(tile, zoom_), tile, zoom_);
 }
 
 void MapWidget::Zoom(const QPointF& zoom_position)
@@ -202,33 +339,255 @@ void MapWidget::Zoom(const QPointF& zoom_position)
 
 void MapWidget::DrawRoute()
 {
-    auto route_point_stack = navigation_manager_u_ptr_->FindPath(route_.start_point.epsg_3857_point_u_ptr, route_.end_point.epsg_3857_point_u_ptr);
-    if (route_point_stack.empty())
+    const auto to_scene_point = [this](const projection::Epsg3857Point& point) {
+        return QPointF((point.x + kMapBoundEpsg3857) / pixel_epsg_3857_length_,
+                       (kMapBoundEpsg3857 - point.y) / pixel_epsg_3857_length_);
+    };
+
+    auto waypoints = std::vector<projection::Epsg3857Point>();
+    auto path = QPainterPath();
+    if (route_.route_editor_u_ptr)
+    {
+        const auto& route_editor = *route_.route_editor_u_ptr;
+        for (size_t waypoint = 0; waypoint < route_editor.WaypointCount(); waypoint++)
+            waypoints.push_back(route_editor.Waypoint(waypoint));
+
+        // Every leg is a separate subpath, so leg without path leaves a gap
+        for (size_t leg = 0; leg < route_editor.LegCount(); leg++)
+        {
+            auto polyline = QPolygonF();
+            polyline.reserve(route_editor.LegPoints(leg).size());
+            for (const auto& point : route_editor.LegPoints(leg))
+                polyline.append(to_scene_point(point));
+
+            path.addPolygon(polyline);
+        }
+    }
+    else if (!route_.paged_waypoints.empty())
+    {
+        waypoints = route_.paged_waypoints;
+
+        auto polyline = QPolygonF();
+        polyline.reserve(route_.paged_path_points.size());
+        for (const auto& point : route_.paged_path_points)
+            polyline.append(to_scene_point(point));
+
+        path.addPolygon(polyline);
+    }
+    else if (route_.start_point_u_ptr)
+    {
+        waypoints.push_back(*route_.start_point_u_ptr);
+    }
+
+    auto alternatives_path = QPainterPath();
+    for (const auto& points : route_.alternative_points)
+    {
+        auto polyline = QPolygonF();
+        polyline.reserve(points.size());
+        for (const auto& point : points)
+            polyline.append(to_scene_point(point));
+
+        alternatives_path.addPolygon(polyline);
+    }
+
+    if (route_.alternatives_item)
+    {
+        route_.alternatives_item->setPath(alternatives_path);
+    }
+    else if (!alternatives_path.isEmpty())
+    {
+        auto alternatives_pen = QPen(Qt::gray, kPenWidth * 0.75);
+        alternatives_pen.setCapStyle(Qt::RoundCap);
+        alternatives_pen.setJoinStyle(Qt::RoundJoin);
+
+        route_.alternatives_item = scene_.addPath(alternatives_path, alternatives_pen);
+        route_.alternatives_item->setZValue(0.5);
+    }
+
+    for (; route_.marker_items.size() > waypoints.size();)
+    {
+        scene_.removeItem(route_.marker_items.back());
+        delete route_.marker_items.back();
+        route_.marker_items.pop_back();
+    }
+
+    QGraphicsEllipseItem* marker_item;
+    for (size_t waypoint = 0; waypoint < waypoints.size(); waypoint++)
+    {
+        const auto scene_point = to_scene_point(waypoints[waypoint]);
+        const auto marker_rect = QRectF(scene_point.x() - kPenWidth, scene_point.y() - kPenWidth, 2 * kPenWidth, 2 * kPenWidth);
+
+        if (waypoint < route_.marker_items.size())
+        {
+            route_.marker_items[waypoint]->setRect(marker_rect);
+            continue;
+        }
+
+        marker_item = scene_.addEllipse(marker_rect, QPen(Qt::red), QBrush(Qt::red));
+        marker_item->setData(MapGraphicsView::kDraggableDataKey, true);
+        marker_item->setZValue(2);
+        route_.marker_items.push_back(marker_item);
+    }
+
+    if (route_.path_item)
+    {
+        route_.path_item->setPath(path);
         return;
+    }
 
-    auto last_point = std::move(route_point_stack.top());
-    route_point_stack.pop();
+    if (path.isEmpty())
+        return;
 
-    projection::Epsg3857PointUPtr point;
-    QGraphicsLineItem* line;
+    auto pen = QPen(Qt::red, kPenWidth * 0.75);
+    pen.setCapStyle(Qt::RoundCap);
+    pen.setJoinStyle(Qt::RoundJoin);
 
-    for (; !route_point_stack.empty();)
+    // Whole route is one item, dragging it inserts via waypoint
+    route_.path_item = scene_.addPath(path, pen);
+    route_.path_item->setData(MapGraphicsView::kDraggableDataKey, true);
+    route_.path_item->setZValue(1);
+}
+
+void MapWidget::RemoveRoute()
+{
+    for (const auto marker_item : route_.marker_items)
     {
-        point = std::move(route_point_stack.top());
-        route_point_stack.pop();
+        scene_.removeItem(marker_item);
+        delete marker_item;
+    }
 
-        line = scene_.addLine((last_point->x - kPenWidth + kMapBoundEpsg3857) / pixel_epsg_3857_length_,
-                              (kMapBoundEpsg3857 - last_point->y - kPenWidth) / pixel_epsg_3857_length_,
-                              (point->x - kPenWidth + kMapBoundEpsg3857) / pixel_epsg_3857_length_,
-                              (kMapBoundEpsg3857 - point->y - kPenWidth) / pixel_epsg_3857_length_,
-                              QPen(Qt::red, kPenWidth * 0.75));
+    if (route_.path_item)
+    {
+        scene_.removeItem(route_.path_item);
+        delete route_.path_item;
+    }
+
+    if (route_.alternatives_item)
+    {
+        scene_.removeItem(route_.alternatives_item);
+        delete route_.alternatives_item;
+    }
+
+    route_ = Route();
+}
 
-        route_.line_deque.push_back(line);
+void MapWidget::UpdateAlternatives()
+{
+    route_.alternative_points.clear();
+
+    if (!is_alternatives_mode_ || !route_.route_editor_u_ptr || route_.route_editor_u_ptr->WaypointCount() != 2)
+        return;
 
-        last_point = std::move(point);
+    const auto& route_editor = *route_.route_editor_u_ptr;
+
+    auto costs = std::vector<double>();
+    if (!navigation_manager_u_ptr_->FindAlternativeRoutes(route_editor.Waypoint(0), route_editor.Waypoint(1), kAlternativeRouteCount,
+                                                          route_.alternative_points, costs))
+        return;
+
+    // First one is the shortest route, already shown by editor
+    route_.alternative_points.erase(route_.alternative_points.begin());
+}
+
+void MapWidget::ShowAddress(const QPointF& position) const
+{
+    if (!reverse_geocoder_u_ptr_)
+        return;
+
+    const auto point = projection::Epsg3857Point(
+        (position.x() * pixel_epsg_3857_length_) - kMapBoundEpsg3857,
+        kMapBoundEpsg3857 - position.y() * pixel_epsg_3857_length_);
+
+    auto result = ReverseGeocoder::Result();
+    reverse_geocoder_u_ptr_->Lookup(point, result);
+
+    // Empty text hides tooltip left by previous click
+    const auto view_position = graphics_view_.mapFromScene(position);
+    QToolTip::showText(graphics_view_.viewport()->mapToGlobal(view_position),
+                       QString::fromStdString(reverse_geocoder_u_ptr_->Describe(result)), &graphics_view_);
+}
+
+projection::Epsg3857Point MapWidget::SnapToRoad(const QPointF& position) const
+{
+    auto point = projection::Epsg3857Point(
+        (position.x() * pixel_epsg_3857_length_) - kMapBoundEpsg3857,
+        kMapBoundEpsg3857 - position.y() * pixel_epsg_3857_length_);
+
+    // Paged graph has no index of the whole map, FindPath snaps waypoints itself
+    if (navigation_manager_u_ptr_->IsPaged())
+        return point;
+
+    auto nearest_road_point = projection::Epsg3857Point();
+    if (navigation_manager_u_ptr_->FindNearestRoadPoint(QPointF(point.x, point.y), nearest_road_point))
+        point = nearest_road_point;
+
+    return point;
+}
+
+void MapWidget::ComputeIsochrone(const QPointF& position)
+{
+    const auto origin = projection::Epsg3857Point(
+        (position.x() * pixel_epsg_3857_length_) - kMapBoundEpsg3857,
+        kMapBoundEpsg3857 - position.y() * pixel_epsg_3857_length_);
+
+    isochrone_u_ptr_ = navigation_manager_u_ptr_->CreateIsochrone(origin, kIsochroneMaxBudget * kSecondsInMinute);
+
+    DrawIsochrone();
+}
+
+void MapWidget::DrawIsochrone()
+{
+    if (!isochrone_u_ptr_)
+        return;
+
+    auto rings = std::vector<Epsg3857Ring>();
+    isochrone_u_ptr_->BuildRings(map_controls_widget_.IsochroneBudget() * kSecondsInMinute, rings);
+
+    auto path = QPainterPath();
+    path.setFillRule(Qt::OddEvenFill);
+    for (const auto& ring : rings)
+    {
+        auto polygon = QPolygonF();
+        polygon.reserve(ring.size());
+        for (const auto& point : ring)
+            polygon.append(QPointF((point.x + kMapBoundEpsg3857) / pixel_epsg_3857_length_,
+                                   (kMapBoundEpsg3857 - point.y) / pixel_epsg_3857_length_));
+
+        path.addPolygon(polygon);
     }
 
-    return;
+    if (isochrone_item_)
+    {
+        isochrone_item_->setPath(path);
+        return;
+    }
+
+    isochrone_item_ = scene_.addPath(path, QPen(QColor(30, 90, 200), 2), QBrush(QColor(30, 90, 200, 70)));
+    // Keep polygon above tiles that are rendered later
+    isochrone_item_->setZValue(1);
+}
+
+void MapWidget::RemoveIsochrone()
+{
+    if (isochrone_item_)
+    {
+        scene_.removeItem(isochrone_item_);
+        delete isochrone_item_;
+        isochrone_item_ = nullptr;
+    }
+
+    isochrone_u_ptr_.reset();
+}
+
+void MapWidget::DrawOverlay()
+{
+    if (overlay_data_u_ptr_->IsEmpty())
+        return;
+
+    auto overlay_item = new OverlayItem(*overlay_data_u_ptr_, zoom_, pixel_epsg_3857_length_);
+    // Above tiles, below route and isochrone
+    overlay_item->setZValue(0.8);
+    scene_.addItem(overlay_item);
 }
 
 void MapWidget::OnZoomInWheel(const QPointF& zoom_position)
@@ -279,61 +638,180 @@ void MapWidget::OnZoomOutButtton()
 
 void MapWidget::OnLocationButtonPressed()
 {
-    auto device_location_epsg_4326_point = projection::Epsg4326Point();
-    if (!location::RequestDeviceLocation(device_location_epsg_4326_point))
-        return;
+    // Cached fix is shown at once, fresh one moves the map when it arrives
+    auto epsg_4326_point = projection::Epsg4326Point();
+    auto age = std::chrono::steady_clock::duration();
+    if (location_service_u_ptr_->LastLocation(epsg_4326_point, age))
+        CenterOn(epsg_4326_point);
 
-    auto device_location_epsg_3857_point = projection::Epsg3857Point();
-    if (!projection::Transform(device_location_epsg_4326_point, device_location_epsg_3857_point))
+    location_service_u_ptr_->RequestLocation();
+}
+
+void MapWidget::OnLocationFound(const projection::Epsg4326Point& epsg_4326_point)
+{
+    CenterOn(epsg_4326_point);
+}
+
+void MapWidget::CenterOn(const projection::Epsg4326Point& epsg_4326_point)
+{
+    auto epsg_3857_point = projection::Epsg3857Point();
+    if (!projection::ToEpsg3857(epsg_4326_point, epsg_3857_point))
         return;
 
-    const auto scene_x = (device_location_epsg_3857_point.x + kMapBoundEpsg3857) / tile_epsg_3857_length_ * kTilePixelSize;
-    const auto scene_y = (kMapBoundEpsg3857 - device_location_epsg_3857_point.y) / tile_epsg_3857_length_ * kTilePixelSize;
+    CenterOn(epsg_3857_point);
+}
+
+void MapWidget::CenterOn(const projection::Epsg3857Point& epsg_3857_point)
+{
+    const auto scene_x = (epsg_3857_point.x + kMapBoundEpsg3857) / tile_epsg_3857_length_ * kTilePixelSize;
+    const auto scene_y = (kMapBoundEpsg3857 - epsg_3857_point.y) / tile_epsg_3857_length_ * kTilePixelSize;
 
     graphics_view_.centerOn(scene_x, scene_y);
 }
 
+void MapWidget::ShowPoint(const projection::Epsg3857Point& epsg_3857_point, const unsigned int min_zoom)
+{
+    if (zoom_ >= min_zoom)
+    {
+        CenterOn(epsg_3857_point);
+        return;
+    }
+
+    zoom_ = min_zoom;
+    map_controls_widget_.SetCurrentZoom(zoom_);
+
+    // Relative point is scene position at zoom 0, it is scaled to the new zoom
+    UpdateMapWithNewZoom(RelativeScenePoint((epsg_3857_point.x + kMapBoundEpsg3857) / (2 * kMapBoundEpsg3857) * kTilePixelSize,
+                                            (kMapBoundEpsg3857 - epsg_3857_point.y) / (2 * kMapBoundEpsg3857) * kTilePixelSize));
+}
+
+projection::Epsg3857Point MapWidget::ViewCenter() const
+{
+    const auto scene_center = graphics_view_.mapToScene(graphics_view_.viewport()->rect().center());
+
+    return projection::Epsg3857Point(scene_center.x() * pixel_epsg_3857_length_ - kMapBoundEpsg3857,
+                                     kMapBoundEpsg3857 - scene_center.y() * pixel_epsg_3857_length_);
+}
+
 void MapWidget::OnMapClicked(const QPointF& position)
 {
-    if (route_.end_point.is_set)
+    ShowAddress(position);
+
+    if (is_road_override_mode_)
     {
-        scene_.removeItem(route_.start_point.scene_item);
-        route_.start_point.is_set = false;
+        EditRoadOverride(position);
+        return;
+    }
+
+    if (is_isochrone_mode_)
+    {
+        ComputeIsochrone(position);
+        return;
+    }
 
-        scene_.removeItem(route_.end_point.scene_item);
-        route_.end_point.is_set = false;
+    const auto road_point = SnapToRoad(position);
 
-        auto line = route_.line_deque.begin();
-        for (; !route_.line_deque.empty();)
+    // Shift click appends stop to route, plain click after route is complete starts a new one
+    if (route_.route_editor_u_ptr && QGuiApplication::keyboardModifiers() & Qt::ShiftModifier)
+    {
+        auto waypoints = route_.route_editor_u_ptr->Waypoints();
+        waypoints.push_back(road_point);
+        route_.route_editor_u_ptr->SetWaypoints(waypoints);
+        UpdateAlternatives();
+
+        DrawRoute();
+        return;
+    }
+
+    if (route_.route_editor_u_ptr || !route_.paged_waypoints.empty())
+        RemoveRoute();
+
+    if (!route_.start_point_u_ptr)
+    {
+        route_.start_point_u_ptr = std::make_unique<projection::Epsg3857Point>(road_point);
+    }
+    else if (navigation_manager_u_ptr_->IsPaged())
+    {
+        route_.paged_waypoints = { *route_.start_point_u_ptr, road_point };
+        route_.paged_path_id = navigation_manager_u_ptr_->FindPath(route_.paged_waypoints[0], route_.paged_waypoints[1]);
+
+        route_.start_point_u_ptr.reset();
+    }
+    else
+    {
+        route_.route_editor_u_ptr = navigation_manager_u_ptr_->CreateRouteEditor();
+        if (route_.route_editor_u_ptr)
         {
-            scene_.removeItem(*line);
-            line = route_.line_deque.erase(line);
+            connect(route_.route_editor_u_ptr.get(), &RouteEditor::LegsRouted, this, &MapWidget::OnRouteLegsRouted);
+            route_.route_editor_u_ptr->SetWaypoints({ *route_.start_point_u_ptr, road_point });
         }
+
+        route_.start_point_u_ptr.reset();
+        UpdateAlternatives();
     }
 
-    auto nearest_road_point = std::make_unique<projection::Epsg3857Point>();
-    if (!navigation_manager_u_ptr_->FindNearestRoadPoint(
-            QPointF(
-                (position.x() * pixel_epsg_3857_length_) - kMapBoundEpsg3857,
-                (kMapBoundEpsg3857 - position.y() * pixel_epsg_3857_length_)),
-            *nearest_road_point))
+    DrawRoute();
+}
+
+void MapWidget::OnItemDragStarted(QGraphicsItem* item, const QPointF& position)
+{
+    if (!route_.route_editor_u_ptr)
         return;
 
-    const auto ellipse_item = scene_.addEllipse(
-        (nearest_road_point->x - kPenWidth + kMapBoundEpsg3857) / pixel_epsg_3857_length_,
-        (kMapBoundEpsg3857 - nearest_road_point->y - kPenWidth) / pixel_epsg_3857_length_,
-        2 * kPenWidth,
-        2 * kPenWidth,
-        QPen(Qt::red),
-        QBrush(Qt::red));
+    auto& route_editor = *route_.route_editor_u_ptr;
+
+    auto waypoint = RouteEditor::kNoWaypoint;
+    if (item == route_.path_item)
+    {
+        // Dragging route line pulls new via waypoint out of the leg under cursor
+        const auto point = projection::Epsg3857Point(
+            (position.x() * pixel_epsg_3857_length_) - kMapBoundEpsg3857,
+            kMapBoundEpsg3857 - position.y() * pixel_epsg_3857_length_);
+
+        const auto leg = route_editor.FindNearestLeg(point);
+        if (leg == RouteEditor::kNoWaypoint)
+            return;
 
-    if (!route_.start_point.is_set)
-        route_.start_point = RoadPoint(std::move(nearest_road_point), ellipse_item);
+        waypoint = route_editor.InsertWaypoint(leg, SnapToRoad(position));
+    }
     else
     {
-        route_.end_point = RoadPoint(std::move(nearest_road_point), ellipse_item);
-        DrawRoute();
+        const auto marker_item = std::find(route_.marker_items.begin(), route_.marker_items.end(), item);
+        if (marker_item == route_.marker_items.end())
+            return;
+
+        waypoint = marker_item - route_.marker_items.begin();
     }
+
+    route_editor.BeginDrag(waypoint);
+
+    // Alternatives of the old route are hidden while it is dragged
+    route_.alternative_points.clear();
+
+    DrawRoute();
+}
+
+void MapWidget::OnItemDragged(const QPointF& position)
+{
+    if (!route_.route_editor_u_ptr)
+        return;
+
+    route_.route_editor_u_ptr->DragTo(SnapToRoad(position));
+
+    DrawRoute();
+}
+
+void MapWidget::OnItemDragFinished(const QPointF& position)
+{
+    Q_UNUSED(position);
+
+    if (!route_.route_editor_u_ptr)
+        return;
+
+    route_.route_editor_u_ptr->EndDrag();
+    UpdateAlternatives();
+
+    DrawRoute();
 }
 
 void MapWidget::OnImageRendered(std::shared_ptr<QPixmap> pixmap, const map::Tile& tile, const unsigned int zoom)
@@ -344,6 +822,299 @@ void MapWidget::OnImageRendered(std::shared_ptr<QPixmap> pixmap, const map::Tile
     if (zoom != zoom_)
         return;
 
-    const auto pixmap_item = scene_.addPixmap(*pixmap);
+    const auto pixmap_item = scene_.addPixmap(renderer_processes_manager_u_ptr_->ThemedPixmap(*pixmap));
     pixmap_item->setPos(kTilePixelSize * tile.x_index, kTilePixelSize * (max_axis_index_ - tile.y_index));
+
+    shown_tiles_.push_back({ tile, *pixmap, pixmap_item });
+    if (is_hillshade_enabled_)
+        DrawHillshade(tile);
+}
+
+void MapWidget::OnRouteLegsRouted(const bool is_complete)
+{
+    Q_UNUSED(is_complete);
+
+    // Legs routed on service threads arrive after waypoints were set
+    DrawRoute();
+}
+
+void MapWidget::OnPathFound(const uint64_t path_id, const bool is_found, const std::vector<projection::Epsg3857Point>& path_points)
+{
+    // Route may have been replaced or removed while the query was running
+    if (path_id != route_.paged_path_id || !is_found)
+        return;
+
+    route_.paged_path_points = path_points;
+
+    DrawRoute();
+}
+
+void MapWidget::OnIsochroneModeToggled(const bool is_enabled)
+{
+    is_isochrone_mode_ = is_enabled;
+
+    if (!is_isochrone_mode_)
+        RemoveIsochrone();
+}
+
+void MapWidget::OnIsochroneBudgetChanged(const int budget)
+{
+    Q_UNUSED(budget);
+
+    DrawIsochrone();
+}
+
+void MapWidget::OnRoutingProfileChanged(const routing_profile::Type routing_profile_type)
+{
+    navigation_manager_u_ptr_->SetRoutingProfile(routing_profile_type);
+
+    // Shown route and area were found for previous profile
+    if (route_.route_editor_u_ptr)
+    {
+        route_.route_editor_u_ptr->SetRoutingProfile(routing_profile_type);
+        UpdateAlternatives();
+        DrawRoute();
+    }
+    else if (!route_.paged_waypoints.empty())
+    {
+        route_.paged_path_points.clear();
+        route_.paged_path_id = navigation_manager_u_ptr_->FindPath(route_.paged_waypoints[0], route_.paged_waypoints[1]);
+        DrawRoute();
+    }
+
+    if (isochrone_u_ptr_)
+    {
+        const auto origin = isochrone_u_ptr_->Origin();
+        isochrone_u_ptr_ = navigation_manager_u_ptr_->CreateIsochrone(origin, kIsochroneMaxBudget * kSecondsInMinute);
+        DrawIsochrone();
+    }
+}
+
+void MapWidget::OnStopOrderOptimizationRequested()
+{
+    // With less than two stops after the first one there is nothing to reorder
+    if (!route_.route_editor_u_ptr || route_.route_editor_u_ptr->WaypointCount() < 3)
+        return;
+
+    const auto waypoints = route_.route_editor_u_ptr->Waypoints();
+
+    auto order = std::vector<size_t>();
+    if (!navigation_manager_u_ptr_->OptimizeStopOrder(waypoints, false, kStopOrderTimeBudget, order))
+        return;
+
+    auto ordered_waypoints = std::vector<projection::Epsg3857Point>();
+    ordered_waypoints.reserve(order.size());
+    for (const auto stop : order)
+        ordered_waypoints.push_back(waypoints[stop]);
+
+    route_.route_editor_u_ptr->SetWaypoints(ordered_waypoints);
+
+    DrawRoute();
+}
+
+void MapWidget::OnAlternativesToggled(const bool is_enabled)
+{
+    is_alternatives_mode_ = is_enabled;
+
+    UpdateAlternatives();
+    DrawRoute();
+}
+
+void MapWidget::OnRoadOverrideModeToggled(const bool is_enabled)
+{
+    // Paged graph is read from database rows as they are, so its routes could not follow overrides
+    if (is_enabled && navigation_manager_u_ptr_->IsPaged())
+    {
+        std::cerr << "MapWidget::OnRoadOverrideModeToggled Road overrides are not supported with paged road graph" << std::endl;
+        return;
+    }
+
+    is_road_override_mode_ = is_enabled;
+}
+
+void MapWidget::OnHillshadeToggled(const bool is_enabled)
+{
+    is_hillshade_enabled_ = is_enabled;
+
+    RemoveHillshade();
+    if (!is_hillshade_enabled_)
+    {
+        ClearHillshadeTasks();
+        return;
+    }
+
+    for (const auto& shown_tile : shown_tiles_)
+        DrawHillshade(shown_tile.tile);
+}
+
+void MapWidget::OnThemeChanged(const palette::Theme theme)
+{
+    renderer_processes_manager_u_ptr_->SetTheme(theme);
+
+    // Tiles on screen are transformed from pixmaps they were rendered into, nothing is rendered again
+    for (const auto& shown_tile : shown_tiles_)
+        shown_tile.item->setPixmap(renderer_processes_manager_u_ptr_->ThemedPixmap(shown_tile.pixmap));
+}
+
+void MapWidget::DrawHillshade(const map::Tile& tile)
+{
+    // Zoom takes the top bits, indices of tiles at zoom 22 fit 24 bits each
+    const auto tile_key = (static_cast<uint64_t>(zoom_) << 48) | (static_cast<uint64_t>(tile.x_index) << 24) | tile.y_index;
+
+    auto pixmap = QPixmap();
+    if (hillshade_tile_cache_.FindImage(tile_key, pixmap))
+    {
+        AddHillshadeItem(tile, pixmap);
+        return;
+    }
+
+    if (!hillshade_pending_keys_u_set_.insert(tile_key).second)
+        return;
+
+    // Worker only posts pixels, pixmaps are made and drawn in the UI thread
+    hillshade_service_u_ptr_->Submit(tile, zoom_, [this](const map::Tile& shaded_tile, const unsigned int shaded_zoom, std::vector<uint32_t>&& pixels) {
+        QMetaObject::invokeMethod(this, [this, shaded_tile, shaded_zoom, pixels = std::move(pixels)]() {
+            OnHillshadeTileShaded(shaded_tile, shaded_zoom, pixels);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void MapWidget::OnHillshadeTileShaded(const map::Tile& tile, const unsigned int zoom, const std::vector<uint32_t>& pixels)
+{
+    const auto tile_key = (static_cast<uint64_t>(zoom) << 48) | (static_cast<uint64_t>(tile.x_index) << 24) | tile.y_index;
+
+    auto pixmap = QPixmap();
+    if (!pixels.empty())
+    {
+        const auto image = QImage(reinterpret_cast<const uchar*>(pixels.data()), kTilePixelSize, kTilePixelSize, QImage::Format_ARGB32_Premultiplied);
+        pixmap = QPixmap::fromImage(image);
+    }
+
+    hillshade_tile_cache_.InsertImage(tile_key, pixmap);
+
+    // Tasks are forgotten when zoom changes or shading is turned off, such tile is only cached
+    if (hillshade_pending_keys_u_set_.erase(tile_key) == 0)
+        return;
+
+    AddHillshadeItem(tile, pixmap);
+}
+
+void MapWidget::AddHillshadeItem(const map::Tile& tile, const QPixmap& pixmap)
+{
+    if (pixmap.isNull())
+        return;
+
+    const auto hillshade_item = scene_.addPixmap(pixmap);
+    hillshade_item->setPos(kTilePixelSize * tile.x_index, kTilePixelSize * (max_axis_index_ - tile.y_index));
+    // Blended over tiles, below everything drawn on the map
+    hillshade_item->setZValue(0.1);
+    hillshade_items_.push_back(hillshade_item);
+}
+
+void MapWidget::RemoveHillshade()
+{
+    for (const auto hillshade_item : hillshade_items_)
+    {
+        scene_.removeItem(hillshade_item);
+        delete hillshade_item;
+    }
+
+    hillshade_items_.clear();
+}
+
+void MapWidget::ClearHillshadeTasks()
+{
+    hillshade_service_u_ptr_->Clear();
+    hillshade_pending_keys_u_set_.clear();
+}
+
+void MapWidget::EditRoadOverride(const QPointF& position)
+{
+    const auto point = projection::Epsg3857Point(
+        (position.x() * pixel_epsg_3857_length_) - kMapBoundEpsg3857,
+        kMapBoundEpsg3857 - position.y() * pixel_epsg_3857_length_);
+
+    uint32_t edge;
+    if (!navigation_manager_u_ptr_->FindNearestRoad(point, kRoadOverrideClickDistance * pixel_epsg_3857_length_, edge))
+        return;
+
+    // The same click again lifts the override
+    const auto factor = QGuiApplication::keyboardModifiers() & Qt::ShiftModifier ? kRoadPenaltyFactor : RoadOverrides::kClosed;
+    const auto current_factor = navigation_manager_u_ptr_->CurrentRoadOverrides()->EdgeFactor(edge);
+    if (!navigation_manager_u_ptr_->SetRoadFactor(edge, current_factor == factor ? 1 : factor))
+        return;
+
+    DrawRoadOverrides();
+
+    if (route_.route_editor_u_ptr)
+    {
+        route_.route_editor_u_ptr->SetRoadOverrides(navigation_manager_u_ptr_->CurrentRoadOverrides());
+        UpdateAlternatives();
+        DrawRoute();
+    }
+
+    if (isochrone_u_ptr_)
+    {
+        const auto origin = isochrone_u_ptr_->Origin();
+        isochrone_u_ptr_ = navigation_manager_u_ptr_->CreateIsochrone(origin, kIsochroneMaxBudget * kSecondsInMinute);
+        DrawIsochrone();
+    }
+}
+
+void MapWidget::DrawRoadOverrides()
+{
+    if (!closed_roads_item_ && navigation_manager_u_ptr_->CurrentRoadOverrides()->IsEmpty())
+        return;
+
+    const auto& road_graph = navigation_manager_u_ptr_->SharedRoutingData()->Graph();
+
+    auto closed_path = QPainterPath();
+    auto penalized_path = QPainterPath();
+    auto shape = std::vector<projection::Epsg3857Point>();
+    for (const auto& [edge, factor] : navigation_manager_u_ptr_->CurrentRoadOverrides()->EdgeFactors())
+    {
+        shape.clear();
+        road_graph.EdgeShape(edge, shape);
+
+        auto polyline = QPolygonF();
+        polyline.reserve(shape.size());
+        for (const auto& point : shape)
+            polyline.append(QPointF((point.x + kMapBoundEpsg3857) / pixel_epsg_3857_length_,
+                                    (kMapBoundEpsg3857 - point.y) / pixel_epsg_3857_length_));
+
+        (factor == RoadOverrides::kClosed ? closed_path : penalized_path).addPolygon(polyline);
+    }
+
+    if (!closed_roads_item_)
+    {
+        closed_roads_item_ = scene_.addPath(QPainterPath(), QPen(QColor(220, 30, 30), kPenWidth, Qt::DotLine, Qt::RoundCap));
+        penalized_roads_item_ = scene_.addPath(QPainterPath(), QPen(QColor(240, 150, 20), kPenWidth, Qt::DashLine, Qt::RoundCap));
+        // Above tiles and overlay, below route
+        closed_roads_item_->setZValue(0.9);
+        penalized_roads_item_->setZValue(0.9);
+    }
+
+    closed_roads_item_->setPath(closed_path);
+    penalized_roads_item_->setPath(penalized_path);
+}
+
+void MapWidget::OnSearchQueryChanged(const QString& query)
+{
+    // Nearer places of the same kind go first, so the same street name finds the local one
+    geocoder_u_ptr_->Search(query.toStdString(), ViewCenter(), kSearchResultCount, search_results_);
+
+    auto results = QStringList();
+    for (const auto& result : search_results_)
+        results.append(QString("%1, %2").arg(QString::fromStdString(result.name), Geocoder::KindName(result.kind)));
+
+    search_widget_.SetResults(results);
+}
+
+void MapWidget::OnSearchResultChosen(const int index)
+{
+    if (index < 0 || static_cast<size_t>(index) >= search_results_.size())
+        return;
+
+    const auto& result = search_results_[index];
+    ShowPoint(result.point, SearchResultZoom(result.kind));
 }
@@ -1,15 +1,26 @@
 #ifndef MAPWIDGET_H
 #define MAPWIDGET_H
 
+#include <thread>
+#include <atomic>
 #include <unordered_set>
 
 #include <QWidget>
 #include <QGraphicsEllipseItem>
+#include <QGraphicsPathItem>
 
 #include "RendererProcessesManager.h"
 #include "NavigationManager.h"
+#include "LocationService.h"
+#include "Geocoder.h"
+#include "ReverseGeocoder.h"
+#include "OverlayItem.h"
+#include "HillshadeService.h"
+#include "TileCache.h"
 #include "MapGraphicsView.h"
 #include "MapControlsWidget.h"
+#include "SearchWidget.h"
+#include "RouteEditor.h"
 #include "Map.h"
 
 class MapWidget : public QWidget
@@ -18,6 +29,7 @@ class MapWidget : public QWidget
 
 public:
     explicit MapWidget(QWidget* parent = nullptr);
+    ~MapWidget();
 
 public slots:
     void OnZoomInWheel(const QPointF& zoom_position);
@@ -27,41 +39,64 @@ public slots:
     void OnZoomOutButtton();
 
     void OnLocationButtonPressed();
+    void OnLocationFound(const projection::Epsg4326Point& epsg_4326_point);
 
     void OnMapClicked(const QPointF& position);
+    void OnItemDragStarted(QGraphicsItem* item, const QPointF& position);
+    void OnItemDragged(const QPointF& position);
+    void OnItemDragFinished(const QPointF& position);
+
+    void OnIsochroneModeToggled(const bool is_enabled);
+    void OnIsochroneBudgetChanged(const int budget);
+
+    void OnRoutingProfileChanged(const routing_profile::Type routing_profile_type);
+    void OnStopOrderOptimizationRequested();
+    void OnAlternativesToggled(const bool is_enabled);
+    void OnRoadOverrideModeToggled(const bool is_enabled);
+    void OnHillshadeToggled(const bool is_enabled);
+    void OnThemeChanged(const palette::Theme theme);
+
+    void OnSearchQueryChanged(const QString& query);
+    void OnSearchResultChosen(const int index);
 
     void OnImageRendered(std::shared_ptr<QPixmap> pixmap, const map::Tile& tile, const unsigned int zoom);
+    void OnPathFound(const uint64_t path_id, const bool is_found, const std::vector<projection::Epsg3857Point>& path_points);
+    void OnRouteLegsRouted(const bool is_complete);
 
 private:
-    struct RoadPoint
+    struct Route
     {
-        RoadPoint()
+        Route()
         {
 
         }
 
-        RoadPoint(projection::Epsg3857PointUPtr epsg_3857_point_u_ptr, QGraphicsEllipseItem* scene_item)
-            : epsg_3857_point_u_ptr(std::move(epsg_3857_point_u_ptr)), scene_item(scene_item), is_set(true)
-        {
+        //! Start point chosen by first click, until end point is chosen
+        projection::Epsg3857PointUPtr start_point_u_ptr;
+        //! Created when end point is chosen, owns waypoints and legs
+        RouteEditorUPtr route_editor_u_ptr;
 
-        }
+        //! Waypoint markers in route order
+        std::vector<QGraphicsEllipseItem*> marker_items;
+        QGraphicsPathItem* path_item = nullptr;
+
+        //! Alternatives to route between two waypoints, shown below it and not draggable
+        std::vector<std::vector<projection::Epsg3857Point>> alternative_points;
+        QGraphicsPathItem* alternatives_item = nullptr;
 
-        projection::Epsg3857PointUPtr epsg_3857_point_u_ptr;
-        QGraphicsEllipseItem* scene_item;
-        bool is_set = false;
+        //! With paged graph there is no editor, route between two waypoints is queried by FindPath
+        std::vector<projection::Epsg3857Point> paged_waypoints;
+        std::vector<projection::Epsg3857Point> paged_path_points;
+        //! Result of other queries is ignored
+        uint64_t paged_path_id = 0;
     };
 
-    struct Route
+    struct ShownTile
     {
-        Route()
-        {
-
-        }
-
-        RoadPoint start_point;
-        RoadPoint end_point;
-
-        std::deque<QGraphicsLineItem*> line_deque;
+        map::Tile tile;
+        //! Pixmap as rendered, transformed again when theme changes
+        QPixmap pixmap;
+        QGraphicsPixmapItem* item;
     };
 
     struct RelativeScenePoint
@@ -78,6 +113,15 @@ private:
 
     RendererProcessesManagerUPtr renderer_processes_manager_u_ptr_;
     NavigationManagerUPtr navigation_manager_u_ptr_;
+    LocationServiceUPtr location_service_u_ptr_;
+    GeocoderUPtr geocoder_u_ptr_;
+    //! Empty until loader thread hands it over, stays empty if loading failed
+    ReverseGeocoderUPtr reverse_geocoder_u_ptr_;
+    std::thread reverse_geocoder_loader_thread_;
+    //! Set by destructor, so closing the window does not wait for the whole load
+    std::atomic<bool> is_reverse_geocoder_load_cancelled_ = false;
+    OverlayDataUPtr overlay_data_u_ptr_;
+    HillshadeServiceUPtr hillshade_service_u_ptr_;
 
     QGraphicsScene scene_;
     MapGraphicsView graphics_view_;
@@ -94,9 +138,31 @@ private:
     std::unordered_set<std::string> visible_tiles_u_set_;
 
     MapControlsWidget map_controls_widget_;
+    SearchWidget search_widget_;
+    std::vector<Geocoder::Result> search_results_;
 
     Route route_;
-
+    bool is_alternatives_mode_ = false;
+
+    bool is_isochrone_mode_ = false;
+    IsochroneUPtr isochrone_u_ptr_;
+    QGraphicsPathItem* isochrone_item_ = nullptr;
+
+    bool is_road_override_mode_ = false;
+    QGraphicsPathItem* closed_roads_item_ = nullptr;
+    QGraphicsPathItem* penalized_roads_item_ = nullptr;
+
+    bool is_hillshade_enabled_ = false;
+    //! Shading by tile and zoom, null pixmap for tiles without relief
+    TileCache hillshade_tile_cache_;
+    //! Tiles shown at current zoom, shaded when hillshade is turned on
+    std::vector<ShownTile> shown_tiles_;
+    std::vector<QGraphicsPixmapItem*> hillshade_items_;
+    //! Keys of tiles being shaded, so a tile is not queued twice
+    std::unordered_set<uint64_t> hillshade_pending_keys_u_set_;
+
+    //! Loads reverse geocoder on its own thread, it is set when loading finishes
+    void LoadReverseGeocoder();
     void InitConnections() const;
     void InitLayout();
     void InitMapControls();
@@ -112,8 +178,41 @@ private:
     void RenderTile(const unsigned int x_index, const unsigned int y_index);
 
     void Zoom(const QPointF& zoom_position);
+    void CenterOn(const projection::Epsg4326Point& epsg_4326_point);
+    void CenterOn(const projection::Epsg3857Point& epsg_3857_point);
+    //! Centers on point, zooming in first if current zoom is below min_zoom
+    void ShowPoint(const projection::Epsg3857Point& epsg_3857_point, const unsigned int min_zoom);
+    projection::Epsg3857Point ViewCenter() const;
 
+    //! Creates or updates markers and path of route
     void DrawRoute();
+    void RemoveRoute();
+    //! Finds alternatives if the mode is on and route has two waypoints, otherwise clears them
+    void UpdateAlternatives();
+    //! Nearest point on roads to scene position, or position itself if there are no roads
+    projection::Epsg3857Point SnapToRoad(const QPointF& position) const;
+    //! Shows address and administrative areas of clicked point next to the cursor
+    void ShowAddress(const QPointF& position) const;
+
+    void ComputeIsochrone(const QPointF& position);
+    void DrawIsochrone();
+    void RemoveIsochrone();
+
+    //! Closes or penalizes road nearest to clicked position, or lifts its override, and reroutes
+    void EditRoadOverride(const QPointF& position);
+    void DrawRoadOverrides();
+
+    //! Adds item drawing user datasets for current zoom, if any were loaded
+    void DrawOverlay();
+
+    //! Adds relief shading over tile, computed on first use and then taken from cache
+    void DrawHillshade(const map::Tile& tile);
+    //! Caches tile shaded by the worker and draws it if it is still shown
+    void OnHillshadeTileShaded(const map::Tile& tile, const unsigned int zoom, const std::vector<uint32_t>& pixels);
+    void AddHillshadeItem(const map::Tile& tile, const QPixmap& pixmap);
+    //! Drops shading queued for tiles no longer shown
+    void ClearHillshadeTasks();
+    void RemoveHillshade();
 };
 
 #endif // MAPWIDGET_H
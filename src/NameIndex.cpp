@@ -0,0 +1,705 @@
+#include "NameIndex.h"
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+constexpr char kNameIndexMagic[] = "ORNI";
+constexpr uint32_t kNameIndexVersion { 1 };
+//! Every kTokenRestartInterval-th token is stored in full, so search can start there
+constexpr uint32_t kTokenRestartInterval { 16 };
+constexpr size_t kMaxNameSize { std::numeric_limits<uint16_t>::max() };
+
+//! Base letters of U+00C0-U+00FF and U+0100-U+017F, space marks separators
+constexpr char kLatin1Letters[] = "aaaaaaaceeeeiiiidnooooo ouuuuytsaaaaaaaceeeeiiiidnooooo ouuuuyty";
+constexpr char kLatinExtendedALetters[] = "aaaaaaccccccccddddeeeeeeeeeegggggggghhhhiiiiiiiiiiiijjkkkllllllllllnnnnnnnnnoooooooorrrrrrssssssssttttttuuuuuuuuuuuuwwyyyzzzzzzs";
+
+enum NameIndexSection
+{
+    kPlacesSection,
+    kNamesSection,
+    kPlaceTokenOffsetsSection,
+    kPlaceTokensSection,
+    kTokenRestartsSection,
+    kTokensSection,
+    kPostingOffsetsSection,
+    kPostingsSection,
+    kNameIndexSectionCount
+};
+
+struct NameIndexHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t place_count;
+    uint64_t token_count;
+    uint64_t restart_count;
+    uint64_t section_offsets[kNameIndexSectionCount];
+    uint64_t section_sizes[kNameIndexSectionCount];
+};
+
+struct NameIndex::PlaceRecord
+{
+    double x;
+    double y;
+    uint32_t name_offset;
+    uint16_t name_size;
+    uint8_t kind;
+    uint8_t reserved;
+};
+
+//! Invalid sequences decode to U+FFFD one byte at a time
+uint32_t DecodeCodePoint(const std::string_view text, size_t& offset)
+{
+    const auto lead = static_cast<uint8_t>(text[offset++]);
+    if (lead < 0x80)
+        return lead;
+
+    const auto length = lead >= 0xf0 ? 3 : (lead >= 0xe0 ? 2 : (lead >= 0xc0 ? 1 : 0));
+    if (length == 0 || lead >= 0xf8 || offset + length > text.size())
+        return 0xfffd;
+
+    auto code_point = uint32_t(lead & (0x3f >> length));
+    for (int i = 0; i < length; i++)
+    {
+        const auto byte = static_cast<uint8_t>(text[offset + i]);
+        if ((byte & 0xc0) != 0x80)
+            return 0xfffd;
+
+        code_point = code_point << 6 | (byte & 0x3f);
+    }
+
+    offset += length;
+
+    return code_point;
+}
+
+void AppendCodePoint(const uint32_t code_point, std::string& text)
+{
+    if (code_point < 0x80)
+    {
+        text.push_back(static_cast<char>(code_point));
+    }
+    else if (code_point < 0x800)
+    {
+        text.push_back(static_cast<char>(0xc0 | code_point >> 6));
+        text.push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+    }
+    else if (code_point < 0x10000)
+    {
+        text.push_back(static_cast<char>(0xe0 | code_point >> 12));
+        text.push_back(static_cast<char>(0x80 | (code_point >> 6 & 0x3f)));
+        text.push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+    }
+    else
+    {
+        text.push_back(static_cast<char>(0xf0 | code_point >> 18));
+        text.push_back(static_cast<char>(0x80 | (code_point >> 12 & 0x3f)));
+        text.push_back(static_cast<char>(0x80 | (code_point >> 6 & 0x3f)));
+        text.push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+    }
+}
+
+/* Lowercases and strips diacritics of Latin, Cyrillic and Greek letters,
+returns 0 for characters which separate tokens. Other scripts are kept as is */
+uint32_t NormalizeCodePoint(const uint32_t code_point)
+{
+    if (code_point < 0x80)
+    {
+        if (code_point >= 'A' && code_point <= 'Z')
+            return code_point + ('a' - 'A');
+
+        return (code_point >= 'a' && code_point <= 'z') || (code_point >= '0' && code_point <= '9') ? code_point : 0;
+    }
+
+    if (code_point < 0xc0 || (code_point >= 0x2000 && code_point < 0x2070) || (code_point >= 0x3000 && code_point < 0x3040) || code_point == 0xfffd)
+        return 0;
+
+    if (code_point < 0x100)
+        return kLatin1Letters[code_point - 0xc0] == ' ' ? 0 : static_cast<uint32_t>(kLatin1Letters[code_point - 0xc0]);
+
+    if (code_point < 0x180)
+        return static_cast<uint32_t>(kLatinExtendedALetters[code_point - 0x100]);
+
+    // Greek capitals
+    if (code_point >= 0x391 && code_point <= 0x3a9)
+        return code_point + 0x20;
+
+    // Cyrillic, yo is written as ye in most names
+    if (code_point == 0x401 || code_point == 0x451)
+        return 0x435;
+    if (code_point >= 0x400 && code_point < 0x410)
+        return code_point + 0x50;
+    if (code_point >= 0x410 && code_point < 0x430)
+        return code_point + 0x20;
+
+    return code_point;
+}
+
+void DecodeCodePoints(const std::string_view text, std::vector<uint32_t>& code_points)
+{
+    code_points.clear();
+    for (size_t offset = 0; offset < text.size();)
+        code_points.push_back(DecodeCodePoint(text, offset));
+}
+
+void WriteTokenVarint(uint64_t value, std::string& bytes)
+{
+    for (; value >= 0x80; value >>= 7)
+        bytes.push_back(static_cast<char>(value | 0x80));
+
+    bytes.push_back(static_cast<char>(value));
+}
+
+size_t AlignSection(const size_t size)
+{
+    return (size + 7) & ~size_t(7);
+}
+
+NameIndex::NameIndex()
+{
+
+}
+
+NameIndex::~NameIndex()
+{
+    if (mapping_)
+        munmap(mapping_, size_);
+}
+
+void NameIndex::Tokenize(const std::string_view text, std::vector<std::string>& tokens)
+{
+    tokens.clear();
+
+    auto token = std::string();
+    for (size_t offset = 0; offset < text.size();)
+    {
+        const auto code_point = DecodeCodePoint(text, offset);
+
+        // Sharp s is the only letter which expands into two
+        if (code_point == 0xdf)
+        {
+            token.append("ss");
+            continue;
+        }
+
+        const auto normalized_code_point = NormalizeCodePoint(code_point);
+        if (normalized_code_point != 0)
+        {
+            AppendCodePoint(normalized_code_point, token);
+            continue;
+        }
+
+        if (!token.empty())
+            tokens.push_back(std::move(token));
+
+        token.clear();
+    }
+
+    if (!token.empty())
+        tokens.push_back(std::move(token));
+}
+
+NameIndexUPtr NameIndex::Create(std::vector<Place>& places)
+{
+    std::sort(places.begin(), places.end(), [](const Place& lhs, const Place& rhs) {
+        if (lhs.kind != rhs.kind)
+            return lhs.kind < rhs.kind;
+        if (lhs.name != rhs.name)
+            return lhs.name < rhs.name;
+
+        return lhs.point.x != rhs.point.x ? lhs.point.x < rhs.point.x : lhs.point.y < rhs.point.y;
+    });
+
+    // Names which are too long for the record are dropped, as are names without tokens
+    places.erase(std::remove_if(places.begin(), places.end(), [](const Place& place) { return place.name.size() > kMaxNameSize; }),
+                 places.end());
+
+    auto token_places = std::vector<std::pair<std::string, uint32_t>>();
+    auto tokens = std::vector<std::string>();
+    auto names = std::string();
+    auto place_records = std::vector<PlaceRecord>();
+    for (const auto& place : places)
+    {
+        Tokenize(place.name, tokens);
+        if (tokens.empty())
+            continue;
+
+        std::sort(tokens.begin(), tokens.end());
+        tokens.erase(std::unique(tokens.begin(), tokens.end()), tokens.end());
+
+        for (auto& token : tokens)
+            token_places.emplace_back(std::move(token), static_cast<uint32_t>(place_records.size()));
+
+        place_records.push_back(PlaceRecord { place.point.x, place.point.y, static_cast<uint32_t>(names.size()),
+                                              static_cast<uint16_t>(place.name.size()), static_cast<uint8_t>(place.kind), 0 });
+        names.append(place.name);
+    }
+
+    if (names.size() > std::numeric_limits<uint32_t>::max())
+    {
+        std::cerr << "NameIndex::Create Names do not fit 32 bit offsets" << std::endl;
+        return nullptr;
+    }
+
+    std::sort(token_places.begin(), token_places.end());
+
+    // Postings come out sorted by place, since pairs are sorted by token and then by place
+    auto token_bytes = std::string();
+    auto token_restarts = std::vector<uint32_t>();
+    auto posting_offsets = std::vector<uint32_t>();
+    auto postings = std::vector<uint32_t>();
+    auto place_token_counts = std::vector<uint32_t>(place_records.size() + 1, 0);
+    const std::string* previous_token = nullptr;
+    for (const auto& token_place : token_places)
+    {
+        const auto& token = token_place.first;
+        if (!previous_token || token != *previous_token)
+        {
+            const auto token_id = posting_offsets.size();
+            auto shared_size = size_t(0);
+            if (token_id % kTokenRestartInterval == 0)
+            {
+                token_restarts.push_back(static_cast<uint32_t>(token_bytes.size()));
+            }
+            else
+            {
+                const auto max_shared_size = std::min(token.size(), previous_token->size());
+                for (; shared_size < max_shared_size && token[shared_size] == (*previous_token)[shared_size];)
+                    shared_size++;
+            }
+
+            WriteTokenVarint(shared_size, token_bytes);
+            WriteTokenVarint(token.size() - shared_size, token_bytes);
+            token_bytes.append(token, shared_size, std::string::npos);
+
+            posting_offsets.push_back(static_cast<uint32_t>(postings.size()));
+            previous_token = &token;
+        }
+
+        postings.push_back(token_place.second);
+        place_token_counts[token_place.second + 1]++;
+    }
+
+    posting_offsets.push_back(static_cast<uint32_t>(postings.size()));
+
+    // Counting sort by place keeps token ids of every place in increasing order
+    for (size_t place = 1; place < place_token_counts.size(); place++)
+        place_token_counts[place] += place_token_counts[place - 1];
+
+    const auto& place_token_offsets = place_token_counts;
+    auto place_tokens = std::vector<uint32_t>(postings.size());
+    auto place_token_ends = std::vector<uint32_t>(place_token_offsets.begin(), place_token_offsets.end() - 1);
+    for (uint32_t token_id = 0; token_id + 1 < posting_offsets.size(); token_id++)
+    {
+        for (auto posting = posting_offsets[token_id]; posting < posting_offsets[token_id + 1]; posting++)
+            place_tokens[place_token_ends[postings[posting]]++] = token_id;
+    }
+
+    auto header = NameIndexHeader();
+    std::memcpy(header.magic, kNameIndexMagic, sizeof(header.magic));
+    header.version = kNameIndexVersion;
+    header.place_count = place_records.size();
+    header.token_count = posting_offsets.size() - 1;
+    header.restart_count = token_restarts.size();
+
+    const std::pair<const void*, size_t> sections[kNameIndexSectionCount] = {
+        { place_records.data(), place_records.size() * sizeof(PlaceRecord) },
+        { names.data(), names.size() },
+        { place_token_offsets.data(), place_token_offsets.size() * sizeof(uint32_t) },
+        { place_tokens.data(), place_tokens.size() * sizeof(uint32_t) },
+        { token_restarts.data(), token_restarts.size() * sizeof(uint32_t) },
+        { token_bytes.data(), token_bytes.size() },
+        { posting_offsets.data(), posting_offsets.size() * sizeof(uint32_t) },
+        { postings.data(), postings.size() * sizeof(uint32_t) },
+    };
+
+    auto size = AlignSection(sizeof(NameIndexHeader));
+    for (int section = 0; section < kNameIndexSectionCount; section++)
+    {
+        header.section_offsets[section] = size;
+        header.section_sizes[section] = sections[section].second;
+        size += AlignSection(sections[section].second);
+    }
+
+    std::unique_ptr<NameIndex> instance(new NameIndex());
+
+    // Buffer of 64 bit words keeps every section aligned like in mapped file
+    instance->buffer_.assign(size / sizeof(uint64_t), 0);
+    const auto data = reinterpret_cast<char*>(instance->buffer_.data());
+    std::memcpy(data, &header, sizeof(header));
+    for (int section = 0; section < kNameIndexSectionCount; section++)
+    {
+        if (sections[section].second > 0)
+            std::memcpy(data + header.section_offsets[section], sections[section].first, sections[section].second);
+    }
+
+    instance->data_ = data;
+    instance->size_ = size;
+    if (!instance->Attach())
+        return nullptr;
+
+    return instance;
+}
+
+NameIndexUPtr NameIndex::Create(const std::string& path)
+{
+    const auto file_descriptor = open(path.c_str(), O_RDONLY);
+    if (file_descriptor < 0)
+        return nullptr;
+
+    struct stat file_stat;
+    if (fstat(file_descriptor, &file_stat) != 0 || file_stat.st_size < static_cast<off_t>(sizeof(NameIndexHeader)))
+    {
+        std::cerr << "NameIndex::Create File is too short: " << path << std::endl;
+        close(file_descriptor);
+        return nullptr;
+    }
+
+    std::unique_ptr<NameIndex> instance(new NameIndex());
+
+    const auto size = static_cast<size_t>(file_stat.st_size);
+    const auto mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+    close(file_descriptor);
+
+    if (mapping == MAP_FAILED)
+    {
+        std::cerr << "NameIndex::Create Failed to map " << path << std::endl;
+        return nullptr;
+    }
+
+    instance->mapping_ = mapping;
+    instance->data_ = static_cast<const char*>(mapping);
+    instance->size_ = size;
+    if (!instance->Attach())
+    {
+        std::cerr << "NameIndex::Create Broken index file " << path << std::endl;
+        return nullptr;
+    }
+
+    return instance;
+}
+
+bool NameIndex::Write(const std::string& path) const
+{
+    auto file = std::ofstream(path, std::ios::binary);
+    if (!file)
+    {
+        std::cerr << "NameIndex::Write Failed to open " << path << std::endl;
+        return false;
+    }
+
+    file.write(data_, static_cast<std::streamsize>(size_));
+    if (!file)
+    {
+        std::cerr << "NameIndex::Write Failed to write " << path << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool NameIndex::Attach()
+{
+    if (size_ < sizeof(NameIndexHeader))
+        return false;
+
+    auto header = NameIndexHeader();
+    std::memcpy(&header, data_, sizeof(header));
+    if (std::memcmp(header.magic, kNameIndexMagic, sizeof(header.magic)) != 0 || header.version != kNameIndexVersion)
+        return false;
+
+    for (int section = 0; section < kNameIndexSectionCount; section++)
+    {
+        if (header.section_offsets[section] % 8 != 0 || header.section_offsets[section] > size_ ||
+            header.section_sizes[section] > size_ - header.section_offsets[section])
+            return false;
+    }
+
+    const auto& sizes = header.section_sizes;
+    if (header.token_count >= std::numeric_limits<uint32_t>::max() ||
+        sizes[kPlacesSection] != header.place_count * sizeof(PlaceRecord) ||
+        sizes[kPlaceTokenOffsetsSection] != (header.place_count + 1) * sizeof(uint32_t) ||
+        sizes[kTokenRestartsSection] != header.restart_count * sizeof(uint32_t) ||
+        header.restart_count != (header.token_count + kTokenRestartInterval - 1) / kTokenRestartInterval ||
+        sizes[kPostingOffsetsSection] != (header.token_count + 1) * sizeof(uint32_t))
+        return false;
+
+    place_count_ = header.place_count;
+    token_count_ = header.token_count;
+    restart_count_ = header.restart_count;
+
+    places_ = reinterpret_cast<const PlaceRecord*>(data_ + header.section_offsets[kPlacesSection]);
+    names_ = data_ + header.section_offsets[kNamesSection];
+    place_token_offsets_ = reinterpret_cast<const uint32_t*>(data_ + header.section_offsets[kPlaceTokenOffsetsSection]);
+    place_tokens_ = reinterpret_cast<const uint32_t*>(data_ + header.section_offsets[kPlaceTokensSection]);
+    token_restarts_ = reinterpret_cast<const uint32_t*>(data_ + header.section_offsets[kTokenRestartsSection]);
+    tokens_ = data_ + header.section_offsets[kTokensSection];
+    token_bytes_size_ = sizes[kTokensSection];
+    posting_offsets_ = reinterpret_cast<const uint32_t*>(data_ + header.section_offsets[kPostingOffsetsSection]);
+    postings_ = reinterpret_cast<const uint32_t*>(data_ + header.section_offsets[kPostingsSection]);
+
+    // Every reference is checked once here, so queries need no bounds checks
+    const auto place_token_count = sizes[kPlaceTokensSection] / sizeof(uint32_t);
+    if (place_token_offsets_[0] != 0 || place_token_offsets_[place_count_] != place_token_count)
+        return false;
+
+    for (size_t place = 0; place < place_count_; place++)
+    {
+        if (place_token_offsets_[place] > place_token_offsets_[place + 1] ||
+            uint64_t(places_[place].name_offset) + places_[place].name_size > sizes[kNamesSection])
+            return false;
+    }
+
+    if (!std::all_of(place_tokens_, place_tokens_ + place_token_count, [this](const uint32_t token_id) { return token_id < token_count_; }))
+        return false;
+
+    const auto posting_count = sizes[kPostingsSection] / sizeof(uint32_t);
+    if (posting_offsets_[0] != 0 || posting_offsets_[token_count_] != posting_count)
+        return false;
+
+    for (size_t token_id = 0; token_id < token_count_; token_id++)
+    {
+        if (posting_offsets_[token_id] > posting_offsets_[token_id + 1])
+            return false;
+    }
+
+    if (!std::all_of(postings_, postings_ + posting_count, [this](const uint32_t place) { return place < place_count_; }))
+        return false;
+
+    // Tokens must decode within bounds, restart where expected and be strictly increasing
+    auto token = std::string();
+    auto previous_token = std::string();
+    size_t offset = 0;
+    for (size_t token_id = 0; token_id < token_count_; token_id++)
+    {
+        const auto read_varint = [&](uint64_t& value) {
+            value = 0;
+            for (unsigned int shift = 0; shift < 64 && offset < token_bytes_size_; shift += 7)
+            {
+                const auto byte = static_cast<uint8_t>(tokens_[offset++]);
+                value |= uint64_t(byte & 0x7f) << shift;
+                if (!(byte & 0x80))
+                    return true;
+            }
+
+            return false;
+        };
+
+        if (token_id % kTokenRestartInterval == 0 && token_restarts_[token_id / kTokenRestartInterval] != offset)
+            return false;
+
+        uint64_t shared_size, suffix_size;
+        if (!read_varint(shared_size) || !read_varint(suffix_size) || shared_size > token.size() ||
+            (token_id % kTokenRestartInterval == 0 && shared_size != 0) || suffix_size > token_bytes_size_ - offset)
+            return false;
+
+        token.resize(shared_size);
+        token.append(tokens_ + offset, suffix_size);
+        offset += suffix_size;
+
+        if (token.empty() || (token_id > 0 && token <= previous_token))
+            return false;
+
+        previous_token = token;
+    }
+
+    return true;
+}
+
+std::string_view NameIndex::PlaceName(const uint32_t place) const
+{
+    return std::string_view(names_ + places_[place].name_offset, places_[place].name_size);
+}
+
+NameIndex::PlaceKind NameIndex::Kind(const uint32_t place) const
+{
+    return static_cast<PlaceKind>(places_[place].kind);
+}
+
+projection::Epsg3857Point NameIndex::PlacePoint(const uint32_t place) const
+{
+    return projection::Epsg3857Point(places_[place].x, places_[place].y);
+}
+
+size_t NameIndex::DecodeToken(size_t& offset, std::string& token) const
+{
+    const auto read_varint = [&]() {
+        uint64_t value = 0;
+        for (unsigned int shift = 0;; shift += 7)
+        {
+            const auto byte = static_cast<uint8_t>(tokens_[offset++]);
+            value |= uint64_t(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                return value;
+        }
+    };
+
+    const auto shared_size = read_varint();
+    const auto suffix_size = read_varint();
+
+    token.resize(shared_size);
+    token.append(tokens_ + offset, suffix_size);
+    offset += suffix_size;
+
+    return shared_size;
+}
+
+void NameIndex::TokenAt(const uint32_t token_id, std::string& token) const
+{
+    auto offset = size_t(token_restarts_[token_id / kTokenRestartInterval]);
+    token.clear();
+    for (auto id = token_id - token_id % kTokenRestartInterval; id <= token_id; id++)
+        DecodeToken(offset, token);
+}
+
+template <typename IsBefore>
+uint32_t NameIndex::LowerBound(IsBefore is_before) const
+{
+    // First block whose first token is not before, the answer is in the block preceding it
+    auto token = std::string();
+    size_t low = 0, high = restart_count_;
+    for (; low < high;)
+    {
+        const auto middle = (low + high) / 2;
+
+        auto offset = size_t(token_restarts_[middle]);
+        token.clear();
+        DecodeToken(offset, token);
+
+        if (is_before(token))
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    if (low == 0)
+        return 0;
+
+    const auto block = low - 1;
+    auto offset = size_t(token_restarts_[block]);
+    token.clear();
+
+    auto token_id = static_cast<uint32_t>(block * kTokenRestartInterval);
+    const auto block_end = static_cast<uint32_t>(std::min<size_t>(token_count_, low * kTokenRestartInterval));
+    for (; token_id < block_end; token_id++)
+    {
+        DecodeToken(offset, token);
+        if (!is_before(token))
+            return token_id;
+    }
+
+    return token_id;
+}
+
+bool NameIndex::FindToken(const std::string_view token, uint32_t& token_id) const
+{
+    token_id = LowerBound([&](const std::string& index_token) { return index_token < token; });
+    if (token_id >= token_count_)
+        return false;
+
+    auto index_token = std::string();
+    TokenAt(token_id, index_token);
+
+    return index_token == token;
+}
+
+void NameIndex::FindPrefix(const std::string_view prefix, uint32_t& first_token, uint32_t& last_token) const
+{
+    first_token = LowerBound([&](const std::string& index_token) { return index_token < prefix; });
+    last_token = LowerBound([&](const std::string& index_token) {
+        return index_token < prefix || index_token.compare(0, prefix.size(), prefix) == 0;
+    });
+}
+
+void NameIndex::FindSimilarTokens(const std::string_view token, const bool is_prefix, const unsigned int max_distance,
+                                  std::vector<uint32_t>& token_ids) const
+{
+    constexpr size_t kNoDepth { std::numeric_limits<size_t>::max() };
+
+    token_ids.clear();
+    if (token.empty())
+        return;
+
+    auto first_letter_size = size_t(0);
+    DecodeCodePoint(token, first_letter_size);
+
+    uint32_t first_token, last_token;
+    FindPrefix(token.substr(0, first_letter_size), first_token, last_token);
+    if (first_token == last_token)
+        return;
+
+    auto pattern = std::vector<uint32_t>();
+    DecodeCodePoints(token, pattern);
+    const auto column_count = pattern.size() + 1;
+
+    /* Row k of Levenshtein table belongs to the first k letters of index token.
+    Sorted tokens share prefixes, so rows of shared letters are kept like on a
+    walk over a trie. Once every cell of a row exceeds max_distance the rest of
+    the token cannot match, once the last cell fits a prefix match is found */
+    auto rows = std::vector<unsigned int>(column_count);
+    for (size_t column = 0; column < column_count; column++)
+        rows[column] = static_cast<unsigned int>(column);
+
+    auto letter_ends = std::vector<size_t>();
+    auto dead_depth = kNoDepth;
+    auto match_depth = kNoDepth;
+
+    auto index_token = std::string();
+    auto offset = size_t(token_restarts_[first_token / kTokenRestartInterval]);
+    for (auto token_id = first_token - first_token % kTokenRestartInterval; token_id < last_token; token_id++)
+    {
+        const auto shared_size = DecodeToken(offset, index_token);
+
+        // Rows of letters which lie within bytes shared with the previous token stay valid
+        const auto depth = static_cast<size_t>(std::upper_bound(letter_ends.begin(), letter_ends.end(), shared_size) - letter_ends.begin());
+        letter_ends.resize(depth);
+        rows.resize((depth + 1) * column_count);
+        if (dead_depth > depth)
+            dead_depth = kNoDepth;
+        if (match_depth > depth)
+            match_depth = kNoDepth;
+
+        auto letter_offset = depth == 0 ? size_t(0) : letter_ends.back();
+        for (; letter_offset < index_token.size() && dead_depth == kNoDepth && (!is_prefix || match_depth == kNoDepth);)
+        {
+            const auto letter = DecodeCodePoint(index_token, letter_offset);
+            letter_ends.push_back(letter_offset);
+
+            rows.resize(rows.size() + column_count);
+            const auto row = rows.data() + rows.size() - column_count;
+            const auto previous_row = row - column_count;
+
+            row[0] = previous_row[0] + 1;
+            auto row_min = row[0];
+            for (size_t column = 1; column < column_count; column++)
+            {
+                row[column] = std::min({ previous_row[column] + 1, row[column - 1] + 1,
+                                         previous_row[column - 1] + (pattern[column - 1] == letter ? 0 : 1) });
+                row_min = std::min(row_min, row[column]);
+            }
+
+            if (row_min > max_distance)
+                dead_depth = letter_ends.size();
+            if (row[column_count - 1] <= max_distance && match_depth == kNoDepth)
+                match_depth = letter_ends.size();
+        }
+
+        if (token_id < first_token)
+            continue;
+
+        const auto is_similar = is_prefix
+            ? match_depth != kNoDepth
+            : dead_depth == kNoDepth && letter_offset == index_token.size() && rows.back() <= max_distance;
+
+        if (is_similar)
+            token_ids.push_back(token_id);
+    }
+}
@@ -0,0 +1,121 @@
+#ifndef NAMEINDEX_H
+#define NAMEINDEX_H
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+#include "Projection.h"
+
+class NameIndex;
+using NameIndexUPtr = std::unique_ptr<NameIndex>;
+
+/* Token index over names of places. Names are split into normalized tokens
+(lowercase, without diacritics), tokens are sorted and front coded in blocks,
+postings of token i list places having it. Everything lives in one flat
+buffer, which is written to file as is and memory mapped on load, so opening
+index of a whole country takes no parsing. Token ids follow token order,
+so all tokens with common prefix form one id range with adjacent postings */
+class NameIndex
+{
+public:
+    //! Kind of named object, earlier kinds rank higher in search results
+    enum class PlaceKind : uint8_t
+    {
+        Region,
+        City,
+        Town,
+        Village,
+        Suburb,
+        Locality,
+        Street,
+        PointOfInterest
+    };
+
+    struct Place
+    {
+        std::string name;
+        PlaceKind kind;
+        projection::Epsg3857Point point;
+    };
+
+    //! Places are numbered by kind and name, so smaller index means higher rank
+    static NameIndexUPtr Create(std::vector<Place>& places);
+    //! Maps index written by Write, returns nullptr if file is missing or broken
+    static NameIndexUPtr Create(const std::string& path);
+    ~NameIndex();
+
+    NameIndex(const NameIndex&) = delete;
+    NameIndex& operator=(const NameIndex&) = delete;
+
+    bool Write(const std::string& path) const;
+
+    //! Splits text into normalized tokens, same rules are used for names and queries
+    static void Tokenize(const std::string_view text, std::vector<std::string>& tokens);
+
+    size_t PlaceCount() const { return place_count_; }
+    size_t TokenCount() const { return token_count_; }
+
+    std::string_view PlaceName(const uint32_t place) const;
+    PlaceKind Kind(const uint32_t place) const;
+    projection::Epsg3857Point PlacePoint(const uint32_t place) const;
+    //! Sorted ids of distinct tokens of place name
+    const uint32_t* PlaceTokensBegin(const uint32_t place) const { return place_tokens_ + place_token_offsets_[place]; }
+    const uint32_t* PlaceTokensEnd(const uint32_t place) const { return place_tokens_ + place_token_offsets_[place + 1]; }
+
+    //! Sorted places having any token of [first_token, last_token)
+    const uint32_t* PostingsBegin(const uint32_t first_token) const { return postings_ + posting_offsets_[first_token]; }
+    const uint32_t* PostingsEnd(const uint32_t last_token) const { return postings_ + posting_offsets_[last_token]; }
+    size_t PostingCount(const uint32_t first_token, const uint32_t last_token) const
+    {
+        return posting_offsets_[last_token] - posting_offsets_[first_token];
+    }
+
+    bool FindToken(const std::string_view token, uint32_t& token_id) const;
+    //! Range of tokens starting with prefix, empty if there are none
+    void FindPrefix(const std::string_view prefix, uint32_t& first_token, uint32_t& last_token) const;
+    /* Finds tokens within max_distance edits of token, or with such prefix if
+    is_prefix. Only tokens with the same first letter are checked, typos there
+    are rare and it keeps the scan short */
+    void FindSimilarTokens(const std::string_view token, const bool is_prefix, const unsigned int max_distance,
+                           std::vector<uint32_t>& token_ids) const;
+
+private:
+    struct PlaceRecord;
+
+    //! Owned buffer of built index, empty when file is mapped
+    std::vector<uint64_t> buffer_;
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    void* mapping_ = nullptr;
+
+    size_t place_count_ = 0;
+    size_t token_count_ = 0;
+    size_t restart_count_ = 0;
+
+    const PlaceRecord* places_ = nullptr;
+    const char* names_ = nullptr;
+    const uint32_t* place_token_offsets_ = nullptr;
+    const uint32_t* place_tokens_ = nullptr;
+    const uint32_t* token_restarts_ = nullptr;
+    const char* tokens_ = nullptr;
+    size_t token_bytes_size_ = 0;
+    const uint32_t* posting_offsets_ = nullptr;
+    const uint32_t* postings_ = nullptr;
+
+    NameIndex();
+
+    //! Sets section pointers from data_, checks that sections fit the buffer
+    bool Attach();
+
+    //! First token id for which is_before(token) is false, is_before must be monotonic
+    template <typename IsBefore>
+    uint32_t LowerBound(IsBefore is_before) const;
+    //! Decodes token at offset into token, which holds the previous one, returns number of bytes kept from it
+    size_t DecodeToken(size_t& offset, std::string& token) const;
+    void TokenAt(const uint32_t token_id, std::string& token) const;
+};
+
+#endif // NAMEINDEX_H
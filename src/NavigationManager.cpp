@@ -1,289 +1,343 @@
 #include "NavigationManager.h"
 
 #include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <cstdlib>
 
-#include <QtSql/QSqlQuery>
+#include <QByteArray>
 #include <QtSql/QSqlError>
 #include <QtSql/QSqlDatabase>
-#include <QRegularExpression>
 
-NavigationManager::NavigationManager()
-{
-    database_ = QSqlDatabase::addDatabase("QPSQL");
-    database_.setHostName("localhost");
-    database_.setDatabaseName("gis");
-    database_.setUserName("mapper");
-    database_.setPassword("");
-}
+#include "DistanceMatrix.h"
+#include "Trace.h"
+#include "StopOrder.h"
+
+//! Routes waiting for a worker, Submit blocks above this
+constexpr size_t kRoutingServiceQueueSize { 1024 };
 
-NavigationManagerUPtr NavigationManager::Create()
+/* Loads graph file written by OpenRouteImporter when OPENROUTE_GRAPH is set.
+Otherwise opens a connection with unique name, loads routing data and removes
+the connection. Default connection belongs to the thread that opened it, while
+loaded data is used from any thread */
+RoutingDataSPtr LoadRoutingData(const RoadGraph::VertexOrder vertex_order)
 {
-    auto instance = std::make_unique<NavigationManager>(NavigationManager());
+    const auto graph_path = std::getenv("OPENROUTE_GRAPH");
+    if (graph_path && *graph_path)
+        return RoutingData::Create(RoadGraph::Create(std::string(graph_path), vertex_order));
 
-    if (!instance->database_.open())
+    static auto connection_counter = std::atomic<int>(0);
+    const auto connection_name = QString("NavigationManager%1").arg(connection_counter.fetch_add(1));
+
+    auto routing_data_s_ptr = RoutingDataSPtr();
     {
-        std::cerr << "NavigationManager::Create Database connection error: " << instance->database_.lastError().text().toStdString() << std::endl;
-        return nullptr;
+        auto database = QSqlDatabase::addDatabase("QPSQL", connection_name);
+        database.setHostName("localhost");
+        database.setDatabaseName("gis");
+        database.setUserName("mapper");
+        database.setPassword("");
+
+        if (database.open())
+        {
+            routing_data_s_ptr = RoutingData::Create(database, vertex_order);
+            database.close();
+        }
+        else
+        {
+            std::cerr << "NavigationManager::Create Database connection error: " << database.lastError().text().toStdString() << std::endl;
+        }
     }
 
-    return instance;
+    QSqlDatabase::removeDatabase(connection_name);
+
+    return routing_data_s_ptr;
 }
 
-bool NavigationManager::FindNearestRoadPoint(const QPointF& position, projection::Epsg3857Point& nearest_road_point)
+NavigationManager::NavigationManager()
 {
-    QSqlQuery query;
-    query.prepare(R"(
-        SELECT
-            ST_AsText(ST_ClosestPoint(way, ST_SetSRID(ST_MakePoint(:x, :y), 3857))) AS closest_point,
-            ST_Distance(way, ST_SetSRID(ST_MakePoint(:x, :y), 3857)) AS distance
-        FROM
-            planet_osm_line
-        WHERE
-            highway IS NOT NULL
-        ORDER BY
-            distance
-        LIMIT 1;
-    )");
-    query.bindValue(":x", position.x());
-    query.bindValue(":y", position.y());
-
-    if (!query.exec() || !query.next())
+
+}
+
+NavigationManagerUPtr NavigationManager::Create(const RoadGraph::VertexOrder vertex_order)
+{
+    std::unique_ptr<NavigationManager> instance(new NavigationManager());
+
+    // Graph too large to load is queried from database by cells, only FindPath is served then
+    const auto paged_budget = std::getenv("OPENROUTE_PAGED_GRAPH");
+    if (paged_budget && *paged_budget)
     {
-        std::cerr << "NavigationManager::FindNearestRoadPoint SQL query execution error: " << query.lastError().text().toStdString() << std::endl;
-        return false;
-    }
+        auto is_valid = false;
+        const auto paged_budget_megabytes = QByteArray(paged_budget).toULongLong(&is_valid);
+        if (!is_valid || paged_budget_megabytes == 0)
+        {
+            std::cerr << "NavigationManager::Create OPENROUTE_PAGED_GRAPH must be cell cache budget in megabytes" << std::endl;
+            return nullptr;
+        }
+
+        instance->paged_routing_service_u_ptr_ = PagedRoutingService::Create(static_cast<size_t>(paged_budget_megabytes) << 20, kRoutingServiceQueueSize);
+        if (!instance->paged_routing_service_u_ptr_)
+        {
+            std::cerr << "NavigationManager::Create Failed to open paged road graph" << std::endl;
+            return nullptr;
+        }
 
-    const auto point_string = query.value(0).toString();
+        instance->road_overrides_s_ptr_ = RoadOverrides::Create();
 
-    QRegularExpression regex("POINT\\(([-\\d\\.]+) ([-\\d\\.]+)\\)");
-    QRegularExpressionMatch match = regex.match(point_string);
-    if (!match.hasMatch())
+        return instance;
+    }
+
+    instance->routing_data_s_ptr_ = LoadRoutingData(vertex_order);
+    if (!instance->routing_data_s_ptr_)
     {
-        std::cerr << "NavigationManager::FindNearestRoadPoint Failed to parse string for coordinates: " << point_string.toStdString() << std::endl;
-        return false;
+        std::cerr << "NavigationManager::Create Failed to load routing data" << std::endl;
+        return nullptr;
     }
 
-    nearest_road_point.x = match.captured(1).toDouble();
-    nearest_road_point.y = match.captured(2).toDouble();
+    instance->routing_service_u_ptr_ = RoutingService::Create(instance->routing_data_s_ptr_,
+                                                              std::max(1u, std::thread::hardware_concurrency()),
+                                                              kRoutingServiceQueueSize);
+    if (!instance->routing_service_u_ptr_)
+        return nullptr;
 
-    return true;
-}
+    instance->road_overrides_s_ptr_ = RoadOverrides::Create();
 
-struct Vertice;
-using VerticeSPtr = std::shared_ptr<Vertice>;
+    return instance;
+}
 
-struct Vertice
+void NavigationManager::SetRoutingProfile(const routing_profile::Type routing_profile_type)
 {
-    int64_t id;
-    VerticeSPtr previous_vertice = nullptr;
-    projection::Epsg3857PointUPtr epsg_3857_point_u_ptr;
-    double cost = std::numeric_limits<double>::max();
-};
+    routing_profile_type_ = routing_profile_type;
+}
 
-struct NeighbourVertice
+ArcWeights NavigationManager::Weights() const
 {
-    double distance;
-    VerticeSPtr vertice;
-};
+    return routing_data_s_ptr_->Weights(routing_profile_type_).WithOverrides(road_overrides_s_ptr_);
+}
 
-using NeighbourVerticeSPtr = std::shared_ptr<NeighbourVertice>;
+bool NavigationManager::FindNearestAccessibleVertex(const projection::Epsg3857Point& point, uint32_t& vertex) const
+{
+    return routing_data_s_ptr_->FindNearestAccessibleVertex(point, Weights(), vertex);
+}
 
-double EstimateDistance(VerticeSPtr start_vertice, VerticeSPtr end_vertice)
+bool NavigationManager::IsGraphLoaded(const char* method_name) const
 {
-    double dx = start_vertice->epsg_3857_point_u_ptr->x - end_vertice->epsg_3857_point_u_ptr->x;
-    double dy = start_vertice->epsg_3857_point_u_ptr->y - end_vertice->epsg_3857_point_u_ptr->y;
-    return std::sqrt(dx * dx + dy * dy);
+    if (routing_data_s_ptr_)
+        return true;
+
+    std::cerr << "NavigationManager::" << method_name << " Not available with paged road graph" << std::endl;
+    return false;
 }
 
-bool FindNearestVertice(const projection::Epsg3857Point& epsg_3857_point, VerticeSPtr vertice)
+bool NavigationManager::FindNearestRoadPoint(const QPointF& position, projection::Epsg3857Point& nearest_road_point)
 {
-    auto query = QSqlQuery();
-    query.prepare(R"(
-        SELECT
-            rvp.id,
-            st_x(rvp.the_geom) as vertice_x,
-            st_y(rvp.the_geom) as vertice_y,
-            ST_Distance(r.geom, ST_SetSRID(ST_MakePoint(:x, :y), 3857)) AS distance
-        FROM
-            roads r
-        join
-            roads_vertices_pgr rvp
-        on
-            rvp.id = r.source
-        ORDER BY
-            distance
-        LIMIT 1;
-    )");
-    query.bindValue(":x", epsg_3857_point.x);
-    query.bindValue(":y", epsg_3857_point.y);
-
-    if (!query.exec() || !query.next())
+    if (!IsGraphLoaded("FindNearestRoadPoint"))
+        return false;
+
+    auto road_projection = SpatialIndex::RoadProjection();
+    if (!routing_data_s_ptr_->Index().FindNearestRoadPoint(projection::Epsg3857Point(position.x(), position.y()), road_projection))
     {
-        std::cerr << "NavigationManager::FindNearestVertice SQL query execution error: " << query.lastError().text().toStdString() << std::endl;
+        std::cerr << "NavigationManager::FindNearestRoadPoint There are no roads in the graph" << std::endl;
         return false;
     }
 
-    vertice->id = query.value(0).toLongLong();
-
-    vertice->epsg_3857_point_u_ptr = std::make_unique<projection::Epsg3857Point>();
-    vertice->epsg_3857_point_u_ptr->x = query.value(1).toDouble();
-    vertice->epsg_3857_point_u_ptr->y = query.value(2).toDouble();
+    nearest_road_point = road_projection.point;
 
     return true;
 }
 
-bool GetNeighbourVertices(const VerticeSPtr vertice, std::stack<NeighbourVerticeSPtr>& neighbour_vertice_stack)
+uint64_t NavigationManager::FindPath(const projection::Epsg3857Point& start_epsg_3857_point, const projection::Epsg3857Point& end_epsg_3857_point)
 {
-    QSqlQuery query;
-    query.prepare(R"(
-        SELECT
-            w.target as neighbour_id,
-            st_x(wvp.the_geom) as neighbour_x,
-            st_y(wvp.the_geom) as neighbour_y,
-            w.length as distance_to_neighbour
-        FROM
-            roads w
-        JOIN
-            roads_vertices_pgr wvp
-        ON
-            wvp.id = w.target
-        WHERE
-            w.source = :node_id;
-    )");
-    query.bindValue(":node_id", QVariant::fromValue(vertice->id));
-
-    if (!query.exec())
-    {
-        std::cerr << "NavigationManager::GetNeighbourVertices SQL query execution error: " << query.lastError().text().toStdString() << std::endl;
-        return false;
-    }
+    const auto path_id = ++last_path_id_;
+    const auto routing_profile_type = routing_profile_type_;
 
-    NeighbourVerticeSPtr neighbour_vertice;
-    for (; query.next();)
-    {
-        neighbour_vertice = std::make_shared<NeighbourVertice>();
-        neighbour_vertice->vertice = std::make_shared<Vertice>();
+    const auto on_routed = [this, path_id, routing_profile_type](RoutingService::Route&& route) {
+        // Worker thread only posts the result, signal is emitted by event loop of the manager thread
+        QMetaObject::invokeMethod(this, [this, path_id, routing_profile_type, route = std::move(route)]() {
+            if (!route.is_found)
+                std::cerr << "NavigationManager::FindPath There is no path for profile " << routing_profile::TypeName(routing_profile_type) << std::endl;
 
-        neighbour_vertice->vertice->id = query.value(0).toLongLong();
+            emit PathFound(path_id, route.is_found, route.points);
+        }, Qt::QueuedConnection);
+    };
 
-        neighbour_vertice->vertice->epsg_3857_point_u_ptr = std::make_unique<projection::Epsg3857Point>();
-        neighbour_vertice->vertice->epsg_3857_point_u_ptr->x = query.value(1).toDouble();
-        neighbour_vertice->vertice->epsg_3857_point_u_ptr->y = query.value(2).toDouble();
-        neighbour_vertice->distance = query.value(3).toDouble();
+    const auto is_queued = paged_routing_service_u_ptr_
+        ? paged_routing_service_u_ptr_->TrySubmit(start_epsg_3857_point, end_epsg_3857_point, routing_profile_type, on_routed)
+        : routing_service_u_ptr_->TrySubmit(start_epsg_3857_point, end_epsg_3857_point, routing_profile_type, on_routed);
 
-        neighbour_vertice_stack.push(neighbour_vertice);
+    if (!is_queued)
+    {
+        std::cerr << "NavigationManager::FindPath Routing queue is full" << std::endl;
+        return 0;
     }
 
-    return true;
+    return path_id;
 }
 
-std::stack<VerticeSPtr> BuildPath(VerticeSPtr end_vertice)
+bool NavigationManager::FindAlternativeRoutes(const projection::Epsg3857Point& start_epsg_3857_point, const projection::Epsg3857Point& end_epsg_3857_point,
+                                              const size_t max_count, std::vector<std::vector<projection::Epsg3857Point>>& routes_points,
+                                              std::vector<double>& costs)
 {
-    auto path = std::stack<VerticeSPtr>();
+    const auto alternatives_span = trace::Span("Alternative routes");
+
+    routes_points.clear();
+    costs.clear();
+
+    if (!IsGraphLoaded("FindAlternativeRoutes"))
+        return false;
 
-    for (; end_vertice != nullptr; )
+    uint32_t start_vertex, end_vertex;
+    if (!FindNearestAccessibleVertex(start_epsg_3857_point, start_vertex) || !FindNearestAccessibleVertex(end_epsg_3857_point, end_vertex))
     {
-        path.push(end_vertice);
-        end_vertice = end_vertice->previous_vertice;
+        std::cerr << "NavigationManager::FindAlternativeRoutes Failed to snap points to road graph" << std::endl;
+        return false;
     }
 
-    return path;
-}
+    const auto& road_graph = routing_data_s_ptr_->Graph();
+    if (alternative_search_spaces_.empty())
+        alternative_search_spaces_.assign(3, SearchSpace(road_graph.VertexCount()));
+    if (!alternative_marks_u_ptr_)
+        alternative_marks_u_ptr_ = std::make_unique<alternatives::Marks>(road_graph.VertexCount(), road_graph.EdgeCount());
 
-VerticeSPtr PickBestVertice(std::unordered_map<int64_t, VerticeSPtr> reachable, VerticeSPtr end_vertice)
-{
-    auto min_cost = UINT_MAX;
-    VerticeSPtr best_vertice = nullptr;
+    const auto cost_per_distance = routing_profile::Dispatch(routing_profile_type_, [](const auto profile) {
+        return routing_profile::EstimateCost<decltype(profile)>(1);
+    });
 
-    for (const auto& vertice : reachable)
+    auto routes = std::vector<alternatives::Route>();
+    alternatives::Find(road_graph, Weights(), start_vertex, end_vertex,
+                       max_count, alternatives::Limits(), cost_per_distance,
+                       alternative_search_spaces_[0], alternative_search_spaces_[1], alternative_search_spaces_[2],
+                       *alternative_marks_u_ptr_, routes);
+
+    if (routes.empty())
     {
-        const auto cost_start_to_vertice = vertice.second->cost;
-        const auto cost_vertice_to_goal = EstimateDistance(vertice.second, end_vertice);
-        const auto total_cost = cost_start_to_vertice + cost_vertice_to_goal;
+        std::cerr << "NavigationManager::FindAlternativeRoutes There is no path for profile " << routing_profile::TypeName(routing_profile_type_) << std::endl;
+        return false;
+    }
 
-        if (total_cost < min_cost)
-        {
-            min_cost = total_cost;
-            best_vertice = vertice.second;
-        }
+    for (const auto& route : routes)
+    {
+        auto points = std::vector<projection::Epsg3857Point>();
+        points.push_back(start_epsg_3857_point);
+        points.push_back(road_graph.VertexPoint(start_vertex));
+        road_graph.PathShape(route.arcs, points);
+        points.push_back(end_epsg_3857_point);
+
+        routes_points.push_back(std::move(points));
+        costs.push_back(route.cost);
     }
 
-    return best_vertice;
+    return true;
 }
 
-std::stack<VerticeSPtr> FindPath(VerticeSPtr start_vertice, VerticeSPtr end_vertice)
+bool NavigationManager::FindDistanceMatrix(const std::vector<projection::Epsg3857Point>& sources, const std::vector<projection::Epsg3857Point>& targets,
+                                           const unsigned int thread_count, std::vector<double>& costs)
 {
-    auto reachable_u_map = std::unordered_map<int64_t, VerticeSPtr>();
-    reachable_u_map[start_vertice->id] = start_vertice;
+    const auto matrix_span = trace::Span("Distance matrix");
 
-    auto explored_u_map = std::unordered_map<int64_t, VerticeSPtr>();
+    if (!IsGraphLoaded("FindDistanceMatrix"))
+        return false;
 
-    VerticeSPtr vertice = nullptr;
-    NeighbourVerticeSPtr neighbour;
-    double from_start_node_to_neighbour_cost;
-    std::stack<NeighbourVerticeSPtr> neighbour_vertice_stack;
-    for (; !reachable_u_map.empty(); )
+    auto source_vertices = std::vector<uint32_t>(sources.size());
+    for (size_t i = 0; i < sources.size(); i++)
     {
-        vertice = PickBestVertice(reachable_u_map, end_vertice);
-        if (!vertice)
-            return std::stack<VerticeSPtr>();
+        if (!FindNearestAccessibleVertex(sources[i], source_vertices[i]))
+        {
+            std::cerr << "NavigationManager::FindDistanceMatrix Failed to snap sources to road graph" << std::endl;
+            return false;
+        }
+    }
 
-        if (vertice->id == end_vertice->id)
-            return BuildPath(vertice);
+    auto target_vertices = std::vector<uint32_t>(targets.size());
+    for (size_t i = 0; i < targets.size(); i++)
+    {
+        if (!FindNearestAccessibleVertex(targets[i], target_vertices[i]))
+        {
+            std::cerr << "NavigationManager::FindDistanceMatrix Failed to snap targets to road graph" << std::endl;
+            return false;
+        }
+    }
 
-        reachable_u_map.erase(vertice->id);
-        explored_u_map[vertice->id] = vertice;
+    distance_matrix::Compute(routing_data_s_ptr_->Graph(), Weights(),
+                             source_vertices, target_vertices, thread_count, costs);
 
-        neighbour_vertice_stack = std::stack<NeighbourVerticeSPtr>();
-        if (!GetNeighbourVertices(vertice, neighbour_vertice_stack))
-            return std::stack<VerticeSPtr>();
+    return true;
+}
 
-        // Fill reachable with new neighbors and compute their cost
-        for (; !neighbour_vertice_stack.empty();)
-        {
-            neighbour = neighbour_vertice_stack.top();
-            neighbour_vertice_stack.pop();
+bool NavigationManager::OptimizeStopOrder(const std::vector<projection::Epsg3857Point>& stops, const bool is_last_fixed, const double time_budget,
+                                          std::vector<size_t>& order)
+{
+    auto costs = std::vector<double>();
+    if (!FindDistanceMatrix(stops, stops, std::max(1u, std::thread::hardware_concurrency()), costs))
+        return false;
 
-            if (explored_u_map.find(neighbour->vertice->id) != explored_u_map.end()
-                || reachable_u_map.find(neighbour->vertice->id) != reachable_u_map.end())
-                continue;
+    const auto optimize_span = trace::Span("Stop order");
+    stop_order::Optimize(costs, stops.size(), is_last_fixed, time_budget, order);
 
-            reachable_u_map[neighbour->vertice->id] = neighbour->vertice;
+    return true;
+}
 
-            from_start_node_to_neighbour_cost = vertice->cost + neighbour->distance;
-            if (from_start_node_to_neighbour_cost < neighbour->vertice->cost)
-            {
-                neighbour->vertice->cost = from_start_node_to_neighbour_cost;
-                neighbour->vertice->previous_vertice = vertice;
-            }
-        }
+IsochroneUPtr NavigationManager::CreateIsochrone(const projection::Epsg3857Point& origin, const double max_cost)
+{
+    const auto isochrone_span = trace::Span("Isochrone");
+
+    if (!IsGraphLoaded("CreateIsochrone"))
+        return nullptr;
+
+    uint32_t origin_vertex;
+    if (!FindNearestAccessibleVertex(origin, origin_vertex))
+    {
+        std::cerr << "NavigationManager::CreateIsochrone Failed to snap origin to road graph" << std::endl;
+        return nullptr;
     }
 
-    return std::stack<VerticeSPtr>();
+    return Isochrone::Create(routing_data_s_ptr_->Graph(), Weights(), origin_vertex, max_cost);
 }
 
-std::stack<projection::Epsg3857PointUPtr> NavigationManager::FindPath(projection::Epsg3857PointUPtr& start_epsg_3857_point_u_ptr, projection::Epsg3857PointUPtr& end_epsg_3857_point_u_ptr)
+RouteEditorUPtr NavigationManager::CreateRouteEditor() const
 {
-    auto start_road_vertice = std::make_shared<Vertice>();
-    start_road_vertice->cost = 0;
-    FindNearestVertice(*start_epsg_3857_point_u_ptr, start_road_vertice);
+    if (!IsGraphLoaded("CreateRouteEditor"))
+        return nullptr;
 
-    auto end_road_vertice = std::make_shared<Vertice>();
-    FindNearestVertice(*end_epsg_3857_point_u_ptr, end_road_vertice);
+    return RouteEditor::Create(routing_data_s_ptr_, routing_profile_type_, routing_service_u_ptr_.get(), road_overrides_s_ptr_);
+}
+
+bool NavigationManager::FindNearestRoad(const projection::Epsg3857Point& point, const double max_distance, uint32_t& edge) const
+{
+    if (!IsGraphLoaded("FindNearestRoad"))
+        return false;
 
-    auto road_vertice_stack = ::FindPath(start_road_vertice, end_road_vertice);
+    auto road_projection = SpatialIndex::RoadProjection();
+    if (!routing_data_s_ptr_->Index().FindNearestRoadPoint(point, road_projection) || road_projection.distance > max_distance)
+        return false;
 
-    auto full_road_vertice_stack = std::stack<projection::Epsg3857PointUPtr>();
-    full_road_vertice_stack.push(std::move(start_epsg_3857_point_u_ptr));
-    VerticeSPtr vertice;
-    for (; !road_vertice_stack.empty();)
-    {
-        vertice = road_vertice_stack.top();
-        road_vertice_stack.pop();
+    edge = road_projection.edge;
 
-        full_road_vertice_stack.push(std::move(vertice->epsg_3857_point_u_ptr));
+    return true;
+}
+
+bool NavigationManager::SetRoadFactor(const uint32_t edge, const float factor)
+{
+    // Paged FindPath takes costs from database rows and would not see overrides
+    if (IsPaged())
+    {
+        std::cerr << "NavigationManager::SetRoadFactor Road overrides are ignored by paged road graph" << std::endl;
+        return false;
     }
-    full_road_vertice_stack.push(std::move(end_epsg_3857_point_u_ptr));
 
-    return full_road_vertice_stack;
+    auto road_overrides_s_ptr = road_overrides_s_ptr_->WithEdgeFactor(routing_data_s_ptr_->Graph(), { edge }, factor);
+    if (!road_overrides_s_ptr)
+        return false;
+
+    road_overrides_s_ptr_ = std::move(road_overrides_s_ptr);
+    routing_service_u_ptr_->SetRoadOverrides(road_overrides_s_ptr_);
+
+    return true;
+}
+
+void NavigationManager::ClearRoadOverrides()
+{
+    road_overrides_s_ptr_ = RoadOverrides::Create();
+    if (routing_service_u_ptr_)
+        routing_service_u_ptr_->SetRoadOverrides(road_overrides_s_ptr_);
 }
@@ -1,28 +1,107 @@
 #ifndef NAVIGATIONMANAGER_H
 #define NAVIGATIONMANAGER_H
 
-#include <stack>
-
+#include <QObject>
 #include <QPoint>
-#include <QSqlDatabase>
 
 #include "Projection.h"
+#include "Isochrone.h"
+#include "RoutingProfile.h"
+#include "RoutingData.h"
+#include "RoutingService.h"
+#include "PagedRoutingService.h"
+#include "RouteEditor.h"
+#include "SearchSpace.h"
+#include "Alternatives.h"
 
 class NavigationManager;
 typedef std::unique_ptr<NavigationManager> NavigationManagerUPtr;
 
-class NavigationManager
+class NavigationManager : public QObject
 {
+    Q_OBJECT
+
 public:
-    static NavigationManagerUPtr Create();
+    /* Vertex order other than Hilbert is only meant for measuring its effect.
+    When OPENROUTE_PAGED_GRAPH gives a cell cache budget in megabytes, graph
+    is not loaded but paged from database, then only FindPath works and the
+    other queries fail as if nothing was found */
+    static NavigationManagerUPtr Create(const RoadGraph::VertexOrder vertex_order = RoadGraph::VertexOrder::Hilbert);
+
+    bool IsPaged() const { return paged_routing_service_u_ptr_ != nullptr; }
+
+    //! Profile used by all following queries, costs are travel times in seconds
+    void SetRoutingProfile(const routing_profile::Type routing_profile_type);
+    routing_profile::Type RoutingProfile() const { return routing_profile_type_; }
+
+    //! Graph shared with routing threads, may be used from any thread. Null when graph is paged
+    RoutingDataSPtr SharedRoutingData() const { return routing_data_s_ptr_; }
+    //! Service for concurrent route queries, may be used from any thread. Must not be used when graph is paged
+    RoutingService& Routing() { return *routing_service_u_ptr_; }
 
     bool FindNearestRoadPoint(const QPointF& position, projection::Epsg3857Point& nearest_road_point);
-    std::stack<projection::Epsg3857PointUPtr> FindPath(projection::Epsg3857PointUPtr& start_epsg_3857_point, projection::Epsg3857PointUPtr& end_epsg_3857_point_u_ptr);
+    /* Queues route query on routing threads without waiting for it and returns
+    its id, PathFound is emitted with this id later. Returns 0 if queue is full */
+    uint64_t FindPath(const projection::Epsg3857Point& start_epsg_3857_point, const projection::Epsg3857Point& end_epsg_3857_point);
+
+    /* Writes the shortest route followed by up to max_count - 1 meaningfully different
+    alternatives, each one as path points with its cost. Returns false if there is no path */
+    bool FindAlternativeRoutes(const projection::Epsg3857Point& start_epsg_3857_point, const projection::Epsg3857Point& end_epsg_3857_point,
+                               const size_t max_count, std::vector<std::vector<projection::Epsg3857Point>>& routes_points,
+                               std::vector<double>& costs);
+
+    /* Computes N x M table of path costs between points snapped to nearest routable vertices,
+    costs[i * targets.size() + j] is cost from sources[i] to targets[j], infinity if unreachable */
+    bool FindDistanceMatrix(const std::vector<projection::Epsg3857Point>& sources, const std::vector<projection::Epsg3857Point>& targets,
+                            const unsigned int thread_count, std::vector<double>& costs);
+
+    /* Orders stops by travel time of current profile within time_budget milliseconds.
+    First stop stays first, is_last_fixed keeps the last one last */
+    bool OptimizeStopOrder(const std::vector<projection::Epsg3857Point>& stops, const bool is_last_fixed, const double time_budget,
+                           std::vector<size_t>& order);
+
+    //! Creates editor of route through draggable waypoints using current profile and road overrides
+    RouteEditorUPtr CreateRouteEditor() const;
+
+    //! Finds road edge passing within max_distance of point
+    bool FindNearestRoad(const projection::Epsg3857Point& point, const double max_distance, uint32_t& edge) const;
+    /* Multiplies cost of edge for every profile by factor, RoadOverrides::kClosed
+    closes it and 1 restores it. Only overridden edges are copied, graph and
+    weights stay as they are. Queries started afterwards see the change */
+    bool SetRoadFactor(const uint32_t edge, const float factor);
+    void ClearRoadOverrides();
+    RoadOverridesSPtr CurrentRoadOverrides() const { return road_overrides_s_ptr_; }
+
+    //! Computes area reachable from the nearest routable vertex within max_cost, in case of error returns nullptr
+    IsochroneUPtr CreateIsochrone(const projection::Epsg3857Point& origin, const double max_cost);
+
+signals:
+    //! Path points from start to end following road geometry, emitted in the thread owning the manager
+    void PathFound(const uint64_t path_id, const bool is_found, const std::vector<projection::Epsg3857Point>& path_points);
 
 private:
-    QSqlDatabase database_;
+    RoutingDataSPtr routing_data_s_ptr_;
+    RoutingServiceUPtr routing_service_u_ptr_;
+    //! Replaces both above when graph is paged
+    PagedRoutingServiceUPtr paged_routing_service_u_ptr_;
+
+    routing_profile::Type routing_profile_type_ = routing_profile::Type::Car;
+    RoadOverridesSPtr road_overrides_s_ptr_;
+
+    uint64_t last_path_id_ = 0;
+
+    //! Forward, backward and local search spaces of alternative routes, allocated on first use
+    std::vector<SearchSpace> alternative_search_spaces_;
+    std::unique_ptr<alternatives::Marks> alternative_marks_u_ptr_;
 
     NavigationManager();
+
+    //! Logs that method needs loaded graph if it is paged
+    bool IsGraphLoaded(const char* method_name) const;
+    //! Weights of current profile with road overrides
+    ArcWeights Weights() const;
+    //! Finds nearest vertex usable by current profile
+    bool FindNearestAccessibleVertex(const projection::Epsg3857Point& point, uint32_t& vertex) const;
 };
 
 #endif // NAVIGATIONMANAGER_H
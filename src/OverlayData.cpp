@@ -0,0 +1,218 @@
+#include "OverlayData.h"
+
+#include <iostream>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include <unordered_map>
+
+#include <QDir>
+#include <QString>
+
+#include "OverlayReader.h"
+#include "LineSimplification.h"
+
+constexpr double kOverlayTilePixelSize { 256 };
+
+//! Side of clustering grid cell in pixels, about the size of a cluster symbol
+constexpr double kClusterCellPixels { 48 };
+//! Deviation of simplified line allowed at each zoom, in pixels
+constexpr double kLineTolerancePixels { 0.5 };
+//! Points of one line chunk, neighbouring chunks share one point
+constexpr size_t kLineChunkPointCount { 64 };
+
+OverlayData::OverlayData()
+    : point_levels_(kMaxZoom + 1), line_levels_(kMaxZoom + 1)
+{
+
+}
+
+OverlayDataUPtr OverlayData::Create(const std::vector<std::string>& paths)
+{
+    std::unique_ptr<OverlayData> instance(new OverlayData());
+
+    auto features = overlay_reader::Features();
+    for (const auto& path : paths)
+    {
+        if (!overlay_reader::Read(path, features))
+        {
+            std::cerr << "OverlayData::Create Failed to read " << path << std::endl;
+            return nullptr;
+        }
+    }
+
+    instance->point_count_ = features.points.size();
+    instance->line_count_ = features.lines.Count();
+    instance->point_names_ = std::move(features.point_names);
+
+    instance->ClusterPoints(features.points);
+    instance->SimplifyLines(features.lines);
+
+    return instance;
+}
+
+OverlayDataUPtr OverlayData::CreateFromEnvironment()
+{
+    const auto overlay_paths = std::getenv("OPENROUTE_OVERLAY");
+    if (!overlay_paths || !*overlay_paths)
+        return Create({});
+
+    auto paths = std::vector<std::string>();
+    for (const auto& path : QString(overlay_paths).split(QDir::listSeparator(), Qt::SkipEmptyParts))
+        paths.push_back(path.toStdString());
+
+    return Create(paths);
+}
+
+unsigned int OverlayData::LevelZoom(const unsigned int zoom)
+{
+    return std::min(zoom, kMaxZoom);
+}
+
+double OverlayData::PixelLength(const unsigned int zoom)
+{
+    return projection::TileLength(zoom) / kOverlayTilePixelSize;
+}
+
+/* The finest level holds every point as its own cluster. Coarser levels merge
+clusters of the previous one falling into the same grid cell, the merged
+cluster is placed at the weighted centre of its members */
+void OverlayData::ClusterPoints(const std::vector<projection::Epsg3857Point>& points)
+{
+    auto& finest_level = point_levels_[kMaxZoom];
+    finest_level.points = points;
+    finest_level.sizes.assign(points.size(), 1);
+    finest_level.first_points.resize(points.size());
+    for (uint32_t point = 0; point < points.size(); point++)
+        finest_level.first_points[point] = point;
+
+    auto cell_clusters_u_map = std::unordered_map<uint64_t, uint32_t>();
+    auto sums = std::vector<projection::Epsg3857Point>();
+    for (auto zoom = kMaxZoom; zoom-- > 0;)
+    {
+        const auto& finer_level = point_levels_[zoom + 1];
+        auto& level = point_levels_[zoom];
+
+        const auto cell_length = kClusterCellPixels * PixelLength(zoom);
+
+        cell_clusters_u_map.clear();
+        sums.clear();
+        for (size_t finer_cluster = 0; finer_cluster < finer_level.points.size(); finer_cluster++)
+        {
+            const auto& point = finer_level.points[finer_cluster];
+            const auto size = finer_level.sizes[finer_cluster];
+
+            const auto cell_x = static_cast<uint64_t>(std::max(0.0, std::floor((point.x + projection::kEpsg3857Bound) / cell_length)));
+            const auto cell_y = static_cast<uint64_t>(std::max(0.0, std::floor((point.y + projection::kEpsg3857Bound) / cell_length)));
+
+            const auto [it, is_inserted] = cell_clusters_u_map.emplace((cell_x << 32) | cell_y, static_cast<uint32_t>(level.sizes.size()));
+            if (is_inserted)
+            {
+                level.sizes.push_back(0);
+                level.first_points.push_back(finer_level.first_points[finer_cluster]);
+                sums.emplace_back(0, 0);
+            }
+
+            level.sizes[it->second] += size;
+            sums[it->second].x += point.x * size;
+            sums[it->second].y += point.y * size;
+        }
+
+        level.points.resize(sums.size());
+        for (size_t cluster = 0; cluster < sums.size(); cluster++)
+            level.points[cluster] = projection::Epsg3857Point(sums[cluster].x / level.sizes[cluster], sums[cluster].y / level.sizes[cluster]);
+    }
+
+    auto boxes = std::vector<PackedRTree::Box>();
+    for (auto& level : point_levels_)
+    {
+        boxes.clear();
+        boxes.reserve(level.points.size());
+        for (const auto& point : level.points)
+            boxes.emplace_back(point.x, point.y, point.x, point.y);
+
+        level.r_tree.Build(boxes);
+    }
+}
+
+/* Each line is simplified from the finest zoom down, every level starting from
+the result of the finer one, so total work shrinks with the point count */
+void OverlayData::SimplifyLines(const PolylineStore& lines)
+{
+    auto points = std::vector<projection::Epsg3857Point>();
+    auto simplified_points = std::vector<projection::Epsg3857Point>();
+    auto chunk_points = std::vector<projection::Epsg3857Point>();
+
+    for (uint32_t line = 0; line < lines.Count(); line++)
+    {
+        points.clear();
+        lines.Decode(line, false, points);
+
+        for (auto zoom = kMaxZoom + 1; zoom-- > 0;)
+        {
+            simplified_points.clear();
+            line_simplification::Simplify(points, kLineTolerancePixels * PixelLength(zoom), simplified_points);
+            std::swap(points, simplified_points);
+
+            auto& level = line_levels_[zoom];
+            for (size_t first = 0; first + 1 < points.size(); first += kLineChunkPointCount - 1)
+            {
+                const auto last = std::min(first + kLineChunkPointCount, points.size());
+                chunk_points.assign(points.begin() + first, points.begin() + last);
+
+                auto box = PackedRTree::Box();
+                for (const auto& point : chunk_points)
+                    box.Extend(PackedRTree::Box(point.x, point.y, point.x, point.y));
+
+                level.chunks.Add(chunk_points);
+                level.chunk_boxes.push_back(box);
+            }
+        }
+    }
+
+    for (auto& level : line_levels_)
+    {
+        level.chunks.ShrinkToFit();
+        level.chunk_boxes.shrink_to_fit();
+        level.r_tree.Build(level.chunk_boxes);
+    }
+}
+
+void OverlayData::FindClusters(const unsigned int zoom, const PackedRTree::Box& box, std::vector<uint32_t>& clusters) const
+{
+    clusters.clear();
+    point_levels_[LevelZoom(zoom)].r_tree.Search(box, [&clusters](const uint32_t cluster) {
+        clusters.push_back(cluster);
+    });
+}
+
+const projection::Epsg3857Point& OverlayData::ClusterPoint(const unsigned int zoom, const uint32_t cluster) const
+{
+    return point_levels_[LevelZoom(zoom)].points[cluster];
+}
+
+uint32_t OverlayData::ClusterSize(const unsigned int zoom, const uint32_t cluster) const
+{
+    return point_levels_[LevelZoom(zoom)].sizes[cluster];
+}
+
+const std::string& OverlayData::ClusterName(const unsigned int zoom, const uint32_t cluster) const
+{
+    static const auto kNoName = std::string();
+
+    const auto& level = point_levels_[LevelZoom(zoom)];
+    return level.sizes[cluster] == 1 ? point_names_[level.first_points[cluster]] : kNoName;
+}
+
+void OverlayData::FindLineChunks(const unsigned int zoom, const PackedRTree::Box& box, std::vector<uint32_t>& chunks) const
+{
+    chunks.clear();
+    line_levels_[LevelZoom(zoom)].r_tree.Search(box, [&chunks](const uint32_t chunk) {
+        chunks.push_back(chunk);
+    });
+}
+
+void OverlayData::LineChunk(const unsigned int zoom, const uint32_t chunk, std::vector<projection::Epsg3857Point>& points) const
+{
+    line_levels_[LevelZoom(zoom)].chunks.Decode(chunk, false, points);
+}
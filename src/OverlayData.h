@@ -0,0 +1,81 @@
+#ifndef OVERLAYDATA_H
+#define OVERLAYDATA_H
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "PackedRTree.h"
+#include "PolylineStore.h"
+#include "Projection.h"
+
+class OverlayData;
+using OverlayDataUPtr = std::unique_ptr<OverlayData>;
+
+/* User datasets shown over the map, prepared for each zoom once on load.
+Points are clustered on a pixel grid, every zoom merges clusters of the next
+finer one. Lines are simplified to the pixel size of zoom and cut into short
+chunks, so a view far inside a long track decodes only a few of them. Each
+zoom level has its own packed R-tree, drawing cost depends on what is visible
+rather than on dataset size */
+class OverlayData
+{
+public:
+    //! Finest prepared zoom, deeper zooms use it as is
+    static constexpr unsigned int kMaxZoom = 18;
+
+    //! Reads GeoJSON and GPX files, fails if any of them can not be read
+    static OverlayDataUPtr Create(const std::vector<std::string>& paths);
+    //! Files from OPENROUTE_OVERLAY separated as in PATH, empty overlay if it is not set
+    static OverlayDataUPtr CreateFromEnvironment();
+
+    bool IsEmpty() const { return point_count_ == 0 && line_count_ == 0; }
+
+    //! Calls return indices valid for the same zoom only
+    void FindClusters(const unsigned int zoom, const PackedRTree::Box& box, std::vector<uint32_t>& clusters) const;
+    const projection::Epsg3857Point& ClusterPoint(const unsigned int zoom, const uint32_t cluster) const;
+    //! Count of points merged into cluster
+    uint32_t ClusterSize(const unsigned int zoom, const uint32_t cluster) const;
+    //! Name of the point if cluster has only one, otherwise empty
+    const std::string& ClusterName(const unsigned int zoom, const uint32_t cluster) const;
+
+    void FindLineChunks(const unsigned int zoom, const PackedRTree::Box& box, std::vector<uint32_t>& chunks) const;
+    //! Appends points of simplified chunk, neighbouring chunks of a line share end points
+    void LineChunk(const unsigned int zoom, const uint32_t chunk, std::vector<projection::Epsg3857Point>& points) const;
+
+private:
+    struct PointLevel
+    {
+        std::vector<projection::Epsg3857Point> points;
+        std::vector<uint32_t> sizes;
+        //! Any point of cluster, its name is shown for clusters of one point
+        std::vector<uint32_t> first_points;
+        PackedRTree r_tree;
+    };
+
+    struct LineLevel
+    {
+        PolylineStore chunks;
+        std::vector<PackedRTree::Box> chunk_boxes;
+        PackedRTree r_tree;
+    };
+
+    size_t point_count_ = 0;
+    size_t line_count_ = 0;
+    std::vector<std::string> point_names_;
+
+    //! Level of zoom z is at index z
+    std::vector<PointLevel> point_levels_;
+    std::vector<LineLevel> line_levels_;
+
+    OverlayData();
+
+    static unsigned int LevelZoom(const unsigned int zoom);
+    //! Length of one pixel of zoom in EPSG:3857 units
+    static double PixelLength(const unsigned int zoom);
+
+    void ClusterPoints(const std::vector<projection::Epsg3857Point>& points);
+    void SimplifyLines(const PolylineStore& lines);
+};
+
+#endif // OVERLAYDATA_H
@@ -0,0 +1,100 @@
+#include "OverlayItem.h"
+
+#include <cmath>
+
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+
+//! Symbols around visible area which may reach into it, in pixels
+constexpr double kOverlayPaintMargin { 64 };
+
+constexpr double kOverlayPointRadius { 5 };
+constexpr double kOverlayClusterMinRadius { 9 };
+constexpr double kOverlayClusterMaxRadius { 22 };
+
+//! From this zoom names of single points are drawn next to them
+constexpr unsigned int kOverlayNameMinZoom { 15 };
+
+const QColor kOverlayColor { 200, 40, 120 };
+
+OverlayItem::OverlayItem(const OverlayData& overlay_data, const unsigned int zoom, const double pixel_epsg_3857_length)
+    : overlay_data_(overlay_data), zoom_(zoom), pixel_epsg_3857_length_(pixel_epsg_3857_length),
+    scene_length_(2 * projection::kEpsg3857Bound / pixel_epsg_3857_length)
+{
+    // Needed for exposedRect, otherwise every paint would cover the whole scene
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+    setAcceptedMouseButtons(Qt::NoButton);
+}
+
+QRectF OverlayItem::boundingRect() const
+{
+    return QRectF(0, 0, scene_length_, scene_length_);
+}
+
+QPointF OverlayItem::ToScenePoint(const projection::Epsg3857Point& point) const
+{
+    return QPointF((point.x + projection::kEpsg3857Bound) / pixel_epsg_3857_length_,
+                   (projection::kEpsg3857Bound - point.y) / pixel_epsg_3857_length_);
+}
+
+void OverlayItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget*)
+{
+    const auto exposed_rect = option->exposedRect.adjusted(-kOverlayPaintMargin, -kOverlayPaintMargin,
+                                                           kOverlayPaintMargin, kOverlayPaintMargin);
+
+    // Scene y grows to the south, EPSG:3857 y to the north
+    const auto box = PackedRTree::Box(
+        exposed_rect.left() * pixel_epsg_3857_length_ - projection::kEpsg3857Bound,
+        projection::kEpsg3857Bound - exposed_rect.bottom() * pixel_epsg_3857_length_,
+        exposed_rect.right() * pixel_epsg_3857_length_ - projection::kEpsg3857Bound,
+        projection::kEpsg3857Bound - exposed_rect.top() * pixel_epsg_3857_length_);
+
+    painter->setRenderHint(QPainter::Antialiasing);
+
+    painter->setPen(QPen(kOverlayColor, 3, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin));
+    painter->setBrush(Qt::NoBrush);
+
+    overlay_data_.FindLineChunks(zoom_, box, found_items_);
+    for (const auto chunk : found_items_)
+    {
+        points_.clear();
+        overlay_data_.LineChunk(zoom_, chunk, points_);
+
+        polygon_.clear();
+        for (const auto& point : points_)
+            polygon_.append(ToScenePoint(point));
+
+        painter->drawPolyline(polygon_);
+    }
+
+    painter->setPen(QPen(Qt::white, 2));
+    painter->setBrush(kOverlayColor);
+
+    overlay_data_.FindClusters(zoom_, box, found_items_);
+    for (const auto cluster : found_items_)
+    {
+        const auto center = ToScenePoint(overlay_data_.ClusterPoint(zoom_, cluster));
+        const auto size = overlay_data_.ClusterSize(zoom_, cluster);
+
+        if (size == 1)
+        {
+            painter->drawEllipse(center, kOverlayPointRadius, kOverlayPointRadius);
+
+            const auto& name = overlay_data_.ClusterName(zoom_, cluster);
+            if (zoom_ >= kOverlayNameMinZoom && !name.empty())
+            {
+                painter->setPen(kOverlayColor);
+                painter->drawText(center + QPointF(kOverlayPointRadius + 3, kOverlayPointRadius), QString::fromStdString(name));
+                painter->setPen(QPen(Qt::white, 2));
+            }
+
+            continue;
+        }
+
+        // Radius grows with digits of the count
+        const auto radius = std::min(kOverlayClusterMinRadius + 3 * std::log10(static_cast<double>(size)), kOverlayClusterMaxRadius);
+        painter->drawEllipse(center, radius, radius);
+        painter->drawText(QRectF(center.x() - radius, center.y() - radius, 2 * radius, 2 * radius),
+                          Qt::AlignCenter, QString::number(size));
+    }
+}
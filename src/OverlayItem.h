@@ -0,0 +1,37 @@
+#ifndef OVERLAYITEM_H
+#define OVERLAYITEM_H
+
+#include <vector>
+
+#include <QGraphicsItem>
+#include <QPolygonF>
+
+#include "OverlayData.h"
+
+/* Single scene item drawing overlay data of one zoom. Items are not created
+per feature: paint queries only the exposed part of the scene, so panning
+over a large dataset costs as much as the features in view */
+class OverlayItem : public QGraphicsItem
+{
+public:
+    OverlayItem(const OverlayData& overlay_data, const unsigned int zoom, const double pixel_epsg_3857_length);
+
+    QRectF boundingRect() const override;
+    void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget) override;
+
+private:
+    const OverlayData& overlay_data_;
+    unsigned int zoom_;
+    double pixel_epsg_3857_length_;
+    //! Width and height of scene at zoom in pixels
+    double scene_length_;
+
+    //! Reused between paints to avoid allocations while panning
+    std::vector<uint32_t> found_items_;
+    std::vector<projection::Epsg3857Point> points_;
+    QPolygonF polygon_;
+
+    QPointF ToScenePoint(const projection::Epsg3857Point& point) const;
+};
+
+#endif // OVERLAYITEM_H
@@ -0,0 +1,334 @@
+#include "OverlayReader.h"
+
+#include <iostream>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <cctype>
+
+#include <QFile>
+#include <QXmlStreamReader>
+
+#include "rapidjson/reader.h"
+#include "rapidjson/filereadstream.h"
+
+//! Read buffer of GeoJSON parser
+constexpr size_t kGeoJsonBufferSize { 1 << 16 };
+
+/* Collects positions of "coordinates" arrays and interprets them by "type"
+of the same object when it ends, as members of GeoJSON object may come in any
+order. Innermost arrays of numbers are positions, arrays holding positions
+are parts: lines, rings or the list of MultiPoint */
+class GeoJsonHandler : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, GeoJsonHandler>
+{
+public:
+    explicit GeoJsonHandler(overlay_reader::Features& features)
+        : features_(features)
+    {
+
+    }
+
+    bool Default() { return true; }
+
+    bool Int(const int value) { return Number(value); }
+    bool Uint(const unsigned int value) { return Number(value); }
+    bool Int64(const int64_t value) { return Number(static_cast<double>(value)); }
+    bool Uint64(const uint64_t value) { return Number(static_cast<double>(value)); }
+    bool Double(const double value) { return Number(value); }
+
+    bool String(const char* value, const rapidjson::SizeType length, const bool)
+    {
+        if (frames_.empty() || frames_.back().is_array)
+            return true;
+
+        auto& frame = frames_.back();
+        if (key_ == "type")
+            frame.type.assign(value, length);
+        else if (key_ == "name" && frame.is_properties && frames_.size() > 1)
+            frames_[frames_.size() - 2].name.assign(value, length);
+
+        return true;
+    }
+
+    bool Key(const char* value, const rapidjson::SizeType length, const bool)
+    {
+        key_.assign(value, length);
+        return true;
+    }
+
+    bool StartObject()
+    {
+        auto frame = Frame();
+        frame.is_properties = !frames_.empty() && !frames_.back().is_array && key_ == "properties";
+        frame.first_point = features_.points.size();
+        frames_.push_back(std::move(frame));
+
+        return true;
+    }
+
+    bool EndObject(const rapidjson::SizeType)
+    {
+        auto& frame = frames_.back();
+        if (frame.has_coordinates)
+            AddGeometry(frame.type);
+
+        // Name comes from properties of feature, which may follow its geometry
+        if (frame.type == "Feature" && !frame.name.empty())
+        {
+            for (auto point = frame.first_point; point < features_.points.size(); point++)
+                features_.point_names[point] = frame.name;
+        }
+
+        frames_.pop_back();
+        return true;
+    }
+
+    bool StartArray()
+    {
+        if (coordinates_depth_ == 0 && !frames_.empty() && !frames_.back().is_array && key_ == "coordinates")
+        {
+            frames_.back().has_coordinates = true;
+            positions_.clear();
+            part_ends_.clear();
+            coordinates_depth_ = frames_.size() + 1;
+        }
+
+        auto frame = Frame();
+        frame.is_array = true;
+        frames_.push_back(std::move(frame));
+
+        return true;
+    }
+
+    bool EndArray(const rapidjson::SizeType)
+    {
+        const auto has_positions = frames_.back().has_positions;
+        frames_.pop_back();
+
+        if (coordinates_depth_ == 0)
+            return true;
+
+        if (!numbers_.empty())
+        {
+            // Altitude and other extra values are ignored
+            if (numbers_.size() >= 2)
+            {
+                positions_.emplace_back(numbers_[0], numbers_[1]);
+                frames_.back().has_positions = true;
+            }
+
+            numbers_.clear();
+        }
+        else if (has_positions)
+        {
+            part_ends_.push_back(positions_.size());
+        }
+
+        if (frames_.size() + 1 == coordinates_depth_)
+            coordinates_depth_ = 0;
+
+        return true;
+    }
+
+private:
+    struct Frame
+    {
+        bool is_array = false;
+        bool is_properties = false;
+        bool has_coordinates = false;
+        bool has_positions = false;
+        std::string type;
+        //! Name from properties, set on feature object
+        std::string name;
+        //! Points added before the object started
+        size_t first_point = 0;
+    };
+
+    overlay_reader::Features& features_;
+
+    std::vector<Frame> frames_;
+    std::string key_;
+
+    //! Frame count inside coordinates array, zero outside of it
+    size_t coordinates_depth_ = 0;
+    std::vector<double> numbers_;
+    std::vector<projection::Epsg4326Point> positions_;
+    std::vector<size_t> part_ends_;
+
+    bool Number(const double value)
+    {
+        if (coordinates_depth_ > 0)
+            numbers_.push_back(value);
+
+        return true;
+    }
+
+    void AddGeometry(const std::string& type)
+    {
+        auto points = std::vector<projection::Epsg3857Point>();
+        if (!projection::ToEpsg3857(positions_, points))
+            return;
+
+        if (type == "Point" || type == "MultiPoint")
+        {
+            features_.points.insert(features_.points.end(), points.begin(), points.end());
+            features_.point_names.resize(features_.points.size());
+            return;
+        }
+
+        if (type != "LineString" && type != "MultiLineString" && type != "Polygon" && type != "MultiPolygon")
+            return;
+
+        auto line = std::vector<projection::Epsg3857Point>();
+        auto part_begin = size_t(0);
+        for (const auto part_end : part_ends_)
+        {
+            if (part_end - part_begin >= 2)
+            {
+                line.assign(points.begin() + part_begin, points.begin() + part_end);
+                features_.lines.Add(line);
+            }
+
+            part_begin = part_end;
+        }
+    }
+};
+
+namespace overlay_reader {
+
+bool ReadGeoJson(const std::string& path, Features& features)
+{
+    const auto file = std::unique_ptr<FILE, decltype(&std::fclose)>(std::fopen(path.c_str(), "rb"), &std::fclose);
+    if (!file)
+    {
+        std::cerr << "OverlayReader::ReadGeoJson Failed to open " << path << std::endl;
+        return false;
+    }
+
+    auto buffer = std::vector<char>(kGeoJsonBufferSize);
+    auto stream = rapidjson::FileReadStream(file.get(), buffer.data(), buffer.size());
+
+    auto handler = GeoJsonHandler(features);
+    auto reader = rapidjson::Reader();
+    if (!reader.Parse(stream, handler))
+    {
+        std::cerr << "OverlayReader::ReadGeoJson Parse error at offset " << reader.GetErrorOffset() << " of " << path << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool ReadGpx(const std::string& path, Features& features)
+{
+    auto file = QFile(QString::fromStdString(path));
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        std::cerr << "OverlayReader::ReadGpx Failed to open " << path << std::endl;
+        return false;
+    }
+
+    // Points with missing or out of range coordinates are skipped instead of failing the whole file
+    auto skipped_count = size_t(0);
+    const auto read_position = [&skipped_count](const QXmlStreamReader& reader, projection::Epsg4326Point& point) {
+        const auto attributes = reader.attributes();
+        auto is_longitude_valid = false, is_latitude_valid = false;
+        point = projection::Epsg4326Point(attributes.value("lon").toDouble(&is_longitude_valid), attributes.value("lat").toDouble(&is_latitude_valid));
+        if (is_longitude_valid && is_latitude_valid && std::abs(point.longitude) <= 180 && std::abs(point.latitude) < 90)
+            return true;
+
+        skipped_count++;
+        return false;
+    };
+
+    auto waypoints = std::vector<projection::Epsg4326Point>();
+    auto line = std::vector<projection::Epsg4326Point>();
+    auto line_points = std::vector<projection::Epsg3857Point>();
+    auto point = projection::Epsg4326Point();
+    auto is_in_waypoint = false;
+
+    auto reader = QXmlStreamReader(&file);
+    for (; !reader.atEnd();)
+    {
+        reader.readNext();
+
+        if (reader.isStartElement())
+        {
+            const auto name = reader.name();
+            if (name == QLatin1String("wpt"))
+            {
+                // Name of skipped waypoint is not read either
+                is_in_waypoint = read_position(reader, point);
+                if (is_in_waypoint)
+                {
+                    waypoints.push_back(point);
+                    features.point_names.emplace_back();
+                }
+            }
+            else if ((name == QLatin1String("trkpt") || name == QLatin1String("rtept")) && read_position(reader, point))
+            {
+                line.push_back(point);
+            }
+            else if (name == QLatin1String("trkseg") || name == QLatin1String("rte"))
+            {
+                line.clear();
+            }
+            else if (name == QLatin1String("name") && is_in_waypoint)
+            {
+                features.point_names.back() = reader.readElementText().toStdString();
+            }
+        }
+        else if (reader.isEndElement())
+        {
+            const auto name = reader.name();
+            if (name == QLatin1String("wpt"))
+            {
+                is_in_waypoint = false;
+            }
+            else if ((name == QLatin1String("trkseg") || name == QLatin1String("rte")) && line.size() >= 2)
+            {
+                line_points.clear();
+                if (projection::ToEpsg3857(line, line_points))
+                    features.lines.Add(line_points);
+
+                line.clear();
+            }
+        }
+    }
+
+    if (skipped_count > 0)
+        std::cerr << "OverlayReader::ReadGpx Skipped " << skipped_count << " points with invalid coordinates in " << path << std::endl;
+
+    if (reader.hasError())
+    {
+        std::cerr << "OverlayReader::ReadGpx " << reader.errorString().toStdString() << " at line " << reader.lineNumber() << " of " << path << std::endl;
+        features.point_names.resize(features.points.size());
+        return false;
+    }
+
+    auto waypoint_points = std::vector<projection::Epsg3857Point>();
+    if (!projection::ToEpsg3857(waypoints, waypoint_points))
+    {
+        features.point_names.resize(features.points.size());
+        return false;
+    }
+
+    features.points.insert(features.points.end(), waypoint_points.begin(), waypoint_points.end());
+
+    return true;
+}
+
+bool Read(const std::string& path, Features& features)
+{
+    const auto extension_position = path.rfind('.');
+    auto extension = extension_position == std::string::npos ? std::string() : path.substr(extension_position + 1);
+    for (auto& character : extension)
+        character = static_cast<char>(std::tolower(static_cast<unsigned char>(character)));
+
+    if (extension == "gpx")
+        return ReadGpx(path, features);
+
+    return ReadGeoJson(path, features);
+}
+
+} // namespace overlay_reader
@@ -0,0 +1,33 @@
+#ifndef OVERLAYREADER_H
+#define OVERLAYREADER_H
+
+#include <string>
+#include <vector>
+
+#include "Projection.h"
+#include "PolylineStore.h"
+
+//! Streaming readers of user datasets shown over the map
+namespace overlay_reader {
+
+struct Features
+{
+    std::vector<projection::Epsg3857Point> points;
+    //! Name of point i, empty if it has none
+    std::vector<std::string> point_names;
+    //! Lines, tracks and polygon rings
+    PolylineStore lines;
+};
+
+/* Reads GeoJSON with SAX parser, so the file is never held in memory as a
+document. Point and MultiPoint become points named after "name" property of
+their feature, other geometries become lines */
+bool ReadGeoJson(const std::string& path, Features& features);
+//! Reads waypoints as points, track segments and routes as lines
+bool ReadGpx(const std::string& path, Features& features);
+//! Chooses reader by file extension, .gpx or GeoJSON otherwise
+bool Read(const std::string& path, Features& features);
+
+} // namespace overlay_reader
+
+#endif // OVERLAYREADER_H
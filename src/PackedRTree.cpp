@@ -0,0 +1,86 @@
+#include "PackedRTree.h"
+
+#include <numeric>
+
+#include "Hilbert.h"
+
+PackedRTree::PackedRTree(const unsigned int node_size)
+    : node_size_(std::max(node_size, 2u))
+{
+
+}
+
+void PackedRTree::Build(const std::vector<Box>& item_boxes)
+{
+    item_count_ = item_boxes.size();
+    boxes_.clear();
+    indices_.clear();
+    level_bounds_.clear();
+
+    if (item_boxes.empty())
+        return;
+
+    auto bounds = Box();
+    for (const auto& box : item_boxes)
+        bounds.Extend(box);
+
+    // Sort items along Hilbert curve by their box centers
+    auto hilbert_indices = std::vector<uint32_t>(item_count_);
+    for (size_t i = 0; i < item_count_; i++)
+    {
+        const auto& box = item_boxes[i];
+        hilbert_indices[i] = hilbert::XYToIndex(
+            hilbert::ToAxis((box.min_x + box.max_x) / 2, bounds.min_x, bounds.max_x),
+            hilbert::ToAxis((box.min_y + box.max_y) / 2, bounds.min_y, bounds.max_y));
+    }
+
+    auto order = std::vector<uint32_t>(item_count_);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&hilbert_indices](const uint32_t lhs, const uint32_t rhs) {
+        return hilbert_indices[lhs] < hilbert_indices[rhs];
+    });
+
+    // Compute size of each level, there is always at least one level above items
+    auto level_item_count = item_count_;
+    auto total_count = item_count_;
+    level_bounds_.push_back(total_count);
+    do
+    {
+        level_item_count = (level_item_count + node_size_ - 1) / node_size_;
+        total_count += level_item_count;
+        level_bounds_.push_back(total_count);
+    } while (level_item_count != 1);
+
+    boxes_.reserve(total_count);
+    indices_.reserve(total_count);
+
+    for (const auto item : order)
+    {
+        boxes_.push_back(item_boxes[item]);
+        indices_.push_back(item);
+    }
+
+    size_t level_start = 0;
+    for (size_t level = 0; level + 1 < level_bounds_.size(); level++)
+    {
+        const auto level_end = level_bounds_[level];
+
+        for (auto position = level_start; position < level_end; position += node_size_)
+        {
+            auto node_box = Box();
+            const auto node_end = std::min(position + node_size_, level_end);
+            for (auto child = position; child < node_end; child++)
+                node_box.Extend(boxes_[child]);
+
+            boxes_.push_back(node_box);
+            indices_.push_back(static_cast<uint32_t>(position));
+        }
+
+        level_start = level_end;
+    }
+}
+
+size_t PackedRTree::LevelUpperBound(const size_t position) const
+{
+    return *std::upper_bound(level_bounds_.begin(), level_bounds_.end(), position);
+}
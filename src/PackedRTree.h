@@ -0,0 +1,183 @@
+#ifndef PACKEDRTREE_H
+#define PACKEDRTREE_H
+
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <cstdint>
+
+/* Static R-tree packed along Hilbert curve. Built once from a set of boxes
+and stored in flat arrays, so queries touch only a few cache lines per level.
+Items are addressed by their index in the vector passed to Build */
+class PackedRTree
+{
+public:
+    struct Box
+    {
+        Box()
+            : min_x(std::numeric_limits<double>::max()), min_y(std::numeric_limits<double>::max()),
+            max_x(std::numeric_limits<double>::lowest()), max_y(std::numeric_limits<double>::lowest())
+        {
+
+        }
+
+        Box(const double min_x, const double min_y, const double max_x, const double max_y)
+            : min_x(min_x), min_y(min_y), max_x(max_x), max_y(max_y)
+        {
+
+        }
+
+        void Extend(const Box& box)
+        {
+            min_x = std::min(min_x, box.min_x);
+            min_y = std::min(min_y, box.min_y);
+            max_x = std::max(max_x, box.max_x);
+            max_y = std::max(max_y, box.max_y);
+        }
+
+        bool Intersects(const Box& box) const
+        {
+            return min_x <= box.max_x && box.min_x <= max_x && min_y <= box.max_y && box.min_y <= max_y;
+        }
+
+        //! Squared distance from point to the box, zero if point is inside
+        double SquaredDistance(const double x, const double y) const
+        {
+            const auto dx = x < min_x ? min_x - x : (x > max_x ? x - max_x : 0);
+            const auto dy = y < min_y ? min_y - y : (y > max_y ? y - max_y : 0);
+            return dx * dx + dy * dy;
+        }
+
+        double min_x;
+        double min_y;
+        double max_x;
+        double max_y;
+    };
+
+    explicit PackedRTree(const unsigned int node_size = 16);
+
+    void Build(const std::vector<Box>& item_boxes);
+
+    size_t ItemCount() const { return item_count_; }
+
+    //! Calls visitor(item) for every item which box intersects with the given box
+    template <typename Visitor>
+    void Search(const Box& box, Visitor visitor) const;
+
+    /* Best-first nearest item search. item_squared_distance(item) must return exact
+    squared distance from the point to the item, it must not be less than squared
+    distance to the item box. Returns false if no item is closer than max_distance */
+    template <typename ItemSquaredDistance>
+    bool FindNearest(const double x, const double y, ItemSquaredDistance item_squared_distance,
+                     uint32_t& nearest_item, double& nearest_squared_distance,
+                     const double max_distance = std::numeric_limits<double>::max()) const;
+
+private:
+    unsigned int node_size_;
+    size_t item_count_ = 0;
+
+    //! Items boxes sorted along Hilbert curve followed by boxes of each upper level up to the root
+    std::vector<Box> boxes_;
+    //! For leaf level position holds item index, for upper levels position of the first child
+    std::vector<uint32_t> indices_;
+    //! End position of each level in boxes_
+    std::vector<size_t> level_bounds_;
+
+    size_t LevelUpperBound(const size_t position) const;
+};
+
+template <typename Visitor>
+void PackedRTree::Search(const Box& box, Visitor visitor) const
+{
+    if (boxes_.empty())
+        return;
+
+    auto node_stack = std::vector<size_t>();
+    node_stack.push_back(boxes_.size() - 1);
+
+    size_t node_index, end;
+    for (; !node_stack.empty();)
+    {
+        node_index = node_stack.back();
+        node_stack.pop_back();
+
+        end = std::min(node_index + node_size_, LevelUpperBound(node_index));
+        for (auto position = node_index; position < end; position++)
+        {
+            if (!box.Intersects(boxes_[position]))
+                continue;
+
+            if (node_index < item_count_)
+                visitor(indices_[position]);
+            else
+                node_stack.push_back(indices_[position]);
+        }
+    }
+}
+
+template <typename ItemSquaredDistance>
+bool PackedRTree::FindNearest(const double x, const double y, ItemSquaredDistance item_squared_distance,
+                              uint32_t& nearest_item, double& nearest_squared_distance,
+                              const double max_distance) const
+{
+    if (boxes_.empty())
+        return false;
+
+    struct QueueEntry
+    {
+        double squared_distance;
+        size_t value;
+        bool is_item;
+
+        bool operator>(const QueueEntry& entry) const
+        {
+            return squared_distance > entry.squared_distance;
+        }
+    };
+
+    const auto max_squared_distance = max_distance == std::numeric_limits<double>::max()
+        ? max_distance : max_distance * max_distance;
+
+    auto queue = std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>>();
+
+    size_t node_index = boxes_.size() - 1;
+    size_t end;
+    double squared_distance;
+    for (;;)
+    {
+        end = std::min(node_index + node_size_, LevelUpperBound(node_index));
+        for (auto position = node_index; position < end; position++)
+        {
+            if (node_index < item_count_)
+            {
+                squared_distance = item_squared_distance(indices_[position]);
+                if (squared_distance <= max_squared_distance)
+                    queue.push(QueueEntry { squared_distance, indices_[position], true });
+            }
+            else
+            {
+                squared_distance = boxes_[position].SquaredDistance(x, y);
+                if (squared_distance <= max_squared_distance)
+                    queue.push(QueueEntry { squared_distance, indices_[position], false });
+            }
+        }
+
+        if (queue.empty())
+            return false;
+
+        // Items are pushed with exact distance, so the first popped item is the nearest
+        if (queue.top().is_item)
+        {
+            nearest_item = static_cast<uint32_t>(queue.top().value);
+            nearest_squared_distance = queue.top().squared_distance;
+            return true;
+        }
+
+        node_index = queue.top().value;
+        queue.pop();
+    }
+}
+
+#endif // PACKEDRTREE_H
@@ -0,0 +1,212 @@
+#ifndef PAGEDASTAR_H
+#define PAGEDASTAR_H
+
+#include <cmath>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+
+#include "PagedRoadGraph.h"
+
+namespace paged_astar {
+
+//! Rings of cells around snapped point searched for a vertex usable by profile
+constexpr unsigned int kMaxSnapRingCount { 2 };
+
+/* Labels and queue of one search over paged graph. Vertices are keyed by id
+as the graph has no dense numbering, containers keep their memory between searches.
+Cells touched by the search are pinned in the graph cache while it runs, so a
+frontier wider than the cache does not fetch the same cell again and again. Pinned
+cells share memory budget of the graph with the rest of the cache and are unpinned
+when the search finishes */
+class SearchState
+{
+public:
+    void Clear()
+    {
+        labels_u_map_.clear();
+        queue_.clear();
+        ReleaseCells();
+        settled_count_ = 0;
+        relaxed_count_ = 0;
+    }
+
+    size_t SettledCount() const { return settled_count_; }
+    size_t RelaxedCount() const { return relaxed_count_; }
+
+private:
+    template <typename Profile>
+    friend bool Search(PagedRoadGraph&, const PagedRoadGraph::Vertex&, const PagedRoadGraph::Vertex&, SearchState&,
+                       double&, std::vector<PagedRoadGraph::ArcReference>&);
+
+    struct Label
+    {
+        double cost = std::numeric_limits<double>::infinity();
+        //! Tells the cell holding outgoing arcs of the vertex
+        projection::Epsg3857Point point;
+        int64_t parent_id = 0;
+        PagedRoadGraph::ArcReference parent_arc;
+        bool has_parent = false;
+        bool is_settled = false;
+    };
+
+    struct QueueEntry
+    {
+        double priority;
+        int64_t vertex_id;
+
+        bool operator>(const QueueEntry& entry) const
+        {
+            return priority > entry.priority;
+        }
+    };
+
+    std::unordered_map<int64_t, Label> labels_u_map_;
+    //! Binary min-heap with lazy deletion, as in SearchSpace
+    std::vector<QueueEntry> queue_;
+    //! Cells pinned by the search in the cache of this graph
+    PagedRoadGraph* paged_road_graph_ = nullptr;
+    std::unordered_map<uint64_t, PagedRoadGraph::CellSPtr> cells_u_map_;
+
+    size_t settled_count_ = 0;
+    size_t relaxed_count_ = 0;
+
+    void ReleaseCells()
+    {
+        for (const auto& cell : cells_u_map_)
+            paged_road_graph_->UnpinCell(cell.first);
+
+        cells_u_map_.clear();
+    }
+};
+
+/* A* over paged graph, the same estimate as astar::Search. Cell of a vertex is
+fetched only when the vertex is settled, so cells are queried along the search
+frontier and a long route touches a corridor of cells around it. Returns false
+if target is unreachable or a cell cannot be fetched */
+template <typename Profile>
+bool Search(PagedRoadGraph& paged_road_graph, const PagedRoadGraph::Vertex& source, const PagedRoadGraph::Vertex& target,
+            SearchState& search_state, double& cost, std::vector<PagedRoadGraph::ArcReference>& path_arcs)
+{
+    const auto estimate = [&target](const projection::Epsg3857Point& point) {
+        return routing_profile::EstimateCost<Profile>(std::hypot(point.x - target.point.x, point.y - target.point.y));
+    };
+
+    auto& labels_u_map = search_state.labels_u_map_;
+    auto& queue = search_state.queue_;
+    const auto push = [&queue](const double priority, const int64_t vertex_id) {
+        queue.push_back(SearchState::QueueEntry { priority, vertex_id });
+        std::push_heap(queue.begin(), queue.end(), std::greater<SearchState::QueueEntry>());
+    };
+
+    search_state.Clear();
+    search_state.paged_road_graph_ = &paged_road_graph;
+    path_arcs.clear();
+
+    const auto finish = [&search_state](const bool is_found) {
+        search_state.ReleaseCells();
+        return is_found;
+    };
+
+    auto& source_label = labels_u_map[source.id];
+    source_label.cost = 0;
+    source_label.point = source.point;
+    push(estimate(source.point), source.id);
+
+    auto cell_s_ptr = PagedRoadGraph::CellSPtr();
+    auto cell_key = uint64_t(0);
+    uint32_t vertex;
+    float weight;
+    double head_cost;
+    for (; !queue.empty();)
+    {
+        std::pop_heap(queue.begin(), queue.end(), std::greater<SearchState::QueueEntry>());
+        const auto vertex_id = queue.back().vertex_id;
+        queue.pop_back();
+
+        // References to map elements survive rehashing
+        auto& label = labels_u_map[vertex_id];
+        if (label.is_settled)
+            continue;
+
+        label.is_settled = true;
+        search_state.settled_count_++;
+
+        if (vertex_id == target.id)
+        {
+            cost = label.cost;
+            for (auto path_label = &label; path_label->has_parent; path_label = &labels_u_map[path_label->parent_id])
+                path_arcs.push_back(path_label->parent_arc);
+
+            std::reverse(path_arcs.begin(), path_arcs.end());
+            return finish(true);
+        }
+
+        // Settled vertices are close to each other, so the cell usually stays the same
+        const auto vertex_cell_key = paged_road_graph.CellKey(label.point);
+        if (!cell_s_ptr || vertex_cell_key != cell_key)
+        {
+            cell_key = vertex_cell_key;
+
+            const auto held_cell_iterator = search_state.cells_u_map_.find(cell_key);
+            if (held_cell_iterator != search_state.cells_u_map_.end())
+            {
+                cell_s_ptr = held_cell_iterator->second;
+            }
+            else
+            {
+                cell_s_ptr = paged_road_graph.FetchCell(cell_key);
+                if (!cell_s_ptr)
+                    return finish(false);
+
+                // Beyond the budget cells are left to least recently used order
+                if (paged_road_graph.PinCell(cell_key))
+                    search_state.cells_u_map_.emplace(cell_key, cell_s_ptr);
+            }
+        }
+
+        if (!cell_s_ptr->FindVertex(vertex_id, vertex))
+            continue;
+
+        for (auto arc = cell_s_ptr->FirstArc(vertex); arc < cell_s_ptr->FirstArc(vertex + 1); arc++)
+        {
+            weight = cell_s_ptr->ArcCost<Profile>(arc);
+            if (weight == routing_profile::kInaccessible)
+                continue;
+
+            auto& head_label = labels_u_map[cell_s_ptr->ArcHeadId(arc)];
+            if (head_label.is_settled)
+                continue;
+
+            head_cost = label.cost + weight;
+            if (head_cost >= head_label.cost)
+                continue;
+
+            head_label.cost = head_cost;
+            head_label.point = cell_s_ptr->ArcHeadPoint(arc);
+            head_label.parent_id = vertex_id;
+            head_label.parent_arc = PagedRoadGraph::ArcReference { cell_key, arc };
+            head_label.has_parent = true;
+            search_state.relaxed_count_++;
+
+            push(head_cost + estimate(head_label.point), cell_s_ptr->ArcHeadId(arc));
+        }
+    }
+
+    return finish(false);
+}
+
+//! Finds nearest vertex usable by profile in cells around point
+template <typename Profile>
+bool FindNearestAccessibleVertex(PagedRoadGraph& paged_road_graph, const projection::Epsg3857Point& point, PagedRoadGraph::Vertex& vertex)
+{
+    return paged_road_graph.FindNearestVertex(point, kMaxSnapRingCount, [](const PagedRoadGraph::Cell& cell, const uint32_t cell_vertex) {
+        return cell.IsVertexAccessible<Profile>(cell_vertex);
+    }, vertex);
+}
+
+} // namespace paged_astar
+
+#endif // PAGEDASTAR_H
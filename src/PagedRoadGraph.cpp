@@ -0,0 +1,361 @@
+#include "PagedRoadGraph.h"
+
+#include <numeric>
+#include <iostream>
+
+#include <QtSql/QSqlError>
+#include <QVariant>
+
+#include "Wkb.h"
+
+//! Envelope of cell query is widened, vertices on its border are assigned to cells by CellKey
+constexpr double kCellQueryMargin { 1 };
+
+bool PagedRoadGraph::Cell::FindVertex(const int64_t vertex_id, uint32_t& vertex) const
+{
+    const auto vertex_it = std::lower_bound(vertex_ids_.begin(), vertex_ids_.end(), vertex_id);
+    if (vertex_it == vertex_ids_.end() || *vertex_it != vertex_id)
+        return false;
+
+    vertex = static_cast<uint32_t>(vertex_it - vertex_ids_.begin());
+    return true;
+}
+
+void PagedRoadGraph::Cell::ArcShape(const uint32_t arc, std::vector<projection::Epsg3857Point>& shape) const
+{
+    edge_shapes_.Decode(arc_edges_[arc], !arc_forward_flags_[arc], shape);
+}
+
+PagedRoadGraph::PagedRoadGraph(const QSqlDatabase& database, const size_t memory_budget, const unsigned int cell_zoom)
+    : cell_zoom_(cell_zoom), memory_budget_(memory_budget), cell_query_(database)
+{
+
+}
+
+PagedRoadGraphUPtr PagedRoadGraph::Create(const QSqlDatabase& database, const size_t memory_budget, const unsigned int cell_zoom)
+{
+    std::unique_ptr<PagedRoadGraph> instance(new PagedRoadGraph(database, memory_budget, cell_zoom));
+
+    /* Edges are found through vertices inside cell envelope, from both ends, so
+    roads crossing cell border belong to both cells. Query is planned once and
+    executed for every fetched cell */
+    instance->cell_query_.setForwardOnly(true);
+    if (!instance->cell_query_.prepare(R"(
+        WITH cell_vertices AS (
+            SELECT
+                id
+            FROM
+                roads_vertices_pgr
+            WHERE
+                the_geom && ST_MakeEnvelope(?, ?, ?, ?, 3857)
+        ), cell_edges AS (
+            SELECT r.id FROM roads r JOIN cell_vertices v ON r.source = v.id
+            UNION
+            SELECT r.id FROM roads r JOIN cell_vertices v ON r.target = v.id
+        )
+        SELECT
+            r.id,
+            r.source,
+            st_x(s.the_geom),
+            st_y(s.the_geom),
+            r.target,
+            st_x(t.the_geom),
+            st_y(t.the_geom),
+            r.length,
+            ST_AsBinary(r.geom),
+            l.highway,
+            l.oneway
+        FROM
+            cell_edges c
+        JOIN roads r ON r.id = c.id
+        JOIN roads_vertices_pgr s ON s.id = r.source
+        JOIN roads_vertices_pgr t ON t.id = r.target
+        LEFT JOIN LATERAL (
+            SELECT
+                highway,
+                oneway
+            FROM
+                planet_osm_line
+            WHERE
+                osm_id = r.old_id AND highway IS NOT NULL
+            LIMIT 1
+        ) l ON true;
+    )"))
+    {
+        std::cerr << "PagedRoadGraph::Create SQL query preparation error: " << instance->cell_query_.lastError().text().toStdString() << std::endl;
+        return nullptr;
+    }
+
+    return instance;
+}
+
+uint64_t PagedRoadGraph::CellKey(const projection::Epsg3857Point& point) const
+{
+    const auto tile = projection::PointTile(point, cell_zoom_);
+    return (static_cast<uint64_t>(tile.x_index) << 32) | tile.y_index;
+}
+
+PagedRoadGraph::CellSPtr PagedRoadGraph::FetchCell(const uint64_t cell_key)
+{
+    const auto cached_cell_it = cached_cells_u_map_.find(cell_key);
+    if (cached_cell_it != cached_cells_u_map_.end())
+    {
+        if (cached_cell_it->second.pin_count == 0)
+            lru_cell_keys_.splice(lru_cell_keys_.begin(), lru_cell_keys_, cached_cell_it->second.lru_position);
+
+        return cached_cell_it->second.cell_s_ptr;
+    }
+
+    auto cell_edges = std::vector<CellEdge>();
+    if (!QueryCell(cell_key, cell_edges))
+        return nullptr;
+
+    auto cell_s_ptr = BuildCell(cell_key, cell_edges);
+
+    lru_cell_keys_.push_front(cell_key);
+    cached_cells_u_map_.emplace(cell_key, CachedCell { cell_s_ptr, lru_cell_keys_.begin() });
+    cached_byte_count_ += cell_s_ptr->ByteCount();
+
+    EvictCells();
+
+    return cell_s_ptr;
+}
+
+bool PagedRoadGraph::PinCell(const uint64_t cell_key)
+{
+    const auto cached_cell_it = cached_cells_u_map_.find(cell_key);
+    if (cached_cell_it == cached_cells_u_map_.end())
+        return false;
+
+    auto& cached_cell = cached_cell_it->second;
+    if (cached_cell.pin_count == 0)
+    {
+        if (pinned_byte_count_ + cached_cell.cell_s_ptr->ByteCount() > memory_budget_)
+            return false;
+
+        lru_cell_keys_.erase(cached_cell.lru_position);
+        pinned_byte_count_ += cached_cell.cell_s_ptr->ByteCount();
+    }
+
+    cached_cell.pin_count++;
+
+    return true;
+}
+
+void PagedRoadGraph::UnpinCell(const uint64_t cell_key)
+{
+    const auto cached_cell_it = cached_cells_u_map_.find(cell_key);
+    if (cached_cell_it == cached_cells_u_map_.end() || cached_cell_it->second.pin_count == 0)
+        return;
+
+    auto& cached_cell = cached_cell_it->second;
+    if (--cached_cell.pin_count > 0)
+        return;
+
+    lru_cell_keys_.push_front(cell_key);
+    cached_cell.lru_position = lru_cell_keys_.begin();
+    pinned_byte_count_ -= cached_cell.cell_s_ptr->ByteCount();
+
+    EvictCells();
+}
+
+void PagedRoadGraph::EvictCells()
+{
+    for (; cached_byte_count_ > memory_budget_ && lru_cell_keys_.size() > 1;)
+    {
+        const auto cached_cell_it = cached_cells_u_map_.find(lru_cell_keys_.back());
+        cached_byte_count_ -= cached_cell_it->second.cell_s_ptr->ByteCount();
+
+        cached_cells_u_map_.erase(cached_cell_it);
+        lru_cell_keys_.pop_back();
+    }
+}
+
+bool PagedRoadGraph::QueryCell(const uint64_t cell_key, std::vector<CellEdge>& cell_edges)
+{
+    const auto x_index = static_cast<unsigned int>(cell_key >> 32);
+    const auto y_index = static_cast<unsigned int>(cell_key);
+    const auto bounds = projection::TileBounds(map::Tile(x_index, y_index), cell_zoom_);
+
+    // Points outside of the map belong to border cells, their envelopes reach beyond it
+    const auto max_index = (1u << cell_zoom_) - 1;
+    const auto outer_margin = projection::kEpsg3857Bound;
+
+    cell_query_.addBindValue(bounds.bottom_left_point.x - (x_index == 0 ? outer_margin : kCellQueryMargin));
+    cell_query_.addBindValue(bounds.bottom_left_point.y - (y_index == 0 ? outer_margin : kCellQueryMargin));
+    cell_query_.addBindValue(bounds.top_right_point.x + (x_index == max_index ? outer_margin : kCellQueryMargin));
+    cell_query_.addBindValue(bounds.top_right_point.y + (y_index == max_index ? outer_margin : kCellQueryMargin));
+
+    query_count_++;
+    if (!cell_query_.exec())
+    {
+        std::cerr << "PagedRoadGraph::QueryCell SQL query execution error: " << cell_query_.lastError().text().toStdString() << std::endl;
+        return false;
+    }
+
+    int wkb_offset;
+    for (; cell_query_.next();)
+    {
+        auto cell_edge = CellEdge();
+        cell_edge.id = cell_query_.value(0).toLongLong();
+        cell_edge.source.id = cell_query_.value(1).toLongLong();
+        cell_edge.source.point = projection::Epsg3857Point(cell_query_.value(2).toDouble(), cell_query_.value(3).toDouble());
+        cell_edge.target.id = cell_query_.value(4).toLongLong();
+        cell_edge.target.point = projection::Epsg3857Point(cell_query_.value(5).toDouble(), cell_query_.value(6).toDouble());
+        cell_edge.length = cell_query_.value(7).toDouble();
+        cell_edge.road_class = routing_profile::ParseRoadClass(cell_query_.value(9).toString().toStdString());
+        cell_edge.oneway = routing_profile::ParseOneway(cell_query_.value(10).toString().toStdString());
+
+        wkb_offset = 0;
+        if (!wkb::ParseLineString(cell_query_.value(8).toByteArray(), wkb_offset, cell_edge.shape) || cell_edge.shape.size() < 2)
+        {
+            // Fall back to straight line between end points, as in RoadGraph
+            cell_edge.shape.clear();
+            cell_edge.shape.push_back(cell_edge.source.point);
+            cell_edge.shape.push_back(cell_edge.target.point);
+        }
+
+        cell_edges.push_back(std::move(cell_edge));
+    }
+
+    cell_query_.finish();
+
+    return true;
+}
+
+PagedRoadGraph::CellSPtr PagedRoadGraph::BuildCell(const uint64_t cell_key, const std::vector<CellEdge>& cell_edges) const
+{
+    auto cell = std::make_shared<Cell>();
+
+    // Edges in id order make numbering independent of the order rows came in
+    auto edge_order = std::vector<uint32_t>(cell_edges.size());
+    std::iota(edge_order.begin(), edge_order.end(), 0);
+    std::sort(edge_order.begin(), edge_order.end(), [&cell_edges](const uint32_t lhs, const uint32_t rhs) {
+        return cell_edges[lhs].id < cell_edges[rhs].id;
+    });
+
+    auto vertices = std::vector<Vertex>();
+    for (const auto& cell_edge : cell_edges)
+    {
+        for (const auto& end_vertex : { cell_edge.source, cell_edge.target })
+        {
+            if (CellKey(end_vertex.point) == cell_key)
+                vertices.push_back(end_vertex);
+        }
+    }
+
+    std::sort(vertices.begin(), vertices.end(), [](const Vertex& lhs, const Vertex& rhs) {
+        return lhs.id < rhs.id;
+    });
+    vertices.erase(std::unique(vertices.begin(), vertices.end(), [](const Vertex& lhs, const Vertex& rhs) {
+        return lhs.id == rhs.id;
+    }), vertices.end());
+
+    cell->vertex_ids_.reserve(vertices.size());
+    cell->vertex_points_.reserve(vertices.size());
+    for (const auto& vertex : vertices)
+    {
+        cell->vertex_ids_.push_back(vertex.id);
+        cell->vertex_points_.push_back(vertex.point);
+    }
+
+    // Arcs are counted per tail vertex first, then placed, as in RoadGraph::BuildAdjacency
+    cell->first_arcs_.assign(cell->VertexCount() + 1, 0);
+    uint32_t tail;
+    for (const auto& cell_edge : cell_edges)
+    {
+        if (cell->FindVertex(cell_edge.source.id, tail))
+            cell->first_arcs_[tail + 1]++;
+        if (cell->FindVertex(cell_edge.target.id, tail))
+            cell->first_arcs_[tail + 1]++;
+    }
+
+    for (size_t vertex = 0; vertex < cell->VertexCount(); vertex++)
+        cell->first_arcs_[vertex + 1] += cell->first_arcs_[vertex];
+
+    const auto arc_count = cell->first_arcs_.back();
+    cell->arc_head_ids_.resize(arc_count);
+    cell->arc_head_points_.resize(arc_count);
+    cell->arc_edges_.resize(arc_count);
+    cell->arc_forward_flags_.resize(arc_count);
+
+    auto next_arcs = std::vector<uint32_t>(cell->first_arcs_.begin(), cell->first_arcs_.end() - 1);
+    const auto add_arc = [&](const uint32_t tail, const Vertex& head, const uint32_t edge, const bool is_forward) {
+        const auto arc = next_arcs[tail]++;
+
+        cell->arc_head_ids_[arc] = head.id;
+        cell->arc_head_points_[arc] = head.point;
+        cell->arc_edges_[arc] = edge;
+        cell->arc_forward_flags_[arc] = is_forward;
+    };
+
+    for (const auto edge_index : edge_order)
+    {
+        const auto& cell_edge = cell_edges[edge_index];
+
+        // Widened envelope brings roads of neighbouring cells, they have no arcs here
+        uint32_t source_tail, target_tail;
+        const auto is_source_inside = cell->FindVertex(cell_edge.source.id, source_tail);
+        const auto is_target_inside = cell->FindVertex(cell_edge.target.id, target_tail);
+        if (!is_source_inside && !is_target_inside)
+            continue;
+
+        const auto edge = static_cast<uint32_t>(cell->edge_ids_.size());
+
+        cell->edge_ids_.push_back(cell_edge.id);
+        cell->edge_lengths_.push_back(cell_edge.length);
+        cell->edge_road_classes_.push_back(cell_edge.road_class);
+        cell->edge_oneways_.push_back(cell_edge.oneway);
+        cell->edge_shapes_.Add(cell_edge.shape);
+
+        if (is_source_inside)
+            add_arc(source_tail, cell_edge.target, edge, true);
+        if (is_target_inside)
+            add_arc(target_tail, cell_edge.source, edge, false);
+    }
+
+    cell->edge_shapes_.ShrinkToFit();
+
+    cell->byte_count_ = sizeof(Cell)
+        + cell->vertex_ids_.capacity() * sizeof(int64_t)
+        + cell->vertex_points_.capacity() * sizeof(projection::Epsg3857Point)
+        + cell->edge_ids_.capacity() * sizeof(int64_t)
+        + cell->edge_lengths_.capacity() * sizeof(double)
+        + cell->edge_road_classes_.capacity() * sizeof(routing_profile::RoadClass)
+        + cell->edge_oneways_.capacity() * sizeof(routing_profile::Oneway)
+        + cell->edge_shapes_.ByteCount() + (cell->edge_shapes_.Count() + 1) * sizeof(uint64_t)
+        + cell->first_arcs_.capacity() * sizeof(uint32_t)
+        + cell->arc_head_ids_.capacity() * sizeof(int64_t)
+        + cell->arc_head_points_.capacity() * sizeof(projection::Epsg3857Point)
+        + cell->arc_edges_.capacity() * sizeof(uint32_t)
+        + cell->arc_forward_flags_.capacity() * sizeof(char);
+
+    return cell;
+}
+
+bool PagedRoadGraph::PathShape(const std::vector<ArcReference>& path_arcs, std::vector<projection::Epsg3857Point>& shape)
+{
+    auto arc_shape = std::vector<projection::Epsg3857Point>();
+    auto cell_s_ptr = CellSPtr();
+    auto cell_key = uint64_t(0);
+    for (const auto& path_arc : path_arcs)
+    {
+        // Consecutive arcs are mostly in one cell
+        if (!cell_s_ptr || cell_key != path_arc.cell_key)
+        {
+            cell_key = path_arc.cell_key;
+            cell_s_ptr = FetchCell(cell_key);
+            if (!cell_s_ptr)
+                return false;
+        }
+
+        arc_shape.clear();
+        cell_s_ptr->ArcShape(path_arc.arc, arc_shape);
+
+        // Decoded end points are rounded, vertex points are exact
+        shape.insert(shape.end(), arc_shape.begin() + 1, arc_shape.end() - 1);
+        shape.push_back(cell_s_ptr->ArcHeadPoint(path_arc.arc));
+    }
+
+    return true;
+}
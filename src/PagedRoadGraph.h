@@ -0,0 +1,252 @@
+#ifndef PAGEDROADGRAPH_H
+#define PAGEDROADGRAPH_H
+
+#include <list>
+#include <cmath>
+#include <memory>
+#include <algorithm>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+#include <QSqlDatabase>
+#include <QtSql/QSqlQuery>
+
+#include "Projection.h"
+#include "RoutingProfile.h"
+#include "PolylineStore.h"
+
+class PagedRoadGraph;
+using PagedRoadGraphUPtr = std::unique_ptr<PagedRoadGraph>;
+
+/* Road graph read from tables of pgr_createTopology (roads and roads_vertices_pgr)
+on demand instead of at once. Map is split into cells, tiles of a fixed zoom,
+and one query returns every edge touching vertices of a cell. Cells are kept in
+least recently used order and dropped when their total size exceeds memory
+budget, so search over the whole planet holds only cells near its frontier.
+Search may pin cells it keeps using, pinned cells are not evicted and count
+against the same budget. Vertices are addressed by database id together with their point, the point
+tells which cell to fetch. Not thread safe, used from the thread owning database */
+class PagedRoadGraph
+{
+public:
+    //! Side of a cell is that of a tile at this zoom, about 5 km
+    static constexpr unsigned int kDefaultCellZoom = 13;
+
+    struct Vertex
+    {
+        int64_t id = 0;
+        projection::Epsg3857Point point;
+    };
+
+    /* Part of the graph inside one cell. Vertices are sorted by id, arcs start at
+    vertices of the cell and may end in other cells, so heads keep their points.
+    Arc order is derived from data only, so cell fetched again after eviction
+    has the same arc numbering */
+    class Cell
+    {
+    public:
+        size_t VertexCount() const { return vertex_ids_.size(); }
+        int64_t VertexId(const uint32_t vertex) const { return vertex_ids_[vertex]; }
+        const projection::Epsg3857Point& VertexPoint(const uint32_t vertex) const { return vertex_points_[vertex]; }
+        //! Finds vertex index by its id, returns false if vertex is not in this cell
+        bool FindVertex(const int64_t vertex_id, uint32_t& vertex) const;
+
+        //! Outgoing arcs of vertex are [FirstArc(vertex), FirstArc(vertex + 1))
+        uint32_t FirstArc(const uint32_t vertex) const { return first_arcs_[vertex]; }
+        int64_t ArcHeadId(const uint32_t arc) const { return arc_head_ids_[arc]; }
+        const projection::Epsg3857Point& ArcHeadPoint(const uint32_t arc) const { return arc_head_points_[arc]; }
+        bool IsArcForward(const uint32_t arc) const { return arc_forward_flags_[arc]; }
+        //! Travel time along arc for profile, routing_profile::kInaccessible if it cannot be used
+        template <typename Profile>
+        float ArcCost(const uint32_t arc) const
+        {
+            const auto edge = arc_edges_[arc];
+            return routing_profile::ArcCost<Profile>(edge_road_classes_[edge], edge_oneways_[edge], edge_lengths_[edge], arc_forward_flags_[arc]);
+        }
+
+        //! Whether vertex has at least one arc in any direction usable by profile
+        template <typename Profile>
+        bool IsVertexAccessible(const uint32_t vertex) const
+        {
+            for (auto arc = first_arcs_[vertex]; arc < first_arcs_[vertex + 1]; arc++)
+            {
+                const auto edge = arc_edges_[arc];
+                for (const auto is_forward : { true, false })
+                {
+                    if (routing_profile::ArcCost<Profile>(edge_road_classes_[edge], edge_oneways_[edge], edge_lengths_[edge], is_forward) != routing_profile::kInaccessible)
+                        return true;
+                }
+            }
+
+            return false;
+        }
+
+        int64_t ArcEdgeId(const uint32_t arc) const { return edge_ids_[arc_edges_[arc]]; }
+        //! Appends arc geometry from its tail to its head including both end points
+        void ArcShape(const uint32_t arc, std::vector<projection::Epsg3857Point>& shape) const;
+
+        //! Bytes taken by arrays of the cell, counted against memory budget
+        size_t ByteCount() const { return byte_count_; }
+
+    private:
+        friend class PagedRoadGraph;
+
+        std::vector<int64_t> vertex_ids_;
+        std::vector<projection::Epsg3857Point> vertex_points_;
+
+        std::vector<int64_t> edge_ids_;
+        std::vector<double> edge_lengths_;
+        std::vector<routing_profile::RoadClass> edge_road_classes_;
+        std::vector<routing_profile::Oneway> edge_oneways_;
+        PolylineStore edge_shapes_;
+
+        std::vector<uint32_t> first_arcs_;
+        std::vector<int64_t> arc_head_ids_;
+        std::vector<projection::Epsg3857Point> arc_head_points_;
+        std::vector<uint32_t> arc_edges_;
+        std::vector<char> arc_forward_flags_;
+
+        size_t byte_count_ = 0;
+    };
+
+    using CellSPtr = std::shared_ptr<const Cell>;
+
+    //! Arc of path found by search, cell is given by its key
+    struct ArcReference
+    {
+        uint64_t cell_key = 0;
+        uint32_t arc = 0;
+    };
+
+    /* Database must stay open while the graph is used. Budget is in bytes, the
+    most recently used cell is kept even if it alone exceeds it */
+    static PagedRoadGraphUPtr Create(const QSqlDatabase& database, const size_t memory_budget, const unsigned int cell_zoom = kDefaultCellZoom);
+
+    uint64_t CellKey(const projection::Epsg3857Point& point) const;
+    //! Returns cached cell or queries it, nullptr if query failed. Returned cell stays valid after eviction
+    CellSPtr FetchCell(const uint64_t cell_key);
+    CellSPtr FetchCell(const projection::Epsg3857Point& point) { return FetchCell(CellKey(point)); }
+    //! Keeps cached cell from eviction, returns false if it is not cached or pinned cells would exceed memory budget
+    bool PinCell(const uint64_t cell_key);
+    //! Returns cell pinned as many times as it was unpinned to least recently used order
+    void UnpinCell(const uint64_t cell_key);
+
+    /* Finds nearest vertex satisfying is_accepted(cell, vertex) in the cell of
+    point and rings of cells around it, stops when the nearest found vertex is
+    closer than the next ring or after max_ring_count rings */
+    template <typename Predicate>
+    bool FindNearestVertex(const projection::Epsg3857Point& point, const unsigned int max_ring_count, Predicate is_accepted, Vertex& vertex);
+
+    /* Appends geometry of consecutive arcs after the path start vertex, which
+    is expected to be already in shape. Returns false if some cell cannot be fetched */
+    bool PathShape(const std::vector<ArcReference>& path_arcs, std::vector<projection::Epsg3857Point>& shape);
+
+    //! Number of cell queries sent to database since creation
+    size_t QueryCount() const { return query_count_; }
+    size_t CachedCellCount() const { return cached_cells_u_map_.size(); }
+    size_t CachedByteCount() const { return cached_byte_count_; }
+
+private:
+    struct CachedCell
+    {
+        CellSPtr cell_s_ptr;
+        //! Position in lru_cell_keys_, pinned cells are taken out of it
+        std::list<uint64_t>::iterator lru_position;
+        size_t pin_count = 0;
+    };
+
+    //! Row of cell query, edge with at least one end vertex in the cell
+    struct CellEdge
+    {
+        int64_t id;
+        Vertex source;
+        Vertex target;
+        double length;
+        routing_profile::RoadClass road_class;
+        routing_profile::Oneway oneway;
+        std::vector<projection::Epsg3857Point> shape;
+    };
+
+    unsigned int cell_zoom_;
+    size_t memory_budget_;
+
+    QSqlQuery cell_query_;
+    size_t query_count_ = 0;
+
+    std::unordered_map<uint64_t, CachedCell> cached_cells_u_map_;
+    //! Most recently used cell is at the front
+    std::list<uint64_t> lru_cell_keys_;
+    size_t cached_byte_count_ = 0;
+    //! Part of cached bytes taken by pinned cells
+    size_t pinned_byte_count_ = 0;
+
+    PagedRoadGraph(const QSqlDatabase& database, const size_t memory_budget, const unsigned int cell_zoom);
+
+    bool QueryCell(const uint64_t cell_key, std::vector<CellEdge>& cell_edges);
+    CellSPtr BuildCell(const uint64_t cell_key, const std::vector<CellEdge>& cell_edges) const;
+    //! Drops least recently used cells that are not pinned until cache fits memory budget
+    void EvictCells();
+};
+
+template <typename Predicate>
+bool PagedRoadGraph::FindNearestVertex(const projection::Epsg3857Point& point, const unsigned int max_ring_count, Predicate is_accepted, Vertex& vertex)
+{
+    const auto center_tile = projection::PointTile(point, cell_zoom_);
+    const auto cell_length = projection::TileLength(cell_zoom_);
+    const auto max_index = static_cast<int64_t>((uint64_t(1) << cell_zoom_) - 1);
+
+    // Distance from point to the border of its cell bounds distance to cells of the next ring
+    const auto center_bounds = projection::TileBounds(center_tile, cell_zoom_);
+    const auto border_distance = std::min({ point.x - center_bounds.bottom_left_point.x, center_bounds.top_right_point.x - point.x,
+                                            point.y - center_bounds.bottom_left_point.y, center_bounds.top_right_point.y - point.y });
+
+    auto is_found = false;
+    auto best_squared_distance = 0.0;
+    for (unsigned int ring = 0; ring <= max_ring_count; ring++)
+    {
+        if (is_found)
+        {
+            const auto ring_distance = std::max(0.0, border_distance) + (ring - 1) * cell_length;
+            if (best_squared_distance <= ring_distance * ring_distance)
+                break;
+        }
+
+        const auto ring_size = static_cast<int64_t>(ring);
+        for (auto dy = -ring_size; dy <= ring_size; dy++)
+        {
+            for (auto dx = -ring_size; dx <= ring_size; dx++)
+            {
+                // Inner cells were searched by previous rings
+                if (std::max(std::abs(dx), std::abs(dy)) != ring_size)
+                    continue;
+
+                const auto x_index = center_tile.x_index + dx;
+                const auto y_index = center_tile.y_index + dy;
+                if (x_index < 0 || y_index < 0 || x_index > max_index || y_index > max_index)
+                    continue;
+
+                const auto cell_s_ptr = FetchCell((static_cast<uint64_t>(x_index) << 32) | static_cast<uint64_t>(y_index));
+                if (!cell_s_ptr)
+                    return false;
+
+                for (uint32_t cell_vertex = 0; cell_vertex < cell_s_ptr->VertexCount(); cell_vertex++)
+                {
+                    const auto& vertex_point = cell_s_ptr->VertexPoint(cell_vertex);
+                    const auto squared_distance = (vertex_point.x - point.x) * (vertex_point.x - point.x) + (vertex_point.y - point.y) * (vertex_point.y - point.y);
+                    if ((is_found && squared_distance >= best_squared_distance) || !is_accepted(*cell_s_ptr, cell_vertex))
+                        continue;
+
+                    is_found = true;
+                    best_squared_distance = squared_distance;
+                    vertex.id = cell_s_ptr->VertexId(cell_vertex);
+                    vertex.point = vertex_point;
+                }
+            }
+        }
+    }
+
+    return is_found;
+}
+
+#endif // PAGEDROADGRAPH_H
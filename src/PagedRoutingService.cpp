@@ -0,0 +1,152 @@
+#include "PagedRoutingService.h"
+
+#include <iostream>
+#include <algorithm>
+
+#include <QtSql/QSqlError>
+#include <QtSql/QSqlDatabase>
+
+#include "Trace.h"
+
+PagedRoutingService::PagedRoutingService(const size_t memory_budget, const size_t max_queue_size)
+    : memory_budget_(memory_budget), max_queue_size_(max_queue_size)
+{
+
+}
+
+PagedRoutingServiceUPtr PagedRoutingService::Create(const size_t memory_budget, const size_t max_queue_size)
+{
+    std::unique_ptr<PagedRoutingService> instance(new PagedRoutingService(memory_budget, std::max<size_t>(1, max_queue_size)));
+
+    auto is_ready_promise = std::promise<bool>();
+    auto is_ready_future = is_ready_promise.get_future();
+    instance->worker_thread_ = std::thread([instance = instance.get(), &is_ready_promise]() { instance->RunWorker(is_ready_promise); });
+
+    if (!is_ready_future.get())
+        return nullptr;
+
+    return instance;
+}
+
+PagedRoutingService::~PagedRoutingService()
+{
+    {
+        std::lock_guard route_task_queue_lock(route_task_queue_mutex_);
+        is_stopped_.store(true);
+    }
+
+    route_task_added_or_stop_cv_.notify_all();
+
+    if (worker_thread_.joinable())
+        worker_thread_.join();
+}
+
+bool PagedRoutingService::TrySubmit(const projection::Epsg3857Point& start_point, const projection::Epsg3857Point& end_point,
+                                    const routing_profile::Type routing_profile_type, RoutingService::RouteCallback on_routed)
+{
+    {
+        std::lock_guard route_task_queue_lock(route_task_queue_mutex_);
+        if (route_task_queue_.size() >= max_queue_size_ || is_stopped_.load())
+            return false;
+
+        route_task_queue_.push(RouteTask { start_point, end_point, routing_profile_type, std::move(on_routed) });
+    }
+
+    route_task_added_or_stop_cv_.notify_one();
+
+    return true;
+}
+
+void PagedRoutingService::RunWorker(std::promise<bool>& is_ready_promise)
+{
+    static auto connection_counter = std::atomic<int>(0);
+    const auto connection_name = QString("PagedRoutingService%1").arg(connection_counter.fetch_add(1));
+
+    {
+        // Connection belongs to this thread, so it is opened and closed here
+        auto database = QSqlDatabase::addDatabase("QPSQL", connection_name);
+        database.setHostName("localhost");
+        database.setDatabaseName("gis");
+        database.setUserName("mapper");
+        database.setPassword("");
+
+        if (database.open())
+        {
+            auto paged_road_graph_u_ptr = PagedRoadGraph::Create(database, memory_budget_);
+            is_ready_promise.set_value(paged_road_graph_u_ptr != nullptr);
+
+            if (paged_road_graph_u_ptr)
+                ServeQueue(*paged_road_graph_u_ptr);
+
+            // Prepared cell query must go before its connection
+            paged_road_graph_u_ptr.reset();
+            database.close();
+        }
+        else
+        {
+            std::cerr << "PagedRoutingService::Create Database connection error: " << database.lastError().text().toStdString() << std::endl;
+            is_ready_promise.set_value(false);
+        }
+    }
+
+    QSqlDatabase::removeDatabase(connection_name);
+}
+
+void PagedRoutingService::ServeQueue(PagedRoadGraph& paged_road_graph)
+{
+    auto search_state = paged_astar::SearchState();
+
+    for (;;)
+    {
+        std::unique_lock route_task_queue_lock(route_task_queue_mutex_);
+        route_task_added_or_stop_cv_.wait(route_task_queue_lock, [this]() {
+            return !route_task_queue_.empty() || is_stopped_.load();
+        });
+
+        if (is_stopped_.load())
+            break;
+
+        auto route_task = std::move(route_task_queue_.front());
+        route_task_queue_.pop();
+
+        route_task_queue_lock.unlock();
+
+        route_task.on_routed(FindRoute(paged_road_graph, route_task, search_state));
+    }
+}
+
+RoutingService::Route PagedRoutingService::FindRoute(PagedRoadGraph& paged_road_graph, const RouteTask& route_task, paged_astar::SearchState& search_state)
+{
+    auto route = RoutingService::Route();
+    auto start_vertex = PagedRoadGraph::Vertex();
+    auto path_arcs = std::vector<PagedRoadGraph::ArcReference>();
+
+    route.is_found = routing_profile::Dispatch(route_task.routing_profile_type, [&](const auto profile) {
+        using Profile = decltype(profile);
+
+        auto end_vertex = PagedRoadGraph::Vertex();
+        {
+            const auto snap_span = trace::Span("Snap waypoints");
+            if (!paged_astar::FindNearestAccessibleVertex<Profile>(paged_road_graph, route_task.start_point, start_vertex)
+                || !paged_astar::FindNearestAccessibleVertex<Profile>(paged_road_graph, route_task.end_point, end_vertex))
+                return false;
+        }
+
+        const auto search_span = trace::Span("Paged route search");
+        return paged_astar::Search<Profile>(paged_road_graph, start_vertex, end_vertex, search_state, route.cost, path_arcs);
+    });
+
+    if (!route.is_found)
+        return route;
+
+    const auto shape_span = trace::Span("Route shape");
+
+    route.points.push_back(route_task.start_point);
+    route.points.push_back(start_vertex.point);
+    if (!paged_road_graph.PathShape(path_arcs, route.points))
+        return RoutingService::Route();
+
+    route.points.push_back(route_task.end_point);
+
+    return route;
+}
@@ -0,0 +1,62 @@
+#ifndef PAGEDROUTINGSERVICE_H
+#define PAGEDROUTINGSERVICE_H
+
+#include <thread>
+#include <queue>
+#include <mutex>
+#include <atomic>
+#include <future>
+#include <condition_variable>
+
+#include "PagedRoadGraph.h"
+#include "PagedAStar.h"
+#include "RoutingService.h"
+
+class PagedRoutingService;
+using PagedRoutingServiceUPtr = std::unique_ptr<PagedRoutingService>;
+
+/* Answers point to point route queries from PagedRoadGraph, for maps whose
+graph does not fit in memory. Paged graph, its cell cache and database
+connection are not thread safe, so one worker thread owns all of them and
+queries run one at a time. Queue is bounded as in RoutingService */
+class PagedRoutingService
+{
+public:
+    //! Opens connection and graph in the worker thread, returns nullptr if either fails
+    static PagedRoutingServiceUPtr Create(const size_t memory_budget, const size_t max_queue_size);
+    ~PagedRoutingService();
+
+    /* Returns false without queueing if queue is full. Otherwise on_routed is
+    called with the route in the worker thread, it is not called for tasks still
+    queued when service is destroyed */
+    bool TrySubmit(const projection::Epsg3857Point& start_point, const projection::Epsg3857Point& end_point,
+                   const routing_profile::Type routing_profile_type, RoutingService::RouteCallback on_routed);
+
+private:
+    struct RouteTask
+    {
+        projection::Epsg3857Point start_point;
+        projection::Epsg3857Point end_point;
+        routing_profile::Type routing_profile_type;
+        RoutingService::RouteCallback on_routed;
+    };
+
+    size_t memory_budget_;
+    size_t max_queue_size_;
+
+    std::mutex route_task_queue_mutex_;
+    std::queue<RouteTask> route_task_queue_;
+    std::condition_variable route_task_added_or_stop_cv_;
+
+    std::atomic<bool> is_stopped_ = false;
+    std::thread worker_thread_;
+
+    PagedRoutingService(const size_t memory_budget, const size_t max_queue_size);
+
+    //! Reports through is_ready_promise whether graph was opened, then serves the queue until stopped
+    void RunWorker(std::promise<bool>& is_ready_promise);
+    void ServeQueue(PagedRoadGraph& paged_road_graph);
+    static RoutingService::Route FindRoute(PagedRoadGraph& paged_road_graph, const RouteTask& route_task, paged_astar::SearchState& search_state);
+};
+
+#endif // PAGEDROUTINGSERVICE_H
@@ -0,0 +1,161 @@
+#include "Palette.h"
+
+#include <cmath>
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace palette {
+
+//! Rec. 709 weights of red, green and blue in luma
+constexpr float kLuma[3] { 0.2126f, 0.7152f, 0.0722f };
+
+//! Night map is darker than the inverted day one, and slightly blue
+constexpr float kNightBrightness { 0.8f };
+constexpr float kNightTint[3] { 0, 4, 16 };
+
+constexpr float kHighContrastSaturation { 1.4f };
+constexpr float kHighContrast { 1.6f };
+
+//! Each row gives one output channel of red, green, blue and constant 1
+struct ColorMatrix
+{
+    float rows[3][4];
+};
+
+constexpr ColorMatrix GreyscaleMatrix()
+{
+    auto matrix = ColorMatrix();
+    for (auto row = 0; row < 3; row++)
+    {
+        for (auto column = 0; column < 3; column++)
+            matrix.rows[row][column] = kLuma[column];
+
+        matrix.rows[row][3] = 0;
+    }
+
+    return matrix;
+}
+
+/* Colour minus twice its luma plus white has luma inverted and the same chroma,
+so light land becomes dark while water stays blue and parks green */
+constexpr ColorMatrix NightMatrix()
+{
+    auto matrix = ColorMatrix();
+    for (auto row = 0; row < 3; row++)
+    {
+        for (auto column = 0; column < 3; column++)
+            matrix.rows[row][column] = kNightBrightness * ((row == column ? 1 : 0) - 2 * kLuma[column]);
+
+        matrix.rows[row][3] = kNightBrightness * 255 + kNightTint[row];
+    }
+
+    return matrix;
+}
+
+//! Saturation is raised first, then channels are stretched away from middle grey
+constexpr ColorMatrix HighContrastMatrix()
+{
+    auto matrix = ColorMatrix();
+    for (auto row = 0; row < 3; row++)
+    {
+        for (auto column = 0; column < 3; column++)
+            matrix.rows[row][column] = kHighContrast * ((1 - kHighContrastSaturation) * kLuma[column] + (row == column ? kHighContrastSaturation : 0));
+
+        matrix.rows[row][3] = 127.5f * (1 - kHighContrast);
+    }
+
+    return matrix;
+}
+
+constexpr ColorMatrix kGreyscaleMatrix = GreyscaleMatrix();
+constexpr ColorMatrix kNightMatrix = NightMatrix();
+constexpr ColorMatrix kHighContrastMatrix = HighContrastMatrix();
+
+uint32_t TransformChannel(const ColorMatrix& matrix, const int row, const float red, const float green, const float blue)
+{
+    const auto value = matrix.rows[row][0] * red + matrix.rows[row][1] * green + matrix.rows[row][2] * blue + matrix.rows[row][3];
+
+    // Rounding of lrint matches that of SIMD conversion
+    return static_cast<uint32_t>(std::lrint(std::clamp(value, 0.0f, 255.0f)));
+}
+
+void TransformPixels(const ColorMatrix& matrix, uint32_t* pixels, const size_t pixel_count)
+{
+    auto pixel = size_t(0);
+#if defined(__SSE2__)
+    // Four pixels per step, channels are split into lanes of 32-bit floats
+    __m128 coefficients[3][4];
+    for (auto row = 0; row < 3; row++)
+    {
+        for (auto column = 0; column < 4; column++)
+            coefficients[row][column] = _mm_set1_ps(matrix.rows[row][column]);
+    }
+
+    const auto channel_mask = _mm_set1_epi32(0xff);
+    const auto alpha_mask = _mm_set1_epi32(static_cast<int>(0xff000000u));
+    const auto zero = _mm_setzero_ps();
+    const auto max_value = _mm_set1_ps(255);
+
+    for (; pixel + 4 <= pixel_count; pixel += 4)
+    {
+        const auto block = reinterpret_cast<__m128i*>(pixels + pixel);
+        const auto argb = _mm_loadu_si128(block);
+
+        const auto red = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(argb, 16), channel_mask));
+        const auto green = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(argb, 8), channel_mask));
+        const auto blue = _mm_cvtepi32_ps(_mm_and_si128(argb, channel_mask));
+
+        __m128i channels[3];
+        for (auto row = 0; row < 3; row++)
+        {
+            const auto value = _mm_add_ps(_mm_add_ps(_mm_mul_ps(coefficients[row][0], red), _mm_mul_ps(coefficients[row][1], green)),
+                                          _mm_add_ps(_mm_mul_ps(coefficients[row][2], blue), coefficients[row][3]));
+            channels[row] = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(value, zero), max_value));
+        }
+
+        const auto result = _mm_or_si128(_mm_or_si128(_mm_and_si128(argb, alpha_mask), _mm_slli_epi32(channels[0], 16)),
+                                         _mm_or_si128(_mm_slli_epi32(channels[1], 8), channels[2]));
+        _mm_storeu_si128(block, result);
+    }
+#endif
+
+    for (; pixel < pixel_count; pixel++)
+    {
+        const auto argb = pixels[pixel];
+        const auto red = static_cast<float>((argb >> 16) & 0xff);
+        const auto green = static_cast<float>((argb >> 8) & 0xff);
+        const auto blue = static_cast<float>(argb & 0xff);
+
+        pixels[pixel] = (argb & 0xff000000u) | (TransformChannel(matrix, 0, red, green, blue) << 16)
+            | (TransformChannel(matrix, 1, red, green, blue) << 8) | TransformChannel(matrix, 2, red, green, blue);
+    }
+}
+
+const char* ThemeName(const Theme theme)
+{
+    switch (theme)
+    {
+    case Theme::Day: return "day";
+    case Theme::Night: return "ngt";
+    case Theme::HighContrast: return "hc";
+    case Theme::Greyscale: return "grey";
+    }
+
+    return "";
+}
+
+void ApplyTheme(const Theme theme, uint32_t* pixels, const size_t pixel_count)
+{
+    switch (theme)
+    {
+    case Theme::Day: return;
+    case Theme::Night: TransformPixels(kNightMatrix, pixels, pixel_count); return;
+    case Theme::HighContrast: TransformPixels(kHighContrastMatrix, pixels, pixel_count); return;
+    case Theme::Greyscale: TransformPixels(kGreyscaleMatrix, pixels, pixel_count); return;
+    }
+}
+
+} // namespace palette
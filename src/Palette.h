@@ -0,0 +1,31 @@
+#ifndef PALETTE_H
+#define PALETTE_H
+
+#include <cstddef>
+#include <cstdint>
+
+/* Alternative looks of rendered map derived from its pixels instead of a second
+mapnik style. Every theme is an affine map of RGB colour, one 3x4 matrix applied
+to each pixel, so it is computed with SIMD arithmetic without table lookups */
+namespace palette {
+
+enum class Theme
+{
+    Day,
+    Night,
+    HighContrast,
+    Greyscale
+};
+
+constexpr int kThemeCount { 4 };
+
+//! Short name shown on the theme button
+const char* ThemeName(const Theme theme);
+
+/* Transforms pixels of QImage::Format_ARGB32 (0xAARRGGBB, not premultiplied)
+in place, alpha is kept. Day leaves pixels as they are */
+void ApplyTheme(const Theme theme, uint32_t* pixels, const size_t pixel_count);
+
+} // namespace palette
+
+#endif // PALETTE_H
@@ -0,0 +1,194 @@
+#include "PolylineStore.h"
+
+#include <cmath>
+#include <algorithm>
+
+uint64_t ZigzagEncode(const int64_t value)
+{
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t ZigzagDecode(const uint64_t value)
+{
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+void PolylineStore::WriteVarint(uint64_t value)
+{
+    for (; value >= 0x80; value >>= 7)
+        bytes_.push_back(static_cast<uint8_t>(value | 0x80));
+
+    bytes_.push_back(static_cast<uint8_t>(value));
+}
+
+bool PolylineStore::ReadVarint(size_t& offset, const size_t end, uint64_t& value) const
+{
+    value = 0;
+    for (auto shift = 0; shift <= 63; shift += 7)
+    {
+        if (offset >= end)
+            return false;
+
+        const auto byte = bytes_[offset++];
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+
+        if (!(byte & 0x80))
+            return true;
+    }
+
+    return false;
+}
+
+uint32_t PolylineStore::Add(const std::vector<projection::Epsg3857Point>& points)
+{
+    WriteVarint(points.size());
+
+    int64_t x, y, previous_x = 0, previous_y = 0;
+    for (const auto& point : points)
+    {
+        x = std::llround(point.x / kResolution);
+        y = std::llround(point.y / kResolution);
+
+        WriteVarint(ZigzagEncode(x - previous_x));
+        WriteVarint(ZigzagEncode(y - previous_y));
+
+        previous_x = x;
+        previous_y = y;
+    }
+
+    offsets_.push_back(bytes_.size());
+
+    return static_cast<uint32_t>(Count() - 1);
+}
+
+void PolylineStore::Append(const PolylineStore& other)
+{
+    const auto byte_offset = bytes_.size();
+    bytes_.insert(bytes_.end(), other.bytes_.begin(), other.bytes_.end());
+
+    for (size_t polyline = 1; polyline < other.offsets_.size(); polyline++)
+        offsets_.push_back(byte_offset + other.offsets_[polyline]);
+}
+
+size_t PolylineStore::PointCount(const uint32_t polyline) const
+{
+    auto offset = static_cast<size_t>(offsets_[polyline]);
+    auto point_count = uint64_t(0);
+    if (!ReadVarint(offset, bytes_.size(), point_count))
+        return 0;
+
+    return point_count;
+}
+
+void PolylineStore::Decode(const uint32_t polyline, const bool is_reversed, std::vector<projection::Epsg3857Point>& points) const
+{
+    auto offset = static_cast<size_t>(offsets_[polyline]);
+    const auto end = static_cast<size_t>(offsets_[polyline + 1]);
+    auto point_count = uint64_t(0);
+    if (!ReadVarint(offset, end, point_count))
+        return;
+
+    // Every point takes at least two bytes, so count can not reserve more than the data holds
+    const auto begin = points.size();
+    points.reserve(begin + std::min<uint64_t>(point_count, (end - offset) / 2));
+
+    int64_t x = 0, y = 0;
+    uint64_t x_delta, y_delta;
+    for (uint64_t i = 0; i < point_count; i++)
+    {
+        if (!ReadVarint(offset, end, x_delta) || !ReadVarint(offset, end, y_delta))
+            break;
+
+        x += ZigzagDecode(x_delta);
+        y += ZigzagDecode(y_delta);
+
+        points.emplace_back(x * kResolution, y * kResolution);
+    }
+
+    if (is_reversed)
+        std::reverse(points.begin() + begin, points.end());
+}
+
+void PolylineStore::ShrinkToFit()
+{
+    bytes_.shrink_to_fit();
+    offsets_.shrink_to_fit();
+}
+
+bool PolylineStore::Save(std::ostream& stream) const
+{
+    const auto offset_count = static_cast<uint64_t>(offsets_.size());
+    const auto byte_count = static_cast<uint64_t>(bytes_.size());
+
+    stream.write(reinterpret_cast<const char*>(&offset_count), sizeof(offset_count));
+    stream.write(reinterpret_cast<const char*>(offsets_.data()), offsets_.size() * sizeof(uint64_t));
+    stream.write(reinterpret_cast<const char*>(&byte_count), sizeof(byte_count));
+    stream.write(reinterpret_cast<const char*>(bytes_.data()), bytes_.size());
+
+    return static_cast<bool>(stream);
+}
+
+bool PolylineStore::IsWellFormed() const
+{
+    uint64_t point_count, delta;
+    for (size_t polyline = 0; polyline < Count(); polyline++)
+    {
+        auto offset = static_cast<size_t>(offsets_[polyline]);
+        const auto end = static_cast<size_t>(offsets_[polyline + 1]);
+        if (!ReadVarint(offset, end, point_count))
+            return false;
+
+        // Loop is bounded by bytes, not by the count read from them
+        for (uint64_t value = 0; value < 2 * point_count; value++)
+        {
+            if (!ReadVarint(offset, end, delta))
+                return false;
+        }
+
+        if (offset != end)
+            return false;
+    }
+
+    return true;
+}
+
+bool PolylineStore::Load(std::istream& stream)
+{
+    // Counts come from the stream, they are checked against its size before anything is allocated
+    const auto remaining_byte_count = [&stream]() {
+        const auto position = stream.tellg();
+        stream.seekg(0, std::ios::end);
+        const auto end = stream.tellg();
+        stream.seekg(position);
+
+        return position < 0 || end < position ? uint64_t(0) : static_cast<uint64_t>(end - position);
+    };
+
+    uint64_t offset_count, byte_count;
+    if (!stream.read(reinterpret_cast<char*>(&offset_count), sizeof(offset_count)) || offset_count == 0
+        || offset_count > remaining_byte_count() / sizeof(uint64_t))
+        return false;
+
+    offsets_.resize(offset_count);
+    stream.read(reinterpret_cast<char*>(offsets_.data()), offset_count * sizeof(uint64_t));
+
+    if (!stream.read(reinterpret_cast<char*>(&byte_count), sizeof(byte_count)) || byte_count > remaining_byte_count())
+    {
+        offsets_.assign(1, 0);
+        return false;
+    }
+
+    bytes_.resize(byte_count);
+    stream.read(reinterpret_cast<char*>(bytes_.data()), byte_count);
+
+    // Offsets must grow from 0 to the end of bytes, otherwise decoding would read out of bounds
+    if (!stream || offsets_.front() != 0 || offsets_.back() != byte_count || !std::is_sorted(offsets_.begin(), offsets_.end())
+        || !IsWellFormed())
+    {
+        bytes_.clear();
+        offsets_.assign(1, 0);
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,52 @@
+#ifndef POLYLINESTORE_H
+#define POLYLINESTORE_H
+
+#include <vector>
+#include <cstdint>
+#include <iostream>
+
+#include "Projection.h"
+
+/* Compact storage of many polylines. Coordinates are rounded to kResolution,
+the first point of each polyline is stored as is and the rest as differences
+to previous point. Values are zigzag and varint encoded, so neighbouring road
+points typically take 2-4 bytes instead of 16. Polylines are decoded on demand */
+class PolylineStore
+{
+public:
+    //! Size of coordinate quantization step in EPSG:3857 units
+    static constexpr double kResolution = 0.01;
+
+    //! Appends polyline and returns its index
+    uint32_t Add(const std::vector<projection::Epsg3857Point>& points);
+    //! Appends all polylines of other store, so parts encoded in parallel can be joined
+    void Append(const PolylineStore& other);
+
+    size_t Count() const { return offsets_.size() - 1; }
+    size_t PointCount(const uint32_t polyline) const;
+    //! Encoded size in bytes, without offsets
+    size_t ByteCount() const { return bytes_.size(); }
+
+    //! Appends decoded points of polyline to points, in reverse order if is_reversed
+    void Decode(const uint32_t polyline, const bool is_reversed, std::vector<projection::Epsg3857Point>& points) const;
+
+    //! Releases memory reserved for adding
+    void ShrinkToFit();
+
+    //! Writes encoded data as is, Load reads it back without re-encoding
+    bool Save(std::ostream& stream) const;
+    bool Load(std::istream& stream);
+
+private:
+    std::vector<uint8_t> bytes_;
+    //! Polyline i takes bytes_[offsets_[i], offsets_[i + 1]) and starts with point count
+    std::vector<uint64_t> offsets_ = { 0 };
+
+    void WriteVarint(uint64_t value);
+    //! Returns false if varint runs past end or does not fit 64 bits
+    bool ReadVarint(size_t& offset, const size_t end, uint64_t& value) const;
+    //! Whether every polyline decodes to exactly its byte range, checked by Load
+    bool IsWellFormed() const;
+};
+
+#endif // POLYLINESTORE_H
@@ -2,20 +2,164 @@
 
 #include <iostream>
 #include <cmath>
+#include <algorithm>
+#include <array>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include <proj.h>
 
+//! Sphere radius of EPSG:3857
+constexpr double kEpsg3857Radius { 6378137 };
+constexpr double kDegreesToRadians { M_PI / 180 };
+
+/* PROJ objects are not thread safe and expensive to create, so every thread
+keeps its own context and transformation for the whole lifetime */
+class ProjTransformation
+{
+public:
+    ProjTransformation()
+        : context_(proj_context_create())
+    {
+        const auto crs_to_crs = proj_create_crs_to_crs(context_, "EPSG:4326", "EPSG:3857", nullptr);
+        if (!crs_to_crs)
+            return;
+
+        // EPSG:4326 axis order is latitude first, normalization makes it longitude first as Epsg4326Point is
+        transformation_ = proj_normalize_for_visualization(context_, crs_to_crs);
+        proj_destroy(crs_to_crs);
+    }
+
+    ~ProjTransformation()
+    {
+        if (transformation_)
+            proj_destroy(transformation_);
+
+        proj_context_destroy(context_);
+    }
+
+    ProjTransformation(const ProjTransformation&) = delete;
+    ProjTransformation& operator=(const ProjTransformation&) = delete;
+
+    PJ* Get() const { return transformation_; }
+
+private:
+    PJ_CONTEXT* context_;
+    PJ* transformation_ = nullptr;
+};
+
+PJ* ThreadProjTransformation()
+{
+    thread_local auto proj_transformation = ProjTransformation();
+    return proj_transformation.Get();
+}
+
+#if defined(__SSE2__)
+
+//! Number of Taylor terms of sin and of atanh series in logarithm
+constexpr int kSeriesTermCount { 12 };
+
+//! Coefficient of x^(2k+1) in sin series is (-1)^k / (2k+1)!
+constexpr std::array<double, kSeriesTermCount> SinSeriesCoefficients()
+{
+    auto coefficients = std::array<double, kSeriesTermCount>();
+    auto factorial = 1.0;
+    for (auto k = 0; k < kSeriesTermCount; k++)
+    {
+        coefficients[k] = (k % 2 ? -1.0 : 1.0) / factorial;
+        factorial *= (2 * k + 2) * (2 * k + 3);
+    }
+
+    return coefficients;
+}
+
+constexpr auto kSinSeriesCoefficients = SinSeriesCoefficients();
+
+//! Coefficient of t^(2k+1) in atanh series is 1 / (2k+1)
+constexpr std::array<double, kSeriesTermCount> AtanhSeriesCoefficients()
+{
+    auto coefficients = std::array<double, kSeriesTermCount>();
+    for (auto k = 0; k < kSeriesTermCount; k++)
+        coefficients[k] = 1.0 / (2 * k + 1);
+
+    return coefficients;
+}
+
+constexpr auto kAtanhSeriesCoefficients = AtanhSeriesCoefficients();
+
+/* Polynomial of kSeriesTermCount coefficients in y by Estrin scheme. Pairs
+of terms are independent, which keeps the dependency chain 4 levels deep
+instead of 12 in Horner scheme */
+__m128d EvaluateSeries(const double* coefficients, const __m128d y)
+{
+    static_assert(kSeriesTermCount == 12, "Estrin scheme below is written for 12 terms");
+
+    const auto term_pair = [&](const int k) {
+        return _mm_add_pd(_mm_set1_pd(coefficients[k]), _mm_mul_pd(_mm_set1_pd(coefficients[k + 1]), y));
+    };
+
+    const auto y2 = _mm_mul_pd(y, y);
+    const auto y4 = _mm_mul_pd(y2, y2);
+
+    const auto low = _mm_add_pd(term_pair(0), _mm_mul_pd(y2, term_pair(2)));
+    const auto middle = _mm_add_pd(term_pair(4), _mm_mul_pd(y2, term_pair(6)));
+    const auto high = _mm_add_pd(term_pair(8), _mm_mul_pd(y2, term_pair(10)));
+
+    return _mm_add_pd(low, _mm_mul_pd(y4, _mm_add_pd(middle, _mm_mul_pd(y4, high))));
+}
+
+/* sin(x) for |x| <= pi / 2 by Taylor series up to x^23, truncation error is
+below 1e-20, so result is as exact as double allows without range reduction */
+__m128d SinHalfPi(const __m128d x)
+{
+    return _mm_mul_pd(EvaluateSeries(kSinSeriesCoefficients.data(), _mm_mul_pd(x, x)), x);
+}
+
+/* Natural logarithm of positive normal numbers. Splits q = m * 2^e with m in
+[sqrt(1/2), sqrt(2)), then ln(m) = 2 atanh(t), t = (m - 1) / (m + 1), |t| < 0.172,
+series up to t^23 leaves error below 1e-18 */
+__m128d LogPositive(const __m128d q)
+{
+    const auto bits = _mm_castpd_si128(q);
+
+    // Exponent field placed in mantissa of 2^52 gives 2^52 + field exactly
+    const auto exponent_field = _mm_srli_epi64(bits, 52);
+    const auto magic = _mm_set1_epi64x(0x4330000000000000);
+    auto exponent = _mm_sub_pd(_mm_castsi128_pd(_mm_or_si128(exponent_field, magic)), _mm_set1_pd(4503599627370496.0 + 1023));
+
+    const auto mantissa_bits = _mm_and_si128(bits, _mm_set1_epi64x(0x000FFFFFFFFFFFFF));
+    auto mantissa = _mm_castsi128_pd(_mm_or_si128(mantissa_bits, _mm_set1_epi64x(0x3FF0000000000000)));
+
+    // Mantissa is in [1, 2), values above sqrt(2) are halved to keep t small
+    const auto is_large = _mm_cmpgt_pd(mantissa, _mm_set1_pd(M_SQRT2));
+    mantissa = _mm_or_pd(_mm_and_pd(is_large, _mm_mul_pd(mantissa, _mm_set1_pd(0.5))), _mm_andnot_pd(is_large, mantissa));
+    exponent = _mm_add_pd(exponent, _mm_and_pd(is_large, _mm_set1_pd(1.0)));
+
+    const auto one = _mm_set1_pd(1.0);
+    const auto t = _mm_div_pd(_mm_sub_pd(mantissa, one), _mm_add_pd(mantissa, one));
+    const auto t2 = _mm_mul_pd(t, t);
+    const auto log_mantissa = _mm_mul_pd(_mm_mul_pd(EvaluateSeries(kAtanhSeriesCoefficients.data(), t2), t), _mm_set1_pd(2.0));
+    return _mm_add_pd(_mm_mul_pd(exponent, _mm_set1_pd(M_LN2)), log_mantissa);
+}
+
+#endif
+
 namespace projection {
 
 bool Transform(const Epsg4326Point& epsg_4326_point, Epsg3857Point& epsg_3857_point)
 {
-    const auto projection_params = proj_create_crs_to_crs(nullptr, "EPSG:4326", "EPSG:3857", nullptr);
+    const auto transformation = ThreadProjTransformation();
+    if (!transformation)
+    {
+        std::cerr << "Projection::Transform Failed to create transformation" << std::endl;
+        return false;
+    }
 
     const auto input_coords = proj_coord(epsg_4326_point.longitude, epsg_4326_point.latitude, 0, 0);
 
-    const auto output_coords = proj_trans(projection_params, PJ_DIRECTION::PJ_FWD, input_coords);
-
-    proj_destroy(projection_params);
+    const auto output_coords = proj_trans(transformation, PJ_DIRECTION::PJ_FWD, input_coords);
 
     if (std::isinf(output_coords.xy.x) || std::isinf(output_coords.xy.y))
     {
@@ -32,4 +176,154 @@ bool Transform(const Epsg4326Point& epsg_4326_point, Epsg3857Point& epsg_3857_po
     return true;
 }
 
+bool Transform(const std::vector<Epsg4326Point>& epsg_4326_points, std::vector<Epsg3857Point>& epsg_3857_points)
+{
+    const auto transformation = ThreadProjTransformation();
+    if (!transformation)
+    {
+        std::cerr << "Projection::Transform Failed to create transformation" << std::endl;
+        return false;
+    }
+
+    epsg_3857_points.resize(epsg_4326_points.size());
+    for (size_t i = 0; i < epsg_4326_points.size(); i++)
+        epsg_3857_points[i] = Epsg3857Point(epsg_4326_points[i].longitude, epsg_4326_points[i].latitude);
+
+    if (epsg_3857_points.empty())
+        return true;
+
+    // Points are transformed in place by one call over strided x and y arrays
+    const auto count = epsg_3857_points.size();
+    proj_trans_generic(transformation, PJ_DIRECTION::PJ_FWD,
+                       &epsg_3857_points[0].x, sizeof(Epsg3857Point), count,
+                       &epsg_3857_points[0].y, sizeof(Epsg3857Point), count,
+                       nullptr, 0, 0,
+                       nullptr, 0, 0);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (std::isinf(epsg_3857_points[i].x) || std::isinf(epsg_3857_points[i].y))
+        {
+            std::cerr << "Projection::Transform Error when projecting longitude: "
+                      << epsg_4326_points[i].longitude << " latitude: "
+                      << epsg_4326_points[i].latitude << std::endl;
+
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool ToEpsg3857(const Epsg4326Point& epsg_4326_point, Epsg3857Point& epsg_3857_point)
+{
+    if (!(std::abs(epsg_4326_point.latitude) < 90))
+    {
+        std::cerr << "Projection::ToEpsg3857 Latitude out of range: " << epsg_4326_point.latitude << std::endl;
+        return false;
+    }
+
+    // y = R * atanh(sin(latitude)) is the same as R * ln(tan(pi / 4 + latitude / 2))
+    epsg_3857_point.x = kEpsg3857Radius * epsg_4326_point.longitude * kDegreesToRadians;
+    epsg_3857_point.y = kEpsg3857Radius * std::atanh(std::sin(epsg_4326_point.latitude * kDegreesToRadians));
+
+    return true;
+}
+
+bool ToEpsg3857(const std::vector<Epsg4326Point>& epsg_4326_points, std::vector<Epsg3857Point>& epsg_3857_points)
+{
+    const auto count = epsg_4326_points.size();
+    epsg_3857_points.resize(count);
+
+    size_t i = 0;
+#if defined(__SSE2__)
+    const auto scale = _mm_set1_pd(kEpsg3857Radius * kDegreesToRadians);
+    const auto to_radians = _mm_set1_pd(kDegreesToRadians);
+    const auto one = _mm_set1_pd(1.0);
+    const auto half_radius = _mm_set1_pd(kEpsg3857Radius / 2);
+    const auto max_latitude = _mm_set1_pd(90.0);
+    const auto sign_mask = _mm_set1_pd(-0.0);
+
+    auto is_invalid = _mm_setzero_pd();
+    for (; i + 2 <= count; i += 2)
+    {
+        // Both structs are two doubles, one load brings longitude and latitude of one point
+        const auto first = _mm_loadu_pd(&epsg_4326_points[i].longitude);
+        const auto second = _mm_loadu_pd(&epsg_4326_points[i + 1].longitude);
+        const auto longitudes = _mm_unpacklo_pd(first, second);
+        const auto latitudes = _mm_unpackhi_pd(first, second);
+
+        // Not less than 90 also catches NaN
+        is_invalid = _mm_or_pd(is_invalid, _mm_cmpnlt_pd(_mm_andnot_pd(sign_mask, latitudes), max_latitude));
+
+        // atanh(s) = ln((1 + s) / (1 - s)) / 2
+        const auto sines = SinHalfPi(_mm_mul_pd(latitudes, to_radians));
+        const auto ratios = _mm_div_pd(_mm_add_pd(one, sines), _mm_sub_pd(one, sines));
+
+        const auto xs = _mm_mul_pd(longitudes, scale);
+        const auto ys = _mm_mul_pd(LogPositive(ratios), half_radius);
+
+        _mm_storeu_pd(&epsg_3857_points[i].x, _mm_unpacklo_pd(xs, ys));
+        _mm_storeu_pd(&epsg_3857_points[i + 1].x, _mm_unpackhi_pd(xs, ys));
+    }
+
+    // Invalid lanes are reported by the scalar version below
+    if (_mm_movemask_pd(is_invalid))
+        i = 0;
+#endif
+
+    for (; i < count; i++)
+    {
+        if (!ToEpsg3857(epsg_4326_points[i], epsg_3857_points[i]))
+            return false;
+    }
+
+    return true;
+}
+
+void ToEpsg4326(const Epsg3857Point& epsg_3857_point, Epsg4326Point& epsg_4326_point)
+{
+    epsg_4326_point.longitude = epsg_3857_point.x / kEpsg3857Radius / kDegreesToRadians;
+    epsg_4326_point.latitude = std::atan(std::sinh(epsg_3857_point.y / kEpsg3857Radius)) / kDegreesToRadians;
+}
+
+void ToEpsg4326(const std::vector<Epsg3857Point>& epsg_3857_points, std::vector<Epsg4326Point>& epsg_4326_points)
+{
+    epsg_4326_points.resize(epsg_3857_points.size());
+    for (size_t i = 0; i < epsg_3857_points.size(); i++)
+        ToEpsg4326(epsg_3857_points[i], epsg_4326_points[i]);
+}
+
+double Epsg3857Scale(const double y)
+{
+    // cos(atan(sinh(v))) is 1 / cosh(v)
+    return std::cosh(y / kEpsg3857Radius);
+}
+
+double TileLength(const unsigned int zoom)
+{
+    return 2 * kEpsg3857Bound / std::ldexp(1.0, zoom);
+}
+
+map::Tile PointTile(const Epsg3857Point& point, const unsigned int zoom)
+{
+    const auto tile_length = TileLength(zoom);
+    const auto max_index = std::ldexp(1.0, zoom) - 1;
+
+    const auto x_index = std::clamp(std::floor((point.x + kEpsg3857Bound) / tile_length), 0.0, max_index);
+    const auto y_index = std::clamp(std::floor((point.y + kEpsg3857Bound) / tile_length), 0.0, max_index);
+
+    return map::Tile(static_cast<unsigned int>(x_index), static_cast<unsigned int>(y_index));
+}
+
+Epsg3857Rect TileBounds(const map::Tile& tile, const unsigned int zoom)
+{
+    const auto tile_length = TileLength(zoom);
+
+    const auto x_min = -kEpsg3857Bound + tile.x_index * tile_length;
+    const auto y_min = -kEpsg3857Bound + tile.y_index * tile_length;
+
+    return Epsg3857Rect(x_min, y_min, x_min + tile_length, y_min + tile_length);
+}
+
 } // namespace projection
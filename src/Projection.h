@@ -2,6 +2,9 @@
 #define PROJECTION_H
 
 #include <memory>
+#include <vector>
+
+#include "Map.h"
 
 namespace projection {
 
@@ -58,8 +61,37 @@ struct Epsg4326Point
     double latitude;
 };
 
-//! Turns coordinates from EPSG:4326 (longitude/latitude) to EPSG:3857 (meters)
+//! Half of the world width in EPSG:3857, map covers [-bound, bound] along both axes
+constexpr double kEpsg3857Bound { 20037508.342789244 };
+//! Latitude where EPSG:3857 square map ends
+constexpr double kEpsg3857MaxLatitude { 85.05112877980659 };
+
+/* Turns coordinates from EPSG:4326 (longitude/latitude) to EPSG:3857 (meters)
+with PROJ. Transformation object is created once per thread and reused */
 bool Transform(const Epsg4326Point& epsg_4326_point, Epsg3857Point& epsg_3857_point);
+//! Batch version, in case of error for any point returns false
+bool Transform(const std::vector<Epsg4326Point>& epsg_4326_points, std::vector<Epsg3857Point>& epsg_3857_points);
+
+/* Closed form spherical Mercator, which is how EPSG:3857 is defined, so it
+gives the same result as PROJ within micrometers. Batch version processes
+several points per SIMD instruction. Returns false for latitudes at poles */
+bool ToEpsg3857(const Epsg4326Point& epsg_4326_point, Epsg3857Point& epsg_3857_point);
+bool ToEpsg3857(const std::vector<Epsg4326Point>& epsg_4326_points, std::vector<Epsg3857Point>& epsg_3857_points);
+
+//! Inverse of spherical Mercator
+void ToEpsg4326(const Epsg3857Point& epsg_3857_point, Epsg4326Point& epsg_4326_point);
+void ToEpsg4326(const std::vector<Epsg3857Point>& epsg_3857_points, std::vector<Epsg4326Point>& epsg_4326_points);
+
+/* EPSG:3857 units per meter on the ground at y, 1 / cos(latitude). Mercator
+stretches distances, at 50 degrees of latitude 100 m are 156 units */
+double Epsg3857Scale(const double y);
+
+/* Tiles of zoom split the map into 2^zoom x 2^zoom squares, tile (0, 0) is
+in the bottom left corner, so y index grows to the north */
+double TileLength(const unsigned int zoom);
+//! Tile containing point, points outside of map go to border tiles
+map::Tile PointTile(const Epsg3857Point& point, const unsigned int zoom);
+Epsg3857Rect TileBounds(const map::Tile& tile, const unsigned int zoom);
 
 } // namespace projection
 
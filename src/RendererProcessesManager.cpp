@@ -5,9 +5,17 @@
 
 #include <QVariant>
 #include <QPixmap>
+#include <QImage>
+
+#include "Trace.h"
+
+//! Size of images made by renderer processes
+constexpr int kTileSize { 256 };
+//! Distinct non uniform tiles kept for reuse, about 256 KB each
+constexpr size_t kTileCacheCapacity { 128 };
 
 RendererProcessesManager::RendererProcessesManager(QObject* parent)
-    : QObject(parent)
+    : QObject(parent), tile_cache_(kTileSize, kTileCacheCapacity), themed_tile_cache_(kTileSize, kTileCacheCapacity)
 {
 
 }
@@ -25,128 +33,138 @@ RendererProcessesManagerUPtr RendererProcessesManager::Create(const unsigned int
         instance->free_process_pool_.emplace(std::move(process));
     }
 
-    instance->rendering_task_queue_manager_thread_ = std::thread([instance = instance.get()]() { instance->StartManagingRenderingTaskQueue(); });
-
     return instance;
 }
 
-RendererProcessesManager::~RendererProcessesManager()
+void RendererProcessesManager::SendDataToRendererProcess(const RenderingTaskUPtr rendering_task, QProcess* process)
 {
-    rendering_task_queue_manager_thread_stop_.store(true);
-    rendering_task_added_or_thread_stop_cv_.notify_one();
-    process_released_or_thread_stop_cv_.notify_one();
+    const auto dispatch_span = trace::Span("Dispatch tile", rendering_task->task_id);
 
-    if (rendering_task_queue_manager_thread_.joinable())
-        rendering_task_queue_manager_thread_.join();
-}
-
-void RendererProcessesManager::SendDataToRendererProcess(const RenderingTaskUPtr rendering_task)
-{
-    auto process = AcquireProcess();
-    if (!process)
-        return;
-
-    const auto write_to_process = [&, this](const auto& value) {
-        process->write(QByteArray::number(value));
-        process->write("\n");
+    auto data = QByteArray();
+    const auto append_value = [&](const auto& value) {
+        data.append(QByteArray::number(value));
+        data.append('\n');
     };
 
-    write_to_process(rendering_task->epsg_3857_rect.bottom_left_point.x);
-    write_to_process(rendering_task->epsg_3857_rect.bottom_left_point.y);
-    write_to_process(rendering_task->epsg_3857_rect.top_right_point.x);
-    write_to_process(rendering_task->epsg_3857_rect.top_right_point.y);
+    append_value(rendering_task->epsg_3857_rect.bottom_left_point.x);
+    append_value(rendering_task->epsg_3857_rect.bottom_left_point.y);
+    append_value(rendering_task->epsg_3857_rect.top_right_point.x);
+    append_value(rendering_task->epsg_3857_rect.top_right_point.y);
+
+    append_value(rendering_task->tile.x_index);
+    append_value(rendering_task->tile.y_index);
 
-    write_to_process(rendering_task->tile.x_index);
-    write_to_process(rendering_task->tile.y_index);
+    append_value(rendering_task->zoom);
 
-    write_to_process(rendering_task->zoom);
+    append_value(rendering_task->task_id);
 
-    process->waitForBytesWritten();
+    // Whole task goes in one write, the rest is sent by event loop when pipe is full
+    process->write(data);
 }
 
 void RendererProcessesManager::OnRenderingFinish()
 {
     const auto process = qobject_cast<QProcess*>(sender());
 
-    const auto pixmap = std::make_shared<QPixmap>();
-    pixmap->load(QString("renderer/renderer_process%1_output.png")
-                     .arg(process->property("process_index").toString()));
+    // Reply is one line, the signal may come before all of it arrived
+    if (!process->canReadLine())
+        return;
 
-    const auto byte_array = process->readAllStandardOutput();
-    auto string_stream = std::istringstream(byte_array.toStdString());
+    auto string_stream = std::istringstream(process->readLine().toStdString());
 
     unsigned int x_index, y_index, zoom;
-    string_stream >> x_index >> y_index >> zoom;
+    uint64_t task_id, hash;
+    bool is_uniform;
+    uint32_t color;
+    string_stream >> x_index >> y_index >> zoom >> task_id >> hash >> is_uniform >> color;
 
-    const auto tile = map::Tile(map::Tile(x_index, y_index));
+    // Renderer sends only color of uniform tile, image of tile seen before is not decoded again
+    const auto pixmap = std::make_shared<QPixmap>();
+    if (is_uniform)
+    {
+        *pixmap = tile_cache_.UniformPixmap(color);
+    }
+    else if (!tile_cache_.FindImage(hash, *pixmap))
+    {
+        const auto load_span = trace::Span("Load image", task_id);
+        pixmap->load(QString("renderer/renderer_process%1_output.png")
+                         .arg(process->property("process_index").toString()));
 
-    emit ImageRendered(pixmap, tile, zoom);
+        if (!pixmap->isNull())
+            tile_cache_.InsertImage(hash, *pixmap);
+    }
 
-    ReleaseProcess(process);
+    // Process gets the next task before the image is shown, so it renders meanwhile
+    free_process_pool_.emplace(process);
+    DispatchRenderingTasks();
+
+    const auto tile = map::Tile(map::Tile(x_index, y_index));
+
+    {
+        // Receivers are in this thread, so the span covers adding tile to the scene
+        const auto insert_span = trace::Span("Insert tile", task_id);
+        emit ImageRendered(pixmap, tile, zoom);
+    }
 }
 
 void RendererProcessesManager::AddRenderingTask(const projection::Epsg3857Rect& epsg_3857_rect, const map::Tile& tile, const unsigned int zoom)
 {
-    std::lock_guard rendering_task_queue_lock(rendering_task_queue_mutex_);
-    rendering_task_queue_.push(std::make_unique<RenderingTask>(epsg_3857_rect, tile, zoom));
+    const auto task_id = ++last_task_id_;
+    {
+        const auto enqueue_span = trace::Span("Enqueue tile", task_id);
+        rendering_task_queue_.push(std::make_unique<RenderingTask>(task_id, epsg_3857_rect, tile, zoom));
+    }
 
-    rendering_task_added_or_thread_stop_cv_.notify_one();
+    DispatchRenderingTasks();
 }
 
 void RendererProcessesManager::ClearRenderingTasks()
 {
-    std::lock_guard rendering_task_queue_lock(rendering_task_queue_mutex_);
     for (; !rendering_task_queue_.empty();)
         rendering_task_queue_.pop();
 }
 
-void RendererProcessesManager::StartManagingRenderingTaskQueue()
+void RendererProcessesManager::SetTheme(const palette::Theme theme)
 {
-    for (; !rendering_task_queue_manager_thread_stop_.load();)
-    {
-        std::unique_lock rendering_task_queue_lock(rendering_task_queue_mutex_);
-        rendering_task_added_or_thread_stop_cv_.wait(rendering_task_queue_lock, [this]() {
-            return !rendering_task_queue_.empty() || rendering_task_queue_manager_thread_stop_.load();
-        });
-
-        if (rendering_task_queue_manager_thread_stop_.load())
-            break;
-
-        auto rendering_task = std::move(rendering_task_queue_.front());
-        rendering_task_queue_.pop();
-
-        rendering_task_queue_lock.unlock();
-        rendering_task_queue_lock.release();
-
-        SendDataToRendererProcess(std::move(rendering_task));
-    }
-
-    ClearRenderingTasks();
+    theme_ = theme;
 }
 
-QProcess* RendererProcessesManager::AcquireProcess()
+QPixmap RendererProcessesManager::ThemedPixmap(const QPixmap& pixmap)
 {
-    std::unique_lock<std::mutex> free_process_pool_lock(free_process_pool_mutex_);
+    if (theme_ == palette::Theme::Day || pixmap.isNull())
+        return pixmap;
 
-    process_released_or_thread_stop_cv_.wait(free_process_pool_lock, [this]() {
-        return !free_process_pool_.empty() || rendering_task_queue_manager_thread_stop_.load();
-    });
+    // Equal tiles share one pixmap from tile cache, so its cache key stands for content
+    const auto themed_key = static_cast<uint64_t>(pixmap.cacheKey()) * palette::kThemeCount + static_cast<uint64_t>(theme_);
 
-    if (rendering_task_queue_manager_thread_stop_.load())
-        return nullptr;
+    auto themed_pixmap = QPixmap();
+    if (themed_tile_cache_.FindImage(themed_key, themed_pixmap))
+        return themed_pixmap;
 
-    const auto process = free_process_pool_.front();
-    free_process_pool_.pop();
+    const auto theme_span = trace::Span("Theme tile");
 
-    return process;
+    auto image = pixmap.toImage().convertToFormat(QImage::Format_ARGB32);
+    for (auto y = 0; y < image.height(); y++)
+        palette::ApplyTheme(theme_, reinterpret_cast<uint32_t*>(image.scanLine(y)), image.width());
+
+    themed_pixmap = QPixmap::fromImage(image);
+    themed_tile_cache_.InsertImage(themed_key, themed_pixmap);
+
+    return themed_pixmap;
 }
 
-void RendererProcessesManager::ReleaseProcess(QProcess* process)
+void RendererProcessesManager::DispatchRenderingTasks()
 {
-    std::lock_guard<std::mutex> lock(free_process_pool_mutex_);
-    free_process_pool_.emplace(process);
+    for (; !rendering_task_queue_.empty() && !free_process_pool_.empty();)
+    {
+        auto rendering_task = std::move(rendering_task_queue_.front());
+        rendering_task_queue_.pop();
 
-    process_released_or_thread_stop_cv_.notify_one();
+        const auto process = free_process_pool_.front();
+        free_process_pool_.pop();
+
+        SendDataToRendererProcess(std::move(rendering_task), process);
+    }
 }
 
 QProcess* RendererProcessesManager::CreateProcess(const unsigned int process_index, RendererProcessesManager* instance)
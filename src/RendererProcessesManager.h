@@ -1,15 +1,15 @@
 #ifndef RENDERERPROCESSESMANAGER_H
 #define RENDERERPROCESSESMANAGER_H
 
-#include <thread>
 #include <queue>
-#include <mutex>
-#include <condition_variable>
+#include <memory>
 
 #include <QProcess>
 
 #include "Projection.h"
 #include "Map.h"
+#include "TileCache.h"
+#include "Palette.h"
 
 class RendererProcessesManager;
 using RendererProcessesManagerUPtr = std::unique_ptr<RendererProcessesManager>;
@@ -18,20 +18,26 @@ using RendererProcessesManagerUPtr = std::unique_ptr<RendererProcessesManager>;
 We cannot use multithreading in one application because library used for
 rendering (mapnik) can use only one connection to database simultaneously.
 Which leads to errors when using multiple threads for rendering in one
-process */
+process. Everything runs in the thread owning the processes: tasks are written
+to every idle process as soon as they are added or a process finishes, writes
+are buffered by QProcess and sent by the event loop without blocking */
 class RendererProcessesManager : public QObject
 {
     Q_OBJECT
 
 public:
     static RendererProcessesManagerUPtr Create(const unsigned int process_count, QObject* parent = nullptr);
-    ~RendererProcessesManager();
 
     //! Adds rendering task in queue. After rendering completion ImageRendered signal will be emitted
     void AddRenderingTask(const projection::Epsg3857Rect& epsg_3857_rect, const map::Tile& tile, const unsigned int zoom);
     //! Clears the queue of rendering tasks, does not stop those that are already running
     void ClearRenderingTasks();
 
+    //! Theme of pixmaps given by ThemedPixmap, tiles are not rendered again when it changes
+    void SetTheme(const palette::Theme theme);
+    //! Rendered pixmap transformed to current theme, transformed ones are cached by source pixmap and theme
+    QPixmap ThemedPixmap(const QPixmap& pixmap);
+
 signals:
     void ImageRendered(std::shared_ptr<QPixmap> pixmap, const map::Tile& tile, const unsigned int zoom);
 
@@ -41,12 +47,14 @@ public slots:
 private:
     struct RenderingTask
     {
-        RenderingTask(const projection::Epsg3857Rect& epsg_3857_rect, const map::Tile& tile, const unsigned int zoom)
-            : epsg_3857_rect(epsg_3857_rect), tile(tile), zoom(zoom)
+        RenderingTask(const uint64_t task_id, const projection::Epsg3857Rect& epsg_3857_rect, const map::Tile& tile, const unsigned int zoom)
+            : task_id(task_id), epsg_3857_rect(epsg_3857_rect), tile(tile), zoom(zoom)
         {
 
         }
 
+        //! Passed to renderer process and back, correlates trace spans of the task
+        uint64_t task_id;
         projection::Epsg3857Rect epsg_3857_rect;
         map::Tile tile;
         unsigned int zoom;
@@ -54,26 +62,24 @@ private:
 
     using RenderingTaskUPtr = std::unique_ptr<RenderingTask>;
 
-    std::mutex rendering_task_queue_mutex_;
     std::queue<RenderingTaskUPtr> rendering_task_queue_;
-    std::condition_variable rendering_task_added_or_thread_stop_cv_;
-
-    std::atomic<bool> rendering_task_queue_manager_thread_stop_ = false;
-    std::thread rendering_task_queue_manager_thread_;
+    uint64_t last_task_id_ = 0;
 
-    std::mutex free_process_pool_mutex_;
+    //! Processes without task, each process renders one task at a time as its output file is reused
     std::queue<QProcess*> free_process_pool_;
-    std::condition_variable process_released_or_thread_stop_cv_;
+
+    TileCache tile_cache_;
+
+    palette::Theme theme_ = palette::Theme::Day;
+    TileCache themed_tile_cache_;
 
     RendererProcessesManager(QObject* parent = nullptr);
 
-    void StartManagingRenderingTaskQueue();
-    void SendDataToRendererProcess(const RenderingTaskUPtr rendering_task);
+    //! Hands queued tasks to free processes until either runs out
+    void DispatchRenderingTasks();
+    void SendDataToRendererProcess(const RenderingTaskUPtr rendering_task, QProcess* process);
 
     static QProcess* CreateProcess(const unsigned int process_index, RendererProcessesManager* instance);
-
-    QProcess* AcquireProcess();
-    void ReleaseProcess(QProcess* process);
 };
 
 #endif // RENDERERPROCESSESMANAGER_H
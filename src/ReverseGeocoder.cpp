@@ -0,0 +1,463 @@
+#include "ReverseGeocoder.h"
+
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <cmath>
+
+#include <QtSql/QSqlQuery>
+#include <QtSql/QSqlError>
+#include <QVariant>
+
+#include "Wkb.h"
+
+//! Address or street farther than this many meters on the ground from the point is not reported
+constexpr double kMaxAddressDistance { 100 };
+constexpr double kMaxStreetDistance { 250 };
+//! Average number of boundary edges per band of area
+constexpr size_t kAreaEdgesPerBand { 8 };
+//! Points of batch taken by a thread at once, neighbouring trace points stay together
+constexpr size_t kLookupChunkSize { 256 };
+
+ReverseGeocoder::ReverseGeocoder()
+{
+
+}
+
+ReverseGeocoderUPtr ReverseGeocoder::Create(const QSqlDatabase& database, const std::atomic<bool>& is_cancelled)
+{
+    std::unique_ptr<ReverseGeocoder> instance(new ReverseGeocoder());
+
+    // Each loader stops early and fails when loading is cancelled
+    auto street_indices_u_map = std::unordered_map<std::string, uint32_t>();
+    if (!instance->LoadStreets(database, is_cancelled, street_indices_u_map) || !instance->LoadAddresses(database, is_cancelled, street_indices_u_map) ||
+        !instance->LoadAreas(database, is_cancelled))
+        return nullptr;
+
+    auto boxes = std::vector<PackedRTree::Box>();
+    boxes.reserve(instance->address_points_.size());
+    for (const auto& point : instance->address_points_)
+        boxes.emplace_back(point.x, point.y, point.x, point.y);
+
+    instance->address_tree_.Build(boxes);
+
+    boxes.clear();
+    for (size_t segment = 0; segment < instance->segment_starts_.size(); segment++)
+    {
+        const auto& start = instance->segment_starts_[segment];
+        const auto& end = instance->segment_ends_[segment];
+        boxes.emplace_back(std::min(start.x, end.x), std::min(start.y, end.y), std::max(start.x, end.x), std::max(start.y, end.y));
+    }
+
+    instance->segment_tree_.Build(boxes);
+    instance->area_tree_.Build(instance->area_boxes_);
+
+    return instance;
+}
+
+/* Database connection has unique name and is removed after loading, like the
+one used for routing data */
+ReverseGeocoderUPtr ReverseGeocoder::CreateFromEnvironment(const std::atomic<bool>& is_cancelled)
+{
+    auto reverse_geocoder_u_ptr = ReverseGeocoderUPtr();
+    {
+        auto database = QSqlDatabase::addDatabase("QPSQL", "ReverseGeocoder");
+        database.setHostName("localhost");
+        database.setDatabaseName("gis");
+        database.setUserName("mapper");
+        database.setPassword("");
+
+        if (database.open())
+        {
+            reverse_geocoder_u_ptr = Create(database, is_cancelled);
+            database.close();
+        }
+        else
+        {
+            std::cerr << "ReverseGeocoder::CreateFromEnvironment Database connection error: " << database.lastError().text().toStdString() << std::endl;
+        }
+    }
+
+    QSqlDatabase::removeDatabase("ReverseGeocoder");
+
+    return reverse_geocoder_u_ptr;
+}
+
+uint32_t ReverseGeocoder::AddStreetName(const std::string& name, std::unordered_map<std::string, uint32_t>& street_indices_u_map)
+{
+    const auto [it, is_inserted] = street_indices_u_map.emplace(name, static_cast<uint32_t>(street_names_.size()));
+    if (is_inserted)
+        street_names_.push_back(name);
+
+    return it->second;
+}
+
+bool ReverseGeocoder::LoadStreets(const QSqlDatabase& database, const std::atomic<bool>& is_cancelled,
+                                  std::unordered_map<std::string, uint32_t>& street_indices_u_map)
+{
+    if (is_cancelled.load())
+        return false;
+
+    auto query = QSqlQuery(database);
+    query.setForwardOnly(true);
+
+    if (!query.exec(R"(
+        SELECT
+            name,
+            ST_AsBinary(way)
+        FROM
+            planet_osm_line
+        WHERE
+            name IS NOT NULL AND highway IS NOT NULL;
+    )"))
+    {
+        std::cerr << "ReverseGeocoder::LoadStreets SQL query execution error: " << query.lastError().text().toStdString() << std::endl;
+        return false;
+    }
+
+    auto shape = std::vector<projection::Epsg3857Point>();
+    int wkb_offset;
+    for (; !is_cancelled.load() && query.next();)
+    {
+        shape.clear();
+        wkb_offset = 0;
+        if (!wkb::ParseLineString(query.value(1).toByteArray(), wkb_offset, shape) || shape.size() < 2)
+            continue;
+
+        const auto street = AddStreetName(query.value(0).toString().toStdString(), street_indices_u_map);
+        for (size_t i = 1; i < shape.size(); i++)
+        {
+            segment_streets_.push_back(street);
+            segment_starts_.push_back(shape[i - 1]);
+            segment_ends_.push_back(shape[i]);
+        }
+    }
+
+    return !is_cancelled.load();
+}
+
+bool ReverseGeocoder::LoadAddresses(const QSqlDatabase& database, const std::atomic<bool>& is_cancelled,
+                                    std::unordered_map<std::string, uint32_t>& street_indices_u_map)
+{
+    if (is_cancelled.load())
+        return false;
+
+    auto query = QSqlQuery(database);
+    query.setForwardOnly(true);
+
+    // Buildings with address are represented by a point inside them
+    if (!query.exec(R"(
+        SELECT
+            "addr:housenumber",
+            tags->'addr:street',
+            ST_X(way),
+            ST_Y(way)
+        FROM
+            planet_osm_point
+        WHERE
+            "addr:housenumber" IS NOT NULL
+        UNION ALL
+        SELECT
+            "addr:housenumber",
+            tags->'addr:street',
+            ST_X(ST_PointOnSurface(way)),
+            ST_Y(ST_PointOnSurface(way))
+        FROM
+            planet_osm_polygon
+        WHERE
+            "addr:housenumber" IS NOT NULL;
+    )"))
+    {
+        std::cerr << "ReverseGeocoder::LoadAddresses SQL query execution error: " << query.lastError().text().toStdString() << std::endl;
+        return false;
+    }
+
+    for (; !is_cancelled.load() && query.next();)
+    {
+        const auto street_name = query.value(1).toString().toStdString();
+
+        address_house_numbers_.push_back(query.value(0).toString().toStdString());
+        address_streets_.push_back(street_name.empty() ? kNotFound : AddStreetName(street_name, street_indices_u_map));
+        address_points_.emplace_back(query.value(2).toDouble(), query.value(3).toDouble());
+    }
+
+    return !is_cancelled.load();
+}
+
+bool ReverseGeocoder::LoadAreas(const QSqlDatabase& database, const std::atomic<bool>& is_cancelled)
+{
+    if (is_cancelled.load())
+        return false;
+
+    auto query = QSqlQuery(database);
+    query.setForwardOnly(true);
+
+    if (!query.exec(R"(
+        SELECT
+            name,
+            admin_level::integer,
+            ST_AsBinary(way)
+        FROM
+            planet_osm_polygon
+        WHERE
+            boundary = 'administrative' AND name IS NOT NULL AND admin_level ~ '^[0-9]{1,2}$';
+    )"))
+    {
+        std::cerr << "ReverseGeocoder::LoadAreas SQL query execution error: " << query.lastError().text().toStdString() << std::endl;
+        return false;
+    }
+
+    area_band_offsets_.push_back(0);
+    band_edge_offsets_.push_back(0);
+
+    auto points = std::vector<projection::Epsg3857Point>();
+    auto ring_ends = std::vector<uint32_t>();
+    int wkb_offset;
+    for (; !is_cancelled.load() && query.next();)
+    {
+        points.clear();
+        ring_ends.clear();
+        wkb_offset = 0;
+        if (!wkb::ParsePolygons(query.value(2).toByteArray(), wkb_offset, points, ring_ends) || points.empty())
+        {
+            std::cerr << "ReverseGeocoder::LoadAreas Invalid boundary of " << query.value(0).toString().toStdString() << std::endl;
+            continue;
+        }
+
+        AddArea(query.value(0).toString().toStdString(), query.value(1).toInt(), points, ring_ends);
+    }
+
+    return !is_cancelled.load();
+}
+
+void ReverseGeocoder::AddArea(const std::string& name, const int admin_level, const std::vector<projection::Epsg3857Point>& points,
+                              const std::vector<uint32_t>& ring_ends)
+{
+    const auto first_point = static_cast<uint32_t>(area_points_.size());
+
+    auto box = PackedRTree::Box();
+    for (const auto& point : points)
+        box.Extend(PackedRTree::Box(point.x, point.y, point.x, point.y));
+
+    // Rings are closed, so edges go between neighbouring points of one ring
+    auto edges = std::vector<uint32_t>();
+    auto ring_begin = uint32_t(0);
+    for (const auto ring_end : ring_ends)
+    {
+        for (auto point = ring_begin; point + 1 < ring_end; point++)
+            edges.push_back(point);
+
+        ring_begin = ring_end;
+    }
+
+    area_points_.insert(area_points_.end(), points.begin(), points.end());
+
+    /* Band is not made lower than average edge height, otherwise jagged
+    boundaries would repeat every edge in many bands */
+    auto edge_height_sum = 0.0;
+    for (const auto edge : edges)
+        edge_height_sum += std::abs(points[edge + 1].y - points[edge].y);
+
+    const auto height = box.max_y - box.min_y;
+    auto band_count = size_t(1);
+    if (height > 0 && edge_height_sum > 0)
+        band_count = std::max<size_t>(1, std::min<double>(edges.size() / kAreaEdgesPerBand, height * edges.size() / edge_height_sum));
+
+    const auto band_height = height / band_count;
+
+    const auto band_of = [&](const double y) {
+        if (band_height <= 0)
+            return size_t(0);
+
+        return std::min(band_count - 1, static_cast<size_t>(std::max(0.0, (y - box.min_y) / band_height)));
+    };
+
+    // Counting pass sizes the bands, filling pass places edges of each band together
+    const auto first_band = band_edge_offsets_.size() - 1;
+    band_edge_offsets_.resize(first_band + band_count + 1, band_edge_offsets_.back());
+
+    auto band_sizes = std::vector<uint32_t>(band_count, 0);
+    for (const auto edge : edges)
+    {
+        const auto& start = points[edge];
+        const auto& end = points[edge + 1];
+        for (auto band = band_of(std::min(start.y, end.y)); band <= band_of(std::max(start.y, end.y)); band++)
+            band_sizes[band]++;
+    }
+
+    for (size_t band = 0; band < band_count; band++)
+        band_edge_offsets_[first_band + band + 1] = band_edge_offsets_[first_band + band] + band_sizes[band];
+
+    band_edges_.resize(band_edge_offsets_.back());
+    for (size_t band = 0; band < band_count; band++)
+        band_sizes[band] = band_edge_offsets_[first_band + band];
+
+    for (const auto edge : edges)
+    {
+        const auto& start = points[edge];
+        const auto& end = points[edge + 1];
+        for (auto band = band_of(std::min(start.y, end.y)); band <= band_of(std::max(start.y, end.y)); band++)
+            band_edges_[band_sizes[band]++] = first_point + edge;
+    }
+
+    area_band_offsets_.push_back(static_cast<uint32_t>(first_band + band_count));
+
+    area_names_.push_back(name);
+    area_admin_levels_.push_back(admin_level);
+    area_boxes_.push_back(box);
+}
+
+bool ReverseGeocoder::IsInArea(const uint32_t area, const projection::Epsg3857Point& point) const
+{
+    const auto& box = area_boxes_[area];
+    if (point.x < box.min_x || point.x > box.max_x || point.y < box.min_y || point.y > box.max_y)
+        return false;
+
+    const auto first_band = area_band_offsets_[area];
+    const auto band_count = area_band_offsets_[area + 1] - first_band;
+    const auto band_height = (box.max_y - box.min_y) / band_count;
+    const auto band = first_band + (band_height > 0 ?
+        std::min(band_count - 1, static_cast<uint32_t>((point.y - box.min_y) / band_height)) : 0);
+
+    // Counts edges crossed by a ray from the point to the right
+    auto is_inside = false;
+    for (auto position = band_edge_offsets_[band]; position < band_edge_offsets_[band + 1]; position++)
+    {
+        const auto& start = area_points_[band_edges_[position]];
+        const auto& end = area_points_[band_edges_[position] + 1];
+
+        if ((start.y > point.y) != (end.y > point.y) &&
+            point.x < start.x + (point.y - start.y) * (end.x - start.x) / (end.y - start.y))
+            is_inside = !is_inside;
+    }
+
+    return is_inside;
+}
+
+double ReverseGeocoder::SegmentSquaredDistance(const uint32_t segment, const projection::Epsg3857Point& point) const
+{
+    const auto& start = segment_starts_[segment];
+    const auto& end = segment_ends_[segment];
+
+    const auto segment_dx = end.x - start.x;
+    const auto segment_dy = end.y - start.y;
+    const auto segment_squared_length = segment_dx * segment_dx + segment_dy * segment_dy;
+
+    auto t = 0.0;
+    if (segment_squared_length > 0)
+        t = std::clamp(((point.x - start.x) * segment_dx + (point.y - start.y) * segment_dy) / segment_squared_length, 0.0, 1.0);
+
+    const auto dx = point.x - (start.x + t * segment_dx);
+    const auto dy = point.y - (start.y + t * segment_dy);
+    return dx * dx + dy * dy;
+}
+
+void ReverseGeocoder::Lookup(const projection::Epsg3857Point& point, Result& result) const
+{
+    result = Result();
+
+    // Tables are in EPSG:3857 units, limits are in meters
+    const auto scale = projection::Epsg3857Scale(point.y);
+
+    uint32_t item;
+    double squared_distance;
+    if (address_tree_.FindNearest(point.x, point.y,
+            [&, this](const uint32_t address) {
+                const auto dx = point.x - address_points_[address].x;
+                const auto dy = point.y - address_points_[address].y;
+                return dx * dx + dy * dy;
+            },
+            item, squared_distance, kMaxAddressDistance * scale))
+    {
+        result.address = item;
+        result.address_distance = std::sqrt(squared_distance) / scale;
+    }
+
+    if (segment_tree_.FindNearest(point.x, point.y,
+            [&, this](const uint32_t segment) { return SegmentSquaredDistance(segment, point); },
+            item, squared_distance, kMaxStreetDistance * scale))
+    {
+        result.street = segment_streets_[item];
+        result.street_distance = std::sqrt(squared_distance) / scale;
+    }
+
+    area_tree_.Search(PackedRTree::Box(point.x, point.y, point.x, point.y), [&, this](const uint32_t area) {
+        if (IsInArea(area, point))
+            result.areas.push_back(area);
+    });
+
+    std::sort(result.areas.begin(), result.areas.end(), [this](const uint32_t lhs, const uint32_t rhs) {
+        if (area_admin_levels_[lhs] != area_admin_levels_[rhs])
+            return area_admin_levels_[lhs] > area_admin_levels_[rhs];
+
+        return lhs < rhs;
+    });
+}
+
+void ReverseGeocoder::Lookup(const std::vector<projection::Epsg3857Point>& points, const unsigned int thread_count,
+                             std::vector<Result>& results) const
+{
+    results.resize(points.size());
+
+    auto next_chunk = std::atomic<size_t>(0);
+
+    const auto lookup_chunks = [&]() {
+        for (auto begin = next_chunk.fetch_add(kLookupChunkSize); begin < points.size(); begin = next_chunk.fetch_add(kLookupChunkSize))
+        {
+            const auto end = std::min(points.size(), begin + kLookupChunkSize);
+            for (auto i = begin; i < end; i++)
+            {
+                // Standing device repeats its position, the answer is the same
+                if (i > begin && points[i].x == points[i - 1].x && points[i].y == points[i - 1].y)
+                    results[i] = results[i - 1];
+                else
+                    Lookup(points[i], results[i]);
+            }
+        }
+    };
+
+    const auto chunk_count = (points.size() + kLookupChunkSize - 1) / kLookupChunkSize;
+    const auto worker_count = std::max<size_t>(1, std::min<size_t>(thread_count, chunk_count));
+
+    auto workers = std::vector<std::thread>();
+    for (size_t i = 1; i < worker_count; i++)
+        workers.emplace_back(lookup_chunks);
+
+    lookup_chunks();
+
+    for (auto& worker : workers)
+        worker.join();
+}
+
+std::string ReverseGeocoder::Describe(const Result& result) const
+{
+    auto parts = std::vector<std::string>();
+
+    auto street = result.street;
+    if (result.address != kNotFound && address_streets_[result.address] != kNotFound)
+        street = address_streets_[result.address];
+
+    if (result.address != kNotFound)
+        parts.push_back(street != kNotFound ? street_names_[street] + " " + address_house_numbers_[result.address] : address_house_numbers_[result.address]);
+    else if (street != kNotFound)
+        parts.push_back(street_names_[street]);
+
+    // City is often both a municipality and a district of the same name
+    for (const auto area : result.areas)
+    {
+        if (parts.empty() || parts.back() != area_names_[area])
+            parts.push_back(area_names_[area]);
+    }
+
+    auto description = std::string();
+    for (const auto& part : parts)
+    {
+        if (!description.empty())
+            description.append(", ");
+
+        description.append(part);
+    }
+
+    return description;
+}
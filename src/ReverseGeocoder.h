@@ -0,0 +1,109 @@
+#ifndef REVERSEGEOCODER_H
+#define REVERSEGEOCODER_H
+
+#include <string>
+#include <vector>
+#include <limits>
+#include <memory>
+#include <atomic>
+#include <unordered_map>
+
+#include <QSqlDatabase>
+
+#include "PackedRTree.h"
+#include "Projection.h"
+
+class ReverseGeocoder;
+using ReverseGeocoderUPtr = std::unique_ptr<ReverseGeocoder>;
+
+/* Finds address, street and administrative areas at a point. Address points,
+named road segments and admin boundaries are loaded once into packed R-trees,
+so lookup is a few tree descents and point-in-polygon tests instead of a
+PostGIS query per point. Boundary edges of each area are bucketed into
+horizontal bands, a point is tested only against edges of its band */
+class ReverseGeocoder
+{
+public:
+    static constexpr uint32_t kNotFound = std::numeric_limits<uint32_t>::max();
+
+    //! Distances are in meters on the ground
+    struct Result
+    {
+        uint32_t address = kNotFound;
+        double address_distance = 0;
+        uint32_t street = kNotFound;
+        double street_distance = 0;
+        //! Areas containing the point, most detailed (highest admin level) first
+        std::vector<uint32_t> areas;
+    };
+
+    /* Loads addresses, named roads and administrative boundaries from osm2pgsql
+    tables. Loading takes seconds, it is abandoned with nullptr as soon as
+    is_cancelled is set, checked between queries and rows */
+    static ReverseGeocoderUPtr Create(const QSqlDatabase& database, const std::atomic<bool>& is_cancelled);
+    //! Connects to the same database as routing data
+    static ReverseGeocoderUPtr CreateFromEnvironment(const std::atomic<bool>& is_cancelled);
+
+    void Lookup(const projection::Epsg3857Point& point, Result& result) const;
+    //! Batch version for GPS traces, points are split between thread_count threads
+    void Lookup(const std::vector<projection::Epsg3857Point>& points, const unsigned int thread_count,
+                std::vector<Result>& results) const;
+
+    //! Street name with house number, the street falls back to nearest one if address has none
+    std::string Describe(const Result& result) const;
+
+    size_t AddressCount() const { return address_points_.size(); }
+    size_t StreetCount() const { return street_names_.size(); }
+    size_t AreaCount() const { return area_names_.size(); }
+
+    const std::string& HouseNumber(const uint32_t address) const { return address_house_numbers_[address]; }
+    //! Street of address from addr:street, kNotFound if it is not set
+    uint32_t AddressStreet(const uint32_t address) const { return address_streets_[address]; }
+    const projection::Epsg3857Point& AddressPoint(const uint32_t address) const { return address_points_[address]; }
+    const std::string& StreetName(const uint32_t street) const { return street_names_[street]; }
+    const std::string& AreaName(const uint32_t area) const { return area_names_[area]; }
+    int AreaAdminLevel(const uint32_t area) const { return area_admin_levels_[area]; }
+
+private:
+    std::vector<projection::Epsg3857Point> address_points_;
+    std::vector<std::string> address_house_numbers_;
+    std::vector<uint32_t> address_streets_;
+    PackedRTree address_tree_;
+
+    std::vector<std::string> street_names_;
+    std::vector<uint32_t> segment_streets_;
+    std::vector<projection::Epsg3857Point> segment_starts_;
+    std::vector<projection::Epsg3857Point> segment_ends_;
+    PackedRTree segment_tree_;
+
+    std::vector<std::string> area_names_;
+    std::vector<int> area_admin_levels_;
+    std::vector<PackedRTree::Box> area_boxes_;
+    PackedRTree area_tree_;
+    //! Ring points of all areas, edge e goes from point e to point e + 1
+    std::vector<projection::Epsg3857Point> area_points_;
+    //! Bands of area i are [area_band_offsets_[i], area_band_offsets_[i + 1]), they split its box evenly by y
+    std::vector<uint32_t> area_band_offsets_;
+    //! Edges crossing band j are band_edges_[band_edge_offsets_[j]] up to the next offset
+    std::vector<uint32_t> band_edge_offsets_;
+    std::vector<uint32_t> band_edges_;
+
+    ReverseGeocoder();
+
+    //! Street names are shared by roads and addr:street of addresses
+    bool LoadStreets(const QSqlDatabase& database, const std::atomic<bool>& is_cancelled,
+                     std::unordered_map<std::string, uint32_t>& street_indices_u_map);
+    bool LoadAddresses(const QSqlDatabase& database, const std::atomic<bool>& is_cancelled,
+                       std::unordered_map<std::string, uint32_t>& street_indices_u_map);
+    bool LoadAreas(const QSqlDatabase& database, const std::atomic<bool>& is_cancelled);
+
+    uint32_t AddStreetName(const std::string& name, std::unordered_map<std::string, uint32_t>& street_indices_u_map);
+    //! Adds area from its rings, edges are bucketed into bands
+    void AddArea(const std::string& name, const int admin_level, const std::vector<projection::Epsg3857Point>& points,
+                 const std::vector<uint32_t>& ring_ends);
+    //! Even-odd test against edges of the band holding the point
+    bool IsInArea(const uint32_t area, const projection::Epsg3857Point& point) const;
+    double SegmentSquaredDistance(const uint32_t segment, const projection::Epsg3857Point& point) const;
+};
+
+#endif // REVERSEGEOCODER_H
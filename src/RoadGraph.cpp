@@ -0,0 +1,326 @@
+#include "RoadGraph.h"
+
+#include <numeric>
+
+#include <iostream>
+#include <algorithm>
+
+#include <QtSql/QSqlQuery>
+#include <QtSql/QSqlError>
+#include <QVariant>
+
+#include "Hilbert.h"
+#include "GraphFile.h"
+#include "Wkb.h"
+
+RoadGraph::RoadGraph()
+{
+
+}
+
+RoadGraphUPtr RoadGraph::Create(const QSqlDatabase& database, const VertexOrder vertex_order)
+{
+    std::unique_ptr<RoadGraph> instance(new RoadGraph());
+
+    if (!instance->LoadVertices(database) || !instance->LoadEdges(database))
+        return nullptr;
+
+    if (vertex_order == VertexOrder::Hilbert)
+        instance->ReorderVertices();
+    instance->ReorderEdges();
+    instance->BuildAdjacency();
+
+    return instance;
+}
+
+RoadGraphUPtr RoadGraph::Create(const std::string& path, const VertexOrder vertex_order)
+{
+    auto graph_data = graph_file::GraphData();
+    if (!graph_file::Read(path, graph_data))
+        return nullptr;
+
+    std::unique_ptr<RoadGraph> instance(new RoadGraph());
+
+    instance->vertex_ids_ = std::move(graph_data.vertex_ids);
+    instance->vertex_points_ = std::move(graph_data.vertex_points);
+    instance->edge_ids_ = std::move(graph_data.edge_ids);
+    instance->edge_sources_ = std::move(graph_data.edge_sources);
+    instance->edge_targets_ = std::move(graph_data.edge_targets);
+    instance->edge_lengths_ = std::move(graph_data.edge_lengths);
+    instance->edge_road_classes_ = std::move(graph_data.edge_road_classes);
+    instance->edge_oneways_ = std::move(graph_data.edge_oneways);
+    instance->edge_shapes_ = std::move(graph_data.edge_shapes);
+
+    instance->vertex_indices_u_map_.reserve(instance->VertexCount());
+    for (uint32_t vertex = 0; vertex < instance->VertexCount(); vertex++)
+        instance->vertex_indices_u_map_[instance->vertex_ids_[vertex]] = vertex;
+
+    // Importer writes edges grouped by way, locality is restored the same way as for database
+    if (vertex_order == VertexOrder::Hilbert)
+        instance->ReorderVertices();
+    instance->ReorderEdges();
+    instance->BuildAdjacency();
+
+    return instance;
+}
+
+bool RoadGraph::FindVertex(const int64_t vertex_id, uint32_t& vertex) const
+{
+    const auto vertex_index = vertex_indices_u_map_.find(vertex_id);
+    if (vertex_index == vertex_indices_u_map_.end())
+        return false;
+
+    vertex = vertex_index->second;
+    return true;
+}
+
+void RoadGraph::EdgeShape(const uint32_t edge, std::vector<projection::Epsg3857Point>& shape) const
+{
+    edge_shapes_.Decode(edge, false, shape);
+}
+
+void RoadGraph::ArcShape(const uint32_t arc, std::vector<projection::Epsg3857Point>& shape) const
+{
+    edge_shapes_.Decode(ArcEdge(arc), !IsArcForward(arc), shape);
+}
+
+void RoadGraph::PathShape(const std::vector<uint32_t>& path_arcs, std::vector<projection::Epsg3857Point>& shape) const
+{
+    auto arc_shape = std::vector<projection::Epsg3857Point>();
+    for (const auto arc : path_arcs)
+    {
+        arc_shape.clear();
+        ArcShape(arc, arc_shape);
+
+        // Decoded end points are rounded, vertex points are exact
+        shape.insert(shape.end(), arc_shape.begin() + 1, arc_shape.end() - 1);
+        shape.push_back(VertexPoint(ArcHead(arc)));
+    }
+}
+
+bool RoadGraph::LoadVertices(const QSqlDatabase& database)
+{
+    auto query = QSqlQuery(database);
+    query.setForwardOnly(true);
+
+    if (!query.exec(R"(
+        SELECT
+            id,
+            st_x(the_geom),
+            st_y(the_geom)
+        FROM
+            roads_vertices_pgr;
+    )"))
+    {
+        std::cerr << "RoadGraph::LoadVertices SQL query execution error: " << query.lastError().text().toStdString() << std::endl;
+        return false;
+    }
+
+    int64_t vertex_id;
+    for (; query.next();)
+    {
+        vertex_id = query.value(0).toLongLong();
+
+        vertex_indices_u_map_[vertex_id] = static_cast<uint32_t>(vertex_ids_.size());
+        vertex_ids_.push_back(vertex_id);
+        vertex_points_.emplace_back(query.value(1).toDouble(), query.value(2).toDouble());
+    }
+
+    return true;
+}
+
+bool RoadGraph::LoadEdges(const QSqlDatabase& database)
+{
+    auto query = QSqlQuery(database);
+    query.setForwardOnly(true);
+
+    // Noded roads keep osm_id of original line in old_id, tags are taken from it
+    if (!query.exec(R"(
+        SELECT
+            r.id,
+            r.source,
+            r.target,
+            r.length,
+            ST_AsBinary(r.geom),
+            l.highway,
+            l.oneway
+        FROM
+            roads r
+        LEFT JOIN LATERAL (
+            SELECT
+                highway,
+                oneway
+            FROM
+                planet_osm_line
+            WHERE
+                osm_id = r.old_id AND highway IS NOT NULL
+            LIMIT 1
+        ) l ON true
+        WHERE
+            r.source IS NOT NULL AND r.target IS NOT NULL;
+    )"))
+    {
+        std::cerr << "RoadGraph::LoadEdges SQL query execution error: " << query.lastError().text().toStdString() << std::endl;
+        return false;
+    }
+
+    auto shape = std::vector<projection::Epsg3857Point>();
+    uint32_t source, target;
+    int wkb_offset;
+    for (; query.next();)
+    {
+        if (!FindVertex(query.value(1).toLongLong(), source) || !FindVertex(query.value(2).toLongLong(), target))
+        {
+            std::cerr << "RoadGraph::LoadEdges Edge " << query.value(0).toLongLong() << " references unknown vertex" << std::endl;
+            continue;
+        }
+
+        shape.clear();
+        wkb_offset = 0;
+        if (!wkb::ParseLineString(query.value(4).toByteArray(), wkb_offset, shape) || shape.size() < 2)
+        {
+            // Fall back to straight line between end points
+            shape.clear();
+            shape.push_back(vertex_points_[source]);
+            shape.push_back(vertex_points_[target]);
+        }
+
+        edge_shapes_.Add(shape);
+
+        edge_ids_.push_back(query.value(0).toLongLong());
+        edge_sources_.push_back(source);
+        edge_targets_.push_back(target);
+        edge_lengths_.push_back(query.value(3).toDouble());
+        edge_road_classes_.push_back(routing_profile::ParseRoadClass(query.value(5).toString().toStdString()));
+        edge_oneways_.push_back(routing_profile::ParseOneway(query.value(6).toString().toStdString()));
+    }
+
+    edge_shapes_.ShrinkToFit();
+
+    return true;
+}
+
+void RoadGraph::ReorderVertices()
+{
+    if (vertex_points_.empty())
+        return;
+
+    auto min_x = vertex_points_.front().x, max_x = min_x;
+    auto min_y = vertex_points_.front().y, max_y = min_y;
+    for (const auto& point : vertex_points_)
+    {
+        min_x = std::min(min_x, point.x);
+        max_x = std::max(max_x, point.x);
+        min_y = std::min(min_y, point.y);
+        max_y = std::max(max_y, point.y);
+    }
+
+    auto hilbert_indices = std::vector<uint32_t>(VertexCount());
+    for (size_t vertex = 0; vertex < VertexCount(); vertex++)
+        hilbert_indices[vertex] = hilbert::XYToIndex(hilbert::ToAxis(vertex_points_[vertex].x, min_x, max_x),
+                                                     hilbert::ToAxis(vertex_points_[vertex].y, min_y, max_y));
+
+    // order[new index] is old index, ids break ties to keep numbering stable between runs
+    auto order = std::vector<uint32_t>(VertexCount());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&, this](const uint32_t lhs, const uint32_t rhs) {
+        return hilbert_indices[lhs] != hilbert_indices[rhs] ? hilbert_indices[lhs] < hilbert_indices[rhs] : vertex_ids_[lhs] < vertex_ids_[rhs];
+    });
+
+    auto new_indices = std::vector<uint32_t>(VertexCount());
+    auto vertex_ids = std::vector<int64_t>(VertexCount());
+    auto vertex_points = std::vector<projection::Epsg3857Point>(VertexCount());
+    for (uint32_t vertex = 0; vertex < VertexCount(); vertex++)
+    {
+        new_indices[order[vertex]] = vertex;
+        vertex_ids[vertex] = vertex_ids_[order[vertex]];
+        vertex_points[vertex] = vertex_points_[order[vertex]];
+    }
+
+    vertex_ids_ = std::move(vertex_ids);
+    vertex_points_ = std::move(vertex_points);
+
+    for (auto& vertex_index : vertex_indices_u_map_)
+        vertex_index.second = new_indices[vertex_index.second];
+
+    for (auto& source : edge_sources_)
+        source = new_indices[source];
+    for (auto& target : edge_targets_)
+        target = new_indices[target];
+}
+
+void RoadGraph::ReorderEdges()
+{
+    auto order = std::vector<uint32_t>(EdgeCount());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [this](const uint32_t lhs, const uint32_t rhs) {
+        return edge_sources_[lhs] != edge_sources_[rhs] ? edge_sources_[lhs] < edge_sources_[rhs] : edge_targets_[lhs] < edge_targets_[rhs];
+    });
+
+    const auto permute = [&order](auto& values) {
+        auto permuted_values = std::remove_reference_t<decltype(values)>(values.size());
+        for (size_t i = 0; i < order.size(); i++)
+            permuted_values[i] = values[order[i]];
+
+        values = std::move(permuted_values);
+    };
+
+    permute(edge_ids_);
+    permute(edge_sources_);
+    permute(edge_targets_);
+    permute(edge_lengths_);
+    permute(edge_road_classes_);
+    permute(edge_oneways_);
+
+    auto edge_shapes = PolylineStore();
+    auto shape = std::vector<projection::Epsg3857Point>();
+    for (const auto edge : order)
+    {
+        shape.clear();
+        edge_shapes_.Decode(edge, false, shape);
+        edge_shapes.Add(shape);
+    }
+
+    edge_shapes.ShrinkToFit();
+    edge_shapes_ = std::move(edge_shapes);
+}
+
+void RoadGraph::BuildAdjacency()
+{
+    first_arcs_.assign(VertexCount() + 1, 0);
+    for (uint32_t edge = 0; edge < EdgeCount(); edge++)
+    {
+        first_arcs_[edge_sources_[edge] + 1]++;
+        first_arcs_[edge_targets_[edge] + 1]++;
+    }
+
+    for (size_t vertex = 0; vertex < VertexCount(); vertex++)
+        first_arcs_[vertex + 1] += first_arcs_[vertex];
+
+    const auto arc_count = 2 * EdgeCount();
+    arc_heads_.resize(arc_count);
+    arc_edges_.resize(arc_count);
+    arc_forward_flags_.resize(arc_count);
+    arc_reverses_.resize(arc_count);
+
+    auto next_arcs = std::vector<uint32_t>(first_arcs_.begin(), first_arcs_.end() - 1);
+    const auto add_arc = [&, this](const uint32_t tail, const uint32_t head, const uint32_t edge, const bool is_forward) {
+        const auto arc = next_arcs[tail]++;
+
+        arc_heads_[arc] = head;
+        arc_edges_[arc] = edge;
+        arc_forward_flags_[arc] = is_forward;
+
+        return arc;
+    };
+
+    uint32_t forward_arc, backward_arc;
+    for (uint32_t edge = 0; edge < EdgeCount(); edge++)
+    {
+        forward_arc = add_arc(edge_sources_[edge], edge_targets_[edge], edge, true);
+        backward_arc = add_arc(edge_targets_[edge], edge_sources_[edge], edge, false);
+
+        arc_reverses_[forward_arc] = backward_arc;
+        arc_reverses_[backward_arc] = forward_arc;
+    }
+}
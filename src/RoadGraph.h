@@ -0,0 +1,105 @@
+#ifndef ROADGRAPH_H
+#define ROADGRAPH_H
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#include <QSqlDatabase>
+
+#include "Projection.h"
+#include "RoutingProfile.h"
+#include "PolylineStore.h"
+
+class RoadGraph;
+using RoadGraphUPtr = std::unique_ptr<RoadGraph>;
+
+/* In-memory road graph, either copied from tables created by pgr_createTopology
+(roads and roads_vertices_pgr) or read from graph file written by importer.
+Vertices and edges are addressed by dense indexes, database ids are kept to
+map them back. Vertices are numbered along Hilbert curve of their coordinates
+and edges by their source vertex, so neighbouring roads are close in memory
+during search */
+class RoadGraph
+{
+public:
+    enum class VertexOrder
+    {
+        //! Along Hilbert curve, the default
+        Hilbert,
+        //! As loaded from database or file, lets benchmark measure effect of Hilbert order
+        Loaded
+    };
+
+    //! Loads graph from database, in case of error returns nullptr
+    static RoadGraphUPtr Create(const QSqlDatabase& database, const VertexOrder vertex_order = VertexOrder::Hilbert);
+    //! Loads graph from graph file, in case of error returns nullptr
+    static RoadGraphUPtr Create(const std::string& path, const VertexOrder vertex_order = VertexOrder::Hilbert);
+
+    size_t VertexCount() const { return vertex_ids_.size(); }
+    size_t EdgeCount() const { return edge_ids_.size(); }
+
+    int64_t VertexId(const uint32_t vertex) const { return vertex_ids_[vertex]; }
+    const projection::Epsg3857Point& VertexPoint(const uint32_t vertex) const { return vertex_points_[vertex]; }
+    //! Finds vertex index by its id, returns false if there is no such vertex
+    bool FindVertex(const int64_t vertex_id, uint32_t& vertex) const;
+
+    int64_t EdgeId(const uint32_t edge) const { return edge_ids_[edge]; }
+    uint32_t EdgeSource(const uint32_t edge) const { return edge_sources_[edge]; }
+    uint32_t EdgeTarget(const uint32_t edge) const { return edge_targets_[edge]; }
+    double EdgeLength(const uint32_t edge) const { return edge_lengths_[edge]; }
+    routing_profile::RoadClass EdgeRoadClass(const uint32_t edge) const { return edge_road_classes_[edge]; }
+    routing_profile::Oneway EdgeOneway(const uint32_t edge) const { return edge_oneways_[edge]; }
+    //! Appends edge geometry from source to target including both end points
+    void EdgeShape(const uint32_t edge, std::vector<projection::Epsg3857Point>& shape) const;
+
+    /* Every edge is stored as two arcs, from source to target (forward) and back.
+    Whether an arc can be used is decided by routing profile. Outgoing arcs of
+    vertex are [FirstArc(vertex), FirstArc(vertex + 1)) */
+    size_t ArcCount() const { return arc_heads_.size(); }
+    uint32_t FirstArc(const uint32_t vertex) const { return first_arcs_[vertex]; }
+    uint32_t ArcHead(const uint32_t arc) const { return arc_heads_[arc]; }
+    uint32_t ArcEdge(const uint32_t arc) const { return arc_edges_[arc]; }
+    bool IsArcForward(const uint32_t arc) const { return arc_forward_flags_[arc]; }
+    //! Arc of the same edge in opposite direction
+    uint32_t ReverseArc(const uint32_t arc) const { return arc_reverses_[arc]; }
+    //! Appends arc geometry from its tail to its head including both end points
+    void ArcShape(const uint32_t arc, std::vector<projection::Epsg3857Point>& shape) const;
+    /* Appends geometry of consecutive arcs after the path start vertex, which
+    is expected to be already in shape. Vertices between arcs are not repeated */
+    void PathShape(const std::vector<uint32_t>& path_arcs, std::vector<projection::Epsg3857Point>& shape) const;
+
+private:
+    std::vector<int64_t> vertex_ids_;
+    std::vector<projection::Epsg3857Point> vertex_points_;
+    std::unordered_map<int64_t, uint32_t> vertex_indices_u_map_;
+
+    std::vector<int64_t> edge_ids_;
+    std::vector<uint32_t> edge_sources_;
+    std::vector<uint32_t> edge_targets_;
+    std::vector<double> edge_lengths_;
+    std::vector<routing_profile::RoadClass> edge_road_classes_;
+    std::vector<routing_profile::Oneway> edge_oneways_;
+
+    //! Geometry of edge i is polyline i, decoded only when requested
+    PolylineStore edge_shapes_;
+
+    //! Adjacency in compressed sparse row form, arcs are grouped by tail vertex
+    std::vector<uint32_t> first_arcs_;
+    std::vector<uint32_t> arc_heads_;
+    std::vector<uint32_t> arc_edges_;
+    std::vector<char> arc_forward_flags_;
+    std::vector<uint32_t> arc_reverses_;
+
+    RoadGraph();
+
+    bool LoadVertices(const QSqlDatabase& database);
+    bool LoadEdges(const QSqlDatabase& database);
+    //! Renumbers vertices in Hilbert order of their points, database order is arbitrary
+    void ReorderVertices();
+    //! Sorts edges by source vertex, after vertices got their final numbers
+    void ReorderEdges();
+    void BuildAdjacency();
+};
+
+#endif // ROADGRAPH_H
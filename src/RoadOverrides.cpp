@@ -0,0 +1,90 @@
+#include "RoadOverrides.h"
+
+#include <iostream>
+
+RoadOverrides::RoadOverrides()
+    : arc_filter_(kArcFilterWordCount, 0)
+{
+
+}
+
+RoadOverridesSPtr RoadOverrides::Create()
+{
+    return RoadOverridesSPtr(new RoadOverrides());
+}
+
+RoadOverridesSPtr RoadOverrides::WithEdgeFactor(const RoadGraph& road_graph, const std::vector<uint32_t>& edges, const float factor) const
+{
+    if (!(factor >= 1))
+    {
+        std::cerr << "RoadOverrides::WithEdgeFactor Factor " << factor << " is below 1" << std::endl;
+        return nullptr;
+    }
+
+    std::shared_ptr<RoadOverrides> instance(new RoadOverrides());
+    instance->edge_factors_u_map_ = edge_factors_u_map_;
+
+    for (const auto edge : edges)
+    {
+        if (edge >= road_graph.EdgeCount())
+        {
+            std::cerr << "RoadOverrides::WithEdgeFactor Invalid edge " << edge << std::endl;
+            return nullptr;
+        }
+
+        if (factor == 1)
+            instance->edge_factors_u_map_.erase(edge);
+        else
+            instance->edge_factors_u_map_[edge] = factor;
+    }
+
+    instance->Index(road_graph);
+
+    return instance;
+}
+
+float RoadOverrides::EdgeFactor(const uint32_t edge) const
+{
+    const auto edge_factor = edge_factors_u_map_.find(edge);
+    return edge_factor == edge_factors_u_map_.end() ? 1 : edge_factor->second;
+}
+
+bool RoadOverrides::IsEdgeClosed(const uint32_t edge) const
+{
+    return EdgeFactor(edge) == kClosed;
+}
+
+//! Derives arc factors, filter and closed vertices, work depends only on count of overrides
+void RoadOverrides::Index(const RoadGraph& road_graph)
+{
+    uint32_t source;
+    for (const auto& [edge, factor] : edge_factors_u_map_)
+    {
+        source = road_graph.EdgeSource(edge);
+        for (auto arc = road_graph.FirstArc(source); arc < road_graph.FirstArc(source + 1); arc++)
+        {
+            if (road_graph.ArcEdge(arc) != edge)
+                continue;
+
+            for (const auto edge_arc : { arc, road_graph.ReverseArc(arc) })
+            {
+                arc_factors_u_map_[edge_arc] = factor;
+                arc_filter_[(edge_arc >> 6) & (kArcFilterWordCount - 1)] |= uint64_t(1) << (edge_arc & 63);
+            }
+        }
+
+        if (factor != kClosed)
+            continue;
+
+        // Arcs of both directions are stored, outgoing arcs of vertex cover all its roads
+        for (const auto vertex : { source, road_graph.EdgeTarget(edge) })
+        {
+            auto is_closed = true;
+            for (auto arc = road_graph.FirstArc(vertex); arc < road_graph.FirstArc(vertex + 1) && is_closed; arc++)
+                is_closed = IsEdgeClosed(road_graph.ArcEdge(arc));
+
+            if (is_closed)
+                closed_vertices_u_set_.insert(vertex);
+        }
+    }
+}
@@ -0,0 +1,76 @@
+#ifndef ROADOVERRIDES_H
+#define ROADOVERRIDES_H
+
+#include <vector>
+#include <memory>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+#include <cstdint>
+
+#include "RoadGraph.h"
+#include "RoutingProfile.h"
+
+class RoadOverrides;
+using RoadOverridesSPtr = std::shared_ptr<const RoadOverrides>;
+
+/* Road closures and cost penalties set at run time, applied on top of arc
+weights of every profile while searching. Snapshot never changes: editing
+returns a new one, which copies only overridden edges, so queries running on
+other threads keep a consistent view and weights are never rebuilt. Arcs
+without override are rejected by a fixed size bit filter before hash lookup */
+class RoadOverrides
+{
+public:
+    //! Factor of closed road
+    static constexpr float kClosed = std::numeric_limits<float>::infinity();
+
+    static RoadOverridesSPtr Create();
+
+    /* Returns copy with factor of edges replaced, factor 1 removes override.
+    Factors below 1 are rejected with nullptr: A* estimate assumes that no
+    road is faster than its profile allows */
+    RoadOverridesSPtr WithEdgeFactor(const RoadGraph& road_graph, const std::vector<uint32_t>& edges, const float factor) const;
+
+    bool IsEmpty() const { return edge_factors_u_map_.empty(); }
+    const std::unordered_map<uint32_t, float>& EdgeFactors() const { return edge_factors_u_map_; }
+    //! 1 for edges without override
+    float EdgeFactor(const uint32_t edge) const;
+
+    //! Weight of arc after override, closed arcs become inaccessible
+    float Apply(const uint32_t arc, const float weight) const
+    {
+        if (!(arc_filter_[(arc >> 6) & (kArcFilterWordCount - 1)] >> (arc & 63) & 1))
+            return weight;
+
+        const auto arc_factor = arc_factors_u_map_.find(arc);
+        if (arc_factor == arc_factors_u_map_.end())
+            return weight;
+
+        // Multiplying would turn closed arc of zero length into NaN, which searches take as accessible
+        return arc_factor->second == kClosed ? routing_profile::kInaccessible : weight * arc_factor->second;
+    }
+
+    //! Whether every road of vertex is closed, such vertex can not be a route end
+    bool IsVertexClosed(const uint32_t vertex) const
+    {
+        return !closed_vertices_u_set_.empty() && closed_vertices_u_set_.count(vertex) > 0;
+    }
+
+private:
+    //! Filter holds one bit per arc index modulo 2^16
+    static constexpr size_t kArcFilterWordCount = 1024;
+
+    std::unordered_map<uint32_t, float> edge_factors_u_map_;
+    //! Both arcs of every overridden edge
+    std::unordered_map<uint32_t, float> arc_factors_u_map_;
+    std::unordered_set<uint32_t> closed_vertices_u_set_;
+    std::vector<uint64_t> arc_filter_;
+
+    RoadOverrides();
+
+    void Index(const RoadGraph& road_graph);
+    bool IsEdgeClosed(const uint32_t edge) const;
+};
+
+#endif // ROADOVERRIDES_H
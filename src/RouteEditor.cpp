@@ -0,0 +1,351 @@
+#include "RouteEditor.h"
+
+#include <cmath>
+#include <iostream>
+
+#include <QPointer>
+#include <QCoreApplication>
+
+#include "AStar.h"
+#include "Dijkstra.h"
+#include "Trace.h"
+
+RouteEditor::RouteEditor(RoutingDataSPtr routing_data_s_ptr, const routing_profile::Type routing_profile_type, RoutingService* routing_service,
+                         RoadOverridesSPtr road_overrides_s_ptr)
+    : routing_data_s_ptr_(std::move(routing_data_s_ptr)), routing_profile_type_(routing_profile_type), routing_service_(routing_service),
+    road_overrides_s_ptr_(std::move(road_overrides_s_ptr)),
+    arc_weights_(routing_data_s_ptr_->Weights(routing_profile_type_).WithOverrides(road_overrides_s_ptr_)),
+    forward_search_space_(routing_data_s_ptr_->Graph().VertexCount()),
+    backward_search_space_(routing_data_s_ptr_->Graph().VertexCount())
+{
+
+}
+
+RouteEditorUPtr RouteEditor::Create(RoutingDataSPtr routing_data_s_ptr, const routing_profile::Type routing_profile_type,
+                                    RoutingService* routing_service, RoadOverridesSPtr road_overrides_s_ptr)
+{
+    if (!routing_data_s_ptr)
+    {
+        std::cerr << "RouteEditor::Create Routing data is not loaded" << std::endl;
+        return nullptr;
+    }
+
+    return RouteEditorUPtr(new RouteEditor(std::move(routing_data_s_ptr), routing_profile_type, routing_service, std::move(road_overrides_s_ptr)));
+}
+
+RouteEditor::WaypointEntry RouteEditor::SnapWaypoint(const projection::Epsg3857Point& point) const
+{
+    auto waypoint = WaypointEntry();
+    waypoint.point = point;
+    waypoint.is_snapped = routing_data_s_ptr_->FindNearestAccessibleVertex(point, arc_weights_, waypoint.vertex);
+
+    return waypoint;
+}
+
+bool RouteEditor::SetWaypoints(const std::vector<projection::Epsg3857Point>& waypoints)
+{
+    EndDrag();
+
+    routing_generation_++;
+    pending_leg_count_ = 0;
+
+    waypoints_.clear();
+    {
+        const auto snap_span = trace::Span("Snap waypoints");
+        for (const auto& point : waypoints)
+            waypoints_.push_back(SnapWaypoint(point));
+    }
+
+    legs_.assign(waypoints_.size() > 1 ? waypoints_.size() - 1 : 0, Leg());
+
+    if (routing_service_ && legs_.size() > 1 && QCoreApplication::instance())
+        return RouteLegsInParallel();
+
+    auto is_complete = true;
+    for (size_t leg = 0; leg < legs_.size(); leg++)
+        is_complete = RouteLeg(leg) && is_complete;
+
+    return is_complete;
+}
+
+bool RouteEditor::SetRoutingProfile(const routing_profile::Type routing_profile_type)
+{
+    routing_profile_type_ = routing_profile_type;
+    arc_weights_ = routing_data_s_ptr_->Weights(routing_profile_type_).WithOverrides(road_overrides_s_ptr_);
+
+    return SetWaypoints(Waypoints());
+}
+
+bool RouteEditor::SetRoadOverrides(RoadOverridesSPtr road_overrides_s_ptr)
+{
+    road_overrides_s_ptr_ = std::move(road_overrides_s_ptr);
+    arc_weights_ = routing_data_s_ptr_->Weights(routing_profile_type_).WithOverrides(road_overrides_s_ptr_);
+
+    return SetWaypoints(Waypoints());
+}
+
+std::vector<projection::Epsg3857Point> RouteEditor::Waypoints() const
+{
+    auto points = std::vector<projection::Epsg3857Point>();
+    points.reserve(waypoints_.size());
+    for (const auto& waypoint : waypoints_)
+        points.push_back(waypoint.point);
+
+    return points;
+}
+
+bool RouteEditor::RouteLegsInParallel()
+{
+    const auto routing_generation = ++routing_generation_;
+    pending_leg_count_ = 0;
+
+    /* Editor may be destroyed before results arrive, so they are posted to the
+    application and checked through a guard made here in the editor thread */
+    const auto editor = QPointer<RouteEditor>(this);
+
+    auto is_complete = true;
+    for (size_t leg = 0; leg < legs_.size(); leg++)
+    {
+        legs_[leg] = Leg();
+
+        const auto start_point = waypoints_[leg].point;
+        const auto end_point = waypoints_[leg + 1].point;
+        const auto is_queued = routing_service_->TrySubmit(start_point, end_point, routing_profile_type_,
+                                                           [editor, routing_generation, leg, start_point, end_point](RoutingService::Route&& route) {
+            QMetaObject::invokeMethod(QCoreApplication::instance(), [editor, routing_generation, leg, start_point, end_point, route = std::move(route)]() mutable {
+                if (editor)
+                    editor->TakeLegRoute(routing_generation, leg, start_point, end_point, std::move(route));
+            }, Qt::QueuedConnection);
+        });
+
+        if (is_queued)
+            pending_leg_count_++;
+        else
+            is_complete = RouteLeg(leg) && is_complete;
+    }
+
+    return is_complete;
+}
+
+void RouteEditor::TakeLegRoute(const uint64_t routing_generation, const size_t leg, const projection::Epsg3857Point& start_point,
+                               const projection::Epsg3857Point& end_point, RoutingService::Route&& route)
+{
+    if (routing_generation != routing_generation_)
+        return;
+
+    pending_leg_count_--;
+
+    // Leg next to dragged waypoint was routed again meanwhile
+    const auto is_current = leg < legs_.size()
+        && waypoints_[leg].point.x == start_point.x && waypoints_[leg].point.y == start_point.y
+        && waypoints_[leg + 1].point.x == end_point.x && waypoints_[leg + 1].point.y == end_point.y;
+    if (is_current)
+    {
+        legs_[leg].is_found = route.is_found;
+        legs_[leg].cost = route.cost;
+        if (route.is_found)
+            legs_[leg].points = std::move(route.points);
+    }
+
+    if (pending_leg_count_ == 0)
+        emit LegsRouted(IsComplete());
+}
+
+bool RouteEditor::RouteLeg(const size_t leg)
+{
+    auto& route_leg = legs_[leg];
+    const auto& start = waypoints_[leg];
+    const auto& end = waypoints_[leg + 1];
+
+    route_leg = Leg();
+    if (!start.is_snapped || !end.is_snapped)
+        return false;
+
+    const auto& road_graph = routing_data_s_ptr_->Graph();
+
+    // Forward space is free while nothing is dragged
+    {
+        const auto search_span = trace::Span("Route search");
+        route_leg.is_found = routing_profile::Dispatch(routing_profile_type_, [&](const auto profile) {
+            return astar::Search<decltype(profile)>(road_graph, arc_weights_, start.vertex, end.vertex, forward_search_space_);
+        });
+    }
+
+    if (!route_leg.is_found)
+        return false;
+
+    const auto shape_span = trace::Span("Route shape");
+
+    route_leg.cost = forward_search_space_.Cost(end.vertex);
+    forward_search_space_.BuildArcPath(end.vertex, path_arcs_);
+
+    route_leg.points.push_back(start.point);
+    route_leg.points.push_back(road_graph.VertexPoint(start.vertex));
+    road_graph.PathShape(path_arcs_, route_leg.points);
+    route_leg.points.push_back(end.point);
+
+    return true;
+}
+
+void RouteEditor::BeginDrag(const size_t waypoint)
+{
+    dragged_waypoint_ = waypoint < waypoints_.size() ? waypoint : kNoWaypoint;
+    if (dragged_waypoint_ == kNoWaypoint)
+        return;
+
+    // Trees are grown lazily by DragTo, here they only get their roots
+    if (dragged_waypoint_ > 0 && waypoints_[dragged_waypoint_ - 1].is_snapped)
+        dijkstra::StartSearch(waypoints_[dragged_waypoint_ - 1].vertex, forward_search_space_);
+
+    if (dragged_waypoint_ + 1 < waypoints_.size() && waypoints_[dragged_waypoint_ + 1].is_snapped)
+        dijkstra::StartSearch(waypoints_[dragged_waypoint_ + 1].vertex, backward_search_space_);
+}
+
+bool RouteEditor::DragTo(const projection::Epsg3857Point& point)
+{
+    if (dragged_waypoint_ == kNoWaypoint)
+        return false;
+
+    waypoints_[dragged_waypoint_] = SnapWaypoint(point);
+
+    auto is_found = true;
+    if (dragged_waypoint_ > 0)
+        is_found = RouteLegToDragged(dragged_waypoint_ - 1) && is_found;
+
+    if (dragged_waypoint_ < legs_.size())
+        is_found = RouteLegFromDragged(dragged_waypoint_) && is_found;
+
+    return is_found;
+}
+
+void RouteEditor::EndDrag()
+{
+    dragged_waypoint_ = kNoWaypoint;
+}
+
+bool RouteEditor::RouteLegToDragged(const size_t leg)
+{
+    auto& route_leg = legs_[leg];
+    const auto& start = waypoints_[leg];
+    const auto& end = waypoints_[leg + 1];
+
+    route_leg = Leg();
+    if (!start.is_snapped || !end.is_snapped)
+        return false;
+
+    const auto& road_graph = routing_data_s_ptr_->Graph();
+    if (!dijkstra::SearchUntilSettled(road_graph, arc_weights_, end.vertex, false, forward_search_space_))
+        return false;
+
+    route_leg.is_found = true;
+    route_leg.cost = forward_search_space_.Cost(end.vertex);
+    forward_search_space_.BuildArcPath(end.vertex, path_arcs_);
+
+    route_leg.points.push_back(start.point);
+    route_leg.points.push_back(road_graph.VertexPoint(start.vertex));
+    road_graph.PathShape(path_arcs_, route_leg.points);
+    route_leg.points.push_back(end.point);
+
+    return true;
+}
+
+bool RouteEditor::RouteLegFromDragged(const size_t leg)
+{
+    auto& route_leg = legs_[leg];
+    const auto& start = waypoints_[leg];
+    const auto& end = waypoints_[leg + 1];
+
+    route_leg = Leg();
+    if (!start.is_snapped || !end.is_snapped)
+        return false;
+
+    const auto& road_graph = routing_data_s_ptr_->Graph();
+    if (!dijkstra::SearchUntilSettled(road_graph, arc_weights_, start.vertex, true, backward_search_space_))
+        return false;
+
+    route_leg.is_found = true;
+    route_leg.cost = backward_search_space_.Cost(start.vertex);
+
+    // Parents of backward tree lead to its root, which is where this leg ends
+    path_arcs_.clear();
+    for (auto vertex = start.vertex; backward_search_space_.ParentVertex(vertex) != SearchSpace::kNoVertex; vertex = backward_search_space_.ParentVertex(vertex))
+        path_arcs_.push_back(road_graph.ReverseArc(backward_search_space_.ParentArc(vertex)));
+
+    route_leg.points.push_back(start.point);
+    route_leg.points.push_back(road_graph.VertexPoint(start.vertex));
+    road_graph.PathShape(path_arcs_, route_leg.points);
+    route_leg.points.push_back(end.point);
+
+    return true;
+}
+
+size_t RouteEditor::FindNearestLeg(const projection::Epsg3857Point& point) const
+{
+    auto nearest_leg = kNoWaypoint;
+    auto nearest_squared_distance = SearchSpace::kInfinity;
+
+    for (size_t leg = 0; leg < legs_.size(); leg++)
+    {
+        const auto& points = legs_[leg].points;
+        for (size_t i = 1; i < points.size(); i++)
+        {
+            const auto dx = points[i].x - points[i - 1].x;
+            const auto dy = points[i].y - points[i - 1].y;
+            const auto squared_length = dx * dx + dy * dy;
+
+            auto t = squared_length > 0 ? ((point.x - points[i - 1].x) * dx + (point.y - points[i - 1].y) * dy) / squared_length : 0.0;
+            t = std::max(0.0, std::min(1.0, t));
+
+            const auto px = points[i - 1].x + t * dx - point.x;
+            const auto py = points[i - 1].y + t * dy - point.y;
+            if (px * px + py * py < nearest_squared_distance)
+            {
+                nearest_squared_distance = px * px + py * py;
+                nearest_leg = leg;
+            }
+        }
+    }
+
+    return nearest_leg;
+}
+
+size_t RouteEditor::InsertWaypoint(const size_t leg, const projection::Epsg3857Point& point)
+{
+    EndDrag();
+
+    const auto waypoint = leg + 1;
+    waypoints_.insert(waypoints_.begin() + waypoint, SnapWaypoint(point));
+    legs_.insert(legs_.begin() + waypoint, Leg());
+
+    // Legs still being routed were queued under old numbering, so all of them are queued again
+    if (IsRouting())
+    {
+        RouteLegsInParallel();
+        return waypoint;
+    }
+
+    RouteLeg(leg);
+    RouteLeg(waypoint);
+
+    return waypoint;
+}
+
+bool RouteEditor::IsComplete() const
+{
+    for (const auto& leg : legs_)
+    {
+        if (!leg.is_found)
+            return false;
+    }
+
+    return !legs_.empty();
+}
+
+double RouteEditor::Cost() const
+{
+    auto cost = 0.0;
+    for (const auto& leg : legs_)
+        cost += leg.cost;
+
+    return cost;
+}
@@ -0,0 +1,125 @@
+#ifndef ROUTEEDITOR_H
+#define ROUTEEDITOR_H
+
+#include <QObject>
+
+#include "RoutingData.h"
+#include "SearchSpace.h"
+#include "RoutingService.h"
+
+class RouteEditor;
+using RouteEditorUPtr = std::unique_ptr<RouteEditor>;
+
+/* Route through ordered waypoints (start, vias, end) edited by dragging one
+waypoint at a time. While waypoint is dragged its neighbours are fixed, so
+forward search tree from the previous waypoint and backward one from the next
+are kept between moves and only grown when new position is outside of them.
+Reroute on mouse move usually costs a snap and a walk along parent arcs.
+When routing service is given, legs of new waypoints are routed in parallel
+without waiting for them: results come through the event loop of the main
+thread and LegsRouted is emitted when the last one arrives. Legs still being
+routed have no path meanwhile */
+class RouteEditor : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr size_t kNoWaypoint = std::numeric_limits<size_t>::max();
+
+    //! Routing service, when given, is expected to hold the same road overrides
+    static RouteEditorUPtr Create(RoutingDataSPtr routing_data_s_ptr, const routing_profile::Type routing_profile_type,
+                                  RoutingService* routing_service = nullptr, RoadOverridesSPtr road_overrides_s_ptr = nullptr);
+
+    //! Replaces waypoints and routes every leg, returns false if some leg routed at once has no path
+    bool SetWaypoints(const std::vector<projection::Epsg3857Point>& waypoints);
+    //! Reroutes every leg for another profile
+    bool SetRoutingProfile(const routing_profile::Type routing_profile_type);
+    //! Reroutes every leg respecting new closures and penalties
+    bool SetRoadOverrides(RoadOverridesSPtr road_overrides_s_ptr);
+
+    size_t WaypointCount() const { return waypoints_.size(); }
+    const projection::Epsg3857Point& Waypoint(const size_t waypoint) const { return waypoints_[waypoint].point; }
+    std::vector<projection::Epsg3857Point> Waypoints() const;
+
+    //! Leg whose geometry passes nearest to point, legs are numbered by their start waypoint
+    size_t FindNearestLeg(const projection::Epsg3857Point& point) const;
+    //! Splits leg with new via waypoint, returns index of inserted waypoint
+    size_t InsertWaypoint(const size_t leg, const projection::Epsg3857Point& point);
+
+    void BeginDrag(const size_t waypoint);
+    //! Moves dragged waypoint and reroutes legs adjacent to it, returns false if one of them has no path
+    bool DragTo(const projection::Epsg3857Point& point);
+    void EndDrag();
+
+    //! Whether every leg has a path
+    bool IsComplete() const;
+    //! Whether legs are still routed by routing service
+    bool IsRouting() const { return pending_leg_count_ > 0; }
+    //! Travel time in seconds along all legs
+    double Cost() const;
+    size_t LegCount() const { return legs_.size(); }
+    //! Geometry of leg from its start waypoint to end one, empty if leg has no path
+    const std::vector<projection::Epsg3857Point>& LegPoints(const size_t leg) const { return legs_[leg].points; }
+
+signals:
+    //! Legs routed by routing service have arrived
+    void LegsRouted(const bool is_complete);
+
+private:
+    struct WaypointEntry
+    {
+        projection::Epsg3857Point point;
+        uint32_t vertex = 0;
+        bool is_snapped = false;
+    };
+
+    struct Leg
+    {
+        bool is_found = false;
+        double cost = SearchSpace::kInfinity;
+        //! Starts at start waypoint and ends at end waypoint
+        std::vector<projection::Epsg3857Point> points;
+    };
+
+    RoutingDataSPtr routing_data_s_ptr_;
+    routing_profile::Type routing_profile_type_;
+    RoutingService* routing_service_;
+    RoadOverridesSPtr road_overrides_s_ptr_;
+    //! Weights of profile with road overrides
+    ArcWeights arc_weights_;
+
+    std::vector<WaypointEntry> waypoints_;
+    //! Leg i goes from waypoint i to waypoint i + 1
+    std::vector<Leg> legs_;
+
+    size_t dragged_waypoint_ = kNoWaypoint;
+    //! Tree rooted at waypoint before dragged one
+    SearchSpace forward_search_space_;
+    //! Tree rooted at waypoint after dragged one, grown against arc direction
+    SearchSpace backward_search_space_;
+
+    std::vector<uint32_t> path_arcs_;
+
+    //! Changes whenever legs are routed anew, results of earlier routing are dropped
+    uint64_t routing_generation_ = 0;
+    size_t pending_leg_count_ = 0;
+
+    RouteEditor(RoutingDataSPtr routing_data_s_ptr, const routing_profile::Type routing_profile_type, RoutingService* routing_service,
+                RoadOverridesSPtr road_overrides_s_ptr);
+
+    WaypointEntry SnapWaypoint(const projection::Epsg3857Point& point) const;
+
+    //! Routes leg from scratch with A*
+    bool RouteLeg(const size_t leg);
+    //! Queues every leg on routing service threads, legs that do not fit the queue are routed at once
+    bool RouteLegsInParallel();
+    //! Stores leg routed by service unless waypoints changed since it was queued
+    void TakeLegRoute(const uint64_t routing_generation, const size_t leg, const projection::Epsg3857Point& start_point,
+                      const projection::Epsg3857Point& end_point, RoutingService::Route&& route);
+    //! Routes leg ending at dragged waypoint using forward tree
+    bool RouteLegToDragged(const size_t leg);
+    //! Routes leg starting at dragged waypoint using backward tree
+    bool RouteLegFromDragged(const size_t leg);
+};
+
+#endif // ROUTEEDITOR_H
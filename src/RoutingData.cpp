@@ -0,0 +1,58 @@
+#include "RoutingData.h"
+
+#include <iostream>
+
+RoutingData::RoutingData()
+{
+
+}
+
+RoutingDataSPtr RoutingData::Create(const QSqlDatabase& database, const RoadGraph::VertexOrder vertex_order)
+{
+    return Create(RoadGraph::Create(database, vertex_order));
+}
+
+RoutingDataSPtr RoutingData::Create(RoadGraphUPtr road_graph_u_ptr)
+{
+    if (!road_graph_u_ptr)
+    {
+        std::cerr << "RoutingData::Create Failed to load road graph" << std::endl;
+        return nullptr;
+    }
+
+    std::shared_ptr<RoutingData> instance(new RoutingData());
+
+    instance->road_graph_u_ptr_ = std::move(road_graph_u_ptr);
+
+    const auto& road_graph = *instance->road_graph_u_ptr_;
+
+    instance->spatial_index_u_ptr_ = SpatialIndex::Create(road_graph);
+
+    instance->car_arc_weights_ = ArcWeights::Build<routing_profile::Car>(road_graph);
+    instance->bike_arc_weights_ = ArcWeights::Build<routing_profile::Bike>(road_graph);
+    instance->foot_arc_weights_ = ArcWeights::Build<routing_profile::Foot>(road_graph);
+
+    return instance;
+}
+
+const ArcWeights& RoutingData::Weights(const routing_profile::Type routing_profile_type) const
+{
+    switch (routing_profile_type)
+    {
+    case routing_profile::Type::Bike: return bike_arc_weights_;
+    case routing_profile::Type::Foot: return foot_arc_weights_;
+    default: return car_arc_weights_;
+    }
+}
+
+bool RoutingData::FindNearestAccessibleVertex(const projection::Epsg3857Point& point, const routing_profile::Type routing_profile_type, uint32_t& vertex) const
+{
+    return FindNearestAccessibleVertex(point, Weights(routing_profile_type), vertex);
+}
+
+bool RoutingData::FindNearestAccessibleVertex(const projection::Epsg3857Point& point, const ArcWeights& arc_weights, uint32_t& vertex) const
+{
+    return spatial_index_u_ptr_->FindNearestVertex(point, [&arc_weights](const uint32_t vertex) {
+        return arc_weights.IsVertexAccessible(vertex);
+    }, vertex);
+}
@@ -0,0 +1,45 @@
+#ifndef ROUTINGDATA_H
+#define ROUTINGDATA_H
+
+#include <QSqlDatabase>
+
+#include "RoadGraph.h"
+#include "SpatialIndex.h"
+#include "ArcWeights.h"
+#include "RoutingProfile.h"
+
+class RoutingData;
+using RoutingDataSPtr = std::shared_ptr<const RoutingData>;
+
+/* Road graph with everything derived from it: spatial index and arc weights of
+every profile. Nothing changes after creation, so one instance is shared by any
+number of threads without locking. Per query state lives in SearchSpace */
+class RoutingData
+{
+public:
+    //! Loads graph using given connection, database is not used after return
+    static RoutingDataSPtr Create(const QSqlDatabase& database, const RoadGraph::VertexOrder vertex_order = RoadGraph::VertexOrder::Hilbert);
+    //! Derives index and weights from already loaded graph
+    static RoutingDataSPtr Create(RoadGraphUPtr road_graph_u_ptr);
+
+    const RoadGraph& Graph() const { return *road_graph_u_ptr_; }
+    const SpatialIndex& Index() const { return *spatial_index_u_ptr_; }
+    const ArcWeights& Weights(const routing_profile::Type routing_profile_type) const;
+
+    //! Finds nearest vertex usable by given profile
+    bool FindNearestAccessibleVertex(const projection::Epsg3857Point& point, const routing_profile::Type routing_profile_type, uint32_t& vertex) const;
+    //! Finds nearest vertex usable with given weights, which may carry road overrides
+    bool FindNearestAccessibleVertex(const projection::Epsg3857Point& point, const ArcWeights& arc_weights, uint32_t& vertex) const;
+
+private:
+    RoadGraphUPtr road_graph_u_ptr_;
+    SpatialIndexUPtr spatial_index_u_ptr_;
+
+    ArcWeights car_arc_weights_;
+    ArcWeights bike_arc_weights_;
+    ArcWeights foot_arc_weights_;
+
+    RoutingData();
+};
+
+#endif // ROUTINGDATA_H
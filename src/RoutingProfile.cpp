@@ -0,0 +1,81 @@
+#include "RoutingProfile.h"
+
+#include <unordered_map>
+
+namespace routing_profile {
+
+RoadClass ParseRoadClass(const std::string& highway)
+{
+    static const auto road_classes_u_map = std::unordered_map<std::string, RoadClass> {
+        { "motorway", RoadClass::Motorway },
+        { "motorway_link", RoadClass::MotorwayLink },
+        { "trunk", RoadClass::Trunk },
+        { "trunk_link", RoadClass::TrunkLink },
+        { "primary", RoadClass::Primary },
+        { "primary_link", RoadClass::PrimaryLink },
+        { "secondary", RoadClass::Secondary },
+        { "secondary_link", RoadClass::SecondaryLink },
+        { "tertiary", RoadClass::Tertiary },
+        { "tertiary_link", RoadClass::TertiaryLink },
+        { "unclassified", RoadClass::Unclassified },
+        { "road", RoadClass::Unclassified },
+        { "residential", RoadClass::Residential },
+        { "living_street", RoadClass::LivingStreet },
+        { "service", RoadClass::Service },
+        { "track", RoadClass::Track },
+        { "pedestrian", RoadClass::Pedestrian },
+        { "footway", RoadClass::Footway },
+        { "path", RoadClass::Path },
+        { "cycleway", RoadClass::Cycleway },
+        { "bridleway", RoadClass::Bridleway },
+        { "steps", RoadClass::Steps },
+    };
+
+    if (highway.empty())
+        return RoadClass::Unclassified;
+
+    const auto road_class = road_classes_u_map.find(highway);
+    if (road_class == road_classes_u_map.end())
+        return RoadClass::Other;
+
+    return road_class->second;
+}
+
+Oneway ParseOneway(const std::string& oneway)
+{
+    if (oneway == "yes" || oneway == "1" || oneway == "true")
+        return Oneway::Forward;
+
+    if (oneway == "-1" || oneway == "reverse")
+        return Oneway::Backward;
+
+    return Oneway::No;
+}
+
+bool ParseType(const std::string& name, Type& type)
+{
+    if (name == "car")
+        type = Type::Car;
+    else if (name == "bike")
+        type = Type::Bike;
+    else if (name == "foot")
+        type = Type::Foot;
+    else
+        return false;
+
+    return true;
+}
+
+const char* TypeName(const Type type)
+{
+    switch (type)
+    {
+    case Type::Car: return "car";
+    case Type::Bike: return "bike";
+    case Type::Foot: return "foot";
+    }
+
+    return "";
+}
+
+} // namespace routing_profile
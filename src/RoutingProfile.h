@@ -0,0 +1,189 @@
+#ifndef ROUTINGPROFILE_H
+#define ROUTINGPROFILE_H
+
+#include <string>
+#include <cstdint>
+#include <limits>
+
+namespace routing_profile {
+
+//! Value of highway tag of the road
+enum class RoadClass : uint8_t
+{
+    Motorway,
+    MotorwayLink,
+    Trunk,
+    TrunkLink,
+    Primary,
+    PrimaryLink,
+    Secondary,
+    SecondaryLink,
+    Tertiary,
+    TertiaryLink,
+    Unclassified,
+    Residential,
+    LivingStreet,
+    Service,
+    Track,
+    Pedestrian,
+    Footway,
+    Path,
+    Cycleway,
+    Bridleway,
+    Steps,
+    Other
+};
+
+//! Value of oneway tag relative to direction of road geometry
+enum class Oneway : uint8_t
+{
+    No,
+    Forward,
+    Backward
+};
+
+enum class Type
+{
+    Car,
+    Bike,
+    Foot
+};
+
+//! Empty value is treated as unclassified road, unknown values as Other which no profile can use
+RoadClass ParseRoadClass(const std::string& highway);
+Oneway ParseOneway(const std::string& oneway);
+
+//! Parses profile name (car, bike or foot), returns false for unknown name
+bool ParseType(const std::string& name, Type& type);
+const char* TypeName(const Type type);
+
+constexpr double KilometersPerHour(const double speed)
+{
+    return speed / 3.6;
+}
+
+/* Profiles are policy types for search templates. Each one defines speed
+in meters per second for every road class (0 if road is not accessible), maximal
+speed used by A* estimate and whether oneway tag is respected */
+struct Car
+{
+    static constexpr bool kRespectsOneway = true;
+    static constexpr double kMaxSpeed = KilometersPerHour(110);
+
+    static constexpr double Speed(const RoadClass road_class)
+    {
+        switch (road_class)
+        {
+        case RoadClass::Motorway: return KilometersPerHour(110);
+        case RoadClass::MotorwayLink: return KilometersPerHour(60);
+        case RoadClass::Trunk: return KilometersPerHour(90);
+        case RoadClass::TrunkLink: return KilometersPerHour(50);
+        case RoadClass::Primary: return KilometersPerHour(70);
+        case RoadClass::PrimaryLink: return KilometersPerHour(50);
+        case RoadClass::Secondary: return KilometersPerHour(60);
+        case RoadClass::SecondaryLink: return KilometersPerHour(40);
+        case RoadClass::Tertiary: return KilometersPerHour(50);
+        case RoadClass::TertiaryLink: return KilometersPerHour(40);
+        case RoadClass::Unclassified: return KilometersPerHour(40);
+        case RoadClass::Residential: return KilometersPerHour(30);
+        case RoadClass::LivingStreet: return KilometersPerHour(10);
+        case RoadClass::Service: return KilometersPerHour(15);
+        case RoadClass::Track: return KilometersPerHour(10);
+        default: return 0;
+        }
+    }
+};
+
+struct Bike
+{
+    static constexpr bool kRespectsOneway = true;
+    static constexpr double kMaxSpeed = KilometersPerHour(20);
+
+    static constexpr double Speed(const RoadClass road_class)
+    {
+        switch (road_class)
+        {
+        case RoadClass::Motorway:
+        case RoadClass::MotorwayLink:
+        case RoadClass::Trunk:
+        case RoadClass::TrunkLink:
+        case RoadClass::Other:
+            return 0;
+        case RoadClass::Cycleway: return KilometersPerHour(20);
+        case RoadClass::LivingStreet: return KilometersPerHour(12);
+        case RoadClass::Track:
+        case RoadClass::Path:
+            return KilometersPerHour(12);
+        case RoadClass::Bridleway: return KilometersPerHour(10);
+        case RoadClass::Pedestrian:
+        case RoadClass::Footway:
+            return KilometersPerHour(6);
+        case RoadClass::Steps: return KilometersPerHour(2);
+        default: return KilometersPerHour(18);
+        }
+    }
+};
+
+struct Foot
+{
+    static constexpr bool kRespectsOneway = false;
+    static constexpr double kMaxSpeed = KilometersPerHour(5);
+
+    static constexpr double Speed(const RoadClass road_class)
+    {
+        switch (road_class)
+        {
+        case RoadClass::Motorway:
+        case RoadClass::MotorwayLink:
+        case RoadClass::Trunk:
+        case RoadClass::TrunkLink:
+        case RoadClass::Other:
+            return 0;
+        case RoadClass::Steps: return KilometersPerHour(3);
+        default: return KilometersPerHour(5);
+        }
+    }
+};
+
+constexpr float kInaccessible = std::numeric_limits<float>::infinity();
+
+//! Travel time in seconds along road in given direction, kInaccessible if profile cannot use it
+template <typename Profile>
+inline float ArcCost(const RoadClass road_class, const Oneway oneway, const double length, const bool is_forward)
+{
+    const auto speed = Profile::Speed(road_class);
+    if (speed <= 0)
+        return kInaccessible;
+
+    if (Profile::kRespectsOneway
+        && ((oneway == Oneway::Forward && !is_forward) || (oneway == Oneway::Backward && is_forward)))
+        return kInaccessible;
+
+    return static_cast<float>(length / speed);
+}
+
+/* Lower bound of travel time for straight line distance, used as A* estimate.
+Slightly reduced because arc costs are rounded to float */
+template <typename Profile>
+inline double EstimateCost(const double distance)
+{
+    return distance * (0.99999 / Profile::kMaxSpeed);
+}
+
+/* Calls function with an instance of profile policy of the given type. Generic
+lambda receiving it instantiates search templates once per profile, so runtime
+profile choice costs one switch per query instead of a call per arc */
+template <typename Function>
+decltype(auto) Dispatch(const Type type, Function function)
+{
+    switch (type)
+    {
+    case Type::Bike: return function(Bike());
+    case Type::Foot: return function(Foot());
+    default: return function(Car());
+    }
+}
+
+} // namespace routing_profile
+
+#endif // ROUTINGPROFILE_H
@@ -0,0 +1,198 @@
+#include "RoutingService.h"
+
+#include <iostream>
+#include <algorithm>
+
+#include "AStar.h"
+#include "Trace.h"
+
+RoutingService::RoutingService(RoutingDataSPtr routing_data_s_ptr, const size_t max_queue_size)
+    : routing_data_s_ptr_(std::move(routing_data_s_ptr)), max_queue_size_(max_queue_size)
+{
+
+}
+
+RoutingServiceUPtr RoutingService::Create(RoutingDataSPtr routing_data_s_ptr, const unsigned int thread_count, const size_t max_queue_size)
+{
+    if (!routing_data_s_ptr)
+    {
+        std::cerr << "RoutingService::Create Routing data is not loaded" << std::endl;
+        return nullptr;
+    }
+
+    std::unique_ptr<RoutingService> instance(new RoutingService(std::move(routing_data_s_ptr), std::max<size_t>(1, max_queue_size)));
+
+    for (unsigned int i = 0; i < std::max(1u, thread_count); i++)
+        instance->worker_threads_.emplace_back([instance = instance.get()]() { instance->RunWorker(); });
+
+    return instance;
+}
+
+RoutingService::~RoutingService()
+{
+    {
+        std::lock_guard route_task_queue_lock(route_task_queue_mutex_);
+        is_stopped_.store(true);
+    }
+
+    route_task_added_or_stop_cv_.notify_all();
+    route_task_taken_or_stop_cv_.notify_all();
+
+    for (auto& worker_thread : worker_threads_)
+    {
+        if (worker_thread.joinable())
+            worker_thread.join();
+    }
+
+    // Waiting callers get empty route instead of broken promise, callbacks may refer to objects being destroyed
+    for (; !route_task_queue_.empty();)
+    {
+        if (!route_task_queue_.front().on_routed)
+            route_task_queue_.front().route_promise.set_value(Route());
+
+        route_task_queue_.pop();
+    }
+}
+
+std::future<RoutingService::Route> RoutingService::Submit(const projection::Epsg3857Point& start_point, const projection::Epsg3857Point& end_point,
+                                                          const routing_profile::Type routing_profile_type)
+{
+    auto route_task = RouteTask { start_point, end_point, routing_profile_type, std::promise<Route>(), nullptr, nullptr };
+    auto route_future = route_task.route_promise.get_future();
+    Enqueue(std::move(route_task), true);
+
+    return route_future;
+}
+
+bool RoutingService::TrySubmit(const projection::Epsg3857Point& start_point, const projection::Epsg3857Point& end_point,
+                               const routing_profile::Type routing_profile_type, std::future<Route>& route_future)
+{
+    auto route_task = RouteTask { start_point, end_point, routing_profile_type, std::promise<Route>(), nullptr, nullptr };
+    auto task_future = route_task.route_promise.get_future();
+    if (!Enqueue(std::move(route_task), false))
+        return false;
+
+    route_future = std::move(task_future);
+
+    return true;
+}
+
+bool RoutingService::TrySubmit(const projection::Epsg3857Point& start_point, const projection::Epsg3857Point& end_point,
+                               const routing_profile::Type routing_profile_type, RouteCallback on_routed)
+{
+    return Enqueue(RouteTask { start_point, end_point, routing_profile_type, std::promise<Route>(), std::move(on_routed), nullptr }, false);
+}
+
+void RoutingService::Complete(RouteTask& route_task, Route&& route)
+{
+    if (route_task.on_routed)
+        route_task.on_routed(std::move(route));
+    else
+        route_task.route_promise.set_value(std::move(route));
+}
+
+void RoutingService::SetRoadOverrides(RoadOverridesSPtr road_overrides_s_ptr)
+{
+    std::lock_guard route_task_queue_lock(route_task_queue_mutex_);
+    road_overrides_s_ptr_ = std::move(road_overrides_s_ptr);
+}
+
+bool RoutingService::Enqueue(RouteTask&& route_task, const bool is_blocking)
+{
+    std::unique_lock route_task_queue_lock(route_task_queue_mutex_);
+
+    if (is_blocking)
+    {
+        route_task_taken_or_stop_cv_.wait(route_task_queue_lock, [this]() {
+            return route_task_queue_.size() < max_queue_size_ || is_stopped_.load();
+        });
+    }
+    else if (route_task_queue_.size() >= max_queue_size_)
+    {
+        return false;
+    }
+
+    route_task.road_overrides_s_ptr = road_overrides_s_ptr_;
+
+    if (is_stopped_.load())
+    {
+        route_task_queue_lock.unlock();
+        Complete(route_task, Route());
+        return true;
+    }
+
+    route_task_queue_.push(std::move(route_task));
+    route_task_queue_lock.unlock();
+
+    route_task_added_or_stop_cv_.notify_one();
+
+    return true;
+}
+
+void RoutingService::RunWorker()
+{
+    auto search_space = SearchSpace(routing_data_s_ptr_->Graph().VertexCount());
+
+    for (;;)
+    {
+        std::unique_lock route_task_queue_lock(route_task_queue_mutex_);
+        route_task_added_or_stop_cv_.wait(route_task_queue_lock, [this]() {
+            return !route_task_queue_.empty() || is_stopped_.load();
+        });
+
+        if (is_stopped_.load())
+            break;
+
+        auto route_task = std::move(route_task_queue_.front());
+        route_task_queue_.pop();
+
+        route_task_queue_lock.unlock();
+        route_task_taken_or_stop_cv_.notify_one();
+
+        Complete(route_task, FindRoute(*routing_data_s_ptr_, route_task.start_point, route_task.end_point,
+                                       route_task.routing_profile_type, route_task.road_overrides_s_ptr, search_space));
+    }
+}
+
+RoutingService::Route RoutingService::FindRoute(const RoutingData& routing_data, const projection::Epsg3857Point& start_point, const projection::Epsg3857Point& end_point,
+                                                const routing_profile::Type routing_profile_type, const RoadOverridesSPtr& road_overrides_s_ptr,
+                                                SearchSpace& search_space)
+{
+    auto route = Route();
+
+    const auto& road_graph = routing_data.Graph();
+    const auto arc_weights = routing_data.Weights(routing_profile_type).WithOverrides(road_overrides_s_ptr);
+
+    uint32_t start_vertex, end_vertex;
+    {
+        const auto snap_span = trace::Span("Snap waypoints");
+        if (!routing_data.FindNearestAccessibleVertex(start_point, arc_weights, start_vertex)
+            || !routing_data.FindNearestAccessibleVertex(end_point, arc_weights, end_vertex))
+            return route;
+    }
+
+    {
+        const auto search_span = trace::Span("Route search");
+        route.is_found = routing_profile::Dispatch(routing_profile_type, [&](const auto profile) {
+            return astar::Search<decltype(profile)>(road_graph, arc_weights, start_vertex, end_vertex, search_space);
+        });
+    }
+
+    if (!route.is_found)
+        return route;
+
+    const auto shape_span = trace::Span("Route shape");
+
+    route.cost = search_space.Cost(end_vertex);
+
+    auto path_arcs = std::vector<uint32_t>();
+    search_space.BuildArcPath(end_vertex, path_arcs);
+
+    // Only edges of the path are decoded
+    route.points.push_back(start_point);
+    route.points.push_back(road_graph.VertexPoint(start_vertex));
+    road_graph.PathShape(path_arcs, route.points);
+    route.points.push_back(end_point);
+
+    return route;
+}
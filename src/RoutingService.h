@@ -0,0 +1,94 @@
+#ifndef ROUTINGSERVICE_H
+#define ROUTINGSERVICE_H
+
+#include <thread>
+#include <queue>
+#include <mutex>
+#include <atomic>
+#include <future>
+#include <functional>
+#include <condition_variable>
+
+#include "RoutingData.h"
+#include "SearchSpace.h"
+
+class RoutingService;
+using RoutingServiceUPtr = std::unique_ptr<RoutingService>;
+
+/* Answers point to point route queries on a pool of worker threads. All
+workers read the same RoutingData and own one SearchSpace each, which is
+reused between queries, so queries never wait for each other except
+for the queue. Queue is bounded: Submit blocks while it is full and
+TrySubmit gives up instead, so callers cannot pile up unbounded work.
+Callers that must not wait, like the UI thread, pass a callback instead of
+holding a future */
+class RoutingService
+{
+public:
+    struct Route
+    {
+        bool is_found = false;
+        //! Travel time in seconds between snapped vertices
+        double cost = SearchSpace::kInfinity;
+        //! Requested start point, shape of every road on the path and requested end point
+        std::vector<projection::Epsg3857Point> points;
+    };
+
+    using RouteCallback = std::function<void(Route&& route)>;
+
+    static RoutingServiceUPtr Create(RoutingDataSPtr routing_data_s_ptr, const unsigned int thread_count, const size_t max_queue_size);
+    ~RoutingService();
+
+    std::future<Route> Submit(const projection::Epsg3857Point& start_point, const projection::Epsg3857Point& end_point,
+                              const routing_profile::Type routing_profile_type);
+    //! Returns false without queueing if queue is full
+    bool TrySubmit(const projection::Epsg3857Point& start_point, const projection::Epsg3857Point& end_point,
+                   const routing_profile::Type routing_profile_type, std::future<Route>& route_future);
+    /* Returns false without queueing if queue is full. Otherwise on_routed is
+    called with the route in a worker thread, it is not called for tasks still
+    queued when service is destroyed */
+    bool TrySubmit(const projection::Epsg3857Point& start_point, const projection::Epsg3857Point& end_point,
+                   const routing_profile::Type routing_profile_type, RouteCallback on_routed);
+
+    //! Queries submitted afterwards use overrides, queued and running ones keep the previous snapshot
+    void SetRoadOverrides(RoadOverridesSPtr road_overrides_s_ptr);
+
+    //! Computes route in calling thread, search_space must be sized for the graph and not shared with other threads
+    static Route FindRoute(const RoutingData& routing_data, const projection::Epsg3857Point& start_point, const projection::Epsg3857Point& end_point,
+                           const routing_profile::Type routing_profile_type, const RoadOverridesSPtr& road_overrides_s_ptr,
+                           SearchSpace& search_space);
+
+private:
+    struct RouteTask
+    {
+        projection::Epsg3857Point start_point;
+        projection::Epsg3857Point end_point;
+        routing_profile::Type routing_profile_type;
+        std::promise<Route> route_promise;
+        //! Replaces promise when set
+        RouteCallback on_routed;
+        //! Taken when task is queued
+        RoadOverridesSPtr road_overrides_s_ptr;
+    };
+
+    RoutingDataSPtr routing_data_s_ptr_;
+    size_t max_queue_size_;
+
+    std::mutex route_task_queue_mutex_;
+    std::queue<RouteTask> route_task_queue_;
+    //! Guarded by the queue mutex
+    RoadOverridesSPtr road_overrides_s_ptr_;
+    std::condition_variable route_task_added_or_stop_cv_;
+    std::condition_variable route_task_taken_or_stop_cv_;
+
+    std::atomic<bool> is_stopped_ = false;
+    std::vector<std::thread> worker_threads_;
+
+    RoutingService(RoutingDataSPtr routing_data_s_ptr, const size_t max_queue_size);
+
+    bool Enqueue(RouteTask&& route_task, const bool is_blocking);
+    static void Complete(RouteTask& route_task, Route&& route);
+    void RunWorker();
+};
+
+#endif // ROUTINGSERVICE_H
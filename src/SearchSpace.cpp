@@ -0,0 +1,104 @@
+#include "SearchSpace.h"
+
+#include <algorithm>
+
+SearchSpace::SearchSpace(const size_t vertex_count)
+    : reached_stamps_(vertex_count, 0), settled_stamps_(vertex_count, 0),
+    costs_(vertex_count, kInfinity), parent_vertices_(vertex_count, kNoVertex), parent_arcs_(vertex_count, kNoVertex)
+{
+
+}
+
+void SearchSpace::Clear()
+{
+    stamp_++;
+
+    // On overflow old stamps could be mistaken for current ones
+    if (stamp_ == 0)
+    {
+        std::fill(reached_stamps_.begin(), reached_stamps_.end(), 0);
+        std::fill(settled_stamps_.begin(), settled_stamps_.end(), 0);
+        stamp_ = 1;
+    }
+
+    queue_.clear();
+    settled_vertices_.clear();
+
+    settled_count_ = 0;
+    relaxed_count_ = 0;
+}
+
+bool SearchSpace::Relax(const uint32_t vertex, const double cost, const double priority, const uint32_t parent_vertex, const uint32_t parent_arc)
+{
+    relaxed_count_++;
+
+    if (IsReached(vertex) && costs_[vertex] <= cost)
+        return false;
+
+    if (IsSettled(vertex))
+        return false;
+
+    reached_stamps_[vertex] = stamp_;
+    costs_[vertex] = cost;
+    parent_vertices_[vertex] = parent_vertex;
+    parent_arcs_[vertex] = parent_arc;
+
+    queue_.push_back(QueueEntry { priority, vertex });
+    std::push_heap(queue_.begin(), queue_.end(), std::greater<QueueEntry>());
+
+    return true;
+}
+
+bool SearchSpace::PopMin(uint32_t& vertex)
+{
+    DiscardSettled();
+
+    if (queue_.empty())
+        return false;
+
+    vertex = queue_.front().vertex;
+    std::pop_heap(queue_.begin(), queue_.end(), std::greater<QueueEntry>());
+    queue_.pop_back();
+
+    settled_stamps_[vertex] = stamp_;
+    settled_vertices_.push_back(vertex);
+    settled_count_++;
+
+    return true;
+}
+
+void SearchSpace::BuildPath(const uint32_t vertex, std::vector<uint32_t>& path_vertices) const
+{
+    path_vertices.clear();
+
+    for (auto path_vertex = vertex; path_vertex != kNoVertex; path_vertex = parent_vertices_[path_vertex])
+        path_vertices.push_back(path_vertex);
+
+    std::reverse(path_vertices.begin(), path_vertices.end());
+}
+
+void SearchSpace::BuildArcPath(const uint32_t vertex, std::vector<uint32_t>& path_arcs) const
+{
+    path_arcs.clear();
+
+    for (auto path_vertex = vertex; parent_vertices_[path_vertex] != kNoVertex; path_vertex = parent_vertices_[path_vertex])
+        path_arcs.push_back(parent_arcs_[path_vertex]);
+
+    std::reverse(path_arcs.begin(), path_arcs.end());
+}
+
+double SearchSpace::MinPriority()
+{
+    DiscardSettled();
+
+    return queue_.empty() ? kInfinity : queue_.front().priority;
+}
+
+void SearchSpace::DiscardSettled()
+{
+    for (; !queue_.empty() && IsSettled(queue_.front().vertex);)
+    {
+        std::pop_heap(queue_.begin(), queue_.end(), std::greater<QueueEntry>());
+        queue_.pop_back();
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef SEARCHSPACE_H
+#define SEARCHSPACE_H
+
+#include <vector>
+#include <limits>
+#include <cstdint>
+#include <functional>
+
+/* Scratch memory of a single shortest path search: tentative costs, parents
+and priority queue. Sized once for the whole graph and reused between searches,
+clearing takes O(1) because entries are validated by search stamp */
+class SearchSpace
+{
+public:
+    static constexpr uint32_t kNoVertex = std::numeric_limits<uint32_t>::max();
+    static constexpr double kInfinity = std::numeric_limits<double>::infinity();
+
+    explicit SearchSpace(const size_t vertex_count);
+
+    //! Forgets previous search and resets counters
+    void Clear();
+
+    bool IsReached(const uint32_t vertex) const { return reached_stamps_[vertex] == stamp_; }
+    bool IsSettled(const uint32_t vertex) const { return settled_stamps_[vertex] == stamp_; }
+
+    double Cost(const uint32_t vertex) const { return IsReached(vertex) ? costs_[vertex] : kInfinity; }
+    //! Previous vertex on the shortest path, kNoVertex for search roots
+    uint32_t ParentVertex(const uint32_t vertex) const { return parent_vertices_[vertex]; }
+    //! Arc used to reach vertex from its parent
+    uint32_t ParentArc(const uint32_t vertex) const { return parent_arcs_[vertex]; }
+
+    /* Adds vertex into queue or lowers its cost. Priority is cost for Dijkstra
+    or cost plus estimate for A*. Returns false if vertex is already reached cheaper */
+    bool Relax(const uint32_t vertex, const double cost, const double priority, const uint32_t parent_vertex, const uint32_t parent_arc);
+
+    //! Extracts vertex with minimal priority and marks it settled, returns false if queue is empty
+    bool PopMin(uint32_t& vertex);
+    //! Minimal priority in queue, kInfinity if queue is empty
+    double MinPriority();
+
+    //! Writes vertices of path from search root to vertex
+    void BuildPath(const uint32_t vertex, std::vector<uint32_t>& path_vertices) const;
+    //! Writes arcs of path from search root to vertex
+    void BuildArcPath(const uint32_t vertex, std::vector<uint32_t>& path_arcs) const;
+
+    //! Vertices settled by current search in order of settling
+    const std::vector<uint32_t>& SettledVertices() const { return settled_vertices_; }
+
+    size_t SettledCount() const { return settled_count_; }
+    size_t RelaxedCount() const { return relaxed_count_; }
+
+private:
+    struct QueueEntry
+    {
+        double priority;
+        uint32_t vertex;
+
+        bool operator>(const QueueEntry& entry) const
+        {
+            return priority > entry.priority;
+        }
+    };
+
+    uint32_t stamp_ = 1;
+    std::vector<uint32_t> reached_stamps_;
+    std::vector<uint32_t> settled_stamps_;
+
+    std::vector<double> costs_;
+    std::vector<uint32_t> parent_vertices_;
+    std::vector<uint32_t> parent_arcs_;
+
+    /* Binary min-heap with lazy deletion, outdated entries are skipped when they
+    reach the top. Kept in plain vector so its capacity survives Clear */
+    std::vector<QueueEntry> queue_;
+    std::vector<uint32_t> settled_vertices_;
+
+    size_t settled_count_ = 0;
+    size_t relaxed_count_ = 0;
+
+    void DiscardSettled();
+};
+
+#endif // SEARCHSPACE_H
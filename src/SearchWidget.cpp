@@ -0,0 +1,66 @@
+#include "SearchWidget.h"
+
+#include <algorithm>
+
+#include <QVBoxLayout>
+
+constexpr int kSearchWidgetWidth { 300 };
+constexpr int kMaxVisibleResultCount { 8 };
+
+SearchWidget::SearchWidget(QWidget* parent)
+    : QWidget(parent)
+{
+    query_edit_ = new QLineEdit(this);
+    query_edit_->setPlaceholderText("Search places and streets");
+    query_edit_->setClearButtonEnabled(true);
+    connect(query_edit_, &QLineEdit::textChanged, this, [this](const QString& query) { emit QueryChanged(query); });
+
+    results_list_ = new QListWidget(this);
+    results_list_->setVisible(false);
+    connect(results_list_, &QListWidget::itemActivated, this, [this](QListWidgetItem* item) { ChooseResult(results_list_->row(item)); });
+    connect(results_list_, &QListWidget::itemClicked, this, [this](QListWidgetItem* item) { ChooseResult(results_list_->row(item)); });
+
+    // Enter picks highlighted result or the best one
+    connect(query_edit_, &QLineEdit::returnPressed, this, [this]() {
+        if (results_list_->count() > 0)
+            ChooseResult(results_list_->currentRow() >= 0 ? results_list_->currentRow() : 0);
+    });
+
+    const auto layout = new QVBoxLayout(this);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->setSpacing(0);
+
+    layout->addWidget(query_edit_);
+    layout->addWidget(results_list_);
+
+    setLayout(layout);
+    setFixedWidth(kSearchWidgetWidth);
+    adjustSize();
+}
+
+void SearchWidget::SetResults(const QStringList& results)
+{
+    results_list_->clear();
+    results_list_->addItems(results);
+    results_list_->setVisible(!results.isEmpty());
+
+    if (!results.isEmpty())
+    {
+        const auto visible_count = std::min<int>(results.size(), kMaxVisibleResultCount);
+        results_list_->setFixedHeight(visible_count * results_list_->sizeHintForRow(0) + 2 * results_list_->frameWidth());
+    }
+
+    adjustSize();
+}
+
+void SearchWidget::ChooseResult(const int index)
+{
+    if (index < 0)
+        return;
+
+    emit ResultChosen(index);
+
+    results_list_->clear();
+    results_list_->setVisible(false);
+    adjustSize();
+}
@@ -0,0 +1,30 @@
+#ifndef SEARCHWIDGET_H
+#define SEARCHWIDGET_H
+
+#include <QWidget>
+#include <QLineEdit>
+#include <QListWidget>
+
+//! Search box with result list below it, searching itself is done by the owner
+class SearchWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit SearchWidget(QWidget* parent = nullptr);
+
+    //! Replaces shown results, empty list hides the list
+    void SetResults(const QStringList& results);
+
+signals:
+    void QueryChanged(const QString& query);
+    void ResultChosen(const int index);
+
+private:
+    QLineEdit* query_edit_;
+    QListWidget* results_list_;
+
+    void ChooseResult(const int index);
+};
+
+#endif // SEARCHWIDGET_H
@@ -0,0 +1,147 @@
+#include "SpatialIndex.h"
+
+#include <cmath>
+#include <algorithm>
+
+SpatialIndex::SpatialIndex(const RoadGraph& road_graph)
+    : road_graph_(road_graph)
+{
+
+}
+
+SpatialIndexUPtr SpatialIndex::Create(const RoadGraph& road_graph)
+{
+    std::unique_ptr<SpatialIndex> instance(new SpatialIndex(road_graph));
+
+    instance->BuildSegmentTree();
+    instance->BuildVertexTree();
+
+    return instance;
+}
+
+void SpatialIndex::BuildSegmentTree()
+{
+    auto segment_boxes = std::vector<PackedRTree::Box>();
+    auto shape = std::vector<projection::Epsg3857Point>();
+    double edge_offset;
+
+    for (uint32_t edge = 0; edge < road_graph_.EdgeCount(); edge++)
+    {
+        shape.clear();
+        road_graph_.EdgeShape(edge, shape);
+
+        edge_offset = 0;
+        for (size_t i = 1; i < shape.size(); i++)
+        {
+            const auto& start = shape[i - 1];
+            const auto& end = shape[i];
+
+            segment_edges_.push_back(edge);
+            segment_starts_.push_back(start);
+            segment_ends_.push_back(end);
+            segment_edge_offsets_.push_back(edge_offset);
+
+            segment_boxes.emplace_back(std::min(start.x, end.x), std::min(start.y, end.y),
+                                       std::max(start.x, end.x), std::max(start.y, end.y));
+
+            edge_offset += std::hypot(end.x - start.x, end.y - start.y);
+        }
+    }
+
+    segment_tree_.Build(segment_boxes);
+}
+
+void SpatialIndex::BuildVertexTree()
+{
+    auto is_routable = std::vector<bool>(road_graph_.VertexCount(), false);
+    for (uint32_t edge = 0; edge < road_graph_.EdgeCount(); edge++)
+    {
+        is_routable[road_graph_.EdgeSource(edge)] = true;
+        is_routable[road_graph_.EdgeTarget(edge)] = true;
+    }
+
+    auto vertex_boxes = std::vector<PackedRTree::Box>();
+    for (uint32_t vertex = 0; vertex < road_graph_.VertexCount(); vertex++)
+    {
+        if (!is_routable[vertex])
+            continue;
+
+        const auto& point = road_graph_.VertexPoint(vertex);
+        routable_vertices_.push_back(vertex);
+        vertex_boxes.emplace_back(point.x, point.y, point.x, point.y);
+    }
+
+    vertex_tree_.Build(vertex_boxes);
+}
+
+double SpatialIndex::ProjectOnSegment(const uint32_t segment, const projection::Epsg3857Point& point, projection::Epsg3857Point& projected_point) const
+{
+    const auto& start = segment_starts_[segment];
+    const auto& end = segment_ends_[segment];
+
+    const auto segment_dx = end.x - start.x;
+    const auto segment_dy = end.y - start.y;
+    const auto segment_squared_length = segment_dx * segment_dx + segment_dy * segment_dy;
+
+    auto t = 0.0;
+    if (segment_squared_length > 0)
+    {
+        t = ((point.x - start.x) * segment_dx + (point.y - start.y) * segment_dy) / segment_squared_length;
+        t = std::clamp(t, 0.0, 1.0);
+    }
+
+    projected_point.x = start.x + t * segment_dx;
+    projected_point.y = start.y + t * segment_dy;
+
+    const auto dx = point.x - projected_point.x;
+    const auto dy = point.y - projected_point.y;
+    return dx * dx + dy * dy;
+}
+
+bool SpatialIndex::FindNearestRoadPoint(const projection::Epsg3857Point& point, RoadProjection& road_projection) const
+{
+    auto projected_point = projection::Epsg3857Point();
+
+    uint32_t segment;
+    double squared_distance;
+    if (!segment_tree_.FindNearest(point.x, point.y,
+            [&, this](const uint32_t segment) { return ProjectOnSegment(segment, point, projected_point); },
+            segment, squared_distance))
+        return false;
+
+    ProjectOnSegment(segment, point, projected_point);
+
+    const auto& start = segment_starts_[segment];
+
+    road_projection.edge = segment_edges_[segment];
+    road_projection.point = projected_point;
+    road_projection.distance = std::sqrt(squared_distance);
+    road_projection.edge_offset = segment_edge_offsets_[segment] + std::hypot(projected_point.x - start.x, projected_point.y - start.y);
+
+    return true;
+}
+
+bool SpatialIndex::FindNearestVertex(const projection::Epsg3857Point& point, uint32_t& vertex) const
+{
+    return FindNearestVertex(point, [](const uint32_t) { return true; }, vertex);
+}
+
+void SpatialIndex::FindNearestRoadPoints(const std::vector<projection::Epsg3857Point>& points,
+                                         std::vector<RoadProjection>& road_projections, std::vector<bool>& found) const
+{
+    road_projections.resize(points.size());
+    found.resize(points.size());
+
+    for (size_t i = 0; i < points.size(); i++)
+        found[i] = FindNearestRoadPoint(points[i], road_projections[i]);
+}
+
+void SpatialIndex::FindNearestVertices(const std::vector<projection::Epsg3857Point>& points,
+                                       std::vector<uint32_t>& vertices, std::vector<bool>& found) const
+{
+    vertices.resize(points.size());
+    found.resize(points.size());
+
+    for (size_t i = 0; i < points.size(); i++)
+        found[i] = FindNearestVertex(points[i], vertices[i]);
+}
@@ -0,0 +1,87 @@
+#ifndef SPATIALINDEX_H
+#define SPATIALINDEX_H
+
+#include "PackedRTree.h"
+#include "RoadGraph.h"
+
+class SpatialIndex;
+using SpatialIndexUPtr = std::unique_ptr<SpatialIndex>;
+
+/* Index over road segments and routable vertices of RoadGraph. Replaces
+full table scans with ST_Distance for every click by in-process lookups */
+class SpatialIndex
+{
+public:
+    //! Point on the road nearest to the requested point
+    struct RoadProjection
+    {
+        uint32_t edge = 0;
+        projection::Epsg3857Point point;
+        double distance = 0;
+        //! Distance along the edge from its source to projected point
+        double edge_offset = 0;
+    };
+
+    static SpatialIndexUPtr Create(const RoadGraph& road_graph);
+
+    bool FindNearestRoadPoint(const projection::Epsg3857Point& point, RoadProjection& road_projection) const;
+    //! Finds nearest vertex that has at least one edge
+    bool FindNearestVertex(const projection::Epsg3857Point& point, uint32_t& vertex) const;
+    //! Finds nearest vertex that has at least one edge and satisfies is_accepted(vertex)
+    template <typename Predicate>
+    bool FindNearestVertex(const projection::Epsg3857Point& point, Predicate is_accepted, uint32_t& vertex) const;
+
+    //! Batch versions, result i is valid only if found[i] is true
+    void FindNearestRoadPoints(const std::vector<projection::Epsg3857Point>& points,
+                               std::vector<RoadProjection>& road_projections, std::vector<bool>& found) const;
+    void FindNearestVertices(const std::vector<projection::Epsg3857Point>& points,
+                             std::vector<uint32_t>& vertices, std::vector<bool>& found) const;
+
+private:
+    const RoadGraph& road_graph_;
+
+    PackedRTree segment_tree_;
+    std::vector<uint32_t> segment_edges_;
+    std::vector<projection::Epsg3857Point> segment_starts_;
+    std::vector<projection::Epsg3857Point> segment_ends_;
+    //! Distance along the edge from its source to segment start
+    std::vector<double> segment_edge_offsets_;
+
+    PackedRTree vertex_tree_;
+    std::vector<uint32_t> routable_vertices_;
+
+    SpatialIndex(const RoadGraph& road_graph);
+
+    void BuildSegmentTree();
+    void BuildVertexTree();
+
+    //! Projects point onto segment, returns squared distance to projection
+    double ProjectOnSegment(const uint32_t segment, const projection::Epsg3857Point& point, projection::Epsg3857Point& projected_point) const;
+};
+
+template <typename Predicate>
+bool SpatialIndex::FindNearestVertex(const projection::Epsg3857Point& point, Predicate is_accepted, uint32_t& vertex) const
+{
+    uint32_t item;
+    double squared_distance;
+    const auto found = vertex_tree_.FindNearest(point.x, point.y,
+        [&, this](const uint32_t item) {
+            // Infinite distance keeps rejected vertices out of the search queue
+            if (!is_accepted(routable_vertices_[item]))
+                return std::numeric_limits<double>::infinity();
+
+            const auto& vertex_point = road_graph_.VertexPoint(routable_vertices_[item]);
+            const auto dx = point.x - vertex_point.x;
+            const auto dy = point.y - vertex_point.y;
+            return dx * dx + dy * dy;
+        },
+        item, squared_distance);
+
+    if (!found)
+        return false;
+
+    vertex = routable_vertices_[item];
+    return true;
+}
+
+#endif // SPATIALINDEX_H
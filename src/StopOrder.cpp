@@ -0,0 +1,148 @@
+#include "StopOrder.h"
+
+#include <cmath>
+#include <chrono>
+#include <limits>
+#include <algorithm>
+
+//! Unreachable pairs get finite cost, so that sums stay comparable
+constexpr double kUnreachableStopCost { 1e12 };
+//! Longest chain of stops moved by Or-opt
+constexpr size_t kMaxOrOptSegmentLength { 3 };
+
+namespace stop_order {
+
+double PathCost(const std::vector<double>& costs, const size_t stop_count, const std::vector<size_t>& order)
+{
+    auto cost = 0.0;
+    for (size_t i = 1; i < order.size(); i++)
+    {
+        const auto stop_cost = costs[order[i - 1] * stop_count + order[i]];
+        cost += std::isfinite(stop_cost) ? stop_cost : kUnreachableStopCost;
+    }
+
+    return cost;
+}
+
+void Optimize(const std::vector<double>& costs, const size_t stop_count, const bool is_last_fixed,
+              const double time_budget, std::vector<size_t>& order)
+{
+    order.clear();
+    if (stop_count == 0)
+        return;
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double, std::milli>(time_budget);
+    const auto cost = [&costs, stop_count](const size_t from, const size_t to) {
+        const auto stop_cost = costs[from * stop_count + to];
+        return std::isfinite(stop_cost) ? stop_cost : kUnreachableStopCost;
+    };
+
+    const auto has_fixed_end = is_last_fixed && stop_count > 1;
+
+    order.push_back(0);
+    if (has_fixed_end)
+        order.push_back(stop_count - 1);
+
+    // Nearest insertion: take stop closest to the path and put it where it adds least
+    auto is_inserted = std::vector<char>(stop_count, 0);
+    is_inserted[0] = 1;
+    if (has_fixed_end)
+        is_inserted[stop_count - 1] = 1;
+
+    for (; order.size() < stop_count;)
+    {
+        auto nearest_stop = stop_count;
+        auto nearest_cost = std::numeric_limits<double>::infinity();
+        for (size_t stop = 0; stop < stop_count; stop++)
+        {
+            if (is_inserted[stop])
+                continue;
+
+            for (const auto path_stop : order)
+            {
+                const auto stop_cost = std::min(cost(path_stop, stop), cost(stop, path_stop));
+                if (stop_cost < nearest_cost)
+                {
+                    nearest_cost = stop_cost;
+                    nearest_stop = stop;
+                }
+            }
+        }
+
+        // Position i means insertion before order[i], order.size() appends when end is free
+        auto best_position = order.size();
+        auto best_increase = std::numeric_limits<double>::infinity();
+        const auto last_position = has_fixed_end ? order.size() - 1 : order.size();
+        for (size_t position = 1; position <= last_position; position++)
+        {
+            const auto increase = position < order.size()
+                ? cost(order[position - 1], nearest_stop) + cost(nearest_stop, order[position]) - cost(order[position - 1], order[position])
+                : cost(order[position - 1], nearest_stop);
+
+            if (increase < best_increase)
+            {
+                best_increase = increase;
+                best_position = position;
+            }
+        }
+
+        order.insert(order.begin() + best_position, nearest_stop);
+        is_inserted[nearest_stop] = 1;
+    }
+
+    // Stops in [first_movable, end_movable) may change places
+    const auto first_movable = size_t(1);
+    const auto end_movable = has_fixed_end ? order.size() - 1 : order.size();
+    if (end_movable <= first_movable + 1)
+        return;
+
+    auto best_cost = PathCost(costs, stop_count, order);
+    auto candidate = std::vector<size_t>(order.size());
+    const auto try_candidate = [&]() {
+        const auto candidate_cost = PathCost(costs, stop_count, candidate);
+        if (candidate_cost >= best_cost - 1e-9)
+            return false;
+
+        best_cost = candidate_cost;
+        order.swap(candidate);
+        return true;
+    };
+
+    // Costs may be asymmetric, so moves are evaluated on the whole path
+    for (auto is_improved = true; is_improved && std::chrono::steady_clock::now() < deadline;)
+    {
+        is_improved = false;
+
+        // 2-opt: reverse order of stops [i, j]
+        for (auto i = first_movable; i + 1 < end_movable && std::chrono::steady_clock::now() < deadline; i++)
+        {
+            for (auto j = i + 1; j < end_movable; j++)
+            {
+                candidate = order;
+                std::reverse(candidate.begin() + i, candidate.begin() + j + 1);
+                is_improved = try_candidate() || is_improved;
+            }
+        }
+
+        // Or-opt: move chain of up to three stops to another place
+        for (size_t length = 1; length <= kMaxOrOptSegmentLength; length++)
+        {
+            for (auto i = first_movable; i + length <= end_movable && std::chrono::steady_clock::now() < deadline; i++)
+            {
+                for (auto position = first_movable; position + length <= end_movable; position++)
+                {
+                    if (position == i)
+                        continue;
+
+                    candidate = order;
+                    const auto chain = std::vector<size_t>(candidate.begin() + i, candidate.begin() + i + length);
+                    candidate.erase(candidate.begin() + i, candidate.begin() + i + length);
+                    candidate.insert(candidate.begin() + position, chain.begin(), chain.end());
+                    is_improved = try_candidate() || is_improved;
+                }
+            }
+        }
+    }
+}
+
+} // namespace stop_order
@@ -0,0 +1,23 @@
+#ifndef STOPORDER_H
+#define STOPORDER_H
+
+#include <vector>
+#include <cstddef>
+
+namespace stop_order {
+
+/* Orders stops to make path through all of them short. costs is row-major
+stop_count x stop_count matrix and may be asymmetric, unreachable pairs are
+infinity. First stop always stays first, is_last_fixed keeps the last stop
+last, otherwise path may end anywhere. Order is built by nearest insertion
+and improved by 2-opt and Or-opt moves until no move helps or time_budget
+(in milliseconds) is spent. order receives stop indexes in visiting order */
+void Optimize(const std::vector<double>& costs, const size_t stop_count, const bool is_last_fixed,
+              const double time_budget, std::vector<size_t>& order);
+
+//! Sum of costs along order
+double PathCost(const std::vector<double>& costs, const size_t stop_count, const std::vector<size_t>& order);
+
+} // namespace stop_order
+
+#endif // STOPORDER_H
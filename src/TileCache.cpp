@@ -0,0 +1,50 @@
+#include "TileCache.h"
+
+#include <QColor>
+
+TileCache::TileCache(const int tile_size, const size_t capacity)
+    : tile_size_(tile_size), capacity_(capacity)
+{
+
+}
+
+QPixmap TileCache::UniformPixmap(const uint32_t color)
+{
+    const auto uniform_pixmap = uniform_pixmaps_u_map_.find(color);
+    if (uniform_pixmap != uniform_pixmaps_u_map_.end())
+        return uniform_pixmap->second;
+
+    auto pixmap = QPixmap(tile_size_, tile_size_);
+    pixmap.fill(QColor(color & 0xff, (color >> 8) & 0xff, (color >> 16) & 0xff, color >> 24));
+
+    uniform_pixmaps_u_map_.emplace(color, pixmap);
+
+    return pixmap;
+}
+
+bool TileCache::FindImage(const uint64_t hash, QPixmap& pixmap)
+{
+    const auto image_position = image_positions_u_map_.find(hash);
+    if (image_position == image_positions_u_map_.end())
+        return false;
+
+    images_.splice(images_.begin(), images_, image_position->second);
+    pixmap = image_position->second->second;
+
+    return true;
+}
+
+void TileCache::InsertImage(const uint64_t hash, const QPixmap& pixmap)
+{
+    if (capacity_ == 0 || image_positions_u_map_.count(hash) > 0)
+        return;
+
+    if (images_.size() == capacity_)
+    {
+        image_positions_u_map_.erase(images_.back().first);
+        images_.pop_back();
+    }
+
+    images_.emplace_front(hash, pixmap);
+    image_positions_u_map_.emplace(hash, images_.begin());
+}
@@ -0,0 +1,40 @@
+#ifndef TILECACHE_H
+#define TILECACHE_H
+
+#include <list>
+#include <unordered_map>
+#include <cstdint>
+
+#include <QPixmap>
+
+/* Pixmaps of rendered tiles by content. Pixel identical tiles (sea, fields,
+forests at low zoom) get the same pixmap, which Qt shares between all scene
+items showing it, so they are decoded and kept in memory once. Any other 64-bit
+key works as well, hillshade keys its tiles by zoom and position */
+class TileCache
+{
+public:
+    TileCache(const int tile_size, const size_t capacity);
+
+    //! Pixmap filled with color, created on first request and kept for the lifetime of cache
+    QPixmap UniformPixmap(const uint32_t color);
+
+    //! Finds image by content hash and marks it recently used
+    bool FindImage(const uint64_t hash, QPixmap& pixmap);
+    //! Adds image, least recently used one is dropped when cache is full
+    void InsertImage(const uint64_t hash, const QPixmap& pixmap);
+
+private:
+    using ImageEntry = std::pair<uint64_t, QPixmap>;
+
+    int tile_size_;
+    size_t capacity_;
+
+    std::unordered_map<uint32_t, QPixmap> uniform_pixmaps_u_map_;
+
+    //! Most recently used first
+    std::list<ImageEntry> images_;
+    std::unordered_map<uint64_t, std::list<ImageEntry>::iterator> image_positions_u_map_;
+};
+
+#endif // TILECACHE_H
@@ -0,0 +1,303 @@
+#include "Trace.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+
+#include <unistd.h>
+
+//! Spans kept by each thread between flushes
+constexpr size_t kTraceBufferCapacity { 1 << 14 };
+
+struct TraceEvent
+{
+    const char* name;
+    uint64_t task_id;
+    int64_t start_time;
+    int64_t duration;
+};
+
+/* Written only by its thread: slot is filled first, then the count is
+published. Reader takes the published range and drops spans which the
+writer may have overwritten while they were copied */
+struct TraceBuffer
+{
+    uint32_t thread_id = 0;
+    std::string thread_name;
+    bool is_thread_name_flushed = false;
+
+    std::array<TraceEvent, kTraceBufferCapacity> events;
+    std::atomic<uint64_t> written_count = 0;
+    //! Accessed under registry mutex
+    uint64_t flushed_count = 0;
+};
+
+struct TraceState
+{
+    std::atomic<bool> is_enabled = false;
+    std::string output_path;
+    std::string process_name;
+    bool is_process_name_flushed = false;
+
+    //! Buffers outlive their threads, spans of finished threads are still flushed
+    std::mutex buffers_mutex;
+    std::vector<std::unique_ptr<TraceBuffer>> buffers;
+};
+
+TraceState& GlobalTraceState()
+{
+    static auto trace_state = TraceState();
+    return trace_state;
+}
+
+TraceBuffer& ThreadTraceBuffer(const std::string* thread_name)
+{
+    thread_local TraceBuffer* trace_buffer = nullptr;
+
+    if (!trace_buffer)
+    {
+        auto& trace_state = GlobalTraceState();
+        std::lock_guard buffers_lock(trace_state.buffers_mutex);
+
+        trace_state.buffers.push_back(std::make_unique<TraceBuffer>());
+        trace_buffer = trace_state.buffers.back().get();
+        trace_buffer->thread_id = static_cast<uint32_t>(trace_state.buffers.size());
+        trace_buffer->thread_name = thread_name ? *thread_name : "Thread " + std::to_string(trace_buffer->thread_id);
+    }
+
+    return *trace_buffer;
+}
+
+int64_t TraceTime()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void AppendJsonString(const std::string& text, std::ostream& stream)
+{
+    stream << '"';
+    for (const auto character : text)
+    {
+        if (character == '"' || character == '\\')
+            stream << '\\' << character;
+        else if (static_cast<unsigned char>(character) >= 0x20)
+            stream << character;
+    }
+    stream << '"';
+}
+
+void AppendMetadataEvent(const char* name, const uint32_t thread_id, const std::string& value, std::ostream& stream)
+{
+    stream << R"({"name":")" << name << R"(","ph":"M","pid":)" << getpid() << R"(,"tid":)" << thread_id << R"(,"args":{"name":)";
+    AppendJsonString(value, stream);
+    stream << "}}\n";
+}
+
+void AppendSpanEvent(const TraceEvent& event, const uint32_t thread_id, std::ostream& stream)
+{
+    // Microseconds with nanosecond fraction, the unit of trace event format
+    stream << R"({"name":)";
+    AppendJsonString(event.name, stream);
+    stream << R"(,"cat":"openroute","ph":"X","ts":)" << event.start_time / 1000 << '.' << std::to_string(1000 + event.start_time % 1000).substr(1)
+           << R"(,"dur":)" << event.duration / 1000 << '.' << std::to_string(1000 + event.duration % 1000).substr(1)
+           << R"(,"pid":)" << getpid() << R"(,"tid":)" << thread_id;
+
+    if (event.task_id != 0)
+        stream << R"(,"args":{"task":)" << event.task_id << R"(},"bind_id":)" << event.task_id << R"(,"flow_in":true,"flow_out":true)";
+
+    stream << "}\n";
+}
+
+std::filesystem::path TracePartPath(const std::string& output_path, const std::string& part_name)
+{
+    auto part_path = std::filesystem::path(output_path);
+    part_path += "." + part_name + ".part";
+    return part_path;
+}
+
+//! Part files of all processes, they are named after output file
+std::vector<std::filesystem::path> TracePartPaths(const std::string& output_path)
+{
+    const auto output = std::filesystem::path(output_path);
+    const auto prefix = output.filename().string() + ".";
+    const auto directory = output.has_parent_path() ? output.parent_path() : std::filesystem::path(".");
+
+    auto part_paths = std::vector<std::filesystem::path>();
+    auto error_code = std::error_code();
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error_code))
+    {
+        const auto file_name = entry.path().filename().string();
+        if (file_name.size() > prefix.size() && file_name.compare(0, prefix.size(), prefix) == 0 && entry.path().extension() == ".part")
+            part_paths.push_back(entry.path());
+    }
+
+    std::sort(part_paths.begin(), part_paths.end());
+    return part_paths;
+}
+
+namespace trace {
+
+void Initialize(const std::string& process_name, const bool is_main_process)
+{
+    auto& trace_state = GlobalTraceState();
+
+    const auto output_path = std::getenv("OPENROUTE_TRACE");
+    if (!output_path || !*output_path)
+        return;
+
+    trace_state.output_path = output_path;
+    trace_state.process_name = process_name;
+
+    if (is_main_process)
+    {
+        auto error_code = std::error_code();
+        for (const auto& part_path : TracePartPaths(trace_state.output_path))
+            std::filesystem::remove(part_path, error_code);
+    }
+
+    trace_state.is_enabled.store(true);
+}
+
+bool IsEnabled()
+{
+    return GlobalTraceState().is_enabled.load(std::memory_order_relaxed);
+}
+
+void SetThreadName(const std::string& thread_name)
+{
+    if (IsEnabled())
+        ThreadTraceBuffer(&thread_name);
+}
+
+Span::Span(const char* name, const uint64_t task_id)
+    : name_(name), task_id_(task_id), start_time_(IsEnabled() ? TraceTime() : -1)
+{
+
+}
+
+Span::~Span()
+{
+    if (start_time_ < 0)
+        return;
+
+    auto& trace_buffer = ThreadTraceBuffer(nullptr);
+
+    const auto count = trace_buffer.written_count.load(std::memory_order_relaxed);
+    trace_buffer.events[count % kTraceBufferCapacity] = TraceEvent { name_, task_id_, start_time_, TraceTime() - start_time_ };
+    trace_buffer.written_count.store(count + 1, std::memory_order_release);
+}
+
+void Flush()
+{
+    if (!IsEnabled())
+        return;
+
+    auto& trace_state = GlobalTraceState();
+    std::lock_guard buffers_lock(trace_state.buffers_mutex);
+
+    auto stream = std::ostringstream();
+    if (!trace_state.is_process_name_flushed)
+    {
+        AppendMetadataEvent("process_name", 0, trace_state.process_name, stream);
+        trace_state.is_process_name_flushed = true;
+    }
+
+    auto lost_count = uint64_t(0);
+    auto events = std::vector<TraceEvent>();
+    for (const auto& trace_buffer : trace_state.buffers)
+    {
+        if (!trace_buffer->is_thread_name_flushed)
+        {
+            AppendMetadataEvent("thread_name", trace_buffer->thread_id, trace_buffer->thread_name, stream);
+            trace_buffer->is_thread_name_flushed = true;
+        }
+
+        const auto written_count = trace_buffer->written_count.load(std::memory_order_acquire);
+        auto first = std::max(trace_buffer->flushed_count, written_count > kTraceBufferCapacity ? written_count - kTraceBufferCapacity : 0);
+
+        events.clear();
+        for (auto position = first; position < written_count; position++)
+            events.push_back(trace_buffer->events[position % kTraceBufferCapacity]);
+
+        // Spans overwritten during the copy are dropped, including the slot a writer may be filling now
+        const auto rewritten_count = trace_buffer->written_count.load(std::memory_order_acquire);
+        const auto valid_first = rewritten_count + 1 > kTraceBufferCapacity ? rewritten_count + 1 - kTraceBufferCapacity : 0;
+        const auto skipped_count = valid_first > first ? std::min(valid_first - first, static_cast<uint64_t>(events.size())) : 0;
+
+        lost_count += first - trace_buffer->flushed_count + skipped_count;
+        for (auto event = events.begin() + skipped_count; event != events.end(); event++)
+            AppendSpanEvent(*event, trace_buffer->thread_id, stream);
+
+        trace_buffer->flushed_count = written_count;
+    }
+
+    if (lost_count > 0)
+        std::cerr << "trace::Flush " << lost_count << " spans were overwritten before flush" << std::endl;
+
+    auto part_file = std::ofstream(TracePartPath(trace_state.output_path, std::to_string(getpid())), std::ios::app);
+    part_file << stream.str();
+    if (!part_file)
+        std::cerr << "trace::Flush Failed to write part file" << std::endl;
+}
+
+bool Export()
+{
+    if (!IsEnabled())
+        return true;
+
+    Flush();
+
+    const auto& output_path = GlobalTraceState().output_path;
+    auto output_file = std::ofstream(output_path);
+    if (!output_file)
+    {
+        std::cerr << "trace::Export Failed to open " << output_path << std::endl;
+        return false;
+    }
+
+    output_file << "{\"traceEvents\":[\n";
+
+    auto is_first_event = true;
+    auto line = std::string();
+    auto error_code = std::error_code();
+    for (const auto& part_path : TracePartPaths(output_path))
+    {
+        // Process may be writing its part, only complete lines are taken
+        auto part_file = std::ifstream(part_path);
+        for (; std::getline(part_file, line);)
+        {
+            if (part_file.eof() || line.empty())
+                break;
+
+            if (!is_first_event)
+                output_file << ",\n";
+
+            output_file << line;
+            is_first_event = false;
+        }
+
+        part_file.close();
+        std::filesystem::remove(part_path, error_code);
+    }
+
+    output_file << "\n]}\n";
+
+    if (!output_file)
+    {
+        std::cerr << "trace::Export Failed to write " << output_path << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace trace
@@ -0,0 +1,45 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <string>
+#include <cstdint>
+
+/* Opt-in tracing of scoped spans, enabled when OPENROUTE_TRACE holds path of
+output file. Each thread records spans into its own ring buffer without locks,
+old spans are overwritten if the buffer is not flushed in time. Processes
+append their spans to part files next to the output, the main process merges
+them into trace event JSON, which opens in Perfetto or chrome://tracing. Spans
+with the same task id are linked by flow arrows across threads and processes.
+Timestamps come from monotonic clock shared by all processes of the machine */
+namespace trace {
+
+//! Main process removes part files left by previous run, merges parts in Export
+void Initialize(const std::string& process_name, const bool is_main_process);
+bool IsEnabled();
+//! Name shown for the calling thread, must be set before its first span
+void SetThreadName(const std::string& thread_name);
+
+//! Records time from construction to destruction. Name must be a string literal
+class Span
+{
+public:
+    explicit Span(const char* name, const uint64_t task_id = 0);
+    ~Span();
+
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+private:
+    const char* name_;
+    uint64_t task_id_;
+    int64_t start_time_;
+};
+
+//! Appends spans recorded since the previous call to part file of this process
+void Flush();
+//! Flushes and merges part files of all processes into the output file
+bool Export();
+
+} // namespace trace
+
+#endif // TRACE_H
@@ -0,0 +1,123 @@
+#include "Wkb.h"
+
+#include <cstring>
+#include <array>
+#include <algorithm>
+
+constexpr uint32_t kWkbLineStringType { 2 };
+constexpr uint32_t kWkbPolygonType { 3 };
+constexpr uint32_t kWkbMultiLineStringType { 5 };
+constexpr uint32_t kWkbMultiPolygonType { 6 };
+
+template <typename T>
+bool ReadWkbValue(const QByteArray& wkb, int& offset, const bool is_little_endian, T& value)
+{
+    if (offset + static_cast<int>(sizeof(T)) > wkb.size())
+        return false;
+
+    auto bytes = std::array<char, sizeof(T)>();
+    std::memcpy(bytes.data(), wkb.constData() + offset, sizeof(T));
+    offset += sizeof(T);
+
+    if (is_little_endian != (Q_BYTE_ORDER == Q_LITTLE_ENDIAN))
+        std::reverse(bytes.begin(), bytes.end());
+
+    std::memcpy(&value, bytes.data(), sizeof(T));
+    return true;
+}
+
+//! Reads byte order and type of geometry at offset
+bool ReadWkbHeader(const QByteArray& wkb, int& offset, bool& is_little_endian, uint32_t& geometry_type)
+{
+    if (offset >= wkb.size())
+        return false;
+
+    is_little_endian = wkb[offset] == 1;
+    offset++;
+
+    return ReadWkbValue(wkb, offset, is_little_endian, geometry_type);
+}
+
+bool ReadWkbPoints(const QByteArray& wkb, int& offset, const bool is_little_endian, const uint32_t count,
+                   std::vector<projection::Epsg3857Point>& points)
+{
+    // Count comes from the data, it is checked against the size before reserving
+    if (static_cast<int64_t>(count) * 2 * static_cast<int64_t>(sizeof(double)) > wkb.size() - offset)
+        return false;
+
+    points.reserve(points.size() + count);
+
+    double x, y;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (!ReadWkbValue(wkb, offset, is_little_endian, x) || !ReadWkbValue(wkb, offset, is_little_endian, y))
+            return false;
+
+        points.emplace_back(x, y);
+    }
+
+    return true;
+}
+
+namespace wkb {
+
+bool ParseLineString(const QByteArray& wkb, int& offset, std::vector<projection::Epsg3857Point>& points)
+{
+    bool is_little_endian;
+    uint32_t geometry_type;
+    if (!ReadWkbHeader(wkb, offset, is_little_endian, geometry_type))
+        return false;
+
+    uint32_t count;
+    if (!ReadWkbValue(wkb, offset, is_little_endian, count))
+        return false;
+
+    if (geometry_type == kWkbMultiLineStringType)
+        return count == 1 && ParseLineString(wkb, offset, points);
+
+    if (geometry_type != kWkbLineStringType)
+        return false;
+
+    return ReadWkbPoints(wkb, offset, is_little_endian, count, points);
+}
+
+bool ParsePolygons(const QByteArray& wkb, int& offset, std::vector<projection::Epsg3857Point>& points,
+                   std::vector<uint32_t>& ring_ends)
+{
+    bool is_little_endian;
+    uint32_t geometry_type;
+    if (!ReadWkbHeader(wkb, offset, is_little_endian, geometry_type))
+        return false;
+
+    uint32_t count;
+    if (!ReadWkbValue(wkb, offset, is_little_endian, count))
+        return false;
+
+    if (geometry_type == kWkbMultiPolygonType)
+    {
+        for (uint32_t polygon = 0; polygon < count; polygon++)
+        {
+            if (!ParsePolygons(wkb, offset, points, ring_ends))
+                return false;
+        }
+
+        return true;
+    }
+
+    if (geometry_type != kWkbPolygonType)
+        return false;
+
+    uint32_t point_count;
+    for (uint32_t ring = 0; ring < count; ring++)
+    {
+        if (!ReadWkbValue(wkb, offset, is_little_endian, point_count) ||
+            !ReadWkbPoints(wkb, offset, is_little_endian, point_count, points))
+            return false;
+
+        ring_ends.push_back(static_cast<uint32_t>(points.size()));
+    }
+
+    return true;
+}
+
+} // namespace wkb
@@ -0,0 +1,24 @@
+#ifndef WKB_H
+#define WKB_H
+
+#include <vector>
+#include <cstdint>
+
+#include <QByteArray>
+
+#include "Projection.h"
+
+//! Parsing of well-known binary geometries returned by ST_AsBinary
+namespace wkb {
+
+//! Appends points of LineString (or single part MultiLineString) to points
+bool ParseLineString(const QByteArray& wkb, int& offset, std::vector<projection::Epsg3857Point>& points);
+/* Appends rings of Polygon or MultiPolygon to points, end position of each
+ring in points is appended to ring_ends. Outer rings and holes are not told
+apart, even-odd rule over all rings gives the area */
+bool ParsePolygons(const QByteArray& wkb, int& offset, std::vector<projection::Epsg3857Point>& points,
+                   std::vector<uint32_t>& ring_ends);
+
+} // namespace wkb
+
+#endif // WKB_H
@@ -0,0 +1,525 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <random>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QSqlDatabase>
+#include <QtSql/QSqlError>
+
+#include "../NavigationManager.h"
+#include "../Dijkstra.h"
+#include "../AStar.h"
+#include "../Bidirectional.h"
+#include "../PagedAStar.h"
+
+//! Rank queries use targets settled 2^k-th by Dijkstra from source, k from this range
+constexpr int kMinRankExponent { 6 };
+constexpr int kMaxRankExponent { 24 };
+//! Rank exponents up to these bounds are short and medium queries, longer are long ones
+constexpr int kShortRankExponent { 10 };
+constexpr int kMediumRankExponent { 15 };
+
+constexpr double kCostRelativeTolerance { 1e-6 };
+
+enum class QueryGroup
+{
+    Random,
+    Short,
+    Medium,
+    Long
+};
+
+constexpr QueryGroup kQueryGroups[] = { QueryGroup::Random, QueryGroup::Short, QueryGroup::Medium, QueryGroup::Long };
+
+const char* QueryGroupName(const QueryGroup query_group)
+{
+    switch (query_group)
+    {
+    case QueryGroup::Short: return "short";
+    case QueryGroup::Medium: return "medium";
+    case QueryGroup::Long: return "long";
+    default: return "random";
+    }
+}
+
+struct BenchQuery
+{
+    uint32_t source;
+    uint32_t target;
+    QueryGroup group;
+};
+
+struct QueryResult
+{
+    double cost;
+    double latency;
+    size_t settled_count;
+    size_t relaxed_count;
+    uint64_t cache_miss_count;
+};
+
+/* Last level cache misses of this thread counted by kernel, vertex numbering
+shows in them more directly than in latency. Not available when kernel or
+virtual machine gives no hardware counters, or perf_event_paranoid forbids them */
+class CacheMissCounter
+{
+public:
+    CacheMissCounter()
+    {
+#if defined(__linux__)
+        perf_event_attr attributes;
+        std::memset(&attributes, 0, sizeof(attributes));
+        attributes.size = sizeof(attributes);
+        attributes.type = PERF_TYPE_HARDWARE;
+        attributes.config = PERF_COUNT_HW_CACHE_MISSES;
+        attributes.exclude_kernel = 1;
+        attributes.exclude_hv = 1;
+
+        file_descriptor_ = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+#endif
+    }
+
+    ~CacheMissCounter()
+    {
+#if defined(__linux__)
+        if (file_descriptor_ >= 0)
+            close(file_descriptor_);
+#endif
+    }
+
+    CacheMissCounter(const CacheMissCounter&) = delete;
+    CacheMissCounter& operator=(const CacheMissCounter&) = delete;
+
+    bool IsAvailable() const { return file_descriptor_ >= 0; }
+
+    //! Misses counted since creation, 0 if counter is not available
+    uint64_t Read() const
+    {
+        auto count = uint64_t(0);
+#if defined(__linux__)
+        if (file_descriptor_ >= 0 && read(file_descriptor_, &count, sizeof(count)) != sizeof(count))
+            count = 0;
+#endif
+        return count;
+    }
+
+private:
+    int file_descriptor_ = -1;
+};
+
+//! Search mode runs query in search_space and returns path cost, infinity if there is no path
+struct SearchMode
+{
+    std::string name;
+    std::function<double(uint32_t, uint32_t, SearchSpace&)> search;
+    //! Second search space of bidirectional modes, its counts are added to the main one
+    SearchSpace* backward_search_space = nullptr;
+    //! Adds counts of modes searching outside of search_space
+    std::function<void(QueryResult&)> add_counts;
+};
+
+//! Reads value in kB of field like VmRSS from /proc/self/status, 0 if it is not available
+size_t ReadProcessMemory(const std::string& field)
+{
+    auto file = std::ifstream("/proc/self/status");
+    auto line = std::string();
+    for (; std::getline(file, line);)
+    {
+        if (line.compare(0, field.size(), field) != 0 || line.size() <= field.size() || line[field.size()] != ':')
+            continue;
+
+        return std::stoull(line.substr(field.size() + 1));
+    }
+
+    return 0;
+}
+
+void GenerateRandomQueries(const std::vector<uint32_t>& accessible_vertices, const size_t query_count, std::mt19937_64& random_engine,
+                           std::vector<BenchQuery>& queries)
+{
+    auto distribution = std::uniform_int_distribution<size_t>(0, accessible_vertices.size() - 1);
+    for (size_t i = 0; i < query_count; i++)
+        queries.push_back(BenchQuery { accessible_vertices[distribution(random_engine)], accessible_vertices[distribution(random_engine)], QueryGroup::Random });
+}
+
+/* Dijkstra rank of vertex is its position in settle order of search from
+source, so 2^k ranks give queries of growing search size independent of
+graph density. One full search per source yields one query per k */
+void GenerateRankQueries(const RoadGraph& road_graph, const ArcWeights& arc_weights, const std::vector<uint32_t>& accessible_vertices,
+                         const size_t source_count, std::mt19937_64& random_engine, SearchSpace& search_space, std::vector<BenchQuery>& queries)
+{
+    auto distribution = std::uniform_int_distribution<size_t>(0, accessible_vertices.size() - 1);
+    auto settled_vertices = std::vector<uint32_t>();
+
+    for (size_t i = 0; i < source_count; i++)
+    {
+        const auto source = accessible_vertices[distribution(random_engine)];
+
+        settled_vertices.clear();
+        dijkstra::SearchBounded(road_graph, arc_weights, source, SearchSpace::kInfinity, search_space, settled_vertices);
+
+        for (auto rank_exponent = kMinRankExponent; rank_exponent <= kMaxRankExponent; rank_exponent++)
+        {
+            const auto rank = size_t(1) << rank_exponent;
+            if (rank >= settled_vertices.size())
+                break;
+
+            const auto group = rank_exponent <= kShortRankExponent ? QueryGroup::Short
+                : rank_exponent <= kMediumRankExponent ? QueryGroup::Medium : QueryGroup::Long;
+            queries.push_back(BenchQuery { source, settled_vertices[rank], group });
+        }
+    }
+}
+
+double Percentile(std::vector<double> values, const double fraction)
+{
+    if (values.empty())
+        return 0;
+
+    const auto index = static_cast<size_t>(std::ceil(fraction * values.size())) - 1;
+    std::nth_element(values.begin(), values.begin() + std::min(index, values.size() - 1), values.end());
+
+    return values[std::min(index, values.size() - 1)];
+}
+
+void PrintReport(const std::vector<SearchMode>& search_modes, const std::vector<BenchQuery>& queries,
+                 const std::vector<std::vector<QueryResult>>& results, const bool has_cache_misses)
+{
+    std::cout << std::left << std::setw(10) << "mode" << std::setw(8) << "group" << std::right
+              << std::setw(8) << "queries" << std::setw(12) << "p50 us" << std::setw(12) << "p90 us"
+              << std::setw(12) << "p99 us" << std::setw(12) << "max us"
+              << std::setw(14) << "settled" << std::setw(14) << "relaxed";
+    if (has_cache_misses)
+        std::cout << std::setw(14) << "LLC misses";
+    std::cout << std::endl;
+
+    std::cout << std::fixed << std::setprecision(1);
+
+    auto latencies = std::vector<double>();
+    for (size_t mode = 0; mode < search_modes.size(); mode++)
+    {
+        for (const auto query_group : kQueryGroups)
+        {
+            latencies.clear();
+            auto settled_sum = 0.0, relaxed_sum = 0.0, cache_miss_sum = 0.0;
+            for (size_t query = 0; query < queries.size(); query++)
+            {
+                if (queries[query].group != query_group)
+                    continue;
+
+                latencies.push_back(results[mode][query].latency);
+                settled_sum += results[mode][query].settled_count;
+                relaxed_sum += results[mode][query].relaxed_count;
+                cache_miss_sum += results[mode][query].cache_miss_count;
+            }
+
+            if (latencies.empty())
+                continue;
+
+            std::cout << std::left << std::setw(10) << search_modes[mode].name << std::setw(8) << QueryGroupName(query_group) << std::right
+                      << std::setw(8) << latencies.size()
+                      << std::setw(12) << Percentile(latencies, 0.5) << std::setw(12) << Percentile(latencies, 0.9)
+                      << std::setw(12) << Percentile(latencies, 0.99) << std::setw(12) << Percentile(latencies, 1)
+                      << std::setw(14) << settled_sum / latencies.size() << std::setw(14) << relaxed_sum / latencies.size();
+            if (has_cache_misses)
+                std::cout << std::setw(14) << cache_miss_sum / latencies.size();
+            std::cout << std::endl;
+        }
+    }
+}
+
+//! Compares costs of every mode with the first one, returns number of disagreeing queries
+size_t CheckCostAgreement(const RoadGraph& road_graph, const std::vector<SearchMode>& search_modes, const std::vector<BenchQuery>& queries,
+                          const std::vector<std::vector<QueryResult>>& results)
+{
+    auto mismatch_count = size_t(0);
+    for (size_t query = 0; query < queries.size(); query++)
+    {
+        const auto reference_cost = results[0][query].cost;
+        for (size_t mode = 1; mode < search_modes.size(); mode++)
+        {
+            const auto cost = results[mode][query].cost;
+            const auto is_equal = std::isfinite(reference_cost) == std::isfinite(cost)
+                && (!std::isfinite(cost) || std::abs(cost - reference_cost) <= kCostRelativeTolerance * std::max(1.0, reference_cost));
+
+            if (is_equal)
+                continue;
+
+            if (mismatch_count < 10)
+                std::cerr << "Cost mismatch " << road_graph.VertexId(queries[query].source) << " -> " << road_graph.VertexId(queries[query].target)
+                          << ": " << search_modes[0].name << " " << reference_cost << ", " << search_modes[mode].name << " " << cost << std::endl;
+
+            mismatch_count++;
+            break;
+        }
+    }
+
+    return mismatch_count;
+}
+
+//! Writes every query result as CSV, so runs can be compared line by line
+bool WriteResults(const std::string& path, const RoadGraph& road_graph, const std::vector<SearchMode>& search_modes,
+                  const std::vector<BenchQuery>& queries, const std::vector<std::vector<QueryResult>>& results)
+{
+    auto file = std::ofstream(path);
+    if (!file)
+    {
+        std::cerr << "WriteResults - failed to open " << path << std::endl;
+        return false;
+    }
+
+    file.imbue(std::locale::classic());
+    file.precision(10);
+
+    file << "mode,group,source_id,target_id,cost,latency_us,settled,relaxed,cache_misses\n";
+    for (size_t mode = 0; mode < search_modes.size(); mode++)
+    {
+        for (size_t query = 0; query < queries.size(); query++)
+        {
+            const auto& result = results[mode][query];
+            file << search_modes[mode].name << ',' << QueryGroupName(queries[query].group) << ','
+                 << road_graph.VertexId(queries[query].source) << ',' << road_graph.VertexId(queries[query].target) << ','
+                 << result.cost << ',' << result.latency << ',' << result.settled_count << ',' << result.relaxed_count << ','
+                 << result.cache_miss_count << '\n';
+        }
+    }
+
+    return static_cast<bool>(file);
+}
+
+/* Measures point to point search over the road graph loaded from database.
+Queries are generated from seed, so runs with the same seed and graph are
+comparable. Exit code is 2 if search modes disagree on path costs */
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("OpenRouteRouteBench");
+
+    auto parser = QCommandLineParser();
+    parser.setApplicationDescription("Benchmarks routing search modes on reproducible query sets");
+    parser.addHelpOption();
+
+    const auto random_option = QCommandLineOption("random", "Number of random queries.", "count", "1000");
+    const auto rank_sources_option = QCommandLineOption("rank-sources", "Number of sources for Dijkstra rank queries.", "count", "50");
+    const auto seed_option = QCommandLineOption("seed", "Seed of query generator.", "seed", "1");
+    const auto profile_option = QCommandLineOption("profile", "Routing profile: car, bike or foot.", "name", "car");
+    const auto modes_option = QCommandLineOption("modes", "Comma separated search modes (dijkstra, astar, bidirectional, paged), first one is reference for cost check.", "modes", "dijkstra,astar");
+    const auto output_option = QCommandLineOption("output", "CSV file for per query results.", "path");
+    const auto paged_budget_option = QCommandLineOption("paged-budget", "Cell cache budget of paged mode in MB.", "megabytes", "256");
+    const auto cell_zoom_option = QCommandLineOption("cell-zoom", "Zoom of tiles used as cells by paged mode.", "zoom",
+                                                     QString::number(PagedRoadGraph::kDefaultCellZoom));
+    const auto vertex_order_option = QCommandLineOption("vertex-order", "Vertex numbering of in-memory graph: hilbert or loaded.", "order", "hilbert");
+
+    parser.addOptions({ random_option, rank_sources_option, seed_option, profile_option, modes_option, output_option, paged_budget_option, cell_zoom_option,
+                        vertex_order_option });
+    parser.process(a);
+
+    auto routing_profile_type = routing_profile::Type();
+    if (!routing_profile::ParseType(parser.value(profile_option).toStdString(), routing_profile_type))
+    {
+        std::cerr << "OpenRouteRouteBench - unknown profile " << parser.value(profile_option).toStdString() << std::endl;
+        return 1;
+    }
+
+    // Loaded order keeps numbering of database or file, comparing the two shows what Hilbert order gains
+    auto vertex_order = RoadGraph::VertexOrder::Hilbert;
+    if (parser.value(vertex_order_option) == "loaded")
+    {
+        vertex_order = RoadGraph::VertexOrder::Loaded;
+    }
+    else if (parser.value(vertex_order_option) != "hilbert")
+    {
+        std::cerr << "OpenRouteRouteBench - unknown vertex order " << parser.value(vertex_order_option).toStdString() << std::endl;
+        return 1;
+    }
+
+    const auto memory_before_load = ReadProcessMemory("VmRSS");
+
+    const auto navigation_manager_u_ptr = NavigationManager::Create(vertex_order);
+    if (!navigation_manager_u_ptr)
+        return 1;
+
+    // Reference modes and vertex sampling need the loaded graph, paged mode is chosen with --modes
+    if (navigation_manager_u_ptr->IsPaged())
+    {
+        std::cerr << "OpenRouteRouteBench - unset OPENROUTE_PAGED_GRAPH, benchmark loads the whole graph" << std::endl;
+        return 1;
+    }
+
+    const auto routing_data_s_ptr = navigation_manager_u_ptr->SharedRoutingData();
+    const auto& road_graph = routing_data_s_ptr->Graph();
+    const auto& arc_weights = routing_data_s_ptr->Weights(routing_profile_type);
+
+    const auto memory_after_load = ReadProcessMemory("VmRSS");
+
+    auto available_modes = std::vector<SearchMode>();
+    available_modes.push_back(SearchMode { "dijkstra", [&](const uint32_t source, const uint32_t target, SearchSpace& search_space) {
+        dijkstra::StartSearch(source, search_space);
+        dijkstra::SearchUntilSettled(road_graph, arc_weights, target, false, search_space);
+        return search_space.Cost(target);
+    } });
+    available_modes.push_back(SearchMode { "astar", [&](const uint32_t source, const uint32_t target, SearchSpace& search_space) {
+        routing_profile::Dispatch(routing_profile_type, [&](const auto profile) {
+            return astar::Search<decltype(profile)>(road_graph, arc_weights, source, target, search_space);
+        });
+        return search_space.Cost(target);
+    } });
+    auto backward_search_space = SearchSpace(road_graph.VertexCount());
+    available_modes.push_back(SearchMode { "bidirectional", [&](const uint32_t source, const uint32_t target, SearchSpace& search_space) {
+        uint32_t meeting_vertex;
+        return bidirectional::Search(road_graph, arc_weights, source, target, 1.0, search_space, backward_search_space, meeting_vertex);
+    }, &backward_search_space });
+    // Same vertices are routed over graph fetched from database cell by cell, latency includes cell queries
+    auto paged_road_graph_u_ptr = PagedRoadGraphUPtr();
+    auto paged_search_state = paged_astar::SearchState();
+    auto paged_path_arcs = std::vector<PagedRoadGraph::ArcReference>();
+    available_modes.push_back(SearchMode { "paged", [&](const uint32_t source, const uint32_t target, SearchSpace& search_space) {
+        search_space.Clear();
+
+        const auto source_vertex = PagedRoadGraph::Vertex { road_graph.VertexId(source), road_graph.VertexPoint(source) };
+        const auto target_vertex = PagedRoadGraph::Vertex { road_graph.VertexId(target), road_graph.VertexPoint(target) };
+
+        auto cost = SearchSpace::kInfinity;
+        const auto is_found = routing_profile::Dispatch(routing_profile_type, [&](const auto profile) {
+            return paged_astar::Search<decltype(profile)>(*paged_road_graph_u_ptr, source_vertex, target_vertex, paged_search_state, cost, paged_path_arcs);
+        });
+
+        return is_found ? cost : SearchSpace::kInfinity;
+    }, nullptr, [&](QueryResult& query_result) {
+        query_result.settled_count += paged_search_state.SettledCount();
+        query_result.relaxed_count += paged_search_state.RelaxedCount();
+    } });
+
+    auto search_modes = std::vector<SearchMode>();
+    for (const auto& mode_name : parser.value(modes_option).split(','))
+    {
+        const auto mode = std::find_if(available_modes.begin(), available_modes.end(), [&mode_name](const SearchMode& search_mode) {
+            return search_mode.name == mode_name.trimmed().toStdString();
+        });
+
+        if (mode == available_modes.end())
+        {
+            std::cerr << "OpenRouteRouteBench - unknown mode " << mode_name.toStdString() << std::endl;
+            return 1;
+        }
+
+        search_modes.push_back(*mode);
+    }
+
+    // Paged graph queries its cells while searching, so its connection stays open
+    auto paged_database = QSqlDatabase();
+    if (std::any_of(search_modes.begin(), search_modes.end(), [](const SearchMode& search_mode) { return search_mode.name == "paged"; }))
+    {
+        paged_database = QSqlDatabase::addDatabase("QPSQL", "PagedRoadGraph");
+        paged_database.setHostName("localhost");
+        paged_database.setDatabaseName("gis");
+        paged_database.setUserName("mapper");
+        paged_database.setPassword("");
+
+        if (!paged_database.open())
+        {
+            std::cerr << "OpenRouteRouteBench - database connection error: " << paged_database.lastError().text().toStdString() << std::endl;
+            return 1;
+        }
+
+        paged_road_graph_u_ptr = PagedRoadGraph::Create(paged_database, parser.value(paged_budget_option).toULongLong() << 20,
+                                                        parser.value(cell_zoom_option).toUInt());
+        if (!paged_road_graph_u_ptr)
+            return 1;
+    }
+
+    auto accessible_vertices = std::vector<uint32_t>();
+    for (uint32_t vertex = 0; vertex < road_graph.VertexCount(); vertex++)
+    {
+        if (arc_weights.IsVertexAccessible(vertex))
+            accessible_vertices.push_back(vertex);
+    }
+
+    if (accessible_vertices.empty())
+    {
+        std::cerr << "OpenRouteRouteBench - graph has no vertices accessible by profile" << std::endl;
+        return 1;
+    }
+
+    auto search_space = SearchSpace(road_graph.VertexCount());
+
+    auto random_engine = std::mt19937_64(parser.value(seed_option).toULongLong());
+    auto queries = std::vector<BenchQuery>();
+    GenerateRandomQueries(accessible_vertices, parser.value(random_option).toULongLong(), random_engine, queries);
+    GenerateRankQueries(road_graph, arc_weights, accessible_vertices, parser.value(rank_sources_option).toULongLong(),
+                        random_engine, search_space, queries);
+
+    std::cout << "Graph: " << road_graph.VertexCount() << " vertices, " << road_graph.EdgeCount() << " edges, profile "
+              << routing_profile::TypeName(routing_profile_type) << ", " << queries.size() << " queries" << std::endl;
+
+    const auto cache_miss_counter = CacheMissCounter();
+    if (!cache_miss_counter.IsAvailable())
+        std::cout << "Cache misses: hardware counters are not available" << std::endl;
+
+    auto results = std::vector<std::vector<QueryResult>>(search_modes.size(), std::vector<QueryResult>(queries.size()));
+    for (size_t mode = 0; mode < search_modes.size(); mode++)
+    {
+        for (size_t query = 0; query < queries.size(); query++)
+        {
+            const auto start_cache_miss_count = cache_miss_counter.Read();
+            const auto start_time = std::chrono::steady_clock::now();
+            const auto cost = search_modes[mode].search(queries[query].source, queries[query].target, search_space);
+            const auto end_time = std::chrono::steady_clock::now();
+            const auto end_cache_miss_count = cache_miss_counter.Read();
+
+            results[mode][query] = QueryResult {
+                cost,
+                std::chrono::duration<double, std::micro>(end_time - start_time).count(),
+                search_space.SettledCount(),
+                search_space.RelaxedCount(),
+                end_cache_miss_count - start_cache_miss_count };
+
+            if (search_modes[mode].backward_search_space)
+            {
+                results[mode][query].settled_count += search_modes[mode].backward_search_space->SettledCount();
+                results[mode][query].relaxed_count += search_modes[mode].backward_search_space->RelaxedCount();
+            }
+
+            if (search_modes[mode].add_counts)
+                search_modes[mode].add_counts(results[mode][query]);
+        }
+    }
+
+    PrintReport(search_modes, queries, results, cache_miss_counter.IsAvailable());
+
+    if (paged_road_graph_u_ptr)
+        std::cout << "Paged graph: " << paged_road_graph_u_ptr->QueryCount() << " cell queries, "
+                  << paged_road_graph_u_ptr->CachedCellCount() << " cells cached, "
+                  << paged_road_graph_u_ptr->CachedByteCount() / (1 << 20) << " MB" << std::endl;
+
+    std::cout << "Memory: graph " << (memory_after_load - memory_before_load) / 1024 << " MB, resident "
+              << ReadProcessMemory("VmRSS") / 1024 << " MB, peak " << ReadProcessMemory("VmHWM") / 1024 << " MB" << std::endl;
+
+    if (parser.isSet(output_option) && !WriteResults(parser.value(output_option).toStdString(), road_graph, search_modes, queries, results))
+        return 1;
+
+    const auto mismatch_count = CheckCostAgreement(road_graph, search_modes, queries, results);
+    if (mismatch_count > 0)
+    {
+        std::cerr << "OpenRouteRouteBench - " << mismatch_count << " queries have different costs" << std::endl;
+        return 2;
+    }
+
+    std::cout << "Costs of all modes agree" << std::endl;
+
+    return 0;
+}
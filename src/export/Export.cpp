@@ -0,0 +1,155 @@
+#include <iostream>
+#include <atomic>
+#include <algorithm>
+#include <thread>
+#include <csignal>
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTimer>
+
+#include "MapExporter.h"
+
+//! How often interrupt request is checked, signal handler may only set a flag
+constexpr int kCancelCheckInterval { 100 };
+//! Deepest zoom of the application map, style has no detail beyond it
+constexpr unsigned int kMaxExportZoom { 22 };
+
+std::atomic<bool> is_export_interrupted { false };
+
+void OnExportInterrupt(int)
+{
+    is_export_interrupted = true;
+}
+
+/* Parses "left,bottom,right,top" extent, geographic one is projected corner by corner */
+bool ParseExtent(const QString& text, const bool is_epsg_4326, projection::Epsg3857Rect& epsg_3857_rect)
+{
+    const auto values = text.split(',');
+    if (values.size() != 4)
+    {
+        std::cerr << "ParseExtent - expected left,bottom,right,top" << std::endl;
+        return false;
+    }
+
+    double coordinates[4];
+    for (auto i = 0; i < 4; i++)
+    {
+        auto is_number = false;
+        coordinates[i] = values[i].toDouble(&is_number);
+        if (!is_number)
+        {
+            std::cerr << "ParseExtent - invalid number " << values[i].toStdString() << std::endl;
+            return false;
+        }
+    }
+
+    if (!is_epsg_4326)
+    {
+        epsg_3857_rect = projection::Epsg3857Rect(coordinates[0], coordinates[1], coordinates[2], coordinates[3]);
+        return true;
+    }
+
+    // Latitudes beyond the square map would project to infinity
+    coordinates[1] = std::max(coordinates[1], -projection::kEpsg3857MaxLatitude);
+    coordinates[3] = std::min(coordinates[3], projection::kEpsg3857MaxLatitude);
+
+    return projection::ToEpsg3857(projection::Epsg4326Point(coordinates[0], coordinates[1]), epsg_3857_rect.bottom_left_point)
+        && projection::ToEpsg3857(projection::Epsg4326Point(coordinates[2], coordinates[3]), epsg_3857_rect.top_right_point);
+}
+
+/* Command line front-end rendering large area of the map into one PNG file,
+run from the application directory as it starts renderer processes */
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("OpenRouteExport");
+
+    auto parser = QCommandLineParser();
+    parser.setApplicationDescription("Renders map area into PNG image of any size");
+    parser.addHelpOption();
+
+    const auto extent_option = QCommandLineOption("extent", "Area to render: left,bottom,right,top.", "bounds");
+    const auto crs_option = QCommandLineOption("crs", "Coordinate system of extent: 4326 (longitude,latitude) or 3857.", "epsg", "4326");
+    const auto zoom_option = QCommandLineOption("zoom", "Zoom level of rendering, pixel size is that of tiles at this zoom.", "level");
+    const auto output_option = QCommandLineOption("output", "Output PNG file.", "path");
+    const auto band_height_option = QCommandLineOption("band-height", "Rows rendered at once, memory grows with it.", "pixels", "512");
+    const auto processes_option = QCommandLineOption("processes", "Number of renderer processes.", "count",
+                                                     QString::number(std::max(1u, std::thread::hardware_concurrency())));
+
+    parser.addOptions({ extent_option, crs_option, zoom_option, output_option, band_height_option, processes_option });
+    parser.process(a);
+
+    if (!parser.isSet(extent_option) || !parser.isSet(zoom_option) || !parser.isSet(output_option))
+    {
+        std::cerr << "OpenRouteExport - --extent, --zoom and --output are required" << std::endl;
+        return 1;
+    }
+
+    auto is_zoom_valid = false;
+    const auto zoom = parser.value(zoom_option).toUInt(&is_zoom_valid);
+    if (!is_zoom_valid || zoom > kMaxExportZoom)
+    {
+        std::cerr << "OpenRouteExport - --zoom must be a whole number from 0 to " << kMaxExportZoom << std::endl;
+        return 1;
+    }
+
+    const auto crs = parser.value(crs_option);
+    if (crs != "4326" && crs != "3857")
+    {
+        std::cerr << "OpenRouteExport - unknown crs " << crs.toStdString() << ", expected 4326 or 3857" << std::endl;
+        return 1;
+    }
+
+    auto is_band_height_valid = false;
+    const auto band_height = parser.value(band_height_option).toUInt(&is_band_height_valid);
+    if (!is_band_height_valid || band_height == 0)
+    {
+        std::cerr << "OpenRouteExport - --band-height must be a positive whole number" << std::endl;
+        return 1;
+    }
+
+    auto is_process_count_valid = false;
+    const auto process_count = parser.value(processes_option).toUInt(&is_process_count_valid);
+    if (!is_process_count_valid || process_count == 0)
+    {
+        std::cerr << "OpenRouteExport - --processes must be a positive whole number" << std::endl;
+        return 1;
+    }
+
+    auto epsg_3857_rect = projection::Epsg3857Rect();
+    if (!ParseExtent(parser.value(extent_option), crs == "4326", epsg_3857_rect))
+        return 1;
+
+    const auto map_exporter_u_ptr = MapExporter::Create(epsg_3857_rect, zoom, parser.value(output_option).toStdString(),
+                                                        band_height, process_count);
+    if (!map_exporter_u_ptr)
+        return 1;
+
+    std::cerr << "OpenRouteExport - " << map_exporter_u_ptr->Width() << "x" << map_exporter_u_ptr->Height() << " pixels in "
+              << map_exporter_u_ptr->ChunkCount() << " chunks, up to " << map_exporter_u_ptr->MaxBandCount() << " bands in memory" << std::endl;
+
+    QObject::connect(map_exporter_u_ptr.get(), &MapExporter::Progress, [](const size_t rendered_chunk_count, const size_t chunk_count) {
+        std::cerr << "\rRendered " << rendered_chunk_count << " of " << chunk_count << " chunks" << std::flush;
+    });
+
+    QObject::connect(map_exporter_u_ptr.get(), &MapExporter::Finished, [&a](const bool is_completed) {
+        std::cerr << std::endl;
+        a.exit(is_completed ? 0 : 1);
+    });
+
+    // Ctrl+C stops the export and removes unfinished file
+    std::signal(SIGINT, OnExportInterrupt);
+    std::signal(SIGTERM, OnExportInterrupt);
+
+    auto cancel_timer = QTimer();
+    QObject::connect(&cancel_timer, &QTimer::timeout, [&map_exporter_u_ptr]() {
+        if (is_export_interrupted)
+            map_exporter_u_ptr->Cancel();
+    });
+    cancel_timer.start(kCancelCheckInterval);
+
+    map_exporter_u_ptr->Start();
+
+    return a.exec();
+}
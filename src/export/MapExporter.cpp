@@ -0,0 +1,408 @@
+#include "MapExporter.h"
+
+#include <iostream>
+#include <sstream>
+#include <cmath>
+#include <cstdio>
+#include <csetjmp>
+#include <algorithm>
+
+#include <QFile>
+#include <QVariant>
+
+constexpr unsigned int kExportTileSize { 256 };
+//! Mapnik refuses maps wider or higher than this
+constexpr unsigned int kMaxRenderSide { 16384 };
+//! Narrower chunks than mapnik allows spread a band over more processes
+constexpr unsigned int kMaxChunkWidth { 4096 };
+//! Largest image side libpng accepts by default
+constexpr uint64_t kMaxImageSide { 1000000 };
+//! PNG is compressed by one thread, fast level keeps it from becoming the slowest stage
+constexpr int kPngCompressionLevel { 3 };
+constexpr size_t kBytesPerPixel { 4 };
+/* Chunks are rendered this many pixels larger on every side and cropped, so
+mapnik places labels near chunk edges seeing the map around them instead of
+clipping them at the edge or moving them inside */
+constexpr unsigned int kChunkMargin { 128 };
+
+/* libpng reports errors by jumping back to the last setjmp, so calls to it are
+kept in small functions without objects that need destruction */
+bool BeginExportPng(png_structp png, png_infop png_info, FILE* file, const unsigned int width, const unsigned int height)
+{
+    if (setjmp(png_jmpbuf(png)))
+        return false;
+
+    png_init_io(png, file);
+    png_set_IHDR(png, png_info, width, height, 8, PNG_COLOR_TYPE_RGB_ALPHA, PNG_INTERLACE_NONE,
+                 PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    png_set_compression_level(png, kPngCompressionLevel);
+    png_write_info(png, png_info);
+
+    return true;
+}
+
+bool WriteExportPngRows(png_structp png, const uint8_t* pixels, const size_t row_size, const unsigned int row_count)
+{
+    if (setjmp(png_jmpbuf(png)))
+        return false;
+
+    for (unsigned int row = 0; row < row_count; row++)
+        png_write_row(png, pixels + row * row_size);
+
+    return true;
+}
+
+bool EndExportPng(png_structp png)
+{
+    if (setjmp(png_jmpbuf(png)))
+        return false;
+
+    png_write_end(png, nullptr);
+
+    return true;
+}
+
+MapExporter::MapExporter(const unsigned int zoom, const unsigned int band_height, QObject* parent)
+    : QObject(parent), zoom_(zoom), pixel_length_(projection::TileLength(zoom) / kExportTileSize), band_height_(band_height)
+{
+
+}
+
+MapExporter::~MapExporter()
+{
+    for (const auto process : processes_)
+    {
+        process->kill();
+        process->waitForFinished();
+    }
+
+    if (png_)
+        png_destroy_write_struct(&png_, &png_info_);
+
+    if (output_file_)
+        std::fclose(output_file_);
+}
+
+MapExporterUPtr MapExporter::Create(const projection::Epsg3857Rect& epsg_3857_rect, const unsigned int zoom, const std::string& output_path,
+                                    const unsigned int band_height, const unsigned int process_count, QObject* parent)
+{
+    if (band_height == 0 || process_count == 0)
+    {
+        std::cerr << "MapExporter::Create Band height and process count must be positive" << std::endl;
+        return nullptr;
+    }
+
+    if (band_height > kMaxRenderSide - 2 * kChunkMargin)
+    {
+        std::cerr << "MapExporter::Create Band height with margins exceeds " << kMaxRenderSide << " pixels" << std::endl;
+        return nullptr;
+    }
+
+    std::unique_ptr<MapExporter> instance(new MapExporter(zoom, band_height, parent));
+
+    // Rect is aligned to the pixel grid of the zoom, so chunks meet without resampling
+    const auto map_pixel_count = static_cast<double>(kExportTileSize) * std::ldexp(1.0, zoom);
+    const auto to_pixel = [&](const double pixel) {
+        return static_cast<uint64_t>(std::clamp(pixel, 0.0, map_pixel_count));
+    };
+
+    const auto& pixel_length = instance->pixel_length_;
+    const auto left_pixel = to_pixel(std::floor((epsg_3857_rect.bottom_left_point.x + projection::kEpsg3857Bound) / pixel_length));
+    const auto right_pixel = to_pixel(std::ceil((epsg_3857_rect.top_right_point.x + projection::kEpsg3857Bound) / pixel_length));
+    const auto top_pixel = to_pixel(std::floor((projection::kEpsg3857Bound - epsg_3857_rect.top_right_point.y) / pixel_length));
+    const auto bottom_pixel = to_pixel(std::ceil((projection::kEpsg3857Bound - epsg_3857_rect.bottom_left_point.y) / pixel_length));
+
+    if (right_pixel <= left_pixel || bottom_pixel <= top_pixel)
+    {
+        std::cerr << "MapExporter::Create Rect is empty or outside of the map" << std::endl;
+        return nullptr;
+    }
+
+    if (right_pixel - left_pixel > kMaxImageSide || bottom_pixel - top_pixel > kMaxImageSide)
+    {
+        std::cerr << "MapExporter::Create Image side exceeds " << kMaxImageSide << " pixels" << std::endl;
+        return nullptr;
+    }
+
+    instance->left_pixel_ = left_pixel;
+    instance->top_pixel_ = top_pixel;
+    instance->width_ = static_cast<unsigned int>(right_pixel - left_pixel);
+    instance->height_ = static_cast<unsigned int>(bottom_pixel - top_pixel);
+
+    instance->band_count_ = (instance->height_ + band_height - 1) / band_height;
+    instance->chunk_width_ = std::min(instance->width_, kMaxChunkWidth);
+    instance->band_chunk_count_ = (instance->width_ + instance->chunk_width_ - 1) / instance->chunk_width_;
+    // Band being written plus enough bands ahead to keep every process busy
+    instance->max_band_count_ = 1 + (process_count + instance->band_chunk_count_ - 1) / instance->band_chunk_count_;
+
+    if (!instance->raw_dir_.isValid())
+    {
+        std::cerr << "MapExporter::Create Failed to create temporary directory" << std::endl;
+        return nullptr;
+    }
+
+    instance->output_path_ = output_path;
+    instance->output_file_ = std::fopen(output_path.c_str(), "wb");
+    if (!instance->output_file_)
+    {
+        std::cerr << "MapExporter::Create Failed to open " << output_path << std::endl;
+        return nullptr;
+    }
+
+    instance->png_ = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+    if (instance->png_)
+        instance->png_info_ = png_create_info_struct(instance->png_);
+
+    if (!instance->png_info_ || !BeginExportPng(instance->png_, instance->png_info_, instance->output_file_, instance->width_, instance->height_))
+    {
+        std::cerr << "MapExporter::Create Failed to start PNG " << output_path << std::endl;
+        instance->Finish(false);
+        return nullptr;
+    }
+
+    for (unsigned int i = 0; i < process_count; i++)
+    {
+        const auto process = CreateProcess(i, instance.get());
+        if (!process)
+        {
+            instance->Finish(false);
+            return nullptr;
+        }
+
+        instance->processes_.push_back(process);
+        instance->free_process_pool_.emplace(process);
+    }
+
+    return instance;
+}
+
+void MapExporter::Start()
+{
+    DispatchChunks();
+}
+
+void MapExporter::Cancel()
+{
+    if (is_finished_)
+        return;
+
+    std::cerr << "MapExporter::Cancel Export cancelled" << std::endl;
+    Finish(false);
+}
+
+QString MapExporter::RawPath(const unsigned int process_index) const
+{
+    return raw_dir_.filePath(QString("chunk%1.rgba").arg(process_index));
+}
+
+void MapExporter::DispatchChunks()
+{
+    for (; !is_finished_ && !free_process_pool_.empty() && next_chunk_ < ChunkCount();)
+    {
+        const auto band = static_cast<unsigned int>(next_chunk_ / band_chunk_count_);
+        const auto chunk = static_cast<unsigned int>(next_chunk_ % band_chunk_count_);
+
+        // Bands far ahead of the written one wait, this is what bounds memory
+        if (band >= written_band_count_ + max_band_count_)
+            return;
+
+        const auto band_top = band * band_height_;
+        const auto band_rows = std::min(band_height_, height_ - band_top);
+        if (chunk == 0)
+        {
+            auto& new_band = bands_u_map_[band];
+            new_band.pixels.resize(static_cast<size_t>(width_) * band_rows * kBytesPerPixel);
+            new_band.remaining_chunk_count = band_chunk_count_;
+        }
+
+        const auto chunk_left = chunk * chunk_width_;
+        const auto chunk_columns = std::min(chunk_width_, width_ - chunk_left);
+
+        const auto left = (static_cast<double>(left_pixel_ + chunk_left) - kChunkMargin) * pixel_length_ - projection::kEpsg3857Bound;
+        const auto top = projection::kEpsg3857Bound - (static_cast<double>(top_pixel_ + band_top) - kChunkMargin) * pixel_length_;
+        const auto rendered_columns = chunk_columns + 2 * kChunkMargin;
+        const auto rendered_rows = band_rows + 2 * kChunkMargin;
+
+        auto data = QByteArray();
+        const auto append_value = [&](const auto& value) {
+            data.append(QByteArray::number(value));
+            data.append('\n');
+        };
+
+        append_value(left);
+        append_value(top - rendered_rows * pixel_length_);
+        append_value(left + rendered_columns * pixel_length_);
+        append_value(top);
+
+        append_value(chunk);
+        append_value(band);
+
+        append_value(zoom_);
+
+        append_value(++last_task_id_);
+
+        append_value(rendered_columns);
+        append_value(band_rows + 2 * kChunkMargin);
+
+        const auto process = free_process_pool_.front();
+        free_process_pool_.pop();
+        process->write(data);
+
+        next_chunk_++;
+    }
+}
+
+void MapExporter::OnChunkRendered()
+{
+    const auto process = qobject_cast<QProcess*>(sender());
+
+    // Reply is one line, the signal may come before all of it arrived
+    if (is_finished_ || !process->canReadLine())
+        return;
+
+    auto string_stream = std::istringstream(process->readLine().toStdString());
+
+    unsigned int chunk, band, zoom;
+    uint64_t task_id;
+    bool is_rendered = false;
+    string_stream >> chunk >> band >> zoom >> task_id >> is_rendered;
+
+    const auto band_it = bands_u_map_.find(band);
+    if (!is_rendered || band_it == bands_u_map_.end())
+    {
+        std::cerr << "MapExporter::OnChunkRendered Failed to render chunk " << chunk << " of band " << band << std::endl;
+        Finish(false);
+        return;
+    }
+
+    // Chunk rows without margin are copied into their place within band rows
+    auto& rendered_band = band_it->second;
+    const auto chunk_left = chunk * chunk_width_;
+    const auto chunk_columns = std::min(chunk_width_, width_ - chunk_left);
+    const auto chunk_row_size = static_cast<qint64>(chunk_columns * kBytesPerPixel);
+    const auto rendered_row_size = static_cast<qint64>((chunk_columns + 2 * kChunkMargin) * kBytesPerPixel);
+    const auto band_row_size = static_cast<size_t>(width_) * kBytesPerPixel;
+    const auto band_rows = rendered_band.pixels.size() / band_row_size;
+
+    auto raw_file = QFile(RawPath(process->property("process_index").toUInt()));
+    auto is_read = raw_file.open(QIODevice::ReadOnly);
+    for (size_t row = 0; is_read && row < band_rows; row++)
+    {
+        const auto row_pixels = reinterpret_cast<char*>(rendered_band.pixels.data() + row * band_row_size + chunk_left * kBytesPerPixel);
+        is_read = raw_file.seek((row + kChunkMargin) * rendered_row_size + kChunkMargin * kBytesPerPixel)
+            && raw_file.read(row_pixels, chunk_row_size) == chunk_row_size;
+    }
+
+    if (!is_read)
+    {
+        std::cerr << "MapExporter::OnChunkRendered Failed to read chunk " << chunk << " of band " << band << std::endl;
+        Finish(false);
+        return;
+    }
+
+    rendered_band.remaining_chunk_count--;
+    rendered_chunk_count_++;
+
+    free_process_pool_.emplace(process);
+
+    if (!WriteCompletedBands())
+    {
+        std::cerr << "MapExporter::OnChunkRendered Failed to write " << output_path_ << std::endl;
+        Finish(false);
+        return;
+    }
+
+    DispatchChunks();
+
+    emit Progress(rendered_chunk_count_, ChunkCount());
+
+    if (written_band_count_ == band_count_)
+        Finish(true);
+}
+
+bool MapExporter::WriteCompletedBands()
+{
+    for (;;)
+    {
+        const auto band_it = bands_u_map_.find(written_band_count_);
+        if (band_it == bands_u_map_.end() || band_it->second.remaining_chunk_count != 0)
+            return true;
+
+        const auto row_size = static_cast<size_t>(width_) * kBytesPerPixel;
+        const auto& pixels = band_it->second.pixels;
+        if (!WriteExportPngRows(png_, pixels.data(), row_size, static_cast<unsigned int>(pixels.size() / row_size)))
+            return false;
+
+        bands_u_map_.erase(band_it);
+        written_band_count_++;
+    }
+}
+
+void MapExporter::Finish(const bool is_completed)
+{
+    if (is_finished_)
+        return;
+
+    is_finished_ = true;
+
+    auto is_written = is_completed && EndExportPng(png_);
+    if (output_file_)
+    {
+        is_written = std::fclose(output_file_) == 0 && is_written;
+        output_file_ = nullptr;
+    }
+
+    if (png_)
+        png_destroy_write_struct(&png_, &png_info_);
+
+    if (!is_written)
+        std::remove(output_path_.c_str());
+
+    // Renderers exit when their input is closed, failed export does not wait for them
+    for (const auto process : processes_)
+    {
+        if (is_written)
+        {
+            process->closeWriteChannel();
+            process->waitForFinished();
+        }
+        else
+        {
+            process->kill();
+            process->waitForFinished();
+        }
+    }
+
+    bands_u_map_.clear();
+
+    emit Finished(is_written);
+}
+
+QProcess* MapExporter::CreateProcess(const unsigned int process_index, MapExporter* instance)
+{
+    auto process = new QProcess(instance);
+    process->setProperty("process_index", process_index);
+
+    const auto program = "renderer/Renderer";
+    const auto arguments = QStringList({ QString::number(process_index), instance->RawPath(process_index) });
+
+    process->start(program, arguments);
+
+    if (!process->waitForStarted())
+    {
+        std::cerr << "MapExporter::CreateProcess Failed to start process" << std::endl;
+        delete process;
+        return nullptr;
+    }
+
+    connect(process, &QProcess::readyReadStandardOutput, instance, &MapExporter::OnChunkRendered);
+    connect(process, &QProcess::errorOccurred, instance, [instance](const QProcess::ProcessError) {
+        if (instance->is_finished_)
+            return;
+
+        std::cerr << "MapExporter::CreateProcess Renderer process failed" << std::endl;
+        instance->Finish(false);
+    });
+
+    return process;
+}
@@ -0,0 +1,104 @@
+#ifndef MAPEXPORTER_H
+#define MAPEXPORTER_H
+
+#include <queue>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+
+#include <QProcess>
+#include <QTemporaryDir>
+
+#include <png.h>
+
+#include "../Projection.h"
+
+class MapExporter;
+using MapExporterUPtr = std::unique_ptr<MapExporter>;
+
+/* Renders rect of the map at zoom into PNG file too large to be held in memory.
+Image is split into bands of rows and bands into chunks of columns, chunks are
+rendered by pool of renderer processes, each writing raw pixels to its own file.
+Finished bands are appended to PNG row by row in order, bands ahead of the one
+being written wait in memory, at most MaxBandCount of them, so memory does
+not depend on image height. Everything runs in the thread owning the processes */
+class MapExporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    static MapExporterUPtr Create(const projection::Epsg3857Rect& epsg_3857_rect, const unsigned int zoom, const std::string& output_path,
+                                  const unsigned int band_height, const unsigned int process_count, QObject* parent = nullptr);
+    ~MapExporter();
+
+    //! Image size in pixels, rect is widened to whole pixels of the zoom
+    unsigned int Width() const { return width_; }
+    unsigned int Height() const { return height_; }
+    size_t ChunkCount() const { return static_cast<size_t>(band_count_) * band_chunk_count_; }
+    //! Bands allocated at once, each of Width x band height RGBA pixels
+    unsigned int MaxBandCount() const { return max_band_count_; }
+
+    //! Hands the first chunks to processes, Finished is emitted when image is written or export fails
+    void Start();
+    //! Stops processes and removes partly written file, Finished(false) is emitted
+    void Cancel();
+
+signals:
+    void Progress(const size_t rendered_chunk_count, const size_t chunk_count);
+    void Finished(const bool is_completed);
+
+private slots:
+    void OnChunkRendered();
+
+private:
+    struct Band
+    {
+        //! Rows of RGBA pixels of the whole image width
+        std::vector<uint8_t> pixels;
+        unsigned int remaining_chunk_count = 0;
+    };
+
+    unsigned int zoom_;
+    double pixel_length_;
+    //! Position of the top left image pixel among pixels of the whole map at zoom, counted from top left
+    uint64_t left_pixel_ = 0;
+    uint64_t top_pixel_ = 0;
+    unsigned int width_ = 0;
+    unsigned int height_ = 0;
+
+    unsigned int band_height_;
+    unsigned int band_count_ = 0;
+    unsigned int chunk_width_ = 0;
+    unsigned int band_chunk_count_ = 0;
+    unsigned int max_band_count_ = 0;
+
+    //! Chunks are dispatched in order, band by band
+    size_t next_chunk_ = 0;
+    size_t rendered_chunk_count_ = 0;
+    unsigned int written_band_count_ = 0;
+    std::unordered_map<unsigned int, Band> bands_u_map_;
+    uint64_t last_task_id_ = 0;
+    bool is_finished_ = false;
+
+    std::string output_path_;
+    FILE* output_file_ = nullptr;
+    png_structp png_ = nullptr;
+    png_infop png_info_ = nullptr;
+
+    //! Holds raw chunk files of processes, removed with the exporter
+    QTemporaryDir raw_dir_;
+    std::vector<QProcess*> processes_;
+    std::queue<QProcess*> free_process_pool_;
+
+    MapExporter(const unsigned int zoom, const unsigned int band_height, QObject* parent);
+
+    QString RawPath(const unsigned int process_index) const;
+    void DispatchChunks();
+    //! Appends completed bands to PNG while the next one in order is complete
+    bool WriteCompletedBands();
+    void Finish(const bool is_completed);
+
+    static QProcess* CreateProcess(const unsigned int process_index, MapExporter* instance);
+};
+
+#endif // MAPEXPORTER_H
@@ -0,0 +1,329 @@
+#include "GraphImport.h"
+
+#include <iostream>
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <atomic>
+#include <thread>
+#include <cmath>
+
+#include "OsmBlock.h"
+
+//! Smaller arrays are sorted by one thread
+constexpr size_t kMinSortChunkSize { 1 << 20 };
+//! Node is not an end of any edge yet
+constexpr uint32_t kNoImportVertex { std::numeric_limits<uint32_t>::max() };
+
+//! Edges of roads of one block, ends are indices of referenced nodes
+struct BlockEdges
+{
+    std::vector<uint32_t> sources;
+    std::vector<uint32_t> targets;
+    std::vector<double> lengths;
+    std::vector<routing_profile::RoadClass> road_classes;
+    std::vector<routing_profile::Oneway> oneways;
+    PolylineStore shapes;
+};
+
+//! Runs work on thread_count threads including the calling one
+void RunImportWorkers(const unsigned int thread_count, const std::function<void()>& work)
+{
+    auto workers = std::vector<std::thread>();
+    for (unsigned int i = 1; i < thread_count; i++)
+        workers.emplace_back(work);
+
+    work();
+
+    for (auto& worker : workers)
+        worker.join();
+}
+
+//! Sorts chunks in parallel, then merges neighbouring sorted runs in rounds
+void SortNodeIds(std::vector<int64_t>& node_ids, const unsigned int thread_count)
+{
+    const auto chunk_count = std::max<size_t>(1, std::min<size_t>(thread_count, node_ids.size() / kMinSortChunkSize));
+
+    auto chunk_bounds = std::vector<size_t>(chunk_count + 1);
+    for (size_t chunk = 0; chunk <= chunk_count; chunk++)
+        chunk_bounds[chunk] = node_ids.size() * chunk / chunk_count;
+
+    auto next_chunk = std::atomic<size_t>(0);
+    RunImportWorkers(static_cast<unsigned int>(chunk_count), [&]() {
+        for (auto chunk = next_chunk.fetch_add(1); chunk < chunk_count; chunk = next_chunk.fetch_add(1))
+            std::sort(node_ids.begin() + chunk_bounds[chunk], node_ids.begin() + chunk_bounds[chunk + 1]);
+    });
+
+    for (size_t width = 1; width < chunk_count; width *= 2)
+    {
+        const auto merge_count = (chunk_count + 2 * width - 1) / (2 * width);
+
+        auto next_merge = std::atomic<size_t>(0);
+        RunImportWorkers(static_cast<unsigned int>(merge_count), [&]() {
+            for (auto merge = next_merge.fetch_add(1); merge < merge_count; merge = next_merge.fetch_add(1))
+            {
+                const auto first = merge * 2 * width;
+                const auto middle = std::min(first + width, chunk_count);
+                const auto last = std::min(first + 2 * width, chunk_count);
+
+                std::inplace_merge(node_ids.begin() + chunk_bounds[first], node_ids.begin() + chunk_bounds[middle], node_ids.begin() + chunk_bounds[last]);
+            }
+        });
+    }
+}
+
+uint32_t FindNodeIndex(const std::vector<int64_t>& node_ids, const int64_t node_id)
+{
+    return static_cast<uint32_t>(std::lower_bound(node_ids.begin(), node_ids.end(), node_id) - node_ids.begin());
+}
+
+/* Splits roads at vertices. A road is also cut where its node is missing
+from the file, nodes next to the gap then end edges */
+void SplitRoads(const osm_block::Roads& roads, const std::vector<int64_t>& node_ids, const std::vector<char>& is_vertex,
+                const std::vector<char>& has_point, const std::vector<projection::Epsg3857Point>& points, BlockEdges& block_edges)
+{
+    auto shape = std::vector<projection::Epsg3857Point>();
+    uint32_t first_node = 0, last_node = 0;
+    auto length = 0.0;
+
+    for (const auto& road : roads.roads)
+    {
+        const auto add_edge = [&]() {
+            block_edges.sources.push_back(first_node);
+            block_edges.targets.push_back(last_node);
+            block_edges.lengths.push_back(length);
+            block_edges.road_classes.push_back(road.road_class);
+            block_edges.oneways.push_back(road.oneway);
+            block_edges.shapes.Add(shape);
+        };
+
+        shape.clear();
+        for (size_t i = road.first_node; i < road.first_node + road.node_count; i++)
+        {
+            const auto node = FindNodeIndex(node_ids, roads.node_ids[i]);
+            if (!has_point[node])
+            {
+                if (shape.size() >= 2)
+                    add_edge();
+
+                shape.clear();
+                continue;
+            }
+
+            // Repeated node would give zero length segment
+            if (!shape.empty() && node == last_node)
+                continue;
+
+            const auto& point = points[node];
+            if (shape.empty())
+            {
+                first_node = node;
+                length = 0.0;
+            }
+            else
+            {
+                length += std::hypot(point.x - shape.back().x, point.y - shape.back().y);
+            }
+
+            shape.push_back(point);
+            last_node = node;
+
+            if (shape.size() >= 2 && is_vertex[node])
+            {
+                add_edge();
+
+                shape.clear();
+                shape.push_back(point);
+                first_node = node;
+                length = 0.0;
+            }
+        }
+
+        // Road ended at a node which is not a vertex only when the next one was missing
+        if (shape.size() >= 2)
+            add_edge();
+    }
+
+    block_edges.shapes.ShrinkToFit();
+}
+
+namespace graph_import {
+
+bool Import(const PbfFile& pbf_file, const unsigned int thread_count, graph_file::GraphData& graph_data, Statistics& statistics)
+{
+    statistics = Statistics();
+
+    const auto worker_count = std::max(1u, thread_count);
+    const auto block_count = pbf_file.BlockCount();
+
+    // Pass 1, roads of every block go to the slot of the block so output does not depend on thread timing
+    auto block_roads = std::vector<osm_block::Roads>(block_count);
+    auto block_has_nodes = std::vector<char>(block_count, 0);
+
+    auto next_block = std::atomic<size_t>(0);
+    auto is_failed = std::atomic<bool>(false);
+    RunImportWorkers(worker_count, [&]() {
+        auto blob_buffer = std::string();
+        auto block_data = std::string();
+        auto has_nodes = false;
+
+        for (auto block = next_block.fetch_add(1); block < block_count && !is_failed; block = next_block.fetch_add(1))
+        {
+            if (!pbf_file.ReadBlock(block, blob_buffer, block_data) || !osm_block::ReadRoads(block_data, block_roads[block], has_nodes))
+            {
+                std::cerr << "GraphImport::Import Failed to read roads of block " << block << std::endl;
+                is_failed = true;
+                return;
+            }
+
+            block_has_nodes[block] = has_nodes;
+        }
+    });
+
+    if (is_failed)
+        return false;
+
+    // End nodes are counted twice, so they are vertices even when used by one road only
+    auto node_ids = std::vector<int64_t>();
+    for (const auto& roads : block_roads)
+    {
+        statistics.road_count += roads.roads.size();
+
+        node_ids.insert(node_ids.end(), roads.node_ids.begin(), roads.node_ids.end());
+        for (const auto& road : roads.roads)
+        {
+            node_ids.push_back(roads.node_ids[road.first_node]);
+            node_ids.push_back(roads.node_ids[road.first_node + road.node_count - 1]);
+        }
+    }
+
+    SortNodeIds(node_ids, worker_count);
+
+    auto is_vertex = std::vector<char>();
+    size_t node_count = 0;
+    for (size_t i = 0; i < node_ids.size();)
+    {
+        auto end = i + 1;
+        for (; end < node_ids.size() && node_ids[end] == node_ids[i];)
+            end++;
+
+        node_ids[node_count++] = node_ids[i];
+        is_vertex.push_back(end - i > 1);
+        i = end;
+    }
+
+    node_ids.resize(node_count);
+    node_ids.shrink_to_fit();
+    statistics.node_count = node_count;
+
+    if (node_count >= kNoImportVertex)
+    {
+        std::cerr << "GraphImport::Import Too many nodes for 32 bit vertex indices" << std::endl;
+        return false;
+    }
+
+    // Pass 2, only blocks with nodes are read again and only referenced nodes are kept
+    auto node_blocks = std::vector<size_t>();
+    for (size_t block = 0; block < block_count; block++)
+    {
+        if (block_has_nodes[block])
+            node_blocks.push_back(block);
+    }
+
+    auto epsg_4326_points = std::vector<projection::Epsg4326Point>(node_count);
+    auto has_point = std::vector<char>(node_count, 0);
+
+    next_block = 0;
+    RunImportWorkers(worker_count, [&]() {
+        auto blob_buffer = std::string();
+        auto block_data = std::string();
+        auto nodes = std::vector<osm_block::Node>();
+
+        for (auto i = next_block.fetch_add(1); i < node_blocks.size() && !is_failed; i = next_block.fetch_add(1))
+        {
+            nodes.clear();
+            if (!pbf_file.ReadBlock(node_blocks[i], blob_buffer, block_data) || !osm_block::ReadNodes(block_data, nodes))
+            {
+                std::cerr << "GraphImport::Import Failed to read nodes of block " << node_blocks[i] << std::endl;
+                is_failed = true;
+                return;
+            }
+
+            // Every node id appears once in file, so threads write to different slots
+            for (const auto& node : nodes)
+            {
+                const auto index = FindNodeIndex(node_ids, node.id);
+                if (index == node_count || node_ids[index] != node.id)
+                    continue;
+
+                epsg_4326_points[index] = node.point;
+                epsg_4326_points[index].latitude = std::clamp(node.point.latitude, -projection::kEpsg3857MaxLatitude, projection::kEpsg3857MaxLatitude);
+                has_point[index] = 1;
+            }
+        }
+    });
+
+    if (is_failed)
+        return false;
+
+    statistics.missing_node_count = static_cast<size_t>(std::count(has_point.begin(), has_point.end(), 0));
+
+    auto points = std::vector<projection::Epsg3857Point>();
+    if (!projection::ToEpsg3857(epsg_4326_points, points))
+    {
+        std::cerr << "GraphImport::Import Failed to project node coordinates" << std::endl;
+        return false;
+    }
+
+    epsg_4326_points = std::vector<projection::Epsg4326Point>();
+
+    auto block_edges = std::vector<BlockEdges>(block_count);
+
+    next_block = 0;
+    RunImportWorkers(worker_count, [&]() {
+        for (auto block = next_block.fetch_add(1); block < block_count; block = next_block.fetch_add(1))
+        {
+            SplitRoads(block_roads[block], node_ids, is_vertex, has_point, points, block_edges[block]);
+            block_roads[block] = osm_block::Roads();
+        }
+    });
+
+    // Vertices are numbered in order of first use, ids are OSM node ids
+    graph_data = graph_file::GraphData();
+
+    auto node_vertices = std::vector<uint32_t>(node_count, kNoImportVertex);
+    const auto node_vertex = [&](const uint32_t node) {
+        if (node_vertices[node] == kNoImportVertex)
+        {
+            node_vertices[node] = static_cast<uint32_t>(graph_data.vertex_ids.size());
+            graph_data.vertex_ids.push_back(node_ids[node]);
+            graph_data.vertex_points.push_back(points[node]);
+        }
+
+        return node_vertices[node];
+    };
+
+    for (auto& edges : block_edges)
+    {
+        for (size_t edge = 0; edge < edges.sources.size(); edge++)
+        {
+            // Ids start from 1 like serial ids of the database pipeline
+            graph_data.edge_ids.push_back(static_cast<int64_t>(graph_data.edge_ids.size() + 1));
+            graph_data.edge_sources.push_back(node_vertex(edges.sources[edge]));
+            graph_data.edge_targets.push_back(node_vertex(edges.targets[edge]));
+        }
+
+        graph_data.edge_lengths.insert(graph_data.edge_lengths.end(), edges.lengths.begin(), edges.lengths.end());
+        graph_data.edge_road_classes.insert(graph_data.edge_road_classes.end(), edges.road_classes.begin(), edges.road_classes.end());
+        graph_data.edge_oneways.insert(graph_data.edge_oneways.end(), edges.oneways.begin(), edges.oneways.end());
+        graph_data.edge_shapes.Append(edges.shapes);
+
+        edges = BlockEdges();
+    }
+
+    graph_data.edge_shapes.ShrinkToFit();
+
+    return true;
+}
+
+} // namespace graph_import
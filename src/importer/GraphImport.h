@@ -0,0 +1,28 @@
+#ifndef GRAPHIMPORT_H
+#define GRAPHIMPORT_H
+
+#include "PbfFile.h"
+#include "../GraphFile.h"
+
+namespace graph_import {
+
+struct Statistics
+{
+    size_t road_count = 0;
+    //! Distinct nodes referenced by roads
+    size_t node_count = 0;
+    //! Referenced nodes absent from the file, typical for clipped extracts
+    size_t missing_node_count = 0;
+};
+
+/* Builds road graph from OSM file in two passes over its blocks. The first
+one collects roads and counts node references, nodes referenced more than
+once or ending a road become vertices. The second one reads coordinates of
+referenced nodes only. Roads are then split at vertices into edges, edge
+lengths are in EPSG:3857 units like ST_Length of the database pipeline.
+Blocks are decoded by thread_count threads, result does not depend on it */
+bool Import(const PbfFile& pbf_file, const unsigned int thread_count, graph_file::GraphData& graph_data, Statistics& statistics);
+
+} // namespace graph_import
+
+#endif // GRAPHIMPORT_H
@@ -0,0 +1,69 @@
+#include <iostream>
+#include <chrono>
+#include <thread>
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+
+#include "PbfFile.h"
+#include "GraphImport.h"
+
+double SecondsSince(const std::chrono::steady_clock::time_point& start_time)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+/* Command line front-end building road graph file from OSM PBF extract,
+replaces osm2pgsql and pgRouting topology steps for routing. The file is
+loaded by the application when OPENROUTE_GRAPH points to it */
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("OpenRouteImporter");
+
+    auto parser = QCommandLineParser();
+    parser.setApplicationDescription("Builds routing graph from OSM PBF file");
+    parser.addHelpOption();
+
+    const auto input_option = QCommandLineOption("input", "OSM PBF file.", "path");
+    const auto output_option = QCommandLineOption("output", "Graph file.", "path");
+    const auto threads_option = QCommandLineOption("threads", "Number of worker threads.", "count",
+                                                   QString::number(std::max(1u, std::thread::hardware_concurrency())));
+
+    parser.addOptions({ input_option, output_option, threads_option });
+    parser.process(a);
+
+    if (!parser.isSet(input_option) || !parser.isSet(output_option))
+    {
+        std::cerr << "OpenRouteImporter - --input and --output are required" << std::endl;
+        return 1;
+    }
+
+    const auto start_time = std::chrono::steady_clock::now();
+
+    const auto pbf_file_u_ptr = PbfFile::Create(parser.value(input_option).toStdString());
+    if (!pbf_file_u_ptr)
+        return 1;
+
+    std::cout << "Input: " << pbf_file_u_ptr->FileSize() / (1024 * 1024) << " MB, " << pbf_file_u_ptr->BlockCount() << " blocks" << std::endl;
+
+    auto graph_data = graph_file::GraphData();
+    auto statistics = graph_import::Statistics();
+    if (!graph_import::Import(*pbf_file_u_ptr, parser.value(threads_option).toUInt(), graph_data, statistics))
+    {
+        std::cerr << "OpenRouteImporter - import failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Roads: " << statistics.road_count << ", nodes " << statistics.node_count
+              << ", missing nodes " << statistics.missing_node_count << std::endl;
+    std::cout << "Graph: " << graph_data.vertex_ids.size() << " vertices, " << graph_data.edge_ids.size() << " edges, shapes "
+              << graph_data.edge_shapes.ByteCount() / (1024 * 1024) << " MB, imported in " << SecondsSince(start_time) << " s" << std::endl;
+
+    if (!graph_file::Write(parser.value(output_option).toStdString(), graph_data))
+        return 1;
+
+    std::cout << "Written in " << SecondsSince(start_time) << " s" << std::endl;
+
+    return 0;
+}
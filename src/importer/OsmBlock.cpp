@@ -0,0 +1,282 @@
+#include "OsmBlock.h"
+
+#include <string>
+
+#include "ProtobufReader.h"
+
+//! Default granularity of coordinates in nanodegrees
+constexpr int64_t kDefaultGranularity { 100 };
+constexpr double kNanodegree { 1e-9 };
+
+//! Values of PrimitiveBlock needed to decode its groups
+struct BlockContext
+{
+    std::vector<std::string_view> strings;
+    int64_t granularity = kDefaultGranularity;
+    int64_t latitude_offset = 0;
+    int64_t longitude_offset = 0;
+
+    projection::Epsg4326Point Point(const int64_t longitude, const int64_t latitude) const
+    {
+        return projection::Epsg4326Point(kNanodegree * double(longitude_offset + granularity * longitude),
+                                         kNanodegree * double(latitude_offset + granularity * latitude));
+    }
+};
+
+/* Reads string table and coordinate encoding, which the format does not
+require to precede groups, and collects groups for the second scan */
+bool ReadBlockContext(const std::string_view block_data, const bool is_strings_needed, BlockContext& block_context,
+                      std::vector<std::string_view>& groups)
+{
+    auto block = ProtobufReader(block_data);
+    for (; block.Next();)
+    {
+        switch (block.Field())
+        {
+        case 1:
+            if (is_strings_needed)
+            {
+                auto string_table = block.Message();
+                for (; string_table.Next();)
+                {
+                    if (string_table.Field() == 1)
+                        block_context.strings.push_back(string_table.Bytes());
+                    else
+                        string_table.Skip();
+                }
+
+                if (!string_table.IsValid())
+                    return false;
+            }
+            else
+            {
+                block.Skip();
+            }
+            break;
+        case 2: groups.push_back(block.Bytes()); break;
+        case 17: block_context.granularity = static_cast<int64_t>(block.Varint()); break;
+        case 19: block_context.latitude_offset = static_cast<int64_t>(block.Varint()); break;
+        case 20: block_context.longitude_offset = static_cast<int64_t>(block.Varint()); break;
+        default: block.Skip(); break;
+        }
+    }
+
+    return block.IsValid();
+}
+
+bool ReadRoad(const std::string_view way_data, const BlockContext& block_context, osm_block::Roads& roads)
+{
+    int64_t id = 0;
+    auto keys = ProtobufReader();
+    auto values = ProtobufReader();
+    auto refs = ProtobufReader();
+
+    auto way = ProtobufReader(way_data);
+    for (; way.Next();)
+    {
+        switch (way.Field())
+        {
+        case 1: id = static_cast<int64_t>(way.Varint()); break;
+        case 2: keys = way.Message(); break;
+        case 3: values = way.Message(); break;
+        case 8: refs = way.Message(); break;
+        default: way.Skip(); break;
+        }
+    }
+
+    if (!way.IsValid())
+        return false;
+
+    auto highway = std::string_view();
+    auto oneway = std::string_view();
+    auto is_roundabout = false;
+    auto is_area = false;
+    const auto string_count = block_context.strings.size();
+    for (; !keys.IsAtEnd();)
+    {
+        const auto key = keys.Varint();
+        const auto value = values.Varint();
+        if (key >= string_count || value >= string_count)
+            return false;
+
+        const auto key_string = block_context.strings[key];
+        const auto value_string = block_context.strings[value];
+        if (key_string == "highway")
+            highway = value_string;
+        else if (key_string == "oneway")
+            oneway = value_string;
+        else if (key_string == "junction")
+            is_roundabout = value_string == "roundabout" || value_string == "circular";
+        else if (key_string == "area")
+            is_area = value_string == "yes";
+    }
+
+    if (!keys.IsValid() || !values.IsValid())
+        return false;
+
+    if (highway.empty() || is_area)
+        return true;
+
+    const auto road_class = routing_profile::ParseRoadClass(std::string(highway));
+    if (road_class == routing_profile::RoadClass::Other)
+        return true;
+
+    // Roundabouts are oneway along their geometry unless tagged otherwise
+    auto road_oneway = routing_profile::ParseOneway(std::string(oneway));
+    if (oneway.empty() && is_roundabout)
+        road_oneway = routing_profile::Oneway::Forward;
+
+    const auto first_node = roads.node_ids.size();
+    int64_t node_id = 0;
+    for (; !refs.IsAtEnd();)
+    {
+        node_id += refs.Sint64();
+        roads.node_ids.push_back(node_id);
+    }
+
+    if (!refs.IsValid())
+        return false;
+
+    const auto node_count = roads.node_ids.size() - first_node;
+    if (node_count < 2)
+    {
+        roads.node_ids.resize(first_node);
+        return true;
+    }
+
+    roads.roads.push_back(osm_block::Road { id, first_node, node_count, road_class, road_oneway });
+
+    return true;
+}
+
+bool ReadDenseNodes(const std::string_view dense_data, const BlockContext& block_context, std::vector<osm_block::Node>& nodes)
+{
+    auto ids = ProtobufReader();
+    auto latitudes = ProtobufReader();
+    auto longitudes = ProtobufReader();
+
+    auto dense = ProtobufReader(dense_data);
+    for (; dense.Next();)
+    {
+        switch (dense.Field())
+        {
+        case 1: ids = dense.Message(); break;
+        case 8: latitudes = dense.Message(); break;
+        case 9: longitudes = dense.Message(); break;
+        default: dense.Skip(); break;
+        }
+    }
+
+    if (!dense.IsValid())
+        return false;
+
+    // All three arrays are delta coded and have the same length
+    int64_t id = 0, latitude = 0, longitude = 0;
+    for (; !ids.IsAtEnd();)
+    {
+        id += ids.Sint64();
+        latitude += latitudes.Sint64();
+        longitude += longitudes.Sint64();
+
+        nodes.push_back(osm_block::Node { id, block_context.Point(longitude, latitude) });
+    }
+
+    return ids.IsValid() && latitudes.IsValid() && longitudes.IsValid() && latitudes.IsAtEnd() && longitudes.IsAtEnd();
+}
+
+bool ReadNode(const std::string_view node_data, const BlockContext& block_context, std::vector<osm_block::Node>& nodes)
+{
+    int64_t id = 0, latitude = 0, longitude = 0;
+
+    auto node = ProtobufReader(node_data);
+    for (; node.Next();)
+    {
+        switch (node.Field())
+        {
+        case 1: id = node.Sint64(); break;
+        case 8: latitude = node.Sint64(); break;
+        case 9: longitude = node.Sint64(); break;
+        default: node.Skip(); break;
+        }
+    }
+
+    if (!node.IsValid())
+        return false;
+
+    nodes.push_back(osm_block::Node { id, block_context.Point(longitude, latitude) });
+
+    return true;
+}
+
+namespace osm_block {
+
+bool ReadRoads(const std::string_view block_data, Roads& roads, bool& has_nodes)
+{
+    has_nodes = false;
+
+    auto block_context = BlockContext();
+    auto groups = std::vector<std::string_view>();
+    if (!ReadBlockContext(block_data, true, block_context, groups))
+        return false;
+
+    for (const auto group_data : groups)
+    {
+        auto group = ProtobufReader(group_data);
+        for (; group.Next();)
+        {
+            switch (group.Field())
+            {
+            case 1:
+            case 2:
+                has_nodes = true;
+                group.Skip();
+                break;
+            case 3:
+                if (!ReadRoad(group.Bytes(), block_context, roads))
+                    return false;
+                break;
+            default: group.Skip(); break;
+            }
+        }
+
+        if (!group.IsValid())
+            return false;
+    }
+
+    return true;
+}
+
+bool ReadNodes(const std::string_view block_data, std::vector<Node>& nodes)
+{
+    auto block_context = BlockContext();
+    auto groups = std::vector<std::string_view>();
+    if (!ReadBlockContext(block_data, false, block_context, groups))
+        return false;
+
+    for (const auto group_data : groups)
+    {
+        auto group = ProtobufReader(group_data);
+        for (; group.Next();)
+        {
+            switch (group.Field())
+            {
+            case 1:
+                if (!ReadNode(group.Bytes(), block_context, nodes))
+                    return false;
+                break;
+            case 2:
+                if (!ReadDenseNodes(group.Bytes(), block_context, nodes))
+                    return false;
+                break;
+            default: group.Skip(); break;
+            }
+        }
+
+        if (!group.IsValid())
+            return false;
+    }
+
+    return true;
+}
+
+} // namespace osm_block
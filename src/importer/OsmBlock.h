@@ -0,0 +1,44 @@
+#ifndef OSMBLOCK_H
+#define OSMBLOCK_H
+
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+#include "../Projection.h"
+#include "../RoutingProfile.h"
+
+namespace osm_block {
+
+//! Way usable for routing, node ids are range of Roads::node_ids
+struct Road
+{
+    int64_t id;
+    size_t first_node;
+    size_t node_count;
+    routing_profile::RoadClass road_class;
+    routing_profile::Oneway oneway;
+};
+
+struct Roads
+{
+    std::vector<Road> roads;
+    std::vector<int64_t> node_ids;
+};
+
+struct Node
+{
+    int64_t id;
+    projection::Epsg4326Point point;
+};
+
+/* Appends ways of PrimitiveBlock with a known highway tag. Areas and roads
+without a class any profile can use (proposed, construction and the like)
+are skipped. has_nodes tells whether block has nodes for the second pass */
+bool ReadRoads(const std::string_view block_data, Roads& roads, bool& has_nodes);
+//! Appends plain and dense nodes of PrimitiveBlock, tags are not decoded
+bool ReadNodes(const std::string_view block_data, std::vector<Node>& nodes);
+
+} // namespace osm_block
+
+#endif // OSMBLOCK_H
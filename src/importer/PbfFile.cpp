@@ -0,0 +1,219 @@
+#include "PbfFile.h"
+
+#include <iostream>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#include "ProtobufReader.h"
+
+//! Limits set by the format, larger values mean a broken file
+constexpr uint32_t kMaxBlobHeaderSize { 64 * 1024 };
+constexpr uint32_t kMaxBlobSize { 32 * 1024 * 1024 };
+
+PbfFile::PbfFile()
+{
+
+}
+
+PbfFile::~PbfFile()
+{
+    if (file_descriptor_ >= 0)
+        close(file_descriptor_);
+}
+
+PbfFileUPtr PbfFile::Create(const std::string& path)
+{
+    std::unique_ptr<PbfFile> instance(new PbfFile());
+
+    instance->file_descriptor_ = open(path.c_str(), O_RDONLY);
+    if (instance->file_descriptor_ < 0)
+    {
+        std::cerr << "PbfFile::Create Failed to open " << path << std::endl;
+        return nullptr;
+    }
+
+    struct stat file_stat;
+    if (fstat(instance->file_descriptor_, &file_stat) != 0)
+    {
+        std::cerr << "PbfFile::Create Failed to get size of " << path << std::endl;
+        return nullptr;
+    }
+
+    instance->file_size_ = static_cast<uint64_t>(file_stat.st_size);
+
+    auto bytes = std::string();
+    auto data = std::string();
+    auto is_header_checked = false;
+    for (uint64_t offset = 0; offset < instance->file_size_;)
+    {
+        // Each blob is preceded by big endian size of its BlobHeader
+        if (!instance->ReadBytes(offset, 4, bytes))
+            return nullptr;
+
+        const auto size_bytes = reinterpret_cast<const uint8_t*>(bytes.data());
+        const auto header_size = uint32_t(size_bytes[0]) << 24 | uint32_t(size_bytes[1]) << 16 | uint32_t(size_bytes[2]) << 8 | uint32_t(size_bytes[3]);
+        if (header_size > kMaxBlobHeaderSize || !instance->ReadBytes(offset + 4, header_size, bytes))
+        {
+            std::cerr << "PbfFile::Create Broken blob header at offset " << offset << std::endl;
+            return nullptr;
+        }
+
+        auto type = std::string_view();
+        uint64_t blob_size = 0;
+        auto blob_header = ProtobufReader(bytes);
+        for (; blob_header.Next();)
+        {
+            if (blob_header.Field() == 1 && blob_header.Type() == ProtobufReader::kLengthDelimited)
+                type = blob_header.Bytes();
+            else if (blob_header.Field() == 3 && blob_header.Type() == ProtobufReader::kVarint)
+                blob_size = blob_header.Varint();
+            else
+                blob_header.Skip();
+        }
+
+        const auto blob_offset = offset + 4 + header_size;
+        if (!blob_header.IsValid() || blob_size > kMaxBlobSize || blob_offset + blob_size > instance->file_size_)
+        {
+            std::cerr << "PbfFile::Create Broken blob header at offset " << offset << std::endl;
+            return nullptr;
+        }
+
+        if (type == "OSMHeader")
+        {
+            if (!instance->ReadBytes(blob_offset, blob_size, bytes) || !instance->DecodeBlob(bytes, data) || !instance->CheckHeader(data))
+                return nullptr;
+
+            is_header_checked = true;
+        }
+        else if (type == "OSMData")
+        {
+            instance->block_locations_.push_back(BlockLocation { blob_offset, static_cast<uint32_t>(blob_size) });
+        }
+
+        // Unknown blob types are allowed by the format and skipped
+        offset = blob_offset + blob_size;
+    }
+
+    if (!is_header_checked)
+    {
+        std::cerr << "PbfFile::Create There is no OSMHeader block in " << path << std::endl;
+        return nullptr;
+    }
+
+    return instance;
+}
+
+bool PbfFile::ReadBlock(const size_t block, std::string& blob_buffer, std::string& block_data) const
+{
+    const auto& block_location = block_locations_[block];
+
+    return ReadBytes(block_location.offset, block_location.size, blob_buffer) && DecodeBlob(blob_buffer, block_data);
+}
+
+bool PbfFile::ReadBytes(const uint64_t offset, const size_t size, std::string& bytes) const
+{
+    bytes.resize(size);
+
+    // pread does not move shared file position, so threads need no locking
+    for (size_t done = 0; done < size;)
+    {
+        const auto count = pread(file_descriptor_, bytes.data() + done, size - done, static_cast<off_t>(offset + done));
+        if (count <= 0)
+        {
+            std::cerr << "PbfFile::ReadBytes Failed to read " << size << " bytes at offset " << offset << std::endl;
+            return false;
+        }
+
+        done += static_cast<size_t>(count);
+    }
+
+    return true;
+}
+
+bool PbfFile::DecodeBlob(const std::string& blob, std::string& data) const
+{
+    auto raw = std::string_view();
+    auto zlib_data = std::string_view();
+    auto is_raw = false;
+    auto is_zlib = false;
+    uint64_t raw_size = 0;
+
+    auto reader = ProtobufReader(blob);
+    for (; reader.Next();)
+    {
+        switch (reader.Field())
+        {
+        case 1: raw = reader.Bytes(); is_raw = true; break;
+        case 2: raw_size = reader.Varint(); break;
+        case 3: zlib_data = reader.Bytes(); is_zlib = true; break;
+        case 4:
+        case 5:
+        case 6:
+        case 7:
+            std::cerr << "PbfFile::DecodeBlob Unsupported blob compression, only zlib is supported" << std::endl;
+            return false;
+        default: reader.Skip(); break;
+        }
+    }
+
+    if (!reader.IsValid())
+    {
+        std::cerr << "PbfFile::DecodeBlob Broken blob" << std::endl;
+        return false;
+    }
+
+    if (is_raw)
+    {
+        data.assign(raw.data(), raw.size());
+        return true;
+    }
+
+    if (!is_zlib || raw_size > kMaxBlobSize)
+    {
+        std::cerr << "PbfFile::DecodeBlob Blob has no data or is too large" << std::endl;
+        return false;
+    }
+
+    data.resize(raw_size);
+    auto data_size = static_cast<uLongf>(raw_size);
+    if (uncompress(reinterpret_cast<Bytef*>(data.data()), &data_size, reinterpret_cast<const Bytef*>(zlib_data.data()),
+                   static_cast<uLong>(zlib_data.size())) != Z_OK || data_size != raw_size)
+    {
+        std::cerr << "PbfFile::DecodeBlob Failed to decompress blob" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool PbfFile::CheckHeader(const std::string& header_data) const
+{
+    auto reader = ProtobufReader(header_data);
+    for (; reader.Next();)
+    {
+        // required_features, reader must understand all of them
+        if (reader.Field() != 4 || reader.Type() != ProtobufReader::kLengthDelimited)
+        {
+            reader.Skip();
+            continue;
+        }
+
+        const auto feature = reader.Bytes();
+        if (feature != "OsmSchema-V0.6" && feature != "DenseNodes")
+        {
+            std::cerr << "PbfFile::CheckHeader Unsupported required feature " << feature << std::endl;
+            return false;
+        }
+    }
+
+    if (!reader.IsValid())
+    {
+        std::cerr << "PbfFile::CheckHeader Broken header block" << std::endl;
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,53 @@
+#ifndef PBFFILE_H
+#define PBFFILE_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+class PbfFile;
+
+typedef std::unique_ptr<PbfFile> PbfFileUPtr;
+
+/* OSM PBF file split into data blocks. Create reads only block headers, so
+blocks can be read and decompressed later by many threads at once. Only raw
+and zlib compressed blobs are supported, which is what common tools write */
+class PbfFile
+{
+public:
+    //! Indexes blocks and checks that file needs no unsupported features
+    static PbfFileUPtr Create(const std::string& path);
+    ~PbfFile();
+
+    PbfFile(const PbfFile&) = delete;
+    PbfFile& operator=(const PbfFile&) = delete;
+
+    size_t BlockCount() const { return block_locations_.size(); }
+    uint64_t FileSize() const { return file_size_; }
+
+    /* Reads and decompresses PrimitiveBlock message of block into block_data.
+    Safe to call from several threads, each passing its own buffers, which
+    keep their capacity between calls */
+    bool ReadBlock(const size_t block, std::string& blob_buffer, std::string& block_data) const;
+
+private:
+    struct BlockLocation
+    {
+        uint64_t offset;
+        uint32_t size;
+    };
+
+    int file_descriptor_ = -1;
+    uint64_t file_size_ = 0;
+    std::vector<BlockLocation> block_locations_;
+
+    PbfFile();
+
+    bool ReadBytes(const uint64_t offset, const size_t size, std::string& bytes) const;
+    //! Extracts uncompressed content of Blob message
+    bool DecodeBlob(const std::string& blob, std::string& data) const;
+    bool CheckHeader(const std::string& header_data) const;
+};
+
+#endif // PBFFILE_H
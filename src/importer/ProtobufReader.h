@@ -0,0 +1,120 @@
+#ifndef PROTOBUFREADER_H
+#define PROTOBUFREADER_H
+
+#include <string_view>
+#include <cstdint>
+
+/* Minimal reader of protobuf wire format over a memory buffer, enough for
+OSM PBF messages. Fields are visited in order with Next, value of current
+field is read with one of the value methods or skipped. Malformed input
+moves reader to the end and clears IsValid, values read after that are 0 */
+class ProtobufReader
+{
+public:
+    enum WireType : uint32_t
+    {
+        kVarint = 0,
+        kFixed64 = 1,
+        kLengthDelimited = 2,
+        kFixed32 = 5
+    };
+
+    ProtobufReader() = default;
+    explicit ProtobufReader(const std::string_view data) : position_(data.data()), end_(data.data() + data.size()) {}
+
+    bool IsValid() const { return is_valid_; }
+    bool IsAtEnd() const { return position_ >= end_; }
+
+    //! Moves to the next field, returns false at the end of message or on error
+    bool Next()
+    {
+        if (IsAtEnd())
+            return false;
+
+        const auto key = Varint();
+        field_ = static_cast<uint32_t>(key >> 3);
+        type_ = static_cast<uint32_t>(key & 7);
+
+        return is_valid_;
+    }
+
+    uint32_t Field() const { return field_; }
+    uint32_t Type() const { return type_; }
+
+    uint64_t Varint()
+    {
+        uint64_t value = 0;
+        for (unsigned int shift = 0; shift < 64 && position_ < end_; shift += 7)
+        {
+            const auto byte = static_cast<uint8_t>(*position_++);
+            value |= uint64_t(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                return value;
+        }
+
+        Fail();
+        return 0;
+    }
+
+    int64_t Sint64()
+    {
+        const auto value = Varint();
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    std::string_view Bytes()
+    {
+        const auto size = Varint();
+        if (size > uint64_t(end_ - position_))
+        {
+            Fail();
+            return std::string_view();
+        }
+
+        const auto bytes = std::string_view(position_, size);
+        position_ += size;
+
+        return bytes;
+    }
+
+    //! Packed repeated field or embedded message as a separate reader
+    ProtobufReader Message()
+    {
+        return ProtobufReader(Bytes());
+    }
+
+    void Skip()
+    {
+        switch (type_)
+        {
+        case kVarint: Varint(); break;
+        case kFixed64: Advance(8); break;
+        case kLengthDelimited: Bytes(); break;
+        case kFixed32: Advance(4); break;
+        default: Fail(); break;
+        }
+    }
+
+private:
+    const char* position_ = nullptr;
+    const char* end_ = nullptr;
+    uint32_t field_ = 0;
+    uint32_t type_ = 0;
+    bool is_valid_ = true;
+
+    void Advance(const size_t size)
+    {
+        if (size > size_t(end_ - position_))
+            Fail();
+        else
+            position_ += size;
+    }
+
+    void Fail()
+    {
+        is_valid_ = false;
+        position_ = end_;
+    }
+};
+
+#endif // PROTOBUFREADER_H
@@ -1,12 +1,21 @@
 #include <QApplication>
 #include <QMainWindow>
+#include <QTimer>
 
 #include "MapWidget.h"
+#include "Trace.h"
+
+//! UI and routing threads record more spans than one ring buffer holds in a long session
+constexpr int kTraceFlushInterval { 1000 };
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
 
+    // Renderer processes started by MapWidget find part files already cleaned
+    trace::Initialize("OpenRoute", true);
+    trace::SetThreadName("UI");
+
     QMainWindow main_window;
     main_window.setGeometry(0, 0, 1200, 800);
 
@@ -15,5 +24,16 @@ int main(int argc, char *argv[])
 
     main_window.show();
 
-    return a.exec();
+    QTimer trace_flush_timer;
+    if (trace::IsEnabled())
+    {
+        QObject::connect(&trace_flush_timer, &QTimer::timeout, []() { trace::Flush(); });
+        trace_flush_timer.start(kTraceFlushInterval);
+    }
+
+    const auto exit_code = a.exec();
+
+    trace::Export();
+
+    return exit_code;
 }
@@ -0,0 +1,183 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <cmath>
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+
+#include "../NavigationManager.h"
+
+constexpr char kBinaryMagic[] = "ORMX";
+constexpr uint32_t kBinaryVersion { 1 };
+
+/* Reads points from CSV file, one "x,y" (or "longitude,latitude" when
+is_epsg_4326 is set) pair per line. Lines that do not start with a number,
+like header, are skipped */
+bool ReadPoints(const std::string& path, const bool is_epsg_4326, std::vector<projection::Epsg3857Point>& points)
+{
+    auto file = std::ifstream(path);
+    if (!file)
+    {
+        std::cerr << "ReadPoints - failed to open " << path << std::endl;
+        return false;
+    }
+
+    auto epsg_4326_points = std::vector<projection::Epsg4326Point>();
+    auto line = std::string();
+    double first, second;
+    char separator;
+    for (; std::getline(file, line);)
+    {
+        auto stream = std::istringstream(line);
+        stream.imbue(std::locale::classic());
+
+        if (!(stream >> first >> separator >> second) || separator != ',')
+            continue;
+
+        if (is_epsg_4326)
+            epsg_4326_points.emplace_back(first, second);
+        else
+            points.emplace_back(first, second);
+    }
+
+    // Geographic points are projected all at once
+    if (is_epsg_4326)
+        return projection::ToEpsg3857(epsg_4326_points, points);
+
+    return true;
+}
+
+//! Writes matrix as CSV, one row per source, unreachable targets are left empty
+bool WriteCsv(const std::string& path, const size_t row_count, const size_t column_count, const std::vector<double>& costs)
+{
+    auto file = std::ofstream(path);
+    if (!file)
+    {
+        std::cerr << "WriteCsv - failed to open " << path << std::endl;
+        return false;
+    }
+
+    file.imbue(std::locale::classic());
+    file.precision(10);
+
+    for (size_t row = 0; row < row_count; row++)
+    {
+        for (size_t column = 0; column < column_count; column++)
+        {
+            if (column > 0)
+                file << ',';
+
+            const auto cost = costs[row * column_count + column];
+            if (std::isfinite(cost))
+                file << cost;
+        }
+        file << '\n';
+    }
+
+    return static_cast<bool>(file);
+}
+
+/* Writes matrix as binary: magic "ORMX", uint32 version, uint32 row count,
+uint32 column count followed by row-major float64 costs in host byte order,
+unreachable targets are +infinity */
+bool WriteBinary(const std::string& path, const uint32_t row_count, const uint32_t column_count, const std::vector<double>& costs)
+{
+    auto file = std::ofstream(path, std::ios::binary);
+    if (!file)
+    {
+        std::cerr << "WriteBinary - failed to open " << path << std::endl;
+        return false;
+    }
+
+    file.write(kBinaryMagic, 4);
+    file.write(reinterpret_cast<const char*>(&kBinaryVersion), sizeof(kBinaryVersion));
+    file.write(reinterpret_cast<const char*>(&row_count), sizeof(row_count));
+    file.write(reinterpret_cast<const char*>(&column_count), sizeof(column_count));
+    file.write(reinterpret_cast<const char*>(costs.data()), costs.size() * sizeof(double));
+
+    return static_cast<bool>(file);
+}
+
+/* Command line front-end for batch computation of travel cost
+matrices over the road graph loaded from database */
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("OpenRouteMatrix");
+
+    auto parser = QCommandLineParser();
+    parser.setApplicationDescription("Computes many-to-many travel cost matrix");
+    parser.addHelpOption();
+
+    const auto sources_option = QCommandLineOption("sources", "CSV file with source points.", "path");
+    const auto targets_option = QCommandLineOption("targets", "CSV file with target points, sources are used if omitted.", "path");
+    const auto output_option = QCommandLineOption("output", "Output file.", "path");
+    const auto format_option = QCommandLineOption("format", "Output format: csv or binary.", "format", "csv");
+    const auto crs_option = QCommandLineOption("crs", "Coordinate system of input points: 4326 (longitude,latitude) or 3857.", "epsg", "4326");
+    const auto profile_option = QCommandLineOption("profile", "Routing profile: car, bike or foot.", "name", "car");
+    const auto threads_option = QCommandLineOption("threads", "Number of worker threads.", "count",
+                                                   QString::number(std::max(1u, std::thread::hardware_concurrency())));
+
+    parser.addOptions({ sources_option, targets_option, output_option, format_option, crs_option, profile_option, threads_option });
+    parser.process(a);
+
+    if (!parser.isSet(sources_option) || !parser.isSet(output_option))
+    {
+        std::cerr << "OpenRouteMatrix - --sources and --output are required" << std::endl;
+        return 1;
+    }
+
+    const auto format = parser.value(format_option);
+    if (format != "csv" && format != "binary")
+    {
+        std::cerr << "OpenRouteMatrix - unknown format " << format.toStdString() << std::endl;
+        return 1;
+    }
+
+    auto routing_profile_type = routing_profile::Type();
+    if (!routing_profile::ParseType(parser.value(profile_option).toStdString(), routing_profile_type))
+    {
+        std::cerr << "OpenRouteMatrix - unknown profile " << parser.value(profile_option).toStdString() << std::endl;
+        return 1;
+    }
+
+    const auto crs = parser.value(crs_option);
+    if (crs != "4326" && crs != "3857")
+    {
+        std::cerr << "OpenRouteMatrix - unknown crs " << crs.toStdString() << ", expected 4326 or 3857" << std::endl;
+        return 1;
+    }
+
+    const auto is_epsg_4326 = crs == "4326";
+
+    auto sources = std::vector<projection::Epsg3857Point>();
+    if (!ReadPoints(parser.value(sources_option).toStdString(), is_epsg_4326, sources))
+        return 1;
+
+    auto targets = sources;
+    if (parser.isSet(targets_option))
+    {
+        targets.clear();
+        if (!ReadPoints(parser.value(targets_option).toStdString(), is_epsg_4326, targets))
+            return 1;
+    }
+
+    const auto navigation_manager_u_ptr = NavigationManager::Create();
+    if (!navigation_manager_u_ptr)
+        return 1;
+
+    navigation_manager_u_ptr->SetRoutingProfile(routing_profile_type);
+
+    auto costs = std::vector<double>();
+    if (!navigation_manager_u_ptr->FindDistanceMatrix(sources, targets, parser.value(threads_option).toUInt(), costs))
+        return 1;
+
+    const auto output_path = parser.value(output_option).toStdString();
+    const auto is_written = format == "csv"
+        ? WriteCsv(output_path, sources.size(), targets.size(), costs)
+        : WriteBinary(output_path, sources.size(), targets.size(), costs);
+
+    return is_written ? 0 : 1;
+}
@@ -6,10 +6,107 @@
 #include <mapnik/load_map.hpp>
 #include <mapnik/datasource_cache.hpp>
 
+#include <cstring>
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <iostream>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include <QApplication>
 
+#include "../Trace.h"
+
 constexpr int kTileSize { 256 };
 
+//! Checks that all pixels equal the first one, stops at the first different block
+bool IsUniformImage(const mapnik::image_rgba8& image, uint32_t& color)
+{
+    const auto pixels = image.data();
+    const auto pixel_count = image.width() * image.height();
+    if (pixel_count == 0)
+        return false;
+
+    color = pixels[0];
+
+    auto pixel = size_t(0);
+#if defined(__SSE2__)
+    // Four registers of four pixels per step, ocean tile is read at memory speed
+    const auto expected = _mm_set1_epi32(static_cast<int>(color));
+    for (; pixel + 16 <= pixel_count; pixel += 16)
+    {
+        const auto block = reinterpret_cast<const __m128i*>(pixels + pixel);
+        const auto equal = _mm_and_si128(
+            _mm_and_si128(_mm_cmpeq_epi32(_mm_loadu_si128(block), expected), _mm_cmpeq_epi32(_mm_loadu_si128(block + 1), expected)),
+            _mm_and_si128(_mm_cmpeq_epi32(_mm_loadu_si128(block + 2), expected), _mm_cmpeq_epi32(_mm_loadu_si128(block + 3), expected)));
+
+        if (_mm_movemask_epi8(equal) != 0xffff)
+            return false;
+    }
+#endif
+
+    for (; pixel < pixel_count; pixel++)
+    {
+        if (pixels[pixel] != color)
+            return false;
+    }
+
+    return true;
+}
+
+/* 64-bit multiplicative hash of pixels, collisions between tiles are practically
+impossible. Four independent lanes keep multiplications from waiting on each other */
+uint64_t ImageContentHash(const mapnik::image_rgba8& image)
+{
+    constexpr uint64_t kMultiplier { 0x9e3779b97f4a7c15ull };
+
+    const auto bytes = reinterpret_cast<const unsigned char*>(image.data());
+    const auto byte_count = image.width() * image.height() * sizeof(mapnik::image_rgba8::pixel_type);
+
+    auto lanes = std::array<uint64_t, 4> { 0xcbf29ce484222325ull, 0x84222325cbf29ce4ull, 0x100000001b3ull, byte_count };
+    auto words = std::array<uint64_t, 4>();
+    auto offset = size_t(0);
+    for (; offset + sizeof(words) <= byte_count; offset += sizeof(words))
+    {
+        std::memcpy(words.data(), bytes + offset, sizeof(words));
+        for (size_t lane = 0; lane < lanes.size(); lane++)
+        {
+            lanes[lane] = (lanes[lane] ^ words[lane]) * kMultiplier;
+            lanes[lane] ^= lanes[lane] >> 29;
+        }
+    }
+
+    // Tail shorter than one step is folded into the first lane byte by byte
+    for (; offset < byte_count; offset++)
+        lanes[0] = (lanes[0] ^ bytes[offset]) * kMultiplier;
+
+    auto hash = uint64_t(0);
+    for (const auto lane : lanes)
+    {
+        hash = (hash ^ lane) * kMultiplier;
+        hash ^= hash >> 32;
+    }
+
+    return hash;
+}
+
+//! Converts premultiplied pixel to straight alpha, as saved images are
+uint32_t StraightAlphaColor(const uint32_t color)
+{
+    const auto alpha = color >> 24;
+    if (alpha == 0 || alpha == 255)
+        return color;
+
+    auto straight_color = alpha << 24;
+    for (auto shift = 0; shift < 24; shift += 8)
+        straight_color |= std::min(255u, ((color >> shift) & 0xff) * 255 / alpha) << shift;
+
+    return straight_color;
+}
+
 Renderer::Renderer()
 {
     const auto stylesheet_path = std::string("renderer/openstreetmap-carto/mapnik.xml");
@@ -22,41 +119,127 @@ Renderer::Renderer()
     image_ = mapnik::image_rgba8 {kTileSize, kTileSize};
 }
 
-void Renderer::RenderTile(const projection::Epsg3857Rect&& epsg_3857_rect, const unsigned int image_index)
+void Renderer::RenderTile(const projection::Epsg3857Rect&& epsg_3857_rect, const unsigned int image_index, const uint64_t task_id,
+                          TileContent& tile_content)
 {
     const auto box = mapnik::box2d<double>(epsg_3857_rect.bottom_left_point.x, epsg_3857_rect.bottom_left_point.y, epsg_3857_rect.top_right_point.x, epsg_3857_rect.top_right_point.y);
     map_.zoom_to_box(box);
 
-    auto renderer = mapnik::agg_renderer<mapnik::image_rgba8>(map_, image_);
-    renderer.apply();
+    {
+        const auto apply_span = trace::Span("Render tile", task_id);
+        auto renderer = mapnik::agg_renderer<mapnik::image_rgba8>(map_, image_);
+        renderer.apply();
+    }
 
+    // Open sea and empty land are one color, such tiles skip hashing, encoding and file
+    tile_content.is_uniform = IsUniformImage(image_, tile_content.color);
+    if (tile_content.is_uniform)
+    {
+        if (image_.get_premultiplied())
+            tile_content.color = StraightAlphaColor(tile_content.color);
+
+        tile_content.hash = 0;
+        return;
+    }
+
+    tile_content.hash = ImageContentHash(image_);
+
+    // Image is passed to the application through file
+    const auto save_span = trace::Span("Save image", task_id);
     mapnik::save_to_file(image_, QString("renderer/renderer_process%1_output.png").arg(image_index).toStdString(), "png");
 }
 
+bool Renderer::RenderRaw(const projection::Epsg3857Rect&& epsg_3857_rect, const unsigned int width, const unsigned int height,
+                         const std::string& path, const uint64_t task_id)
+{
+    if (map_.width() != width || map_.height() != height)
+    {
+        map_.resize(width, height);
+        image_ = mapnik::image_rgba8 {static_cast<int>(width), static_cast<int>(height)};
+    }
+
+    const auto box = mapnik::box2d<double>(epsg_3857_rect.bottom_left_point.x, epsg_3857_rect.bottom_left_point.y, epsg_3857_rect.top_right_point.x, epsg_3857_rect.top_right_point.y);
+    map_.zoom_to_box(box);
+
+    {
+        const auto apply_span = trace::Span("Render chunk", task_id);
+        auto renderer = mapnik::agg_renderer<mapnik::image_rgba8>(map_, image_);
+        renderer.apply();
+    }
+
+    mapnik::demultiply_alpha(image_);
+
+    const auto save_span = trace::Span("Save chunk", task_id);
+    auto file = std::ofstream(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(image_.data()), image_.size());
+    if (!file)
+    {
+        std::cerr << "Renderer::RenderRaw Failed to write " << path << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
 /* This code intended to run as a separate process managed
-by RendererProcessesManager class from main application */
+by RendererProcessesManager class from main application, or by map exporter
+when the second argument gives the file for raw chunk images */
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
 
     const auto process_index = QApplication::arguments()[1].toUInt();
 
+    // Environment is inherited from the application, so tracing is enabled in both
+    trace::Initialize(QString("Renderer %1").arg(process_index).toStdString(), false);
+    trace::SetThreadName("Renderer");
+
     auto renderer = Renderer();
     double left, bottom, right, top;
     unsigned int x_index, y_index, zoom;
+    uint64_t task_id;
+    auto tile_content = Renderer::TileContent();
+
+    // Export tasks carry image size after task id and are answered with success flag
+    if (QApplication::arguments().size() > 2)
+    {
+        const auto raw_path = QApplication::arguments()[2].toStdString();
+        unsigned int width, height;
+
+        for (; std::cin >> left >> bottom >> right >> top;)
+        {
+            std::cin >> x_index >> y_index;
+            std::cin >> zoom;
+            std::cin >> task_id;
+            std::cin >> width >> height;
+
+            const auto is_rendered = renderer.RenderRaw(projection::Epsg3857Rect(left, bottom, right, top), width, height, raw_path, task_id);
+
+            std::cout << x_index << " " << y_index << " " << zoom << " " << task_id << " " << is_rendered << std::endl;
+
+            trace::Flush();
+        }
+
+        return 0;
+    }
 
     for (;;)
     {
         std::cin >> left >> bottom >> right >> top;
         std::cin >> x_index >> y_index;
         std::cin >> zoom;
+        std::cin >> task_id;
 
-        renderer.RenderTile(projection::Epsg3857Rect(left, bottom, right, top), process_index);
+        renderer.RenderTile(projection::Epsg3857Rect(left, bottom, right, top), process_index, task_id, tile_content);
 
         /* Attention! QProcess::readyReadStandardOutput signal emitted every
         time data written in cout. So to avoid multiple signals after finishing
         rendering use endl only in the end of data output */
-        std::cout << x_index << " " << y_index << " " << zoom << std::endl;
+        std::cout << x_index << " " << y_index << " " << zoom << " " << task_id << " "
+                  << tile_content.hash << " " << tile_content.is_uniform << " " << tile_content.color << std::endl;
+
+        // Done after reply, so writing spans does not delay the tile
+        trace::Flush();
     }
 
     return a.exec();
@@ -9,9 +9,25 @@
 class Renderer
 {
 public:
+    //! What application needs to know about rendered image besides the image itself
+    struct TileContent
+    {
+        //! Equal for pixel identical images, not computed for uniform ones
+        uint64_t hash = 0;
+        //! Uniform image is not saved, it is described by its color
+        bool is_uniform = false;
+        //! Non premultiplied RGBA, red in the lowest byte
+        uint32_t color = 0;
+    };
+
     Renderer();
 
-    void RenderTile(const projection::Epsg3857Rect&& epsg_3857_rect, const unsigned int image_index);
+    void RenderTile(const projection::Epsg3857Rect&& epsg_3857_rect, const unsigned int image_index, const uint64_t task_id,
+                    TileContent& tile_content);
+    /* Renders rect into image of given size and writes its pixels to file as
+    rows of non premultiplied RGBA, red first, without encoding */
+    bool RenderRaw(const projection::Epsg3857Rect&& epsg_3857_rect, const unsigned int width, const unsigned int height,
+                   const std::string& path, const uint64_t task_id);
 
 private:
     mapnik::Map map_;